@@ -3,60 +3,207 @@
  * SPDX-License-Identifier: BSD-3-Clause OR MIT
  */
 
+// Time to spin-wait before a frame deadline when the limiter starts, which is afterwards adapted to how accurately the system wakes up from sleeping
+#define INITIAL_SPIN_TIME_US 2000
+// Lower bound of the adaptive spin-wait time
+#define MIN_SPIN_TIME_US 100
+// Number of most recent frames that statistics are computed over
+#define STATISTICS_FRAME_COUNT 600
+// Frames that are presented within this distance of the target frame interval are counted as on time
+#define ON_TIME_TOLERANCE_US 200
+
 #include <imgui.h>
 #include <reshade.hpp>
+#include <cmath>
 #include <chrono>
 #include <thread>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+using clock_type = std::chrono::high_resolution_clock;
 
 static bool s_enabled = false;
 static uint32_t s_fps_limit = 0;
 static bool s_started = false;
-static uint64_t s_num_frames = 0;
-static std::chrono::high_resolution_clock::time_point s_start_point;
+// Absolute point in time the next frame should be released at
+static clock_type::time_point s_next_frame_point;
+static clock_type::time_point s_last_frame_point;
+
+static HANDLE s_timer = nullptr;
+// Running estimate of how late the thread wakes up after sleeping (mean and variance, in microseconds)
+static double s_sleep_overshoot_mean = 0.0;
+static double s_sleep_overshoot_variance = 0.0;
+static double s_spin_time = INITIAL_SPIN_TIME_US;
+
+// Ring buffer of the most recent frame intervals (in milliseconds) and how far past their deadline frames were released (in microseconds)
+static float s_frame_intervals[STATISTICS_FRAME_COUNT] = {};
+static float s_frame_lateness[STATISTICS_FRAME_COUNT] = {};
+static uint32_t s_frame_index = 0;
+static uint32_t s_frame_count = 0;
+
+static void reset_statistics()
+{
+	s_frame_index = 0;
+	s_frame_count = 0;
+}
+
+/// <summary>
+/// Sleeps for the specified amount of time, using a high resolution waitable timer if the system supports it.
+/// </summary>
+static void sleep_for(clock_type::duration duration)
+{
+	if (s_timer == nullptr)
+	{
+		// High resolution timers are only available since Windows 10 version 1803, so fall back to a regular timer (which has the granularity of the system timer)
+		s_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (s_timer == nullptr)
+			s_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+	}
+
+	// Due time is relative when negative and in 100 nanosecond units
+	LARGE_INTEGER due_time;
+	due_time.QuadPart = -std::chrono::duration_cast<std::chrono::duration<LONGLONG, std::ratio<1, 10000000>>>(duration).count();
+
+	if (s_timer == nullptr || due_time.QuadPart >= 0 || !SetWaitableTimer(s_timer, &due_time, 0, nullptr, nullptr, FALSE))
+	{
+		std::this_thread::sleep_for(duration);
+		return;
+	}
+
+	WaitForSingleObject(s_timer, INFINITE);
+}
+
+/// <summary>
+/// Waits until the specified absolute point in time, by sleeping for most of the time and spinning for the remainder.
+/// The spin-wait time is adjusted based on how much each sleep overshoots, so that the deadline is hit precisely without burning more processor time than necessary.
+/// </summary>
+static void wait_until(clock_type::time_point deadline, clock_type::duration time_per_frame)
+{
+	const auto spin_time = std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double, std::micro>(s_spin_time));
+
+	const auto sleep_start = clock_type::now();
+	if (deadline - sleep_start > spin_time)
+	{
+		const auto sleep_end = deadline - spin_time;
+		sleep_for(sleep_end - sleep_start);
+
+		// Keep an exponentially weighted estimate of the overshoot and its variance to derive the spin time from
+		const double overshoot = std::chrono::duration<double, std::micro>(clock_type::now() - sleep_end).count();
+		const double delta = overshoot - s_sleep_overshoot_mean;
+		s_sleep_overshoot_mean += delta / 16.0;
+		s_sleep_overshoot_variance += (delta * delta - s_sleep_overshoot_variance) / 16.0;
+
+		// Cover the overshoot of almost all sleeps, but never spin for longer than a frame
+		s_spin_time = std::clamp(
+			s_sleep_overshoot_mean + 4.0 * std::sqrt(s_sleep_overshoot_variance),
+			static_cast<double>(MIN_SPIN_TIME_US),
+			std::chrono::duration<double, std::micro>(time_per_frame).count());
+	}
+
+	while (clock_type::now() < deadline)
+		YieldProcessor();
+}
 
 static void on_present(reshade::api::command_queue *, reshade::api::swapchain *, const reshade::api::rect *, const reshade::api::rect *, uint32_t, const reshade::api::rect *)
 {
 	if (!s_enabled || s_fps_limit == 0)
 		return;
 
-	if (!s_started)
+	const auto time_per_frame = clock_type::duration(std::chrono::seconds(1)) / s_fps_limit;
+
+	const auto now = clock_type::now();
+
+	// Restart scheduling when the application fell behind by more than a frame (e.g. during a loading screen), instead of trying to catch up with a burst of frames
+	if (!s_started || now > s_next_frame_point + time_per_frame || s_next_frame_point - now > time_per_frame)
 	{
 		s_started = true;
-		s_num_frames = 0;
-		s_start_point = std::chrono::high_resolution_clock::now();
+		s_next_frame_point = now + time_per_frame;
+		s_last_frame_point = now;
+		return;
+	}
+
+	wait_until(s_next_frame_point, time_per_frame);
+
+	const auto frame_point = clock_type::now();
+
+	s_frame_intervals[s_frame_index] = std::chrono::duration<float, std::milli>(frame_point - s_last_frame_point).count();
+	s_frame_lateness[s_frame_index] = std::chrono::duration<float, std::micro>(frame_point - s_next_frame_point).count();
+	s_frame_index = (s_frame_index + 1) % STATISTICS_FRAME_COUNT;
+	s_frame_count = std::min(s_frame_count + 1, static_cast<uint32_t>(STATISTICS_FRAME_COUNT));
+
+	// Schedule based on absolute deadlines, so that errors do not accumulate from frame to frame
+	s_next_frame_point += time_per_frame;
+	s_last_frame_point = frame_point;
+}
+
+static void draw_statistics()
+{
+	if (s_frame_count == 0)
+	{
+		ImGui::TextUnformatted("No frames were limited yet.");
+		return;
 	}
 
-	const auto time_per_frame = std::chrono::high_resolution_clock::duration(std::chrono::seconds(1)) / s_fps_limit;
+	const float target_interval = 1000.0f / s_fps_limit;
 
-	const auto cur_frame_point = s_start_point + s_num_frames++ * time_per_frame;
-	const auto next_frame_point = cur_frame_point + time_per_frame;
+	float min_interval = std::numeric_limits<float>::max(), max_interval = 0.0f;
+	double sum = 0.0, sum_squares = 0.0;
+	uint32_t on_time_count = 0;
+	std::vector<float> deviations(s_frame_count);
 
-	while (true)
+	for (uint32_t i = 0; i < s_frame_count; ++i)
 	{
-		const auto now = std::chrono::high_resolution_clock::now();
-		if (now < cur_frame_point || now > next_frame_point)
-		{
-			s_started = false;
-			break;
-		}
-
-		const auto time_remaining = (next_frame_point - now);
-		if (time_remaining <= std::chrono::milliseconds(1))
-		{
-			break;
-		}
-
-		std::this_thread::sleep_for(time_remaining - std::chrono::milliseconds(1));
+		const float interval = s_frame_intervals[i];
+
+		min_interval = std::min(min_interval, interval);
+		max_interval = std::max(max_interval, interval);
+		sum += interval;
+		sum_squares += static_cast<double>(interval) * interval;
+
+		deviations[i] = std::abs(interval - target_interval) * 1000.0f;
+		if (deviations[i] <= ON_TIME_TOLERANCE_US)
+			on_time_count++;
 	}
+
+	const double mean = sum / s_frame_count;
+	const double std_dev = std::sqrt(std::max(0.0, sum_squares / s_frame_count - mean * mean));
+
+	const auto percentile_99 = deviations.begin() + (deviations.size() * 99) / 100;
+	std::nth_element(deviations.begin(), percentile_99, deviations.end());
+
+	ImGui::Text("Frame interval: %.3f ms mean (target %.3f ms), %.3f ms min, %.3f ms max", mean, target_interval, min_interval, max_interval);
+	ImGui::Text("Jitter: %.1f us standard deviation, %.1f us 99th percentile deviation from target", std_dev * 1000.0, *percentile_99);
+	ImGui::Text("On time (within %d us): %.2f %% of the last %u frames", ON_TIME_TOLERANCE_US, 100.0 * on_time_count / s_frame_count, s_frame_count);
+	ImGui::Text("Last frame released %.1f us after its deadline", s_frame_lateness[(s_frame_index + STATISTICS_FRAME_COUNT - 1) % STATISTICS_FRAME_COUNT]);
+	ImGui::Text("Sleep overshoot: %.1f us mean, spinning for the last %.1f us before each deadline", s_sleep_overshoot_mean, s_spin_time);
+
+	ImGui::PlotLines("##intervals", s_frame_intervals, static_cast<int>(s_frame_count), s_frame_count == STATISTICS_FRAME_COUNT ? static_cast<int>(s_frame_index) : 0, nullptr, target_interval - 1.0f, target_interval + 1.0f, ImVec2(0, 60));
+
+	if (ImGui::Button("Reset statistics"))
+		reset_statistics();
 }
 
 static void draw_settings(reshade::api::effect_runtime *)
 {
 	if (ImGui::Checkbox("Enabled", &s_enabled))
+	{
 		s_started = false;
+		reset_statistics();
+	}
 
 	if (ImGui::DragInt("Target FPS", reinterpret_cast<int *>(&s_fps_limit), 1, 0, 200))
+	{
 		s_enabled = s_started = false;
+		reset_statistics();
+	}
+
+	if (s_enabled && s_fps_limit != 0 && ImGui::CollapsingHeader("Statistics", ImGuiTreeNodeFlags_DefaultOpen))
+		draw_statistics();
 }
 
 extern "C" __declspec(dllexport) const char *NAME = "Framerate Limiter";
@@ -74,6 +221,8 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 		break;
 	case DLL_PROCESS_DETACH:
 		reshade::unregister_addon(hModule);
+		if (s_timer != nullptr)
+			CloseHandle(s_timer);
 		break;
 	}
 
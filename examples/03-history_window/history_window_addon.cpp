@@ -6,48 +6,264 @@
 
 #include <imgui.h>
 #include <reshade.hpp>
+#include <cfloat>
+#include <cassert>
+#include <cstring>
+#include <limits>
 #include <vector>
 #include <string>
-#include <list>
 #include <algorithm>
+#include <unordered_map>
+
+// Maximum number of changes that are kept, after which the oldest ones are discarded
+constexpr size_t HISTORY_LIMIT = 4096;
+// Maximum number of uniform value components that are kept (each change holds the components before and after it), after which the oldest changes are discarded
+constexpr size_t HISTORY_VALUE_LIMIT = 64 * 1024;
+// Maximum number of components of a uniform value that are tracked
+constexpr uint32_t MAX_VALUE_COUNT = 16;
+
+/// <summary>
+/// Description of a uniform variable or technique that changes were recorded for.
+/// This is queried once when the first change to it is recorded, so that drawing the history does not have to query it again.
+/// </summary>
+struct history_object
+{
+	uint64_t handle = 0;
+	std::string name;
+
+	reshade::api::format basetype = reshade::api::format::unknown;
+	uint32_t rows = 0;
+	bool is_color = false;
+	bool is_combo = false;
+	// Number of decimal places to display floating-point values with, based on the "ui_step" annotation
+	int precision = 0;
+	// Items of a combo box, based on the "ui_items" annotation
+	std::vector<std::string> items;
+};
 
-constexpr size_t HISTORY_LIMIT = 1000;
-
-struct history
+struct history_entry
 {
-	enum class kind
+	enum class kind : uint8_t
 	{
 		uniform_value = 0,
 		technique_state
 	};
 
-	union uniform_value
+	kind kind = kind::uniform_value;
+	bool technique_enabled = false;
+	uint16_t value_count = 0;
+	// Index of the changed uniform variable or technique in the list of objects
+	uint32_t object_index = 0;
+	// Position of the components before the change in the value ring buffer (which are followed by the components after the change)
+	uint32_t value_offset = 0;
+};
+
+/// <summary>
+/// Fixed-capacity ring buffer of changes, with the uniform value components of all changes stored in a second ring buffer.
+/// When either is full, the oldest changes are discarded to make room, so memory usage is capped regardless of how many changes are made.
+/// </summary>
+class history_buffer
+{
+public:
+	size_t size() const { return _count; }
+	bool empty() const { return _count == 0; }
+
+	/// <summary>
+	/// Gets the change at the specified position, where position zero is the most recent change.
+	/// </summary>
+	const history_entry &operator[](size_t pos) const
 	{
-		bool as_bool;
-		float as_float[16];
-		int32_t as_int[16];
-		uint32_t as_uint[16];
-	};
+		assert(pos < _count);
+		return _entries[(_first + _count - 1 - pos) % HISTORY_LIMIT];
+	}
 
-	kind kind = kind::uniform_value;
+	void clear()
+	{
+		_first = 0;
+		_count = 0;
+		_first_value = 0;
+		_value_count = 0;
+	}
 
-	reshade::api::effect_technique technique_handle = { 0 };
-	std::string technique_name;
-	bool technique_enabled = false;
+	void push(history_entry entry, const uint32_t *before, const uint32_t *after)
+	{
+		// Allocate storage the first time a change is recorded, so that it is not wasted on effect runtimes that are never changed
+		if (_entries.empty())
+		{
+			_entries.resize(HISTORY_LIMIT);
+			_values.resize(HISTORY_VALUE_LIMIT);
+		}
 
-	reshade::api::effect_uniform_variable variable_handle = { 0 };
-	reshade::api::format variable_basetype = reshade::api::format::unknown;
-	uniform_value before = {}, after = {};
-	bool confirmed = false;
+		const size_t num_values = 2 * static_cast<size_t>(entry.value_count);
+
+		while (!empty() && (_count == HISTORY_LIMIT || _value_count + num_values > HISTORY_VALUE_LIMIT))
+			pop_oldest();
+
+		entry.value_offset = static_cast<uint32_t>((_first_value + _value_count) % HISTORY_VALUE_LIMIT);
+		_value_count += num_values;
+
+		_entries[(_first + _count++) % HISTORY_LIMIT] = entry;
+
+		write_values(entry, false, before);
+		write_values(entry, true, after);
+	}
+	void pop_newest()
+	{
+		assert(!empty());
+
+		_value_count -= 2 * static_cast<size_t>((*this)[0].value_count);
+		_count--;
+	}
+	void pop_oldest()
+	{
+		assert(!empty());
+
+		const size_t num_values = 2 * static_cast<size_t>(_entries[_first].value_count);
+		_first_value = (_first_value + num_values) % HISTORY_VALUE_LIMIT;
+		_value_count -= num_values;
+
+		_first = (_first + 1) % HISTORY_LIMIT;
+		_count--;
+	}
+
+	void read_values(const history_entry &entry, bool after, uint32_t *values) const
+	{
+		const size_t offset = entry.value_offset + (after ? entry.value_count : 0);
+		for (size_t i = 0; i < entry.value_count; ++i)
+			values[i] = _values[(offset + i) % HISTORY_VALUE_LIMIT];
+	}
+	void write_values(const history_entry &entry, bool after, const uint32_t *values)
+	{
+		const size_t offset = entry.value_offset + (after ? entry.value_count : 0);
+		for (size_t i = 0; i < entry.value_count; ++i)
+			_values[(offset + i) % HISTORY_VALUE_LIMIT] = values[i];
+	}
+
+private:
+	std::vector<history_entry> _entries;
+	size_t _first = 0;
+	size_t _count = 0;
+	std::vector<uint32_t> _values;
+	size_t _first_value = 0;
+	size_t _value_count = 0;
 };
 
 struct __declspec(uuid("ee32daa4-6b5c-47e6-9409-f87cca0e5797")) history_context
 {
 	bool was_updated = false;
+	// Number of most recent changes that were undone
 	size_t history_pos = 0;
-	std::list<history> histories;
+	history_buffer histories;
+
+	std::vector<history_object> objects;
+	// Maps uniform variable and technique handles to their index in the list of objects (or 'UINT32_MAX' for uniform variables that are not tracked)
+	std::unordered_map<uint64_t, uint32_t> object_indices;
+
+	void clear()
+	{
+		was_updated = false;
+		history_pos = 0;
+		histories.clear();
+		objects.clear();
+		object_indices.clear();
+	}
+
+	/// <summary>
+	/// Discards all changes that were undone, since they cannot be redone anymore once a new change is made.
+	/// </summary>
+	void discard_undone()
+	{
+		for (; history_pos > 0; --history_pos)
+			histories.pop_newest();
+	}
 };
 
+template <typename F>
+static std::string query_string(F &&query)
+{
+	size_t size = 0;
+	query(nullptr, &size);
+
+	std::string value(size, '\0');
+	if (size != 0)
+	{
+		query(value.data(), &size);
+		value.resize(size);
+	}
+
+	return value;
+}
+
+static uint32_t find_or_add_uniform_variable(reshade::api::effect_runtime *runtime, history_context &ctx, reshade::api::effect_uniform_variable variable)
+{
+	if (const auto it = ctx.object_indices.find(variable.handle); it != ctx.object_indices.end())
+		return it->second;
+
+	// Only track variables that are exposed in the overlay
+	const std::string ui_type = query_string([&](char *value, size_t *size) {
+		if (!runtime->get_annotation_string_from_uniform_variable(variable, "ui_type", value, size))
+			*size = 0;
+	});
+	if (ui_type.empty())
+	{
+		ctx.object_indices.emplace(variable.handle, std::numeric_limits<uint32_t>::max());
+		return std::numeric_limits<uint32_t>::max();
+	}
+
+	history_object &object = ctx.objects.emplace_back();
+	object.handle = variable.handle;
+	object.name = query_string([&](char *value, size_t *size) { runtime->get_uniform_variable_name(variable, value, size); });
+	runtime->get_uniform_variable_type(variable, &object.basetype, &object.rows);
+	object.is_color = ui_type == "color";
+	object.is_combo = ui_type == "combo";
+
+	if (object.basetype == reshade::api::format::r32_float)
+	{
+		float ui_stp_val = 0.0f;
+		runtime->get_annotation_float_from_uniform_variable(variable, "ui_step", &ui_stp_val, 1);
+		if (FLT_EPSILON > ui_stp_val)
+			ui_stp_val = 0.001f;
+
+		// Calculate display precision based on step value
+		for (float x = 1.0f; x * ui_stp_val < 1.0f && object.precision < 9; x *= 10.0f)
+			++object.precision;
+	}
+
+	if (object.is_combo && object.basetype != reshade::api::format::r32_typeless)
+	{
+		const std::string ui_items = query_string([&](char *value, size_t *size) {
+			if (!runtime->get_annotation_string_from_uniform_variable(variable, "ui_items", value, size))
+				*size = 0;
+		});
+
+		// Items are separated by null characters
+		for (size_t offset = 0, next; offset < ui_items.size(); offset = next + 1)
+		{
+			next = ui_items.find('\0', offset);
+			if (next == std::string::npos)
+				next = ui_items.size();
+			object.items.emplace_back(ui_items, offset, next - offset);
+		}
+	}
+
+	const uint32_t index = static_cast<uint32_t>(ctx.objects.size() - 1);
+	ctx.object_indices.emplace(variable.handle, index);
+	return index;
+}
+static uint32_t find_or_add_technique(reshade::api::effect_runtime *runtime, history_context &ctx, reshade::api::effect_technique technique)
+{
+	if (const auto it = ctx.object_indices.find(technique.handle); it != ctx.object_indices.end())
+		return it->second;
+
+	history_object &object = ctx.objects.emplace_back();
+	object.handle = technique.handle;
+	object.name = query_string([&](char *value, size_t *size) { runtime->get_technique_name(technique, value, size); });
+
+	const uint32_t index = static_cast<uint32_t>(ctx.objects.size() - 1);
+	ctx.object_indices.emplace(technique.handle, index);
+	return index;
+}
+
 static void on_init(reshade::api::effect_runtime *runtime)
 {
 	runtime->create_private_data<history_context>();
@@ -61,60 +277,68 @@ static bool on_set_uniform_value(reshade::api::effect_runtime *runtime, reshade:
 {
 	history_context &ctx = runtime->get_private_data<history_context>();
 
-	char ui_type[16];
-	if (!runtime->get_annotation_string_from_uniform_variable(variable, "ui_type", ui_type))
+	const uint32_t object_index = find_or_add_uniform_variable(runtime, ctx, variable);
+	if (object_index == std::numeric_limits<uint32_t>::max())
 		return false;
 
-	reshade::api::format basetype;
-	runtime->get_uniform_variable_type(variable, &basetype);
+	const history_object &object = ctx.objects[object_index];
+
+	const uint32_t value_count = static_cast<uint32_t>(std::min(new_value_size / 4, static_cast<size_t>(MAX_VALUE_COUNT)));
 
-	history::uniform_value before = {}, after = {};
+	uint32_t before[MAX_VALUE_COUNT] = {}, after[MAX_VALUE_COUNT] = {};
 
-	switch (basetype)
+	switch (object.basetype)
 	{
 	case reshade::api::format::r32_typeless:
-		runtime->get_uniform_value_bool(variable, &before.as_bool, 1);
+	{
+		bool before_bool[MAX_VALUE_COUNT];
+		runtime->get_uniform_value_bool(variable, before_bool, value_count);
+		for (uint32_t i = 0; i < value_count; ++i)
+			before[i] = before_bool[i] ? 1 : 0;
 		break;
+	}
 	case reshade::api::format::r32_float:
-		runtime->get_uniform_value_float(variable, before.as_float, 16);
+		runtime->get_uniform_value_float(variable, reinterpret_cast<float *>(before), value_count);
 		break;
 	case reshade::api::format::r32_sint:
-		runtime->get_uniform_value_int(variable, before.as_int, 16);
+		runtime->get_uniform_value_int(variable, reinterpret_cast<int32_t *>(before), value_count);
 		break;
 	case reshade::api::format::r32_uint:
-		runtime->get_uniform_value_uint(variable, before.as_uint, 16);
+		runtime->get_uniform_value_uint(variable, before, value_count);
 		break;
 	}
 
-	std::memcpy(after.as_uint, new_value, std::min(new_value_size, size_t(4 * 16)));
+	std::memcpy(after, new_value, value_count * sizeof(uint32_t));
+
+	if (object.basetype == reshade::api::format::r32_typeless)
+		for (uint32_t i = 0; i < value_count; ++i)
+			after[i] = after[i] != 0 ? 1 : 0;
+
+	if (std::memcmp(before, after, value_count * sizeof(uint32_t)) == 0)
+		return false;
+
+	ctx.discard_undone();
 
-	if (std::memcmp(&before, &after, sizeof(after)) != 0)
+	// Merge consecutive changes to the same variable (e.g. while dragging a slider) into a single one, which keeps the value from before the first change
+	if (!ctx.histories.empty())
 	{
-		history history;
-		history.kind = history::kind::uniform_value;
-		history.variable_handle = variable;
-		history.variable_basetype = basetype;
-		history.before = before;
-		history.after = after;
-
-		while (ctx.history_pos > 0)
-		{
-			ctx.histories.pop_front();
-			--ctx.history_pos;
-		}
+		const history_entry &latest = ctx.histories[0];
 
-		if (auto front = ctx.histories.begin(); front != ctx.histories.end() && front->variable_handle.handle == variable.handle)
+		if (latest.kind == history_entry::kind::uniform_value && latest.object_index == object_index && latest.value_count == value_count)
 		{
-			std::memcpy(&history.before, &front->before, sizeof(history.before));
-			ctx.histories.pop_front();
+			ctx.histories.write_values(latest, true, after);
+			ctx.was_updated = true;
+			return false;
 		}
+	}
 
-		if (ctx.histories.size() < HISTORY_LIMIT)
-			ctx.histories.push_front(std::move(history));
+	history_entry entry;
+	entry.kind = history_entry::kind::uniform_value;
+	entry.value_count = static_cast<uint16_t>(value_count);
+	entry.object_index = object_index;
 
-		ctx.history_pos = 0;
-		ctx.was_updated = true;
-	}
+	ctx.histories.push(entry, before, after);
+	ctx.was_updated = true;
 
 	return false;
 }
@@ -127,35 +351,29 @@ static bool on_set_technique_state(reshade::api::effect_runtime *runtime, reshad
 
 	history_context &ctx = runtime->get_private_data<history_context>();
 
-	char technique_name[128] = "";
-	runtime->get_technique_name(technique, technique_name);
+	const uint32_t object_index = find_or_add_technique(runtime, ctx, technique);
 
-	if (const auto it = std::next(ctx.histories.begin(), ctx.history_pos);
-		it == ctx.histories.end() ||
-		it->kind != history::kind::technique_state ||
-		it->technique_name != technique_name ||
-		enabled == it->technique_enabled)
+	// Toggling a technique back is the same as undoing the change that toggled it
+	if (ctx.history_pos < ctx.histories.size())
 	{
-		history history;
-		history.kind = history::kind::technique_state;
-		history.technique_handle = technique;
-		history.technique_name = technique_name;
-		history.technique_enabled = enabled;
+		const history_entry &current = ctx.histories[ctx.history_pos];
 
-		while (ctx.history_pos > 0)
+		if (current.kind == history_entry::kind::technique_state && current.object_index == object_index && current.technique_enabled != enabled)
 		{
-			ctx.histories.pop_front();
-			--ctx.history_pos;
+			ctx.history_pos++;
+			return false;
 		}
-
-		if (ctx.histories.size() < HISTORY_LIMIT)
-			ctx.histories.push_front(std::move(history));
-	}
-	else
-	{
-		ctx.history_pos++;
 	}
 
+	ctx.discard_undone();
+
+	history_entry entry;
+	entry.kind = history_entry::kind::technique_state;
+	entry.technique_enabled = enabled;
+	entry.object_index = object_index;
+
+	ctx.histories.push(entry, nullptr, nullptr);
+
 	return false;
 }
 
@@ -163,203 +381,186 @@ static void on_set_current_preset_path(reshade::api::effect_runtime *runtime, co
 {
 	history_context &ctx = runtime->get_private_data<history_context>();
 
-	ctx.histories.clear();
-	ctx.history_pos = 0;
-	ctx.was_updated = false;
+	ctx.clear();
 }
-
-static void draw_history_window(reshade::api::effect_runtime *runtime)
+static void on_reloaded_effects(reshade::api::effect_runtime *runtime)
 {
-	size_t current_pos = std::numeric_limits<size_t>::max();
-	size_t selected_pos = std::numeric_limits<size_t>::max();
-
 	history_context &ctx = runtime->get_private_data<history_context>();
 
-	if (ImGui::Selectable("End of Undo", ctx.history_pos == ctx.histories.size()))
-		selected_pos = ctx.histories.size();
-
-	if (ctx.histories.empty())
-		return;
+	// Uniform variable and technique handles are no longer valid after a reload, so cannot keep the cached objects or the history referencing them
+	ctx.clear();
+}
 
-	current_pos = ctx.histories.size() - 1;
-	bool modified = false;
+static void apply_history_entry(reshade::api::effect_runtime *runtime, const history_context &ctx, const history_entry &entry, bool redo)
+{
+	const history_object &object = ctx.objects[entry.object_index];
 
-	for (auto it = ctx.histories.rbegin(); it != ctx.histories.rend(); --current_pos, ++it)
+	switch (entry.kind)
+	{
+	case history_entry::kind::uniform_value:
 	{
-		std::string label;
+		uint32_t values[MAX_VALUE_COUNT];
+		ctx.histories.read_values(entry, redo, values);
+
+		const reshade::api::effect_uniform_variable variable = { object.handle };
 
-		switch (it->kind)
+		switch (object.basetype)
 		{
-			case history::kind::uniform_value:
-			{
-				char ui_type[16] = "";
-				runtime->get_annotation_string_from_uniform_variable(it->variable_handle, "ui_type", ui_type);
+		case reshade::api::format::r32_typeless:
+		{
+			bool values_bool[MAX_VALUE_COUNT];
+			for (uint32_t i = 0; i < entry.value_count; ++i)
+				values_bool[i] = values[i] != 0;
+			runtime->set_uniform_value_bool(variable, values_bool, entry.value_count);
+			break;
+		}
+		case reshade::api::format::r32_float:
+			runtime->set_uniform_value_float(variable, reinterpret_cast<const float *>(values), entry.value_count);
+			break;
+		case reshade::api::format::r32_sint:
+			runtime->set_uniform_value_int(variable, reinterpret_cast<const int32_t *>(values), entry.value_count);
+			break;
+		case reshade::api::format::r32_uint:
+			runtime->set_uniform_value_uint(variable, values, entry.value_count);
+			break;
+		}
+		break;
+	}
+	case history_entry::kind::technique_state:
+		runtime->set_technique_state({ object.handle }, redo ? entry.technique_enabled : !entry.technique_enabled);
+		break;
+	}
+}
+
+static void format_history_entry(const history_context &ctx, const history_entry &entry, std::string &label)
+{
+	const history_object &object = ctx.objects[entry.object_index];
 
-				char variable_name[128] = "";
-				runtime->get_uniform_variable_name(it->variable_handle, variable_name);
+	label = object.name;
 
-				label += variable_name;
+	switch (entry.kind)
+	{
+	case history_entry::kind::uniform_value:
+	{
+		uint32_t before_values[MAX_VALUE_COUNT], after_values[MAX_VALUE_COUNT];
+		ctx.histories.read_values(entry, false, before_values);
+		ctx.histories.read_values(entry, true, after_values);
 
-				reshade::api::format basetype; unsigned int rows;
-				runtime->get_uniform_variable_type(it->variable_handle, &basetype, &rows);
+		const auto before_float = reinterpret_cast<const float *>(before_values), after_float = reinterpret_cast<const float *>(after_values);
+		const auto before_int = reinterpret_cast<const int32_t *>(before_values), after_int = reinterpret_cast<const int32_t *>(after_values);
 
-				for (unsigned int i = 0; i < rows; ++i)
+		for (uint32_t i = 0; i < std::min(object.rows, static_cast<uint32_t>(entry.value_count)); ++i)
+		{
+			char value[80] = "";
+
+			if (object.basetype == reshade::api::format::r32_typeless)
+			{
+				if (object.is_combo)
 				{
-					char value[80] = "";
-
-					if (basetype == reshade::api::format::r32_typeless)
-					{
-						if (strcmp(ui_type, "combo") == 0)
-						{
-							label += it->after.as_bool ? " On" : " Off";
-						}
-						else
-						{
-							label += it->after.as_bool ? " True" : " False";
-						}
-					}
-					else if (basetype == reshade::api::format::r32_float)
-					{
-						if (strcmp(ui_type, "color") == 0)
-						{
-							sprintf_s(value, " %c %+0.0f (%0.0f)", "RGBA"[i], (it->after.as_float[i] - it->before.as_float[i]) / (1.0f / 255.0f), it->after.as_float[i] / (1.0f / 255.0f));
-						}
-						else
-						{
-							float ui_stp_val = 0.0f;
-							runtime->get_annotation_float_from_uniform_variable(it->variable_handle, "ui_step", &ui_stp_val, 1);
-							if (FLT_EPSILON > ui_stp_val)
-								ui_stp_val = 0.001f;
-
-							// Calculate display precision based on step value
-							int precision = 0;
-							for (float x = 1.0f; x * ui_stp_val < 1.0f && precision < 9; x *= 10.0f)
-								++precision;
-
-							sprintf_s(value, " %c %+0.*f (%0.*f)", "XYZW"[i], precision, it->after.as_float[i] - it->before.as_float[i], precision, it->after.as_float[i]);
-						}
-					}
-					else if (basetype == reshade::api::format::r32_sint || basetype == reshade::api::format::r32_uint)
-					{
-						if (strcmp(ui_type, "combo") == 0)
-						{
-							char ui_items[512] = ""; size_t ui_items_len = sizeof(ui_items);
-							runtime->get_annotation_string_from_uniform_variable(it->variable_handle, "ui_items", ui_items, &ui_items_len);
-
-							size_t ui_items_offset = 0;
-							for (uint32_t ui_items_index = 0; ui_items_offset < ui_items_len && ui_items_index != it->after.as_uint[0]; ++ui_items_offset)
-								if (ui_items[ui_items_offset] == '\0')
-									++ui_items_index;
-
-							sprintf_s(value, " %+lld (%s)", static_cast<int64_t>(it->after.as_uint[i]) - static_cast<int64_t>(it->before.as_uint[i]), ui_items + ui_items_offset);
-						}
-						else if (basetype == reshade::api::format::r32_sint)
-						{
-							sprintf_s(value, " %c %+lld (%d)", (strcmp(ui_type, "color") == 0 ? "RGBA" : "XYZW")[i], static_cast<int64_t>(it->after.as_int[i]) - static_cast<int64_t>(it->before.as_int[i]), it->after.as_int[i]);
-						}
-						else
-						{
-							sprintf_s(value, " %c %+lld (%u)", (strcmp(ui_type, "color") == 0 ? "RGBA" : "XYZW")[i], static_cast<int64_t>(it->after.as_uint[i]) - static_cast<int64_t>(it->before.as_uint[i]), it->after.as_uint[i]);
-						}
-					}
-
-					label += value;
+					label += after_values[i] ? " On" : " Off";
+				}
+				else
+				{
+					label += after_values[i] ? " True" : " False";
 				}
-				break;
 			}
-			case history::kind::technique_state:
+			else if (object.basetype == reshade::api::format::r32_float)
 			{
-				label += it->technique_name;
-				label += it->technique_enabled ? " True" : " False";
-				break;
+				if (object.is_color)
+				{
+					sprintf_s(value, " %c %+0.0f (%0.0f)", "RGBA"[i], (after_float[i] - before_float[i]) / (1.0f / 255.0f), after_float[i] / (1.0f / 255.0f));
+				}
+				else
+				{
+					sprintf_s(value, " %c %+0.*f (%0.*f)", "XYZW"[i], object.precision, after_float[i] - before_float[i], object.precision, after_float[i]);
+				}
+			}
+			else if (object.basetype == reshade::api::format::r32_sint || object.basetype == reshade::api::format::r32_uint)
+			{
+				if (object.is_combo)
+				{
+					sprintf_s(value, " %+lld (%s)", static_cast<int64_t>(after_values[i]) - static_cast<int64_t>(before_values[i]), after_values[0] < object.items.size() ? object.items[after_values[0]].c_str() : "");
+				}
+				else if (object.basetype == reshade::api::format::r32_sint)
+				{
+					sprintf_s(value, " %c %+lld (%d)", (object.is_color ? "RGBA" : "XYZW")[i], static_cast<int64_t>(after_int[i]) - static_cast<int64_t>(before_int[i]), after_int[i]);
+				}
+				else
+				{
+					sprintf_s(value, " %c %+lld (%u)", (object.is_color ? "RGBA" : "XYZW")[i], static_cast<int64_t>(after_values[i]) - static_cast<int64_t>(before_values[i]), after_values[i]);
+				}
 			}
+
+			label += value;
 		}
+		break;
+	}
+	case history_entry::kind::technique_state:
+		label += entry.technique_enabled ? " True" : " False";
+		break;
+	}
+}
 
-		label += "##" + std::to_string(current_pos);
+static void draw_history_window(reshade::api::effect_runtime *runtime)
+{
+	size_t selected_pos = std::numeric_limits<size_t>::max();
 
-		if (ImGui::Selectable(label.c_str(), current_pos == ctx.history_pos))
-		{
-			modified = true;
-			selected_pos = current_pos;
-		}
+	history_context &ctx = runtime->get_private_data<history_context>();
 
-		if (ctx.was_updated && current_pos == ctx.history_pos)
-		{
-			ctx.was_updated = false;
-			ImGui::SetScrollHereY();
-		}
-	}
+	if (ImGui::Selectable("End of Undo", ctx.history_pos == ctx.histories.size()))
+		selected_pos = ctx.histories.size();
 
-	if (selected_pos == ctx.history_pos || selected_pos == std::numeric_limits<size_t>::max())
+	if (ctx.histories.empty())
 		return;
 
-	auto it = std::next(ctx.histories.begin(), ctx.history_pos);
-	auto distance = static_cast<ptrdiff_t>(selected_pos) - static_cast<ptrdiff_t>(ctx.history_pos);
+	// Changes are listed from oldest to newest, so row zero is the oldest change (the one at the highest position)
+	const int num_rows = static_cast<int>(ctx.histories.size());
+	const auto pos_to_row = [num_rows](size_t pos) { return num_rows - 1 - static_cast<int>(pos); };
 
-	ctx.history_pos = selected_pos;
+	std::string label;
+
+	// Only format the changes that are visible, so that drawing does not slow down as the history grows
+	ImGuiListClipper clipper;
+	clipper.Begin(num_rows);
+	if (ctx.was_updated && ctx.history_pos < ctx.histories.size())
+		clipper.IncludeRangeByIndices(pos_to_row(ctx.history_pos), pos_to_row(ctx.history_pos) + 1);
 
-	if (distance > 0)
+	while (clipper.Step())
 	{
-		while (distance-- > 0)
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
 		{
-			switch (it->kind)
+			const size_t current_pos = static_cast<size_t>(num_rows - 1 - row);
+
+			format_history_entry(ctx, ctx.histories[current_pos], label);
+			label += "##" + std::to_string(current_pos);
+
+			if (ImGui::Selectable(label.c_str(), current_pos == ctx.history_pos))
+				selected_pos = current_pos;
+
+			if (ctx.was_updated && current_pos == ctx.history_pos)
 			{
-			case history::kind::uniform_value:
-				switch (it->variable_basetype)
-				{
-				case reshade::api::format::r32_typeless:
-					runtime->set_uniform_value_bool(it->variable_handle, &it->before.as_bool, 1);
-					break;
-				case reshade::api::format::r32_float:
-					runtime->set_uniform_value_float(it->variable_handle, it->before.as_float, 16);
-					break;
-				case reshade::api::format::r32_sint:
-					runtime->set_uniform_value_int(it->variable_handle, it->before.as_int, 16);
-					break;
-				case reshade::api::format::r32_uint:
-					runtime->set_uniform_value_uint(it->variable_handle, it->before.as_uint, 16);
-					break;
-				}
-				break;
-			case history::kind::technique_state:
-				runtime->set_technique_state(it->technique_handle, !it->technique_enabled);
-				break;
+				ctx.was_updated = false;
+				ImGui::SetScrollHereY();
 			}
-
-			++it;
 		}
 	}
+
+	if (selected_pos == ctx.history_pos || selected_pos == std::numeric_limits<size_t>::max())
+		return;
+
+	// Each step applies a single change, so the cost only depends on how far the selection is from the current position
+	if (selected_pos > ctx.history_pos)
+	{
+		for (size_t pos = ctx.history_pos; pos < selected_pos; ++pos)
+			apply_history_entry(runtime, ctx, ctx.histories[pos], false);
+	}
 	else
 	{
-		while (distance++ < 0)
-		{
-			--it;
-
-			switch (it->kind)
-			{
-			case history::kind::uniform_value:
-				switch (it->variable_basetype)
-				{
-				case reshade::api::format::r32_typeless:
-					runtime->set_uniform_value_bool(it->variable_handle, &it->after.as_bool, 1);
-					break;
-				case reshade::api::format::r32_float:
-					runtime->set_uniform_value_float(it->variable_handle, it->after.as_float, 16);
-					break;
-				case reshade::api::format::r32_sint:
-					runtime->set_uniform_value_int(it->variable_handle, it->after.as_int, 16);
-					break;
-				case reshade::api::format::r32_uint:
-					runtime->set_uniform_value_uint(it->variable_handle, it->after.as_uint, 16);
-					break;
-				}
-				break;
-			case history::kind::technique_state:
-				runtime->set_technique_state(it->technique_handle, it->technique_enabled);
-				break;
-			}
-		}
+		for (size_t pos = ctx.history_pos; pos-- > selected_pos;)
+			apply_history_entry(runtime, ctx, ctx.histories[pos], true);
 	}
+
+	ctx.history_pos = selected_pos;
 }
 
 extern "C" __declspec(dllexport) const char *NAME = "History Window";
@@ -375,6 +576,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 		reshade::register_event<reshade::addon_event::init_effect_runtime>(on_init);
 		reshade::register_event<reshade::addon_event::destroy_effect_runtime>(on_destroy);
 		reshade::register_event<reshade::addon_event::reshade_set_current_preset_path>(on_set_current_preset_path);
+		reshade::register_event<reshade::addon_event::reshade_reloaded_effects>(on_reloaded_effects);
 		reshade::register_event<reshade::addon_event::reshade_set_uniform_value>(on_set_uniform_value);
 		reshade::register_event<reshade::addon_event::reshade_set_technique_state>(on_set_technique_state);
 		reshade::register_overlay("History", draw_history_window);
@@ -3,343 +3,568 @@
  * SPDX-License-Identifier: BSD-3-Clause OR MIT
  */
 
+// Write captured calls as fixed-size records to a binary trace file next to the executable, instead of formatting each one and writing it to the log
+// Use the 'api_trace_decode' tool to turn such a file into the same text that would otherwise be logged
+#define TRACE_BINARY_FILE 0
+// Number of consecutive frames to capture after pressing the keyboard shortcut
+#define TRACE_FRAME_COUNT 1
+
+// Keep track of all live objects, to validate handles in debug builds and to write the objects that already exist when a capture starts to the trace file (so that it can be replayed)
+#if TRACE_BINARY_FILE || !defined(NDEBUG)
+#define TRACE_TRACK_OBJECTS 1
+#else
+#define TRACE_TRACK_OBJECTS 0
+#endif
+
 #include <reshade.hpp>
+#include "../../source/api_trace_format.hpp"
+#include "../../source/api_trace_replay.hpp"
+#include <atomic>
+#include <vector>
 #include <cassert>
 #include <sstream>
+#include <algorithm>
+#include <mutex>
 #include <shared_mutex>
+#include <unordered_map>
 #include <unordered_set>
+#if TRACE_BINARY_FILE
+#include <deque>
+#include <thread>
+#include <memory>
+#include <fstream>
+#include <filesystem>
+#include <condition_variable>
+#endif
 
 using namespace reshade::api;
+using namespace api_trace;
 
 namespace
 {
-	bool s_do_capture = false;
+	std::atomic<bool> s_do_capture = false;
+	uint32_t s_frames_left = 0;
+
+#if TRACE_TRACK_OBJECTS
+	struct resource_info
+	{
+		resource_desc desc;
+		resource_usage initial_state;
+	};
+	struct resource_view_info
+	{
+		resource resource;
+		resource_usage usage_type;
+		resource_view_desc desc;
+	};
+
 	std::shared_mutex s_mutex;
-	std::unordered_set<uint64_t> s_samplers;
-	std::unordered_set<uint64_t> s_resources;
-	std::unordered_set<uint64_t> s_resource_views;
+	std::unordered_map<uint64_t, sampler_desc> s_samplers;
+	std::unordered_map<uint64_t, resource_info> s_resources;
+	std::unordered_map<uint64_t, resource_view_info> s_resource_views;
 	std::unordered_set<uint64_t> s_pipelines;
+#endif
+
+#if TRACE_BINARY_FILE
+	// Number of records each thread collects before handing them to the writer thread (256 KiB)
+	constexpr size_t RECORDS_PER_BUFFER = 4096;
 
-	inline auto to_string(shader_stage value)
+	/// <summary>
+	/// Writes buffers of trace records to a file on a background thread.
+	/// </summary>
+	class trace_file_writer
 	{
-		switch (value)
+		struct command
 		{
-		case shader_stage::vertex:
-			return "vertex";
-		case shader_stage::hull:
-			return "hull";
-		case shader_stage::domain:
-			return "domain";
-		case shader_stage::geometry:
-			return "geometry";
-		case shader_stage::pixel:
-			return "pixel";
-		case shader_stage::compute:
-			return "compute";
-		case shader_stage::all:
-			return "all";
-		case shader_stage::all_graphics:
-			return "all_graphics";
-		default:
-			return "unknown";
+			enum { open, write, close } type;
+			std::filesystem::path path;
+			std::vector<trace_record> records;
+		};
+
+	public:
+		~trace_file_writer()
+		{
+			// Cannot join here, since this runs during DLL unload with the loader lock held (see 'stop' instead)
+			if (_thread.joinable())
+				_thread.detach();
 		}
-	}
-	inline auto to_string(pipeline_stage value)
-	{
-		switch (value)
+
+		void open(const std::filesystem::path &path)
 		{
-		case pipeline_stage::vertex_shader:
-			return "vertex_shader";
-		case pipeline_stage::hull_shader:
-			return "hull_shader";
-		case pipeline_stage::domain_shader:
-			return "domain_shader";
-		case pipeline_stage::geometry_shader:
-			return "geometry_shader";
-		case pipeline_stage::pixel_shader:
-			return "pixel_shader";
-		case pipeline_stage::compute_shader:
-			return "compute_shader";
-		case pipeline_stage::input_assembler:
-			return "input_assembler";
-		case pipeline_stage::stream_output:
-			return "stream_output";
-		case pipeline_stage::rasterizer:
-			return "rasterizer";
-		case pipeline_stage::depth_stencil:
-			return "depth_stencil";
-		case pipeline_stage::output_merger:
-			return "output_merger";
-		case pipeline_stage::all:
-			return "all";
-		case pipeline_stage::all_graphics:
-			return "all_graphics";
-		case pipeline_stage::all_shader_stages:
-			return "all_shader_stages";
-		default:
-			return "unknown";
+			push({ command::open, path, {} });
 		}
-	}
-	inline auto to_string(descriptor_type value)
+		void write(std::vector<trace_record> &&records)
+		{
+			push({ command::write, {}, std::move(records) });
+		}
+		void close()
+		{
+			push({ command::close, {}, {} });
+		}
+
+		/// <summary>
+		/// Gets an empty buffer with room for at least <see cref="RECORDS_PER_BUFFER"/> records, reusing one that was already written if possible.
+		/// </summary>
+		std::vector<trace_record> acquire_buffer()
+		{
+			std::vector<trace_record> records;
+
+			{ const std::unique_lock<std::mutex> lock(_mutex);
+				if (!_buffer_pool.empty())
+				{
+					records = std::move(_buffer_pool.back());
+					_buffer_pool.pop_back();
+				}
+			}
+
+			records.reserve(RECORDS_PER_BUFFER);
+			return records;
+		}
+
+		/// <summary>
+		/// Waits for all queued buffers to be written and stops the writer thread (it is started again on the next command).
+		/// </summary>
+		void stop()
+		{
+			std::thread thread;
+
+			{ const std::unique_lock<std::mutex> lock(_mutex);
+				_stop = true;
+				thread = std::move(_thread);
+			}
+
+			_command_available.notify_one();
+
+			if (thread.joinable())
+				thread.join();
+
+			{ const std::unique_lock<std::mutex> lock(_mutex);
+				_stop = false;
+			}
+		}
+
+	private:
+		void push(command &&cmd)
+		{
+			{ const std::unique_lock<std::mutex> lock(_mutex);
+				_commands.push_back(std::move(cmd));
+
+				if (!_thread.joinable())
+					_thread = std::thread(&trace_file_writer::thread_main, this);
+			}
+
+			_command_available.notify_one();
+		}
+
+		void thread_main()
+		{
+			FILE *file = nullptr;
+
+			while (true)
+			{
+				command cmd;
+
+				{ std::unique_lock<std::mutex> lock(_mutex);
+					_command_available.wait(lock, [this]() { return !_commands.empty() || _stop; });
+
+					if (_commands.empty())
+						break;
+
+					cmd = std::move(_commands.front());
+					_commands.pop_front();
+				}
+
+				switch (cmd.type)
+				{
+				case command::open:
+					if (file != nullptr)
+						fclose(file);
+					if (_wfopen_s(&file, cmd.path.c_str(), L"wb") == 0)
+					{
+						LARGE_INTEGER frequency;
+						QueryPerformanceFrequency(&frequency);
+
+						trace_file_header header;
+						header.timestamp_frequency = frequency.QuadPart;
+						fwrite(&header, sizeof(header), 1, file);
+					}
+					else
+					{
+						file = nullptr;
+						reshade::log_message(reshade::log_level::error, "Failed to open API trace file for writing!");
+					}
+					break;
+				case command::write:
+					if (file != nullptr)
+						fwrite(cmd.records.data(), sizeof(trace_record), cmd.records.size(), file);
+
+					cmd.records.clear();
+					{ const std::unique_lock<std::mutex> lock(_mutex);
+						_buffer_pool.push_back(std::move(cmd.records));
+					}
+					break;
+				case command::close:
+					if (file != nullptr)
+						fclose(file);
+					file = nullptr;
+					break;
+				}
+			}
+
+			if (file != nullptr)
+				fclose(file);
+		}
+
+		std::mutex _mutex;
+		std::condition_variable _command_available;
+		std::deque<command> _commands;
+		std::vector<std::vector<trace_record>> _buffer_pool;
+		std::thread _thread;
+		bool _stop = false;
+	};
+
+	/// <summary>
+	/// Records of the calls made on a single thread that were not yet handed to the writer thread.
+	/// The lock is practically never contended, since only the owning thread appends records and other threads only access it to collect them at the end of a capture.
+	/// </summary>
+	struct thread_buffer
 	{
-		switch (value)
+		std::mutex mutex;
+		uint32_t thread_id = 0;
+		std::vector<trace_record> records;
+	};
+
+	trace_file_writer s_writer;
+	std::mutex s_thread_buffers_mutex;
+	// Buffers are kept around after their thread exits, so that a capture never loses records and the thread-local pointer below never dangles
+	std::vector<std::unique_ptr<thread_buffer>> s_thread_buffers;
+	thread_local thread_buffer *t_thread_buffer = nullptr;
+
+	void trace_args(trace_event event, const uint64_t *args, uint32_t num_args)
+	{
+		thread_buffer *buffer = t_thread_buffer;
+		if (buffer == nullptr)
 		{
-		case descriptor_type::sampler:
-			return "sampler";
-		case descriptor_type::sampler_with_resource_view:
-			return "sampler_with_resource_view";
-		case descriptor_type::shader_resource_view:
-			return "shader_resource_view";
-		case descriptor_type::unordered_access_view:
-			return "unordered_access_view";
-		case descriptor_type::constant_buffer:
-			return "constant_buffer";
-		default:
-			return "unknown";
+			buffer = new thread_buffer();
+			buffer->thread_id = GetCurrentThreadId();
+			buffer->records = s_writer.acquire_buffer();
+
+			const std::unique_lock<std::mutex> lock(s_thread_buffers_mutex);
+			s_thread_buffers.emplace_back(buffer);
+			t_thread_buffer = buffer;
+		}
+
+		LARGE_INTEGER timestamp;
+		QueryPerformanceCounter(&timestamp);
+
+		const uint32_t num_records = num_records_for_args(num_args);
+
+		const std::unique_lock<std::mutex> lock(buffer->mutex);
+
+		// Never split the records of a single call across buffers, so that they always end up next to each other in the file
+		if (buffer->records.size() + num_records > buffer->records.capacity())
+		{
+			if (!buffer->records.empty())
+			{
+				s_writer.write(std::move(buffer->records));
+				buffer->records = s_writer.acquire_buffer();
+			}
+
+			buffer->records.reserve(num_records);
+		}
+
+		for (uint32_t i = 0, arg_index = 0; i < num_records; ++i)
+		{
+			trace_record &record = buffer->records.emplace_back();
+			record.event = i == 0 ? event : trace_event::continuation;
+			record.thread_id = buffer->thread_id;
+			record.timestamp = timestamp.QuadPart;
+
+			const uint32_t num_record_args = std::min(num_args - arg_index, trace_record::max_args);
+			record.num_args = static_cast<uint16_t>(i == 0 ? num_args : num_record_args);
+			for (uint32_t k = 0; k < trace_record::max_args; ++k, ++arg_index)
+				record.args[k] = k < num_record_args ? args[arg_index] : 0;
 		}
 	}
-	inline auto to_string(dynamic_state value)
+
+#else
+	void trace_args(trace_event event, const uint64_t *args, uint32_t num_args)
 	{
-		switch (value)
-		{
-		default:
-		case dynamic_state::unknown:
-			return "unknown";
-		case dynamic_state::alpha_test_enable:
-			return "alpha_test_enable";
-		case dynamic_state::alpha_reference_value:
-			return "alpha_reference_value";
-		case dynamic_state::alpha_func:
-			return "alpha_func";
-		case dynamic_state::srgb_write_enable:
-			return "srgb_write_enable";
-		case dynamic_state::primitive_topology:
-			return "primitive_topology";
-		case dynamic_state::sample_mask:
-			return "sample_mask";
-		case dynamic_state::alpha_to_coverage_enable:
-			return "alpha_to_coverage_enable";
-		case dynamic_state::blend_enable:
-			return "blend_enable";
-		case dynamic_state::logic_op_enable:
-			return "logic_op_enable";
-		case dynamic_state::color_blend_op:
-			return "color_blend_op";
-		case dynamic_state::source_color_blend_factor:
-			return "src_color_blend_factor";
-		case dynamic_state::dest_color_blend_factor:
-			return "dst_color_blend_factor";
-		case dynamic_state::alpha_blend_op:
-			return "alpha_blend_op";
-		case dynamic_state::source_alpha_blend_factor:
-			return "src_alpha_blend_factor";
-		case dynamic_state::dest_alpha_blend_factor:
-			return "dst_alpha_blend_factor";
-		case dynamic_state::logic_op:
-			return "logic_op";
-		case dynamic_state::blend_constant:
-			return "blend_constant";
-		case dynamic_state::render_target_write_mask:
-			return "render_target_write_mask";
-		case dynamic_state::fill_mode:
-			return "fill_mode";
-		case dynamic_state::cull_mode:
-			return "cull_mode";
-		case dynamic_state::front_counter_clockwise:
-			return "front_counter_clockwise";
-		case dynamic_state::depth_bias:
-			return "depth_bias";
-		case dynamic_state::depth_bias_clamp:
-			return "depth_bias_clamp";
-		case dynamic_state::depth_bias_slope_scaled:
-			return "depth_bias_slope_scaled";
-		case dynamic_state::depth_clip_enable:
-			return "depth_clip_enable";
-		case dynamic_state::scissor_enable:
-			return "scissor_enable";
-		case dynamic_state::multisample_enable:
-			return "multisample_enable";
-		case dynamic_state::antialiased_line_enable:
-			return "antialiased_line_enable";
-		case dynamic_state::depth_enable:
-			return "depth_enable";
-		case dynamic_state::depth_write_mask:
-			return "depth_write_mask";
-		case dynamic_state::depth_func:
-			return "depth_func";
-		case dynamic_state::stencil_enable:
-			return "stencil_enable";
-		case dynamic_state::front_stencil_read_mask:
-			return "front_stencil_read_mask";
-		case dynamic_state::front_stencil_write_mask:
-			return "front_stencil_write_mask";
-		case dynamic_state::front_stencil_reference_value:
-			return "front_stencil_reference_value";
-		case dynamic_state::front_stencil_func:
-			return "front_stencil_func";
-		case dynamic_state::front_stencil_pass_op:
-			return "front_stencil_pass_op";
-		case dynamic_state::front_stencil_fail_op:
-			return "front_stencil_fail_op";
-		case dynamic_state::front_stencil_depth_fail_op:
-			return "front_stencil_depth_fail_op";
-		case dynamic_state::back_stencil_read_mask:
-			return "back_stencil_read_mask";
-		case dynamic_state::back_stencil_write_mask:
-			return "back_stencil_write_mask";
-		case dynamic_state::back_stencil_reference_value:
-			return "back_stencil_reference_value";
-		case dynamic_state::back_stencil_func:
-			return "back_stencil_func";
-		case dynamic_state::back_stencil_pass_op:
-			return "back_stencil_pass_op";
-		case dynamic_state::back_stencil_fail_op:
-			return "back_stencil_fail_op";
-		case dynamic_state::back_stencil_depth_fail_op:
-			return "back_stencil_depth_fail_op";
+		std::stringstream s;
+		format_trace_event(s, event, args, num_args);
+
+		reshade::log_message(reshade::log_level::info, s.str().c_str());
+	}
+#endif
+
+	template <typename... Args>
+	inline void trace(trace_event event, Args... args)
+	{
+		const uint64_t values[] = { to_arg(args)..., 0 };
+		trace_args(event, values, static_cast<uint32_t>(sizeof...(Args)));
+	}
+
+	void trace_create_sampler(uint64_t handle, const sampler_desc &desc)
+	{
+		uint64_t args[1 + num_struct_args<sampler_desc>];
+		args[0] = handle;
+		struct_to_args(desc, args + 1);
+
+		trace_args(trace_event::create_sampler, args, static_cast<uint32_t>(std::size(args)));
+	}
+	void trace_create_resource(uint64_t handle, const resource_desc &desc, resource_usage initial_state)
+	{
+		uint64_t args[2 + num_struct_args<resource_desc>];
+		args[0] = handle;
+		args[1] = to_arg(initial_state);
+		struct_to_args(desc, args + 2);
+
+		trace_args(trace_event::create_resource, args, static_cast<uint32_t>(std::size(args)));
+	}
+	void trace_create_resource_view(uint64_t handle, uint64_t resource, resource_usage usage_type, const resource_view_desc &desc)
+	{
+		uint64_t args[3 + num_struct_args<resource_view_desc>];
+		args[0] = handle;
+		args[1] = resource;
+		args[2] = to_arg(usage_type);
+		struct_to_args(desc, args + 3);
+
+		trace_args(trace_event::create_resource_view, args, static_cast<uint32_t>(std::size(args)));
+	}
+
+#if TRACE_BINARY_FILE
+	std::filesystem::path s_last_capture_path;
+
+	void begin_capture()
+	{
+		// Throw away any records from calls that were still in flight when the previous capture ended
+		{ const std::unique_lock<std::mutex> lock(s_thread_buffers_mutex);
+			for (const std::unique_ptr<thread_buffer> &buffer : s_thread_buffers)
+			{
+				const std::unique_lock<std::mutex> buffer_lock(buffer->mutex);
+				buffer->records.clear();
+			}
 		}
+
+		// Prepend executable directory to trace file
+		wchar_t file_prefix[MAX_PATH] = L"";
+		GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
+
+		SYSTEMTIME time;
+		GetLocalTime(&time);
+
+		wchar_t file_name[64];
+		swprintf_s(file_name, L"api_trace_%04hu-%02hu-%02hu_%02hu-%02hu-%02hu.bin", time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond);
+
+		s_last_capture_path = std::filesystem::path(file_prefix).parent_path() / file_name;
+
+		s_writer.open(s_last_capture_path);
+
+		reshade::log_message(reshade::log_level::info, ("Writing API trace to " + s_last_capture_path.u8string() + " ...").c_str());
+
+		trace(trace_event::begin_frame);
+
+		// Write all objects that already exist, so that the trace is self-contained, and start capturing while holding the lock, so that no object created in between is missed
+		const std::unique_lock<std::shared_mutex> lock(s_mutex);
+
+		for (const auto &[handle, desc] : s_samplers)
+			trace_create_sampler(handle, desc);
+		for (const auto &[handle, info] : s_resources)
+			trace_create_resource(handle, info.desc, info.initial_state);
+		for (const auto &[handle, info] : s_resource_views)
+			trace_create_resource_view(handle, info.resource.handle, info.usage_type, info.desc);
+
+		s_do_capture = true;
 	}
-	inline auto to_string(resource_usage value)
+	void end_capture()
 	{
-		switch (value)
-		{
-		default:
-		case resource_usage::undefined:
-			return "undefined";
-		case resource_usage::index_buffer:
-			return "index_buffer";
-		case resource_usage::vertex_buffer:
-			return "vertex_buffer";
-		case resource_usage::constant_buffer:
-			return "constant_buffer";
-		case resource_usage::stream_output:
-			return "stream_output";
-		case resource_usage::indirect_argument:
-			return "indirect_argument";
-		case resource_usage::depth_stencil:
-		case resource_usage::depth_stencil_read:
-		case resource_usage::depth_stencil_write:
-			return "depth_stencil";
-		case resource_usage::render_target:
-			return "render_target";
-		case resource_usage::shader_resource:
-		case resource_usage::shader_resource_pixel:
-		case resource_usage::shader_resource_non_pixel:
-			return "shader_resource";
-		case resource_usage::unordered_access:
-			return "unordered_access";
-		case resource_usage::copy_dest:
-			return "copy_dest";
-		case resource_usage::copy_source:
-			return "copy_source";
-		case resource_usage::resolve_dest:
-			return "resolve_dest";
-		case resource_usage::resolve_source:
-			return "resolve_source";
-		case resource_usage::general:
-			return "general";
-		case resource_usage::present:
-			return "present";
-		case resource_usage::cpu_access:
-			return "cpu_access";
+		// Hand the remaining records of all threads to the writer thread, which are written before the file is closed
+		{ const std::unique_lock<std::mutex> lock(s_thread_buffers_mutex);
+			for (const std::unique_ptr<thread_buffer> &buffer : s_thread_buffers)
+			{
+				const std::unique_lock<std::mutex> buffer_lock(buffer->mutex);
+				if (buffer->records.empty())
+					continue;
+
+				s_writer.write(std::move(buffer->records));
+				buffer->records = s_writer.acquire_buffer();
+			}
 		}
+
+		s_writer.close();
 	}
-	inline auto to_string(query_type value)
+
+	void replay_last_capture(device *device, command_queue *queue)
 	{
-		switch (value)
+		if (s_last_capture_path.empty())
+			return;
+
+		// Make sure the trace file was written completely
+		s_writer.stop();
+
+		// Objects of the trace are created while loading it, so that the frame times only cover issuing its commands
+		trace_replayer replayer;
+		if (std::ifstream input(s_last_capture_path, std::ios::binary); !input || !replayer.load(device, input))
 		{
-		case query_type::occlusion:
-			return "occlusion";
-		case query_type::binary_occlusion:
-			return "binary_occlusion";
-		case query_type::timestamp:
-			return "timestamp";
-		case query_type::pipeline_statistics:
-			return "pipeline_statistics";
-		case query_type::stream_output_statistics_0:
-			return "stream_output_statistics_0";
-		case query_type::stream_output_statistics_1:
-			return "stream_output_statistics_1";
-		case query_type::stream_output_statistics_2:
-			return "stream_output_statistics_2";
-		case query_type::stream_output_statistics_3:
-			return "stream_output_statistics_3";
-		default:
-			return "unknown";
+			reshade::log_message(reshade::log_level::error, "Failed to load API trace for replay!");
+			return;
 		}
+
+		replay_statistics stats;
+		replayer.replay(queue, stats);
+
+		if (stats.frame_times.empty())
+			return;
+
+		const auto [min_time, max_time] = std::minmax_element(stats.frame_times.begin(), stats.frame_times.end());
+		double total_time = 0.0;
+		for (const double time : stats.frame_times)
+			total_time += time;
+
+		std::stringstream s;
+		s << "Replayed " << stats.frame_times.size() << " frame(s) with " << stats.num_calls << " calls (" << stats.num_skipped_calls << " skipped, " << stats.num_failed_objects << " objects failed to create) in "
+			<< *min_time << " / " << (total_time / stats.frame_times.size()) << " / " << *max_time << " ms (min / avg / max) per frame.";
+
+		reshade::log_message(reshade::log_level::info, s.str().c_str());
 	}
+#else
+	void begin_capture()
+	{
+		trace(trace_event::begin_frame);
+
+		s_do_capture = true;
+	}
+	void end_capture()
+	{
+	}
+#endif
 }
 
 static void on_init_swapchain(swapchain *swapchain)
 {
-	const std::unique_lock<std::shared_mutex> lock(s_mutex);
+	device *const device = swapchain->get_device();
+	const device_api api = device->get_api();
 
-	const device_api api = swapchain->get_device()->get_api();
+#if TRACE_TRACK_OBJECTS
+	const std::unique_lock<std::shared_mutex> lock(s_mutex);
+#endif
 
 	for (uint32_t i = 0; i < swapchain->get_back_buffer_count(); ++i)
 	{
 		const resource buffer = swapchain->get_back_buffer(i);
+		const resource_desc desc = device->get_resource_desc(buffer);
 
-		s_resources.emplace(buffer.handle);
+#if TRACE_TRACK_OBJECTS
+		s_resources[buffer.handle] = { desc, resource_usage::present };
 		if (api == device_api::d3d9 || api == device_api::opengl)
-			s_resource_views.emplace(buffer.handle);
+			s_resource_views[buffer.handle] = { buffer, resource_usage::render_target, resource_view_desc(desc.texture.format) };
+#endif
+
+		if (s_do_capture)
+		{
+			trace_create_resource(buffer.handle, desc, resource_usage::present);
+			if (api == device_api::d3d9 || api == device_api::opengl)
+				trace_create_resource_view(buffer.handle, buffer.handle, resource_usage::render_target, resource_view_desc(desc.texture.format));
+		}
 	}
 }
 static void on_destroy_swapchain(swapchain *swapchain)
 {
-	const std::unique_lock<std::shared_mutex> lock(s_mutex);
-
 	const device_api api = swapchain->get_device()->get_api();
 
+#if TRACE_TRACK_OBJECTS
+	const std::unique_lock<std::shared_mutex> lock(s_mutex);
+#endif
+
 	for (uint32_t i = 0; i < swapchain->get_back_buffer_count(); ++i)
 	{
 		const resource buffer = swapchain->get_back_buffer(i);
 
+#if TRACE_TRACK_OBJECTS
 		s_resources.erase(buffer.handle);
 		if (api == device_api::d3d9 || api == device_api::opengl)
 			s_resource_views.erase(buffer.handle);
+#endif
+
+		if (s_do_capture)
+		{
+			if (api == device_api::d3d9 || api == device_api::opengl)
+				trace(trace_event::destroy_resource_view, buffer.handle);
+			trace(trace_event::destroy_resource, buffer.handle);
+		}
 	}
 }
 static void on_init_sampler(device *device, const sampler_desc &desc, sampler handle)
 {
+#if TRACE_TRACK_OBJECTS
 	const std::unique_lock<std::shared_mutex> lock(s_mutex);
 
-	s_samplers.emplace(handle.handle);
+	s_samplers[handle.handle] = desc;
+#endif
+
+	if (s_do_capture)
+		trace_create_sampler(handle.handle, desc);
 }
 static void on_destroy_sampler(device *device, sampler handle)
 {
+#if TRACE_TRACK_OBJECTS
 	const std::unique_lock<std::shared_mutex> lock(s_mutex);
 
 	assert(s_samplers.find(handle.handle) != s_samplers.end());
 	s_samplers.erase(handle.handle);
+#endif
+
+	if (s_do_capture)
+		trace(trace_event::destroy_sampler, handle.handle);
 }
-static void on_init_resource(device *device, const resource_desc &desc, const subresource_data *, resource_usage, resource handle)
+static void on_init_resource(device *device, const resource_desc &desc, const subresource_data *, resource_usage initial_state, resource handle)
 {
+#if TRACE_TRACK_OBJECTS
 	const std::unique_lock<std::shared_mutex> lock(s_mutex);
 
-	s_resources.emplace(handle.handle);
+	s_resources[handle.handle] = { desc, initial_state };
+#endif
+
+	if (s_do_capture)
+		trace_create_resource(handle.handle, desc, initial_state);
 }
 static void on_destroy_resource(device *device, resource handle)
 {
+#if TRACE_TRACK_OBJECTS
 	const std::unique_lock<std::shared_mutex> lock(s_mutex);
 
 	assert(s_resources.find(handle.handle) != s_resources.end());
 	s_resources.erase(handle.handle);
+#endif
+
+	if (s_do_capture)
+		trace(trace_event::destroy_resource, handle.handle);
 }
 static void on_init_resource_view(device *device, resource resource, resource_usage usage_type, const resource_view_desc &desc, resource_view handle)
 {
+#if TRACE_TRACK_OBJECTS
 	const std::unique_lock<std::shared_mutex> lock(s_mutex);
 
 	assert(resource == 0 || s_resources.find(resource.handle) != s_resources.end());
-	s_resource_views.emplace(handle.handle);
+	s_resource_views[handle.handle] = { resource, usage_type, desc };
+#endif
+
+	if (s_do_capture)
+		trace_create_resource_view(handle.handle, resource.handle, usage_type, desc);
 }
 static void on_destroy_resource_view(device *device, resource_view handle)
 {
+#if TRACE_TRACK_OBJECTS
 	const std::unique_lock<std::shared_mutex> lock(s_mutex);
 
 	assert(s_resource_views.find(handle.handle) != s_resource_views.end());
 	s_resource_views.erase(handle.handle);
+#endif
+
+	if (s_do_capture)
+		trace(trace_event::destroy_resource_view, handle.handle);
 }
+#if TRACE_TRACK_OBJECTS
 static void on_init_pipeline(device *device, pipeline_layout, uint32_t, const pipeline_subobject *, pipeline handle)
 {
 	const std::unique_lock<std::shared_mutex> lock(s_mutex);
@@ -353,6 +578,15 @@ static void on_destroy_pipeline(device *device, pipeline handle)
 	assert(s_pipelines.find(handle.handle) != s_pipelines.end());
 	s_pipelines.erase(handle.handle);
 }
+#endif
+
+#if TRACE_BINARY_FILE
+static void on_destroy_device(device *)
+{
+	// Wait for the trace file to be written before the add-on may be unloaded
+	s_writer.stop();
+}
+#endif
 
 static void on_barrier(command_list *, uint32_t num_resources, const resource *resources, const resource_usage *old_states, const resource_usage *new_states)
 {
@@ -367,11 +601,8 @@ static void on_barrier(command_list *, uint32_t num_resources, const resource *r
 	}
 #endif
 
-	std::stringstream s;
 	for (uint32_t i = 0; i < num_resources; ++i)
-		s << "barrier(" << (void *)resources[i].handle << ", " << to_string(old_states[i]) << ", " << to_string(new_states[i]) << ")" << std::endl;
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+		trace(trace_event::barrier, resources[i].handle, old_states[i], new_states[i]);
 }
 
 static void on_begin_render_pass(command_list *, uint32_t count, const render_pass_render_target_desc *rts, const render_pass_depth_stencil_desc *ds)
@@ -379,23 +610,20 @@ static void on_begin_render_pass(command_list *, uint32_t count, const render_pa
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "begin_render_pass(" << count << ", { ";
-	for (uint32_t i = 0; i < count; ++i)
-		s << (void *)rts[i].view.handle << ", ";
-	s << " }, " << (ds != nullptr ? (void *)ds->view.handle : 0) << ")";
+	uint64_t args[2 + 8];
+	args[0] = count;
+	args[1] = ds != nullptr ? ds->view.handle : 0;
+	for (uint32_t i = 0; i < count && i < 8; ++i)
+		args[2 + i] = rts[i].view.handle;
 
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace_args(trace_event::begin_render_pass, args, 2 + std::min(count, 8u));
 }
 static void on_end_render_pass(command_list *)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "end_render_pass()";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::end_render_pass);
 }
 static void on_bind_render_targets_and_depth_stencil(command_list *, uint32_t count, const resource_view *rtvs, resource_view dsv)
 {
@@ -411,13 +639,13 @@ static void on_bind_render_targets_and_depth_stencil(command_list *, uint32_t co
 	}
 #endif
 
-	std::stringstream s;
-	s << "bind_render_targets_and_depth_stencil(" << count << ", { ";
-	for (uint32_t i = 0; i < count; ++i)
-		s << (void *)rtvs[i].handle << ", ";
-	s << " }, " << (void *)dsv.handle << ")";
+	uint64_t args[2 + 8];
+	args[0] = count;
+	args[1] = dsv.handle;
+	for (uint32_t i = 0; i < count && i < 8; ++i)
+		args[2 + i] = rtvs[i].handle;
 
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace_args(trace_event::bind_render_targets_and_depth_stencil, args, 2 + std::min(count, 8u));
 }
 
 static void on_bind_pipeline(command_list *, pipeline_stage type, pipeline pipeline)
@@ -432,54 +660,63 @@ static void on_bind_pipeline(command_list *, pipeline_stage type, pipeline pipel
 	}
 #endif
 
-	std::stringstream s;
-	s << "bind_pipeline(" << to_string(type) << ", " << (void *)pipeline.handle << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::bind_pipeline, type, pipeline.handle);
 }
 static void on_bind_pipeline_states(command_list *, uint32_t count, const dynamic_state *states, const uint32_t *values)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
 	for (uint32_t i = 0; i < count; ++i)
-		s << "bind_pipeline_state(" << to_string(states[i]) << ", " << values[i] << ")" << std::endl;
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+		trace(trace_event::bind_pipeline_state, states[i], values[i]);
 }
 static void on_bind_viewports(command_list *, uint32_t first, uint32_t count, const viewport *viewports)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "bind_viewports(" << first << ", " << count << ", { ... })";
+	// Reuse argument storage between calls, since the number of viewports is not bounded
+	static thread_local std::vector<uint64_t> args;
+	args.resize(2 + static_cast<size_t>(count) * num_struct_args<viewport>);
+	args[0] = first;
+	args[1] = count;
+	for (uint32_t i = 0; i < count; ++i)
+		struct_to_args(viewports[i], args.data() + 2 + i * num_struct_args<viewport>);
 
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace_args(trace_event::bind_viewports, args.data(), static_cast<uint32_t>(args.size()));
 }
 static void on_bind_scissor_rects(command_list *, uint32_t first, uint32_t count, const rect *rects)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "bind_scissor_rects(" << first << ", " << count << ", { ... })";
+	// Reuse argument storage between calls, since the number of rects is not bounded
+	static thread_local std::vector<uint64_t> args;
+	args.resize(2 + static_cast<size_t>(count) * num_struct_args<rect>);
+	args[0] = first;
+	args[1] = count;
+	for (uint32_t i = 0; i < count; ++i)
+		struct_to_args(rects[i], args.data() + 2 + i * num_struct_args<rect>);
 
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace_args(trace_event::bind_scissor_rects, args.data(), static_cast<uint32_t>(args.size()));
 }
 static void on_push_constants(command_list *, shader_stage stages, pipeline_layout layout, uint32_t param_index, uint32_t first, uint32_t count, const void *values)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "push_constants(" << to_string(stages) << ", " << (void *)layout.handle << ", " << param_index << ", " << first << ", " << count << ", { ";
+	// Reuse argument storage between calls, since the number of constants is not bounded
+	static thread_local std::vector<uint64_t> args;
+	args.resize(5 + static_cast<size_t>(count));
+	args[0] = to_arg(stages);
+	args[1] = layout.handle;
+	args[2] = param_index;
+	args[3] = first;
+	args[4] = count;
 	for (uint32_t i = 0; i < count; ++i)
-		s << std::hex << static_cast<const uint32_t *>(values)[i] << std::dec << ", ";
-	s << " })";
+		args[5 + i] = static_cast<const uint32_t *>(values)[i];
 
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace_args(trace_event::push_constants, args.data(), static_cast<uint32_t>(args.size()));
 }
 static void on_push_descriptors(command_list *, shader_stage stages, pipeline_layout layout, uint32_t param_index, const descriptor_table_update &update)
 {
@@ -514,21 +751,15 @@ static void on_push_descriptors(command_list *, shader_stage stages, pipeline_la
 	}
 #endif
 
-	std::stringstream s;
-	s << "push_descriptors(" << to_string(stages) << ", " << (void *)layout.handle << ", " << param_index << ", { " << to_string(update.type) << ", " << update.binding << ", " << update.count << " })";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::push_descriptors, stages, layout.handle, param_index, update.type, update.binding, update.count);
 }
 static void on_bind_descriptor_tables(command_list *, shader_stage stages, pipeline_layout layout, uint32_t first, uint32_t count, const descriptor_table *tables)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
 	for (uint32_t i = 0; i < count; ++i)
-		s << "bind_descriptor_table(" << to_string(stages) << ", " << (void *)layout.handle << ", " << (first + i) << ", " << (void *)tables[i].handle << ")" << std::endl;
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+		trace(trace_event::bind_descriptor_table, stages, layout.handle, first + i, tables[i].handle);
 }
 static void on_bind_index_buffer(command_list *, resource buffer, uint64_t offset, uint32_t index_size)
 {
@@ -542,10 +773,7 @@ static void on_bind_index_buffer(command_list *, resource buffer, uint64_t offse
 	}
 #endif
 
-	std::stringstream s;
-	s << "bind_index_buffer(" << (void *)buffer.handle << ", " << offset << ", " << index_size << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::bind_index_buffer, buffer.handle, offset, index_size);
 }
 static void on_bind_vertex_buffers(command_list *, uint32_t first, uint32_t count, const resource *buffers, const uint64_t *offsets, const uint32_t *strides)
 {
@@ -560,11 +788,8 @@ static void on_bind_vertex_buffers(command_list *, uint32_t first, uint32_t coun
 	}
 #endif
 
-	std::stringstream s;
 	for (uint32_t i = 0; i < count; ++i)
-		s << "bind_vertex_buffer(" << (first + i) << ", " << (void *)buffers[i].handle << ", " << (offsets != nullptr ? offsets[i] : 0) << ", " << (strides != nullptr ? strides[i] : 0) << ")" << std::endl;
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+		trace(trace_event::bind_vertex_buffer, first + i, buffers[i].handle, offsets != nullptr ? offsets[i] : 0, strides != nullptr ? strides[i] : 0);
 }
 
 static bool on_draw(command_list *, uint32_t vertices, uint32_t instances, uint32_t first_vertex, uint32_t first_instance)
@@ -572,10 +797,7 @@ static bool on_draw(command_list *, uint32_t vertices, uint32_t instances, uint3
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "draw(" << vertices << ", " << instances << ", " << first_vertex << ", " << first_instance << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::draw, vertices, instances, first_vertex, first_instance);
 
 	return false;
 }
@@ -584,10 +806,7 @@ static bool on_draw_indexed(command_list *, uint32_t indices, uint32_t instances
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "draw_indexed(" << indices << ", " << instances << ", " << first_index << ", " << vertex_offset << ", " << first_instance << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::draw_indexed, indices, instances, first_index, vertex_offset, first_instance);
 
 	return false;
 }
@@ -596,10 +815,7 @@ static bool on_dispatch(command_list *, uint32_t group_count_x, uint32_t group_c
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "dispatch(" << group_count_x << ", " << group_count_y << ", " << group_count_z << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::dispatch, group_count_x, group_count_y, group_count_z);
 
 	return false;
 }
@@ -608,24 +824,7 @@ static bool on_draw_or_dispatch_indirect(command_list *, indirect_command type,
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	switch (type)
-	{
-	case indirect_command::unknown:
-		s << "draw_or_dispatch_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-		break;
-	case indirect_command::draw:
-		s << "draw_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-		break;
-	case indirect_command::draw_indexed:
-		s << "draw_indexed_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-		break;
-	case indirect_command::dispatch:
-		s << "dispatch_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-		break;
-	}
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::draw_or_dispatch_indirect, type, buffer.handle, offset, draw_count, stride);
 
 	return false;
 }
@@ -643,10 +842,7 @@ static bool on_copy_resource(command_list *, resource src, resource dst)
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_resource(" << (void *)src.handle << ", " << (void *)dst.handle << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::copy_resource, src.handle, dst.handle);
 
 	return false;
 }
@@ -663,10 +859,7 @@ static bool on_copy_buffer_region(command_list *, resource src, uint64_t src_off
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_buffer_region(" << (void *)src.handle << ", " << src_offset << ", " << (void *)dst.handle << ", " << dst_offset << ", " << size << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::copy_buffer_region, src.handle, src_offset, dst.handle, dst_offset, size);
 
 	return false;
 }
@@ -683,10 +876,7 @@ static bool on_copy_buffer_to_texture(command_list *, resource src, uint64_t src
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_buffer_to_texture(" << (void *)src.handle << ", " << src_offset << ", " << row_length << ", " << slice_height << ", " << (void *)dst.handle << ", " << dst_subresource << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::copy_buffer_to_texture, src.handle, src_offset, row_length, slice_height, dst.handle, dst_subresource);
 
 	return false;
 }
@@ -703,10 +893,7 @@ static bool on_copy_texture_region(command_list *, resource src, uint32_t src_su
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_texture_region(" << (void *)src.handle << ", " << src_subresource << ", " << (void *)dst.handle << ", " << dst_subresource << ", " << (uint32_t)filter << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::copy_texture_region, src.handle, src_subresource, dst.handle, dst_subresource, filter);
 
 	return false;
 }
@@ -723,10 +910,7 @@ static bool on_copy_texture_to_buffer(command_list *, resource src, uint32_t src
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_texture_to_buffer(" << (void *)src.handle << ", " << src_subresource << ", " << (void *)dst.handle << ", " << dst_offset << ", " << row_length << ", " << slice_height << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::copy_texture_to_buffer, src.handle, src_subresource, dst.handle, dst_offset, row_length, slice_height);
 
 	return false;
 }
@@ -743,10 +927,7 @@ static bool on_resolve_texture_region(command_list *, resource src, uint32_t src
 	}
 #endif
 
-	std::stringstream s;
-	s << "resolve_texture_region(" << (void *)src.handle << ", " << src_subresource << ", { ... }, " << (void *)dst.handle << ", " << dst_subresource << ", " << dst_x << ", " << dst_y << ", " << dst_z << ", " << (uint32_t)format << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::resolve_texture_region, src.handle, src_subresource, dst.handle, dst_subresource, dst_x, dst_y, dst_z, format);
 
 	return false;
 }
@@ -763,10 +944,7 @@ static bool on_clear_depth_stencil_view(command_list *, resource_view dsv, const
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_depth_stencil_view(" << (void *)dsv.handle << ", " << (depth != nullptr ? *depth : 0.0f) << ", " << (stencil != nullptr ? *stencil : 0) << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::clear_depth_stencil_view, dsv.handle, depth != nullptr ? *depth : 0.0f, stencil != nullptr ? *stencil : 0);
 
 	return false;
 }
@@ -782,10 +960,7 @@ static bool on_clear_render_target_view(command_list *, resource_view rtv, const
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_render_target_view(" << (void *)rtv.handle << ", { " << color[0] << ", " << color[1] << ", " << color[2] << ", " << color[3] << " })";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::clear_render_target_view, rtv.handle, color[0], color[1], color[2], color[3]);
 
 	return false;
 }
@@ -801,10 +976,7 @@ static bool on_clear_unordered_access_view_uint(command_list *, resource_view ua
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_unordered_access_view_uint(" << (void *)uav.handle << ", { " << values[0] << ", " << values[1] << ", " << values[2] << ", " << values[3] << " })";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::clear_unordered_access_view_uint, uav.handle, values[0], values[1], values[2], values[3]);
 
 	return false;
 }
@@ -820,10 +992,7 @@ static bool on_clear_unordered_access_view_float(command_list *, resource_view u
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_unordered_access_view_float(" << (void *)uav.handle << ", { " << values[0] << ", " << values[1] << ", " << values[2] << ", " << values[3] << " })";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::clear_unordered_access_view_float, uav.handle, values[0], values[1], values[2], values[3]);
 
 	return false;
 }
@@ -840,10 +1009,7 @@ static bool on_generate_mipmaps(command_list *, resource_view srv)
 	}
 #endif
 
-	std::stringstream s;
-	s << "generate_mipmaps(" << (void *)srv.handle << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::generate_mipmaps, srv.handle);
 
 	return false;
 }
@@ -853,10 +1019,7 @@ static bool on_begin_query(command_list *cmd_list, query_heap heap, query_type t
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "begin_query(" << (void *)heap.handle << ", " << to_string(type) << ", " << index << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::begin_query, heap.handle, type, index);
 
 	return false;
 }
@@ -865,10 +1028,7 @@ static bool on_end_query(command_list *cmd_list, query_heap heap, query_type typ
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "end_query(" << (void *)heap.handle << ", " << to_string(type) << ", " << index << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::end_query, heap.handle, type, index);
 
 	return false;
 }
@@ -884,10 +1044,7 @@ static bool on_copy_query_heap_results(command_list *cmd_list, query_heap heap,
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_query_heap_results(" << (void *)heap.handle << ", " << to_string(type) << ", " << first << ", " << count << (void *)dest.handle << ", " << dest_offset << ", " << stride << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	trace(trace_event::copy_query_heap_results, heap.handle, type, first, count, dest.handle, dest_offset, stride);
 
 	return false;
 }
@@ -896,18 +1053,34 @@ static void on_present(effect_runtime *runtime)
 {
 	if (s_do_capture)
 	{
-		reshade::log_message(reshade::log_level::info, "present()");
-		reshade::log_message(reshade::log_level::info, "--- End Frame ---");
-		s_do_capture = false;
+		trace(trace_event::present);
+		trace(trace_event::end_frame);
+
+		if (--s_frames_left != 0)
+		{
+			trace(trace_event::begin_frame);
+		}
+		else
+		{
+			s_do_capture = false;
+			end_capture();
+		}
 	}
 	else
 	{
 		// The keyboard shortcut to trigger logging
 		if (runtime->is_key_pressed(VK_F10))
 		{
-			s_do_capture = true;
-			reshade::log_message(reshade::log_level::info, "--- Frame ---");
+			s_frames_left = TRACE_FRAME_COUNT;
+			begin_capture();
+		}
+#if TRACE_BINARY_FILE
+		// The keyboard shortcut to replay the last capture on the device of this runtime and log how long each frame took
+		else if (runtime->is_key_pressed(VK_F11))
+		{
+			replay_last_capture(runtime->get_device(), runtime->get_command_queue());
 		}
+#endif
 	}
 }
 
@@ -930,8 +1103,13 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 		reshade::register_event<reshade::addon_event::destroy_resource>(on_destroy_resource);
 		reshade::register_event<reshade::addon_event::init_resource_view>(on_init_resource_view);
 		reshade::register_event<reshade::addon_event::destroy_resource_view>(on_destroy_resource_view);
+#if TRACE_TRACK_OBJECTS
 		reshade::register_event<reshade::addon_event::init_pipeline>(on_init_pipeline);
 		reshade::register_event<reshade::addon_event::destroy_pipeline>(on_destroy_pipeline);
+#endif
+#if TRACE_BINARY_FILE
+		reshade::register_event<reshade::addon_event::destroy_device>(on_destroy_device);
+#endif
 
 		reshade::register_event<reshade::addon_event::barrier>(on_barrier);
 		reshade::register_event<reshade::addon_event::begin_render_pass>(on_begin_render_pass);
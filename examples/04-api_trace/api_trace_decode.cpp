@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#include "../../source/api_trace_format.hpp"
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+using namespace api_trace;
+
+static void print_usage(const wchar_t *path)
+{
+	wprintf(LR"(usage: %s [options] <trace file>
+
+Turns a binary trace file written by the API trace add-on into text.
+
+Options:
+  -h, --help                Print this help.
+  -o <file>                 Write text to the given file, instead of standard output.
+  --timestamps              Prefix each line with the time in microseconds since the first call and the thread that made it.
+)", path);
+}
+
+int wmain(int argc, wchar_t *argv[])
+{
+	const wchar_t *input_path = nullptr;
+	const wchar_t *output_path = nullptr;
+	bool print_timestamps = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const wchar_t *const arg = argv[i];
+
+		if (wcscmp(arg, L"-h") == 0 || wcscmp(arg, L"--help") == 0)
+		{
+			print_usage(argv[0]);
+			return 0;
+		}
+		else if (wcscmp(arg, L"-o") == 0 && i + 1 < argc)
+		{
+			output_path = argv[++i];
+		}
+		else if (wcscmp(arg, L"--timestamps") == 0)
+		{
+			print_timestamps = true;
+		}
+		else
+		{
+			input_path = arg;
+		}
+	}
+
+	if (input_path == nullptr)
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	std::ifstream input(std::filesystem::path(input_path), std::ios::binary);
+	if (!input)
+	{
+		wprintf(L"Failed to open '%s'!\n", input_path);
+		return 1;
+	}
+
+	trace_file_header header;
+	std::vector<trace_call> calls;
+	if (!read_trace_file(input, header, calls))
+	{
+		wprintf(L"'%s' is not an API trace file or has an unsupported version!\n", input_path);
+		return 1;
+	}
+
+	std::ofstream output_file;
+	if (output_path != nullptr)
+	{
+		output_file.open(std::filesystem::path(output_path));
+		if (!output_file)
+		{
+			wprintf(L"Failed to open '%s' for writing!\n", output_path);
+			return 1;
+		}
+	}
+
+	std::ostream &output = output_path != nullptr ? output_file : std::cout;
+
+	const uint64_t first_timestamp = calls.empty() ? 0 : calls.front().timestamp;
+
+	for (const trace_call &call : calls)
+	{
+		if (print_timestamps)
+		{
+			const double microseconds = header.timestamp_frequency != 0 ? (call.timestamp - first_timestamp) * 1000000.0 / header.timestamp_frequency : 0.0;
+			output << '[' << static_cast<uint64_t>(microseconds) << " us, thread " << call.thread_id << "] ";
+		}
+
+		format_trace_event(output, call.event, call.args.data(), static_cast<uint32_t>(call.args.size()));
+		output << '\n';
+	}
+
+	return 0;
+}
@@ -8,6 +8,7 @@
 
 #include <reshade.hpp>
 #include "crc32_hash.hpp"
+#include "replacement_index.hpp"
 #include <fstream>
 #include <filesystem>
 
@@ -29,22 +30,21 @@ static bool load_shader_code(device_api device_type, shader_desc &desc, std::vec
 	else if (device_type == device_api::opengl)
 		extension = L".glsl"; // OpenGL otherwise uses plain text GLSL
 
-	// Prepend executable file name to image files
-	wchar_t file_prefix[MAX_PATH] = L"";
-	GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
+	// Scan the directory with replacement shaders once, instead of querying the file system for every shader
+	static replacement_index s_index([]() {
+		// Prepend executable directory to shader files
+		wchar_t file_prefix[MAX_PATH] = L"";
+		GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
 
-	std::filesystem::path replace_path = file_prefix;
-	replace_path  = replace_path.parent_path();
-	replace_path /= LOAD_DIR;
-
-	wchar_t hash_string[11];
-	swprintf_s(hash_string, L"0x%08X", shader_hash);
-
-	replace_path /= hash_string;
-	replace_path += extension;
+		std::filesystem::path replace_dir = file_prefix;
+		replace_dir  = replace_dir.parent_path();
+		replace_dir /= LOAD_DIR;
+		return replace_dir;
+	}());
 
 	// Check if a replacement file for this shader hash exists and if so, overwrite the shader code with its contents
-	if (!std::filesystem::exists(replace_path))
+	std::filesystem::path replace_path;
+	if (!s_index.find(shader_hash, extension, replace_path))
 		return false;
 
 	std::ifstream file(replace_path, std::ios::binary);
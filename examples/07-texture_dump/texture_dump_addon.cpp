@@ -9,6 +9,7 @@ using namespace reshade::api;
 
 // See implementation in 'utils\save_texture_image.cpp'
 extern bool save_texture_image(const resource_desc &desc, const subresource_data &data);
+extern void flush_texture_images();
 
 // There are multiple different ways textures can be initialized, so try and intercept them all
 // - Via initial data provided during texture creation (e.g. for immutable textures, common in D3D11 and OpenGL): See 'on_init_texture' implementation below
@@ -16,6 +17,12 @@ extern bool save_texture_image(const resource_desc &desc, const subresource_data
 // - Via a copy operation from a buffer in host memory to the texture (common in D3D12 and Vulkan): See 'on_copy_buffer_to_texture' implementation below
 // - Via mapping and writing to texture that is accessible in host memory (common in D3D9): See 'on_map_texture' and 'on_unmap_texture' implementation below
 
+// Textures are saved in the background, so wait for any that are still queued before the add-on may be unloaded
+static void on_destroy_device(device *)
+{
+	flush_texture_images();
+}
+
 static inline bool filter_texture(device *device, const resource_desc &desc, const subresource_box *box)
 {
 	if (desc.type != resource_type::texture_2d || (desc.usage & resource_usage::shader_resource) == resource_usage::undefined || (desc.heap != memory_heap::gpu_only && desc.heap != memory_heap::unknown) || (desc.flags & resource_flags::dynamic) == resource_flags::dynamic)
@@ -137,6 +144,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 	case DLL_PROCESS_ATTACH:
 		if (!reshade::register_addon(hModule))
 			return FALSE;
+		reshade::register_event<reshade::addon_event::destroy_device>(on_destroy_device);
 		reshade::register_event<reshade::addon_event::init_resource>(on_init_texture);
 		reshade::register_event<reshade::addon_event::update_texture_region>(on_update_texture);
 		reshade::register_event<reshade::addon_event::copy_buffer_to_texture>(on_copy_buffer_to_texture);
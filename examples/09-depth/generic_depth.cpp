@@ -488,6 +488,9 @@ static bool on_create_resource(device *device, resource_desc &desc, subresource_
 	case device_api::opengl:
 		// No need to change anything in OpenGL
 		return false;
+	default:
+		// Nothing to change on devices that never execute commands either
+		return false;
 	}
 
 	return true;
@@ -77,8 +77,14 @@ static void on_init_device(device *device)
 		return;
 	}
 }
+// See implementation in 'utils\save_texture_image.cpp'
+extern void flush_texture_images();
+
 static void on_destroy_device(device *device)
 {
+	// Wait for any textures that are still being saved in the background before the add-on may be unloaded
+	flush_texture_images();
+
 	auto &data = device->get_private_data<device_data>();
 
 	device->destroy_resource(data.green_texture);
@@ -12,6 +12,7 @@
 
 #include <reshade.hpp>
 #include "crc32_hash.hpp"
+#include "replacement_index.hpp"
 #include <vector>
 #include <filesystem>
 #include <stb_image.h>
@@ -35,22 +36,21 @@ bool load_texture_image(const resource_desc &desc, subresource_data &data, std::
 		format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height));
 #endif
 
-	// Prepend executable directory to image files
-	wchar_t file_prefix[MAX_PATH] = L"";
-	GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
+	// Scan the directory with replacement images once, instead of querying the file system for every texture
+	static replacement_index s_index([]() {
+		// Prepend executable directory to image files
+		wchar_t file_prefix[MAX_PATH] = L"";
+		GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
 
-	std::filesystem::path replace_path = file_prefix;
-	replace_path  = replace_path.parent_path();
-	replace_path /= LOAD_DIR;
-
-	wchar_t hash_string[11];
-	swprintf_s(hash_string, L"0x%08X", hash);
-
-	replace_path /= hash_string;
-	replace_path += LOAD_FORMAT;
+		std::filesystem::path replace_dir = file_prefix;
+		replace_dir  = replace_dir.parent_path();
+		replace_dir /= LOAD_DIR;
+		return replace_dir;
+	}());
 
 	// Check if a replacement file for this texture hash exists and if so, overwrite the texture data with its contents
-	if (!std::filesystem::exists(replace_path))
+	std::filesystem::path replace_path;
+	if (!s_index.find(hash, LOAD_FORMAT, replace_path))
 		return false;
 
 	int width = 0, height = 0, channels = 0;
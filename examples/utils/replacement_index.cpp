@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#include "replacement_index.hpp"
+#include <Windows.h>
+#include <cwchar>
+
+// Minimum amount of time between two checks for changes to the directory, so that look ups usually do not need to enter the kernel
+static constexpr uint64_t CHANGE_CHECK_INTERVAL_MS = 250;
+
+replacement_index::replacement_index(const std::filesystem::path &directory) :
+	_directory(directory)
+{
+	// Only watch for files being added, removed or renamed, since the index only stores file names (so unrelated writes, like to log files, do not cause a rescan)
+	_change_notification = FindFirstChangeNotificationW(_directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME);
+	if (_change_notification == INVALID_HANDLE_VALUE)
+		_change_notification = nullptr;
+
+	_last_change_check = GetTickCount64();
+
+	scan();
+}
+replacement_index::~replacement_index()
+{
+	if (_change_notification != nullptr)
+		FindCloseChangeNotification(_change_notification);
+}
+
+bool replacement_index::find(uint32_t hash, const wchar_t *extension, std::filesystem::path &path)
+{
+	check_for_changes();
+
+	const std::shared_lock<std::shared_mutex> lock(_mutex);
+
+	if (const auto it = _files.find(hash); it != _files.end())
+	{
+		for (const std::filesystem::path &file_path : it->second)
+		{
+			if (_wcsicmp(file_path.extension().c_str(), extension) == 0)
+			{
+				path = file_path;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void replacement_index::check_for_changes()
+{
+	const uint64_t now = GetTickCount64();
+
+	if (now - _last_change_check.load(std::memory_order_relaxed) < CHANGE_CHECK_INTERVAL_MS)
+		return;
+
+	// Let only a single thread check for changes, while all others continue to use the current index
+	const std::unique_lock<std::mutex> lock(_change_mutex, std::try_to_lock);
+	if (!lock.owns_lock())
+		return;
+
+	_last_change_check.store(now, std::memory_order_relaxed);
+
+	if (_change_notification == nullptr)
+	{
+		// The directory may not have existed yet when the index was created, so try again to watch it
+		_change_notification = FindFirstChangeNotificationW(_directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME);
+		if (_change_notification == INVALID_HANDLE_VALUE)
+		{
+			_change_notification = nullptr;
+			return;
+		}
+	}
+	else if (WaitForSingleObject(_change_notification, 0) == WAIT_OBJECT_0)
+	{
+		FindNextChangeNotification(_change_notification);
+	}
+	else
+	{
+		return;
+	}
+
+	scan();
+}
+
+void replacement_index::scan()
+{
+	std::unordered_map<uint32_t, std::vector<std::filesystem::path>> files;
+
+	std::error_code ec;
+	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(_directory, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		if (!entry.is_regular_file(ec))
+			continue;
+
+		// Parse file names in the format "0x%08X.ext"
+		const std::wstring stem = entry.path().stem().native();
+		if (stem.size() != 10 || stem[0] != L'0' || (stem[1] != L'x' && stem[1] != L'X'))
+			continue;
+
+		wchar_t *hash_end = nullptr;
+		const unsigned long hash = std::wcstoul(stem.c_str() + 2, &hash_end, 16);
+		if (hash_end != stem.c_str() + stem.size())
+			continue;
+
+		files[static_cast<uint32_t>(hash)].push_back(entry.path());
+	}
+
+	const std::unique_lock<std::shared_mutex> lock(_mutex);
+	_files = std::move(files);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <filesystem>
+#include <shared_mutex>
+#include <unordered_map>
+
+/// <summary>
+/// An in-memory index of the replacement files in a directory, whose names are a hash in the format "0x%08X" followed by a file extension.
+/// The directory is scanned once and then rescanned only when files in it are added, removed or renamed, so that looking up a hash does not touch the file system.
+/// </summary>
+class replacement_index
+{
+public:
+	explicit replacement_index(const std::filesystem::path &directory);
+	~replacement_index();
+
+	replacement_index(const replacement_index &) = delete;
+	replacement_index &operator=(const replacement_index &) = delete;
+
+	/// <summary>
+	/// Finds the replacement file for the specified <paramref name="hash"/>.
+	/// </summary>
+	/// <param name="hash">Hash of the resource to replace.</param>
+	/// <param name="extension">File extension of the replacement file (including the leading dot).</param>
+	/// <param name="path">Receives the path to the replacement file.</param>
+	/// <returns><see langword="true"/> if a replacement file exists, <see langword="false"/> otherwise.</returns>
+	bool find(uint32_t hash, const wchar_t *extension, std::filesystem::path &path);
+
+private:
+	void check_for_changes();
+	void scan();
+
+	const std::filesystem::path _directory;
+	void *_change_notification = nullptr;
+	std::atomic<uint64_t> _last_change_check = 0;
+	std::mutex _change_mutex;
+	std::shared_mutex _mutex;
+	std::unordered_map<uint32_t, std::vector<std::filesystem::path>> _files;
+};
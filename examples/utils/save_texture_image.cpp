@@ -9,428 +9,333 @@
 #define SAVE_HASH_TEXMOD 1
 // Skip any textures that were already dumped this session, to reduce lag at the cost of increased memory usage
 #define SAVE_ENABLE_HASH_SET 1
+// Number of background threads that convert, encode and write textures (zero to choose based on the number of processor cores)
+#define SAVE_THREAD_COUNT 0
+// Maximum amount of texture data that may be waiting to be saved at any time
+#define SAVE_QUEUE_MEMORY_LIMIT (256 * 1024 * 1024)
+// Maximum amount of memory kept around in unused buffers for later textures
+#define SAVE_POOL_MEMORY_LIMIT (64 * 1024 * 1024)
+// Stall the calling thread until there is room in the queue when it is full, instead of skipping the texture (which is then saved the next time it is uploaded)
+#define SAVE_QUEUE_BLOCK_WHEN_FULL 0
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 
 #include <reshade.hpp>
+#include <reshade_api_format_convert.hpp>
 #include "crc32_hash.hpp"
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <vector>
+#include <algorithm>
 #include <filesystem>
+#include <condition_variable>
 #include <stb_image_write.h>
 
 #if SAVE_ENABLE_HASH_SET
-#include <set>
+#include <unordered_set>
 #endif
 
 using namespace reshade::api;
 
-static void unpack_r5g6b5(uint16_t data, uint8_t rgb[3])
+/// <summary>
+/// A bounded queue of textures waiting to be saved, which are converted, encoded and written to disk by a set of background threads.
+/// This keeps the thread that uploads a texture from being blocked by anything more than hashing and copying the data.
+/// </summary>
+class save_texture_queue
 {
-	uint32_t temp;
-	temp =  (data           >> 11) * 255 + 16;
-	rgb[0] = static_cast<uint8_t>((temp / 32 + temp) / 32);
-	temp = ((data & 0x07E0) >>  5) * 255 + 32;
-	rgb[1] = static_cast<uint8_t>((temp / 64 + temp) / 64);
-	temp =  (data & 0x001F)        * 255 + 16;
-	rgb[2] = static_cast<uint8_t>((temp / 32 + temp) / 32);
-}
-static void unpack_bc1_value(const uint8_t color_0[3], const uint8_t color_1[3], uint32_t color_index, uint8_t result[4], bool not_degenerate = true)
-{
-	switch (color_index)
+	struct job
 	{
-	case 0:
-		for (int c = 0; c < 3; ++c)
-			result[c] = color_0[c];
-		result[3] = 255;
-		break;
-	case 1:
-		for (int c = 0; c < 3; ++c)
-			result[c] = color_1[c];
-		result[3] = 255;
-		break;
-	case 2:
-		for (int c = 0; c < 3; ++c)
-			result[c] = not_degenerate ? (2 * color_0[c] + color_1[c]) / 3 : (color_0[c] + color_1[c]) / 2;
-		result[3] = 255;
-		break;
-	case 3:
-		for (int c = 0; c < 3; ++c)
-			result[c] = not_degenerate ? (color_0[c] + 2 * color_1[c]) / 3 : 0;
-		result[3] = not_degenerate ? 255 : 0;
-		break;
-	}
-}
-static void unpack_bc4_value(uint8_t alpha_0, uint8_t alpha_1, uint32_t alpha_index, uint8_t *result)
-{
-	const bool interpolation_type = alpha_0 > alpha_1;
-
-	switch (alpha_index)
+		resource_desc desc;
+		uint32_t row_pitch;
+		uint32_t hash;
+		std::vector<uint8_t> data;
+	};
+
+public:
+	~save_texture_queue()
 	{
-	case 0:
-		*result = alpha_0;
-		break;
-	case 1:
-		*result = alpha_1;
-		break;
-	case 2:
-		*result = interpolation_type ? (6 * alpha_0 + 1 * alpha_1) / 7 : (4 * alpha_0 + 1 * alpha_1) / 5;
-		break;
-	case 3:
-		*result = interpolation_type ? (5 * alpha_0 + 2 * alpha_1) / 7 : (3 * alpha_0 + 2 * alpha_1) / 5;
-		break;
-	case 4:
-		*result = interpolation_type ? (4 * alpha_0 + 3 * alpha_1) / 7 : (2 * alpha_0 + 3 * alpha_1) / 5;
-		break;
-	case 5:
-		*result = interpolation_type ? (3 * alpha_0 + 4 * alpha_1) / 7 : (1 * alpha_0 + 4 * alpha_1) / 5;
-		break;
-	case 6:
-		*result = interpolation_type ? (2 * alpha_0 + 5 * alpha_1) / 7 : 0;
-		break;
-	case 7:
-		*result = interpolation_type ? (1 * alpha_0 + 6 * alpha_1) / 7 : 255;
-		break;
+		// Cannot join here, since this runs during DLL unload with the loader lock held, which the worker threads need in order to exit.
+		// They are normally stopped in 'flush' already when the device is destroyed, and are terminated by the system anyway when the process exits.
+		for (std::thread &worker : _workers)
+			worker.detach();
 	}
-}
 
-bool save_texture_image(const resource_desc &desc, const subresource_data &data)
-{
-#if SAVE_HASH_TEXMOD
-	// Behavior of the original TexMod (see https://github.com/codemasher/texmod/blob/master/uMod_DX9/uMod_TextureFunction.cpp#L41)
-	const uint32_t hash = ~compute_crc32(
-		static_cast<const uint8_t *>(data.data),
-		desc.texture.height * static_cast<size_t>(
-			(desc.texture.format >= format::bc1_typeless && desc.texture.format <= format::bc1_unorm_srgb) || (desc.texture.format >= format::bc4_typeless && desc.texture.format <= format::bc4_snorm) ? (desc.texture.width * 4) / 8 :
-			(desc.texture.format >= format::bc2_typeless && desc.texture.format <= format::bc2_unorm_srgb) || (desc.texture.format >= format::bc3_typeless && desc.texture.format <= format::bc3_unorm_srgb) || (desc.texture.format >= format::bc5_typeless && desc.texture.format <= format::bc7_unorm_srgb) ? desc.texture.width :
-			format_row_pitch(desc.texture.format, desc.texture.width)));
-#else
-	// Correct hash calculation using entire resource data
-	const uint32_t hash = compute_crc32(
-		static_cast<const uint8_t *>(data.data),
-		format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height));
-#endif
-
-#if SAVE_ENABLE_HASH_SET
-	static std::set<uint32_t> hash_set;
-	if (hash_set.find(hash) != hash_set.end())
+	/// <summary>
+	/// Marks a texture as saved and returns whether it was not marked before, so that each texture is only saved once per session.
+	/// </summary>
+	bool insert_hash(uint32_t hash)
 	{
-		reshade::log_message(reshade::log_level::error, "Skipped texture that was already dumped.");
+#if SAVE_ENABLE_HASH_SET
+		const std::unique_lock<std::mutex> lock(_hash_set_mutex);
+		return _hash_set.insert(hash).second;
+#else
 		return true;
+#endif
 	}
-	else
+	/// <summary>
+	/// Removes the mark from a texture, so that it is saved again the next time it is encountered.
+	/// </summary>
+	void erase_hash(uint32_t hash)
 	{
-		hash_set.insert(hash);
-	}
+#if SAVE_ENABLE_HASH_SET
+		const std::unique_lock<std::mutex> lock(_hash_set_mutex);
+		_hash_set.erase(hash);
+#else
+		(void)hash;
 #endif
+	}
 
-	const uint32_t block_count_x = (desc.texture.width + 3) / 4;
-	const uint32_t block_count_y = (desc.texture.height + 3) / 4;
+	/// <summary>
+	/// Copies the texture data and adds it to the queue.
+	/// </summary>
+	/// <returns><see langword="true"/> if the texture was queued, or <see langword="false"/> if it was skipped because the queue is full or shutting down.</returns>
+	bool push(const resource_desc &desc, const subresource_data &data, uint32_t hash)
+	{
+		const size_t size = format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height);
 
-	uint8_t *data_p = static_cast<uint8_t *>(data.data);
-	// Add sufficient padding for block compressed textures that are not a multiple of 4 in all dimensions
-	std::vector<uint8_t> rgba_pixel_data((block_count_x * 4) * (block_count_y * 4) * 4);
+		job new_job;
+		new_job.desc = desc;
+		new_job.row_pitch = data.row_pitch;
+		new_job.hash = hash;
 
-	switch (desc.texture.format)
-	{
-	case format::l8_unorm:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
+		{ std::unique_lock<std::mutex> lock(_mutex);
 
-				dst[0] = src[0];
-				dst[1] = src[0];
-				dst[2] = src[0];
-				dst[3] = 255;
-			}
-		}
-		break;
-	case format::a8_unorm:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
+			// Always accept a texture when the queue is empty, so that textures larger than the limit can still be saved
+			const auto has_room = [this, size]() { return _queued_bytes == 0 || _queued_bytes + size <= SAVE_QUEUE_MEMORY_LIMIT; };
 
-				dst[0] = 0;
-				dst[1] = 0;
-				dst[2] = 0;
-				dst[3] = src[0];
-			}
-		}
-		break;
-	case format::r8_typeless:
-	case format::r8_unorm:
-	case format::r8_snorm:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
+#if SAVE_QUEUE_BLOCK_WHEN_FULL
+			_space_available.wait(lock, [this, &has_room]() { return has_room() || _stop; });
+#endif
+			if (_stop || !has_room())
+				return false;
 
-				dst[0] = src[0];
-				dst[1] = 0;
-				dst[2] = 0;
-				dst[3] = 255;
-			}
+			_queued_bytes += size;
+			_num_pending_pushes++;
+
+			new_job.data = acquire_buffer(size);
+
+			if (_workers.empty())
+				start_workers();
 		}
-		break;
-	case format::l8a8_unorm:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x * 2;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
 
-				dst[0] = src[0];
-				dst[1] = src[0];
-				dst[2] = src[0];
-				dst[3] = src[1];
-			}
+		// Copy outside the lock, so that multiple threads can copy at the same time
+		std::memcpy(new_job.data.data(), data.data, size);
+
+		{ const std::unique_lock<std::mutex> lock(_mutex);
+			_jobs.push_back(std::move(new_job));
+			_num_pending_pushes--;
 		}
-		break;
-	case format::r8g8_typeless:
-	case format::r8g8_unorm:
-	case format::r8g8_snorm:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x * 2;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
 
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = 0;
-				dst[3] = 255;
-			}
+		_job_available.notify_one();
+
+		return true;
+	}
+
+	/// <summary>
+	/// Waits for all queued textures to be saved and stops the worker threads (they are started again when the next texture is queued).
+	/// </summary>
+	void flush()
+	{
+		std::vector<std::thread> workers;
+
+		{ const std::unique_lock<std::mutex> lock(_mutex);
+			_stop = true;
+			workers = std::move(_workers);
 		}
-		break;
-	case format::r8g8b8a8_typeless:
-	case format::r8g8b8a8_unorm:
-	case format::r8g8b8a8_unorm_srgb:
-	case format::r8g8b8x8_unorm:
-	case format::r8g8b8x8_unorm_srgb:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x * 4;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
 
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-			}
+		_job_available.notify_all();
+		_space_available.notify_all();
+
+		// Workers only exit once the queue is empty and no more textures are being copied into it
+		for (std::thread &worker : workers)
+			worker.join();
+
+		{ const std::unique_lock<std::mutex> lock(_mutex);
+			_stop = false;
+			_buffer_pool.clear();
+			_pooled_bytes = 0;
 		}
-		break;
-	case format::b8g8r8a8_typeless:
-	case format::b8g8r8a8_unorm:
-	case format::b8g8r8a8_unorm_srgb:
-	case format::b8g8r8x8_typeless:
-	case format::b8g8r8x8_unorm:
-	case format::b8g8r8x8_unorm_srgb:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
+	}
+
+private:
+	void start_workers()
+	{
+		uint32_t num_threads = SAVE_THREAD_COUNT;
+		if (num_threads == 0)
+			// Leave half of the cores to the application
+			num_threads = std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+
+		if (_dump_path.empty())
 		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x * 4;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
-
-				// Swap red and blue channel
-				dst[0] = src[2];
-				dst[1] = src[1];
-				dst[2] = src[0];
-				dst[3] = src[3];
-			}
+			// Prepend executable directory to image files
+			wchar_t file_prefix[MAX_PATH] = L"";
+			GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
+
+			_dump_path = file_prefix;
+			_dump_path = _dump_path.parent_path();
+			_dump_path /= SAVE_DIR;
 		}
-		break;
-	case format::bc1_typeless:
-	case format::bc1_unorm:
-	case format::bc1_unorm_srgb:
-		// See https://docs.microsoft.com/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc1
-		for (size_t block_y = 0; block_y < block_count_y; ++block_y, data_p += data.row_pitch)
+
+		std::error_code ec;
+		std::filesystem::create_directory(_dump_path, ec);
+
+		for (uint32_t i = 0; i < num_threads; ++i)
+			_workers.emplace_back(&save_texture_queue::worker_main, this);
+	}
+
+	void worker_main()
+	{
+		// Reuse conversion buffer between textures
+		std::vector<uint8_t> rgba_pixel_data;
+
+		while (true)
 		{
-			for (size_t block_x = 0; block_x < block_count_x; ++block_x)
-			{
-				const uint8_t *const src = data_p + block_x * 8;
-
-				const uint16_t color_0 = *reinterpret_cast<const uint16_t *>(src);
-				const uint16_t color_1 = *reinterpret_cast<const uint16_t *>(src + 2);
-				const uint32_t color_i = *reinterpret_cast<const uint32_t *>(src + 4);
-
-				uint8_t color_0_rgb[3];
-				unpack_r5g6b5(color_0, color_0_rgb);
-				uint8_t color_1_rgb[3];
-				unpack_r5g6b5(color_1, color_1_rgb);
-				const bool degenerate = color_0 > color_1;
-
-				for (int y = 0; y < 4; ++y)
-				{
-					for (int x = 0; x < 4; ++x)
-					{
-						uint8_t *const dst = rgba_pixel_data.data() + ((block_y * 4 + y) * desc.texture.width + (block_x * 4 + x)) * 4;
-
-						unpack_bc1_value(color_0_rgb, color_1_rgb, (color_i >> (2 * (y * 4 + x))) & 0x3, dst, degenerate);
-					}
-				}
+			job current_job;
+
+			{ std::unique_lock<std::mutex> lock(_mutex);
+				_job_available.wait(lock, [this]() { return !_jobs.empty() || (_stop && _num_pending_pushes == 0); });
+
+				if (_jobs.empty())
+					break;
+
+				current_job = std::move(_jobs.front());
+				_jobs.pop_front();
 			}
-		}
-		break;
-	case format::bc3_typeless:
-	case format::bc3_unorm:
-	case format::bc3_unorm_srgb:
-		// See https://docs.microsoft.com/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc3
-		for (size_t block_y = 0; block_y < block_count_y; ++block_y, data_p += data.row_pitch)
-		{
-			for (size_t block_x = 0; block_x < block_count_x; ++block_x)
+
+			if (!write_image(current_job, rgba_pixel_data))
 			{
-				const uint8_t *const src = data_p + block_x * 16;
-
-				const uint8_t  alpha_0 = src[0];
-				const uint8_t  alpha_1 = src[1];
-				const uint64_t alpha_i =
-					(static_cast<uint64_t>(src[2])      ) |
-					(static_cast<uint64_t>(src[3]) <<  8) |
-					(static_cast<uint64_t>(src[4]) << 16) |
-					(static_cast<uint64_t>(src[5]) << 24) |
-					(static_cast<uint64_t>(src[6]) << 32) |
-					(static_cast<uint64_t>(src[7]) << 40);
-
-				const uint16_t color_0 = *reinterpret_cast<const uint16_t *>(src + 8);
-				const uint16_t color_1 = *reinterpret_cast<const uint16_t *>(src + 10);
-				const uint32_t color_i = *reinterpret_cast<const uint32_t *>(src + 12);
-
-				uint8_t color_0_rgb[3];
-				unpack_r5g6b5(color_0, color_0_rgb);
-				uint8_t color_1_rgb[3];
-				unpack_r5g6b5(color_1, color_1_rgb);
-
-				for (int y = 0; y < 4; ++y)
-				{
-					for (int x = 0; x < 4; ++x)
-					{
-						uint8_t *const dst = rgba_pixel_data.data() + ((block_y * 4 + y) * desc.texture.width + (block_x * 4 + x)) * 4;
-
-						unpack_bc1_value(color_0_rgb, color_1_rgb, (color_i >> (2 * (y * 4 + x))) & 0x3, dst);
-						unpack_bc4_value(alpha_0, alpha_1, (alpha_i >> (3 * (y * 4 + x))) & 0x7, dst + 3);
-					}
-				}
+				reshade::log_message(reshade::log_level::error, "Failed to save texture image!");
+				erase_hash(current_job.hash);
 			}
-		}
-		break;
-	case format::bc4_typeless:
-	case format::bc4_unorm:
-	case format::bc4_snorm:
-		// See https://docs.microsoft.com/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc4
-		for (size_t block_y = 0; block_y < block_count_y; ++block_y, data_p += data.row_pitch)
-		{
-			for (size_t block_x = 0; block_x < block_count_x; ++block_x)
-			{
-				const uint8_t *const src = data_p + block_x * 8;
-
-				const uint8_t  red_0 = src[0];
-				const uint8_t  red_1 = src[1];
-				const uint64_t red_i =
-					(static_cast<uint64_t>(src[2])      ) |
-					(static_cast<uint64_t>(src[3]) <<  8) |
-					(static_cast<uint64_t>(src[4]) << 16) |
-					(static_cast<uint64_t>(src[5]) << 24) |
-					(static_cast<uint64_t>(src[6]) << 32) |
-					(static_cast<uint64_t>(src[7]) << 40);
-
-				for (int y = 0; y < 4; ++y)
-				{
-					for (int x = 0; x < 4; ++x)
-					{
-						uint8_t *const dst = rgba_pixel_data.data() + ((block_y * 4 + y) * desc.texture.width + (block_x * 4 + x)) * 4;
-
-						unpack_bc4_value(red_0, red_1, (red_i >> (3 * (y * 4 + x))) & 0x7, dst);
-						dst[1] = dst[0];
-						dst[2] = dst[0];
-						dst[3] = 255;
-					}
-				}
+
+			{ const std::unique_lock<std::mutex> lock(_mutex);
+				_queued_bytes -= current_job.data.size();
+				release_buffer(std::move(current_job.data));
 			}
+
+			_space_available.notify_all();
 		}
-		break;
-	case format::bc5_typeless:
-	case format::bc5_unorm:
-	case format::bc5_snorm:
-		// See https://docs.microsoft.com/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc5
-		for (size_t block_y = 0; block_y < block_count_y; ++block_y, data_p += data.row_pitch)
+
+		// Wake up the other workers, in case they missed the stop request while a texture was still being copied
+		_job_available.notify_all();
+	}
+
+	bool write_image(const job &current_job, std::vector<uint8_t> &rgba_pixel_data) const
+	{
+		const resource_desc &desc = current_job.desc;
+
+		rgba_pixel_data.resize(static_cast<size_t>(desc.texture.width) * static_cast<size_t>(desc.texture.height) * 4);
+
+		// Already running in parallel with the other workers, so decode on this thread only
+		if (!convert_texture_to_rgba8(desc.texture.format, desc.texture.width, desc.texture.height, current_job.data.data(), current_job.row_pitch, rgba_pixel_data.data(), desc.texture.width * 4, 1))
+			return false; // Unsupported format
+
+		wchar_t hash_string[11];
+		swprintf_s(hash_string, L"0x%08X", current_job.hash);
+
+		std::filesystem::path dump_path = _dump_path;
+		dump_path /= hash_string;
+		dump_path += SAVE_FORMAT;
+
+		if (dump_path.extension() == L".bmp")
+			return stbi_write_bmp(dump_path.u8string().c_str(), desc.texture.width, desc.texture.height, 4, rgba_pixel_data.data()) != 0;
+		else if (dump_path.extension() == L".png")
+			return stbi_write_png(dump_path.u8string().c_str(), desc.texture.width, desc.texture.height, 4, rgba_pixel_data.data(), desc.texture.width * 4) != 0;
+		else
+			return false;
+	}
+
+	std::vector<uint8_t> acquire_buffer(size_t size)
+	{
+		// Pick the smallest pooled buffer that is large enough, to avoid wasting large buffers on small textures
+		auto best = _buffer_pool.end();
+		for (auto it = _buffer_pool.begin(); it != _buffer_pool.end(); ++it)
+			if (it->capacity() >= size && (best == _buffer_pool.end() || it->capacity() < best->capacity()))
+				best = it;
+
+		std::vector<uint8_t> buffer;
+		if (best != _buffer_pool.end())
 		{
-			for (size_t block_x = 0; block_x < block_count_x; ++block_x)
-			{
-				const uint8_t *const src = data_p + block_x * 16;
-
-				const uint8_t  red_0 = src[0];
-				const uint8_t  red_1 = src[1];
-				const uint64_t red_i =
-					(static_cast<uint64_t>(src[2])      ) |
-					(static_cast<uint64_t>(src[3]) <<  8) |
-					(static_cast<uint64_t>(src[4]) << 16) |
-					(static_cast<uint64_t>(src[5]) << 24) |
-					(static_cast<uint64_t>(src[6]) << 32) |
-					(static_cast<uint64_t>(src[7]) << 40);
-
-				const uint8_t  green_0 = src[8];
-				const uint8_t  green_1 = src[9];
-				const uint64_t green_i =
-					(static_cast<uint64_t>(src[10])      ) |
-					(static_cast<uint64_t>(src[11]) <<  8) |
-					(static_cast<uint64_t>(src[12]) << 16) |
-					(static_cast<uint64_t>(src[13]) << 24) |
-					(static_cast<uint64_t>(src[14]) << 32) |
-					(static_cast<uint64_t>(src[15]) << 40);
-
-				for (int y = 0; y < 4; ++y)
-				{
-					for (int x = 0; x < 4; ++x)
-					{
-						uint8_t *const dst = rgba_pixel_data.data() + ((block_y * 4 + y) * desc.texture.width + (block_x * 4 + x)) * 4;
-
-						unpack_bc4_value(red_0, red_1, (red_i >> (3 * (y * 4 + x))) & 0x7, dst);
-						unpack_bc4_value(green_0, green_1, (green_i >> (3 * (y * 4 + x))) & 0x7, dst + 1);
-						dst[2] = 0;
-						dst[3] = 255;
-					}
-				}
-			}
+			_pooled_bytes -= best->capacity();
+			buffer = std::move(*best);
+			_buffer_pool.erase(best);
 		}
-		break;
-	default:
-		// Unsupported format
-		return false;
+
+		buffer.resize(size);
+		return buffer;
 	}
+	void release_buffer(std::vector<uint8_t> &&buffer)
+	{
+		if (_stop || _pooled_bytes + buffer.capacity() > SAVE_POOL_MEMORY_LIMIT)
+			return; // Free the memory instead
 
-	// Prepend executable directory to image files
-	wchar_t file_prefix[MAX_PATH] = L"";
-	GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
+		_pooled_bytes += buffer.capacity();
+		_buffer_pool.push_back(std::move(buffer));
+	}
 
-	std::filesystem::path dump_path = file_prefix;
-	dump_path  = dump_path.parent_path();
-	dump_path /= SAVE_DIR;
+	std::mutex _mutex;
+	std::condition_variable _job_available;
+	std::condition_variable _space_available;
+	std::deque<job> _jobs;
+	// Size of all textures that were queued, but not yet saved (including those currently being processed by a worker)
+	size_t _queued_bytes = 0;
+	// Number of textures that were accepted, but are still being copied before being added to the queue
+	size_t _num_pending_pushes = 0;
+	bool _stop = false;
+	std::vector<std::thread> _workers;
+	std::vector<std::vector<uint8_t>> _buffer_pool;
+	size_t _pooled_bytes = 0;
+	std::filesystem::path _dump_path;
 
-	if (std::filesystem::exists(dump_path) == false)
-		std::filesystem::create_directory(dump_path);
+#if SAVE_ENABLE_HASH_SET
+	std::mutex _hash_set_mutex;
+	std::unordered_set<uint32_t> _hash_set;
+#endif
+};
 
-	wchar_t hash_string[11];
-	swprintf_s(hash_string, L"0x%08X", hash);
+static save_texture_queue s_save_queue;
 
-	dump_path /= hash_string;
-	dump_path += SAVE_FORMAT;
+bool save_texture_image(const resource_desc &desc, const subresource_data &data)
+{
+	// Check whether the format can be converted before going through the trouble of copying the data (converting an empty texture does not touch any memory)
+	if (!convert_texture_to_rgba8(desc.texture.format, 0, 0, nullptr, 0, nullptr, 0))
+		return false; // Unsupported format
 
-	if (dump_path.extension() == L".bmp")
-		return stbi_write_bmp(dump_path.u8string().c_str(), desc.texture.width, desc.texture.height, 4, rgba_pixel_data.data()) != 0;
-	else if (dump_path.extension() == L".png")
-		return stbi_write_png(dump_path.u8string().c_str(), desc.texture.width, desc.texture.height, 4, rgba_pixel_data.data(), desc.texture.width * 4) != 0;
-	else
+#if SAVE_HASH_TEXMOD
+	// Behavior of the original TexMod (see https://github.com/codemasher/texmod/blob/master/uMod_DX9/uMod_TextureFunction.cpp#L41)
+	const uint32_t hash = ~compute_crc32(
+		static_cast<const uint8_t *>(data.data),
+		desc.texture.height * static_cast<size_t>(
+			(desc.texture.format >= format::bc1_typeless && desc.texture.format <= format::bc1_unorm_srgb) || (desc.texture.format >= format::bc4_typeless && desc.texture.format <= format::bc4_snorm) ? (desc.texture.width * 4) / 8 :
+			(desc.texture.format >= format::bc2_typeless && desc.texture.format <= format::bc2_unorm_srgb) || (desc.texture.format >= format::bc3_typeless && desc.texture.format <= format::bc3_unorm_srgb) || (desc.texture.format >= format::bc5_typeless && desc.texture.format <= format::bc7_unorm_srgb) ? desc.texture.width :
+			format_row_pitch(desc.texture.format, desc.texture.width)));
+#else
+	// Correct hash calculation using entire resource data
+	const uint32_t hash = compute_crc32(
+		static_cast<const uint8_t *>(data.data),
+		format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height));
+#endif
+
+	// Check and mark in one step, so that two threads uploading the same texture do not both queue it
+	if (!s_save_queue.insert_hash(hash))
+	{
+		reshade::log_message(reshade::log_level::error, "Skipped texture that was already dumped.");
+		return true;
+	}
+
+	if (!s_save_queue.push(desc, data, hash))
+	{
+		// Forget about the texture again, so that it is saved the next time it is uploaded
+		s_save_queue.erase_hash(hash);
+		reshade::log_message(reshade::log_level::warning, "Skipped texture because too many are waiting to be saved.");
 		return false;
+	}
+
+	return true;
+}
+
+void flush_texture_images()
+{
+	s_save_queue.flush();
 }
@@ -11,7 +11,7 @@
 #include <Windows.h>
 
 // Current version of the ReShade API
-#define RESHADE_API_VERSION 10
+#define RESHADE_API_VERSION 12
 
 // Optionally import ReShade API functions when 'RESHADE_API_LIBRARY' is defined instead of using header-only mode
 #if defined(RESHADE_API_LIBRARY) || defined(RESHADE_API_LIBRARY_EXPORT)
@@ -36,6 +36,9 @@ RESHADE_API_LIBRARY_DECL void ReShadeUnregisterAddon(HMODULE module);
 RESHADE_API_LIBRARY_DECL void ReShadeRegisterEvent(reshade::addon_event ev, void *callback);
 RESHADE_API_LIBRARY_DECL void ReShadeUnregisterEvent(reshade::addon_event ev, void *callback);
 
+RESHADE_API_LIBRARY_DECL void ReShadeRegisterBatchedEvent(reshade::addon_event ev, void *callback);
+RESHADE_API_LIBRARY_DECL void ReShadeUnregisterBatchedEvent(reshade::addon_event ev, void *callback);
+
 RESHADE_API_LIBRARY_DECL void ReShadeRegisterOverlay(const char *title, void(*callback)(reshade::api::effect_runtime *runtime));
 RESHADE_API_LIBRARY_DECL void ReShadeUnregisterOverlay(const char *title, void(*callback)(reshade::api::effect_runtime *runtime));
 
@@ -314,6 +317,48 @@ namespace reshade
 #endif
 	}
 
+	/// <summary>
+	/// Registers a batched callback for the specified command list event with ReShade.
+	/// <para>Instead of being called immediately whenever the application records the associated command, the event is recorded into a compact stream on the command list and the callback is called for all recorded events at once when that command list is executed (see <see cref="addon_event::execute_command_list"/>).</para>
+	/// <para>This is only supported for command list events whose arguments are plain values (like <see cref="addon_event::draw"/> or <see cref="addon_event::bind_pipeline"/>, see <see cref="is_batchable_addon_event"/>).</para>
+	/// <para>Since the commands were already recorded by the time batched callbacks are called, their return value is ignored and they cannot skip the command.</para>
+	/// </summary>
+	/// <param name="callback">Pointer to the callback function.</param>
+	/// <typeparam name="ev">Event to register the callback for.</typeparam>
+	template <addon_event ev>
+	inline void register_batched_event(typename addon_event_traits<ev>::decl callback)
+	{
+		static_assert(is_batchable_addon_event<ev>(), "Event cannot be batched!");
+
+#if defined(RESHADE_API_LIBRARY)
+		ReShadeRegisterBatchedEvent(ev, static_cast<void *>(callback));
+#else
+		static const auto func = reinterpret_cast<void(*)(addon_event, void *)>(
+			GetProcAddress(internal::get_reshade_module_handle(), "ReShadeRegisterBatchedEvent"));
+		if (func != nullptr)
+			func(ev, static_cast<void *>(callback));
+#endif
+	}
+	/// <summary>
+	/// Unregisters a batched callback from the specified event that was previously registered via <see cref="register_batched_event"/>.
+	/// </summary>
+	/// <param name="callback">Pointer to the callback function.</param>
+	/// <typeparam name="ev">Event to unregister the callback from.</typeparam>
+	template <addon_event ev>
+	inline void unregister_batched_event(typename addon_event_traits<ev>::decl callback)
+	{
+		static_assert(is_batchable_addon_event<ev>(), "Event cannot be batched!");
+
+#if defined(RESHADE_API_LIBRARY)
+		ReShadeUnregisterBatchedEvent(ev, static_cast<void *>(callback));
+#else
+		static const auto func = reinterpret_cast<void(*)(addon_event, void *)>(
+			GetProcAddress(internal::get_reshade_module_handle(), "ReShadeUnregisterBatchedEvent"));
+		if (func != nullptr)
+			func(ev, static_cast<void *>(callback));
+#endif
+	}
+
 	/// <summary>
 	/// Registers an overlay with ReShade.
 	/// <para>The callback function is then called when the overlay is visible and allows adding Dear ImGui widgets for user interaction.</para>
@@ -43,6 +43,23 @@ namespace reshade { namespace api
 		clipboard = 4,
 	};
 
+	/// <summary>
+	/// Statistics about a series of durations collected over a sliding window of recent samples.
+	/// All durations are in nanoseconds.
+	/// </summary>
+	struct duration_statistics
+	{
+		/// <summary>
+		/// Number of samples in the window.
+		/// </summary>
+		uint32_t sample_count;
+		uint64_t mean;
+		uint64_t p50;
+		uint64_t p95;
+		uint64_t p99;
+		uint64_t max;
+	};
+
 	/// <summary>
 	/// A post-processing effect runtime, used to control effects.
 	/// <para>ReShade associates an independent post-processing effect runtime with most swap chains.</para>
@@ -793,5 +810,19 @@ namespace reshade { namespace api
 		/// Overrides the color space used for presentation.
 		/// </summary>
 		virtual void set_color_space(color_space color_space) = 0;
+
+		/// <summary>
+		/// Gets statistics about the time between recent presents.
+		/// </summary>
+		/// <param name="out_statistics">Pointer to a variable that is set to the frame time statistics.</param>
+		virtual void get_frame_time_statistics(duration_statistics *out_statistics) const = 0;
+		/// <summary>
+		/// Gets statistics about the time recently spent rendering the specified <paramref name="technique"/>.
+		/// </summary>
+		/// <param name="technique">Opaque handle to the technique.</param>
+		/// <param name="out_cpu_statistics">Optional pointer to a variable that is set to the CPU time statistics.</param>
+		/// <param name="out_gpu_statistics">Optional pointer to a variable that is set to the GPU time statistics. These are empty for APIs that do not support timestamp queries.</param>
+		/// <returns><see langword="true"/> if statistics were retrieved, <see langword="false"/> if the technique handle is invalid.</returns>
+		virtual bool get_technique_statistics(effect_technique technique, duration_statistics *out_cpu_statistics, duration_statistics *out_gpu_statistics) const = 0;
 	};
 } }
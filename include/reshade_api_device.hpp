@@ -31,7 +31,13 @@ namespace reshade { namespace api
 		opengl = 0x10000,
 		/// <summary>Vulkan</summary>
 		/// <remarks>https://www.khronos.org/vulkan/</remarks>
-		vulkan = 0x20000
+		vulkan = 0x20000,
+		/// <summary>Headless device that does not use any graphics API and never executes commands</summary>
+		/// <remarks>
+		/// Only used by the benchmark mode of the ReShade test application (added in API version 12, add-ons built against older versions may see it as an unknown value).
+		/// All native handles of this device are zero, so there is nothing to cast them to.
+		/// </remarks>
+		null = 0x30000
 	};
 
 	/// <summary>
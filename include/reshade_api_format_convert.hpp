@@ -0,0 +1,454 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include "reshade_api_format.hpp"
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace reshade { namespace api
+{
+	namespace internal
+	{
+		/// <summary>
+		/// Row kernels converting <paramref name="width"/> texels of a source format to RGBA8.
+		/// The SSE2 paths process four texels per iteration, the scalar loops handle the remainder (and other architectures).
+		/// </summary>
+		struct format_convert_rows
+		{
+			static void r8(const uint8_t *src, uint32_t *dst, uint32_t width)
+			{
+				uint32_t x = 0;
+#if defined(_M_IX86) || defined(_M_X64)
+				const __m128i zero = _mm_setzero_si128(), alpha = _mm_set1_epi32(0xFF000000);
+				for (; x + 4 <= width; x += 4)
+				{
+					uint32_t texels; std::memcpy(&texels, src + x, 4);
+					const __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(texels)), zero), zero);
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_or_si128(v, alpha));
+				}
+#endif
+				for (; x < width; ++x)
+					dst[x] = src[x] | 0xFF000000;
+			}
+			static void l8(const uint8_t *src, uint32_t *dst, uint32_t width)
+			{
+				uint32_t x = 0;
+#if defined(_M_IX86) || defined(_M_X64)
+				const __m128i zero = _mm_setzero_si128(), alpha = _mm_set1_epi32(0xFF000000);
+				for (; x + 4 <= width; x += 4)
+				{
+					uint32_t texels; std::memcpy(&texels, src + x, 4);
+					const __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(texels)), zero), zero);
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_or_si128(_mm_or_si128(v, _mm_slli_epi32(v, 8)), _mm_or_si128(_mm_slli_epi32(v, 16), alpha)));
+				}
+#endif
+				for (; x < width; ++x)
+					dst[x] = src[x] * 0x010101u | 0xFF000000;
+			}
+			static void a8(const uint8_t *src, uint32_t *dst, uint32_t width)
+			{
+				uint32_t x = 0;
+#if defined(_M_IX86) || defined(_M_X64)
+				const __m128i zero = _mm_setzero_si128();
+				for (; x + 4 <= width; x += 4)
+				{
+					uint32_t texels; std::memcpy(&texels, src + x, 4);
+					const __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(texels)), zero), zero);
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_slli_epi32(v, 24));
+				}
+#endif
+				for (; x < width; ++x)
+					dst[x] = static_cast<uint32_t>(src[x]) << 24;
+			}
+			static void r8g8(const uint8_t *src, uint32_t *dst, uint32_t width)
+			{
+				uint32_t x = 0;
+#if defined(_M_IX86) || defined(_M_X64)
+				const __m128i zero = _mm_setzero_si128(), alpha = _mm_set1_epi32(0xFF000000);
+				for (; x + 4 <= width; x += 4)
+				{
+					const __m128i v = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + x * 2)), zero);
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_or_si128(v, alpha));
+				}
+#endif
+				for (; x < width; ++x)
+					dst[x] = src[x * 2 + 0] | (src[x * 2 + 1] << 8) | 0xFF000000;
+			}
+			static void l8a8(const uint8_t *src, uint32_t *dst, uint32_t width)
+			{
+				uint32_t x = 0;
+#if defined(_M_IX86) || defined(_M_X64)
+				const __m128i zero = _mm_setzero_si128(), luminance_mask = _mm_set1_epi32(0xFF), alpha_mask = _mm_set1_epi32(0xFF00);
+				for (; x + 4 <= width; x += 4)
+				{
+					const __m128i v = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + x * 2)), zero);
+					const __m128i l = _mm_and_si128(v, luminance_mask);
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_or_si128(_mm_or_si128(l, _mm_slli_epi32(l, 8)), _mm_or_si128(_mm_slli_epi32(l, 16), _mm_slli_epi32(_mm_and_si128(v, alpha_mask), 16))));
+				}
+#endif
+				for (; x < width; ++x)
+					dst[x] = src[x * 2 + 0] * 0x010101u | (static_cast<uint32_t>(src[x * 2 + 1]) << 24);
+			}
+			template <bool force_opaque>
+			static void r8g8b8a8(const uint8_t *src, uint32_t *dst, uint32_t width)
+			{
+				std::memcpy(dst, src, width * 4);
+				if constexpr (force_opaque)
+				{
+					uint32_t x = 0;
+#if defined(_M_IX86) || defined(_M_X64)
+					const __m128i alpha = _mm_set1_epi32(0xFF000000);
+					for (; x + 4 <= width; x += 4)
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + x)), alpha));
+#endif
+					for (; x < width; ++x)
+						dst[x] |= 0xFF000000;
+				}
+			}
+			template <bool force_opaque>
+			static void b8g8r8a8(const uint8_t *src, uint32_t *dst, uint32_t width)
+			{
+				// Format is BGRA, but output should be RGBA, so flip channels
+				const uint32_t alpha_mask = force_opaque ? 0xFF000000 : 0;
+
+				uint32_t x = 0;
+#if defined(_M_IX86) || defined(_M_X64)
+				const __m128i ga_mask = _mm_set1_epi32(0xFF00FF00), b_mask = _mm_set1_epi32(0xFF), alpha = _mm_set1_epi32(alpha_mask);
+				for (; x + 4 <= width; x += 4)
+				{
+					const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+					const __m128i swapped = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), b_mask), _mm_slli_epi32(_mm_and_si128(v, b_mask), 16));
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_or_si128(_mm_or_si128(_mm_and_si128(v, ga_mask), swapped), alpha));
+				}
+#endif
+				for (; x < width; ++x)
+				{
+					uint32_t bgra; std::memcpy(&bgra, src + x * 4, 4);
+					dst[x] = (bgra & 0xFF00FF00) | ((bgra >> 16) & 0xFF) | ((bgra & 0xFF) << 16) | alpha_mask;
+				}
+			}
+			template <bool bgr>
+			static void r10g10b10a2(const uint8_t *src, uint32_t *dst, uint32_t width)
+			{
+				// Shift right by 2 to get 10-bit range (0-1023) into 8-bit range (0-255), and expand 2-bit alpha by replicating it (which is the same as multiplying by 85)
+				constexpr int r_shift = bgr ? 16 : 0;
+				constexpr int b_shift = 16 - r_shift;
+
+				uint32_t x = 0;
+#if defined(_M_IX86) || defined(_M_X64)
+				const __m128i mask = _mm_set1_epi32(0xFF);
+				for (; x + 4 <= width; x += 4)
+				{
+					const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+					const __m128i a = _mm_srli_epi32(v, 30);
+					const __m128i a8 = _mm_or_si128(_mm_or_si128(a, _mm_slli_epi32(a, 2)), _mm_or_si128(_mm_slli_epi32(a, 4), _mm_slli_epi32(a, 6)));
+					const __m128i r = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 2), mask), r_shift);
+					const __m128i g = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 12), mask), 8);
+					const __m128i b = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 22), mask), b_shift);
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, _mm_slli_epi32(a8, 24))));
+				}
+#endif
+				for (; x < width; ++x)
+				{
+					uint32_t rgba; std::memcpy(&rgba, src + x * 4, 4);
+					dst[x] =
+						(((rgba >>  2) & 0xFF) << r_shift) |
+						(((rgba >> 12) & 0xFF) << 8) |
+						(((rgba >> 22) & 0xFF) << b_shift) |
+						(((rgba >> 30) * 85) << 24);
+				}
+			}
+		};
+
+		/// <summary>
+		/// Block decoders converting a single 4x4 block to RGBA8 texels.
+		/// See https://docs.microsoft.com/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression
+		/// </summary>
+		struct format_convert_blocks
+		{
+			static void unpack_r5g6b5(uint16_t data, uint8_t rgb[3])
+			{
+				uint32_t temp;
+				temp =  (data           >> 11) * 255 + 16;
+				rgb[0] = static_cast<uint8_t>((temp / 32 + temp) / 32);
+				temp = ((data & 0x07E0) >>  5) * 255 + 32;
+				rgb[1] = static_cast<uint8_t>((temp / 64 + temp) / 64);
+				temp =  (data & 0x001F)        * 255 + 16;
+				rgb[2] = static_cast<uint8_t>((temp / 32 + temp) / 32);
+			}
+
+			static void decode_color(const uint8_t *src, uint8_t block[16][4], bool allow_three_color_mode)
+			{
+				uint16_t color_0, color_1; uint32_t color_i;
+				std::memcpy(&color_0, src + 0, 2);
+				std::memcpy(&color_1, src + 2, 2);
+				std::memcpy(&color_i, src + 4, 4);
+
+				uint8_t palette[4][4];
+				unpack_r5g6b5(color_0, palette[0]);
+				unpack_r5g6b5(color_1, palette[1]);
+
+				const bool four_color_mode = !allow_three_color_mode || color_0 > color_1;
+				for (int c = 0; c < 3; ++c)
+				{
+					palette[2][c] = static_cast<uint8_t>(four_color_mode ? (2 * palette[0][c] + palette[1][c]) / 3 : (palette[0][c] + palette[1][c]) / 2);
+					palette[3][c] = static_cast<uint8_t>(four_color_mode ? (palette[0][c] + 2 * palette[1][c]) / 3 : 0);
+				}
+				palette[0][3] = palette[1][3] = palette[2][3] = 255;
+				palette[3][3] = four_color_mode ? 255 : 0;
+
+				for (int i = 0; i < 16; ++i)
+					std::memcpy(block[i], palette[(color_i >> (2 * i)) & 0x3], 4);
+			}
+
+			static void decode_channel(const uint8_t *src, uint8_t block[16][4], int channel)
+			{
+				const uint8_t value_0 = src[0];
+				const uint8_t value_1 = src[1];
+				const uint64_t value_i =
+					(static_cast<uint64_t>(src[2])      ) |
+					(static_cast<uint64_t>(src[3]) <<  8) |
+					(static_cast<uint64_t>(src[4]) << 16) |
+					(static_cast<uint64_t>(src[5]) << 24) |
+					(static_cast<uint64_t>(src[6]) << 32) |
+					(static_cast<uint64_t>(src[7]) << 40);
+
+				uint8_t palette[8] = { value_0, value_1 };
+				if (value_0 > value_1)
+				{
+					for (int i = 1; i < 7; ++i)
+						palette[i + 1] = static_cast<uint8_t>(((7 - i) * value_0 + i * value_1) / 7);
+				}
+				else
+				{
+					for (int i = 1; i < 5; ++i)
+						palette[i + 1] = static_cast<uint8_t>(((5 - i) * value_0 + i * value_1) / 5);
+					palette[6] = 0;
+					palette[7] = 255;
+				}
+
+				for (int i = 0; i < 16; ++i)
+					block[i][channel] = palette[(value_i >> (3 * i)) & 0x7];
+			}
+
+			static void bc1(const uint8_t *src, uint8_t block[16][4])
+			{
+				decode_color(src, block, true);
+			}
+			static void bc2(const uint8_t *src, uint8_t block[16][4])
+			{
+				decode_color(src + 8, block, false);
+
+				for (int i = 0; i < 16; ++i)
+					block[i][3] = static_cast<uint8_t>(((src[i / 2] >> (4 * (i % 2))) & 0xF) * 17);
+			}
+			static void bc3(const uint8_t *src, uint8_t block[16][4])
+			{
+				decode_color(src + 8, block, false);
+				decode_channel(src, block, 3);
+			}
+			static void bc4(const uint8_t *src, uint8_t block[16][4])
+			{
+				decode_channel(src, block, 0);
+
+				for (int i = 0; i < 16; ++i)
+				{
+					block[i][1] = block[i][0];
+					block[i][2] = block[i][0];
+					block[i][3] = 255;
+				}
+			}
+			static void bc5(const uint8_t *src, uint8_t block[16][4])
+			{
+				decode_channel(src + 0, block, 0);
+				decode_channel(src + 8, block, 1);
+
+				for (int i = 0; i < 16; ++i)
+				{
+					block[i][2] = 0;
+					block[i][3] = 255;
+				}
+			}
+		};
+
+		template <void(*decode_block)(const uint8_t *src, uint8_t block[16][4]), uint32_t block_size>
+		inline void convert_block_rows(const uint8_t *src, uint32_t src_row_pitch, uint8_t *dst, uint32_t dst_row_pitch, uint32_t width, uint32_t height, uint32_t block_y_begin, uint32_t block_y_end)
+		{
+			const uint32_t block_count_x = (width + 3) / 4;
+
+			for (uint32_t block_y = block_y_begin; block_y < block_y_end; ++block_y)
+			{
+				const uint8_t *const src_row = src + static_cast<size_t>(block_y) * src_row_pitch;
+				const uint32_t rows = std::min(4u, height - block_y * 4);
+
+				for (uint32_t block_x = 0; block_x < block_count_x; ++block_x)
+				{
+					uint8_t block[16][4];
+					decode_block(src_row + block_x * block_size, block);
+
+					// Clip blocks at the right and bottom edges of textures whose dimensions are not a multiple of four
+					const uint32_t columns = std::min(4u, width - block_x * 4);
+					for (uint32_t y = 0; y < rows; ++y)
+						std::memcpy(dst + static_cast<size_t>(block_y * 4 + y) * dst_row_pitch + block_x * 4 * 4, block[y * 4], columns * 4);
+				}
+			}
+		}
+
+		/// <summary>
+		/// Minimum number of texels each thread has to decode when the number of threads is chosen automatically (about a millisecond of work, compared to tens of microseconds to create a thread).
+		/// </summary>
+		constexpr size_t min_texels_per_thread = 512 * 512;
+
+		template <void(*decode_block)(const uint8_t *src, uint8_t block[16][4]), uint32_t block_size>
+		inline void convert_blocks(const uint8_t *src, uint32_t src_row_pitch, uint8_t *dst, uint32_t dst_row_pitch, uint32_t width, uint32_t height, uint32_t num_threads)
+		{
+			const uint32_t block_count_y = (height + 3) / 4;
+
+			// Threads are created per call, since a header-only module cannot own a pool that outlives the add-on that uses it (worker threads cannot be joined while the module is unloaded)
+			// Only spread work across threads if every thread gets enough texels to decode that the cost of creating it is negligible in comparison
+			if (num_threads == 0)
+				num_threads = std::max(1u, std::min({ 8u, std::thread::hardware_concurrency(), static_cast<uint32_t>((static_cast<size_t>(width) * height) / min_texels_per_thread) }));
+			num_threads = std::min(num_threads, block_count_y);
+
+			if (num_threads <= 1)
+			{
+				convert_block_rows<decode_block, block_size>(src, src_row_pitch, dst, dst_row_pitch, width, height, 0, block_count_y);
+				return;
+			}
+
+			std::vector<std::thread> threads;
+			threads.reserve(num_threads - 1);
+
+			const uint32_t block_rows_per_thread = (block_count_y + num_threads - 1) / num_threads;
+			for (uint32_t i = 1; i < num_threads; ++i)
+			{
+				const uint32_t block_y_begin = i * block_rows_per_thread;
+				const uint32_t block_y_end = std::min(block_count_y, block_y_begin + block_rows_per_thread);
+				if (block_y_begin >= block_y_end)
+					break;
+
+				threads.emplace_back(&convert_block_rows<decode_block, block_size>, src, src_row_pitch, dst, dst_row_pitch, width, height, block_y_begin, block_y_end);
+			}
+
+			convert_block_rows<decode_block, block_size>(src, src_row_pitch, dst, dst_row_pitch, width, height, 0, std::min(block_count_y, block_rows_per_thread));
+
+			for (std::thread &thread : threads)
+				thread.join();
+		}
+	}
+
+	/// <summary>
+	/// Converts texture data of the specified <paramref name="src_format"/> to 8-bit RGBA.
+	/// Supports 8-bit single and two channel formats, 8-bit RGBA/BGRA, 10-bit RGB(A) and the BC1 to BC5 block compressed formats.
+	/// </summary>
+	/// <param name="src_format">Format of the source texture data.</param>
+	/// <param name="width">Width of the texture in texels.</param>
+	/// <param name="height">Height of the texture in texels.</param>
+	/// <param name="src">Pointer to the source texture data.</param>
+	/// <param name="src_row_pitch">Number of bytes per row in the source texture data (per row of blocks for block compressed formats).</param>
+	/// <param name="dst">Pointer to the destination buffer, which has to be at least <paramref name="dst_row_pitch"/> * <paramref name="height"/> bytes large.</param>
+	/// <param name="dst_row_pitch">Number of bytes per row in the destination buffer, which has to be at least <paramref name="width"/> * 4.</param>
+	/// <param name="num_threads">Number of threads to decode block compressed formats with, or zero to choose automatically based on the texture size. Callers that already run on a worker thread should pass one.</param>
+	/// <returns><see langword="true"/> if the format is supported and the data was converted, <see langword="false"/> otherwise.</returns>
+	inline bool convert_texture_to_rgba8(format src_format, uint32_t width, uint32_t height, const void *src, uint32_t src_row_pitch, void *dst, uint32_t dst_row_pitch, uint32_t num_threads = 0)
+	{
+		using rows = internal::format_convert_rows;
+		using blocks = internal::format_convert_blocks;
+
+		void(*convert_row)(const uint8_t *src, uint32_t *dst, uint32_t width) = nullptr;
+
+		switch (src_format)
+		{
+		case format::l8_unorm:
+			convert_row = rows::l8;
+			break;
+		case format::a8_unorm:
+			convert_row = rows::a8;
+			break;
+		case format::r8_typeless:
+		case format::r8_unorm:
+		case format::r8_snorm:
+			convert_row = rows::r8;
+			break;
+		case format::l8a8_unorm:
+			convert_row = rows::l8a8;
+			break;
+		case format::r8g8_typeless:
+		case format::r8g8_unorm:
+		case format::r8g8_snorm:
+			convert_row = rows::r8g8;
+			break;
+		case format::r8g8b8a8_typeless:
+		case format::r8g8b8a8_unorm:
+		case format::r8g8b8a8_unorm_srgb:
+			convert_row = rows::r8g8b8a8<false>;
+			break;
+		case format::r8g8b8x8_unorm:
+		case format::r8g8b8x8_unorm_srgb:
+			convert_row = rows::r8g8b8a8<true>;
+			break;
+		case format::b8g8r8a8_typeless:
+		case format::b8g8r8a8_unorm:
+		case format::b8g8r8a8_unorm_srgb:
+			convert_row = rows::b8g8r8a8<false>;
+			break;
+		case format::b8g8r8x8_typeless:
+		case format::b8g8r8x8_unorm:
+		case format::b8g8r8x8_unorm_srgb:
+			convert_row = rows::b8g8r8a8<true>;
+			break;
+		case format::r10g10b10a2_typeless:
+		case format::r10g10b10a2_unorm:
+			convert_row = rows::r10g10b10a2<false>;
+			break;
+		case format::b10g10r10a2_typeless:
+		case format::b10g10r10a2_unorm:
+			convert_row = rows::r10g10b10a2<true>;
+			break;
+		case format::bc1_typeless:
+		case format::bc1_unorm:
+		case format::bc1_unorm_srgb:
+			internal::convert_blocks<blocks::bc1, 8>(static_cast<const uint8_t *>(src), src_row_pitch, static_cast<uint8_t *>(dst), dst_row_pitch, width, height, num_threads);
+			return true;
+		case format::bc2_typeless:
+		case format::bc2_unorm:
+		case format::bc2_unorm_srgb:
+			internal::convert_blocks<blocks::bc2, 16>(static_cast<const uint8_t *>(src), src_row_pitch, static_cast<uint8_t *>(dst), dst_row_pitch, width, height, num_threads);
+			return true;
+		case format::bc3_typeless:
+		case format::bc3_unorm:
+		case format::bc3_unorm_srgb:
+			internal::convert_blocks<blocks::bc3, 16>(static_cast<const uint8_t *>(src), src_row_pitch, static_cast<uint8_t *>(dst), dst_row_pitch, width, height, num_threads);
+			return true;
+		case format::bc4_typeless:
+		case format::bc4_unorm:
+		case format::bc4_snorm:
+			internal::convert_blocks<blocks::bc4, 8>(static_cast<const uint8_t *>(src), src_row_pitch, static_cast<uint8_t *>(dst), dst_row_pitch, width, height, num_threads);
+			return true;
+		case format::bc5_typeless:
+		case format::bc5_unorm:
+		case format::bc5_snorm:
+			internal::convert_blocks<blocks::bc5, 16>(static_cast<const uint8_t *>(src), src_row_pitch, static_cast<uint8_t *>(dst), dst_row_pitch, width, height, num_threads);
+			return true;
+		default:
+			return false;
+		}
+
+		const uint8_t *src_row = static_cast<const uint8_t *>(src);
+		uint8_t *dst_row = static_cast<uint8_t *>(dst);
+
+		for (uint32_t y = 0; y < height; ++y, src_row += src_row_pitch, dst_row += dst_row_pitch)
+			convert_row(src_row, reinterpret_cast<uint32_t *>(dst_row), width);
+
+		return true;
+	}
+} }
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "reshade_api.hpp"
+#include <type_traits>
 
 namespace reshade
 {
@@ -1732,4 +1733,34 @@ namespace reshade
 
 	RESHADE_DEFINE_ADDON_EVENT_TRAITS(addon_event::reshade_overlay_uniform_variable, bool, api::effect_runtime *runtime, api::effect_uniform_variable variable);
 	RESHADE_DEFINE_ADDON_EVENT_TRAITS(addon_event::reshade_overlay_technique, bool, api::effect_runtime *runtime, api::effect_technique technique);
+
+	namespace internal
+	{
+		template <typename decl>
+		struct is_batchable_event_decl
+		{
+			static constexpr bool value = false;
+		};
+		template <typename ret, typename... Params>
+		struct is_batchable_event_decl<ret(*)(api::command_list *, Params...)>
+		{
+			// Arguments are copied into a stream on the command list, so they must be plain values that are still valid when the command list is executed
+			static constexpr bool value = ((std::is_trivially_copyable_v<Params> && std::is_default_constructible_v<Params> && !std::is_pointer_v<Params>) && ...);
+		};
+	}
+
+	/// <summary>
+	/// Checks whether callbacks for the specified <typeparamref name="ev"/>ent can be registered as batched callbacks (see <see cref="register_batched_event"/>).
+	/// This is the case for command list events whose arguments besides the command list are all plain values, like <see cref="addon_event::draw"/> or <see cref="addon_event::bind_pipeline"/>.
+	/// </summary>
+	template <addon_event ev>
+	constexpr bool is_batchable_addon_event()
+	{
+		// Command list life time events are what drives batching, so cannot be batched themselves
+		return internal::is_batchable_event_decl<typename addon_event_traits<ev>::decl>::value &&
+			ev != addon_event::init_command_list &&
+			ev != addon_event::destroy_command_list &&
+			ev != addon_event::reset_command_list &&
+			ev != addon_event::close_command_list;
+	}
 }
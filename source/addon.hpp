@@ -29,6 +29,7 @@ namespace reshade
 		std::string version;
 
 		std::vector<std::pair<uint32_t, void *>> event_callbacks;
+		std::vector<std::pair<uint32_t, void *>> batched_event_callbacks;
 #if RESHADE_GUI
 		void(*settings_overlay_callback)(api::effect_runtime *) = nullptr;
 		std::vector<overlay_callback> overlay_callbacks;
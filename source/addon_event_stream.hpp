@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "reshade_events.hpp"
+#include <tuple>
+#include <vector>
+#include <cstring>
+
+namespace reshade
+{
+	/// <summary>
+	/// Packed stream of events recorded on a command list for batched callbacks.
+	/// </summary>
+	struct __declspec(uuid("5E6B1D3A-4C8F-4B0E-9A61-2F7D8C3E5B94")) addon_event_stream
+	{
+		struct record_header
+		{
+			addon_event ev;
+			uint32_t size;
+		};
+
+		/// <summary>
+		/// Gets the stream of events recorded on the specified command list, or <see langword="nullptr"/> if nothing was recorded on it yet.
+		/// </summary>
+		static addon_event_stream *get(const api::command_list *cmd_list)
+		{
+			uint64_t stream_data = 0;
+			cmd_list->get_private_data(reinterpret_cast<const uint8_t *>(&__uuidof(addon_event_stream)), &stream_data);
+			return reinterpret_cast<addon_event_stream *>(static_cast<uintptr_t>(stream_data));
+		}
+		/// <summary>
+		/// Gets the stream of events recorded on the specified command list, creating it if nothing was recorded on it yet.
+		/// </summary>
+		static addon_event_stream &get_or_create(api::command_list *cmd_list)
+		{
+			if (addon_event_stream *const stream = get(cmd_list))
+				return *stream;
+			return cmd_list->create_private_data<addon_event_stream>();
+		}
+
+		uint8_t *append(addon_event ev, uint32_t size)
+		{
+			// Keep records 8-byte aligned
+			const uint32_t aligned_size = (size + 7) & ~7u;
+
+			const size_t offset = data.size();
+			data.resize(offset + sizeof(record_header) + aligned_size);
+
+			const record_header header = { ev, aligned_size };
+			std::memcpy(data.data() + offset, &header, sizeof(header));
+
+			return data.data() + offset + sizeof(header);
+		}
+		/// <summary>
+		/// Appends all events recorded in another stream after the ones in this stream (e.g. when a secondary command list is executed on a primary one).
+		/// </summary>
+		void append(const addon_event_stream &other)
+		{
+			data.insert(data.end(), other.data.begin(), other.data.end());
+		}
+
+		/// <summary>
+		/// Calls the specified <paramref name="callback"/> with the event and a pointer to the recorded arguments of every record in this stream, in the order they were recorded in.
+		/// </summary>
+		template <typename F>
+		void for_each(F callback) const
+		{
+			for (size_t offset = 0; offset < data.size();)
+			{
+				record_header header;
+				std::memcpy(&header, data.data() + offset, sizeof(header));
+				offset += sizeof(header);
+
+				callback(header.ev, data.data() + offset);
+
+				offset += header.size;
+			}
+		}
+
+		std::vector<uint8_t> data;
+	};
+
+	/// <summary>
+	/// Records and replays arguments of events that only take plain values besides the command list, so they can be stored in an <see cref="addon_event_stream"/>.
+	/// Only instantiated for events for which <see cref="is_batchable_addon_event"/> is <see langword="true"/>.
+	/// </summary>
+	template <typename decl>
+	struct addon_event_batching;
+	template <typename ret, typename... Params>
+	struct addon_event_batching<ret(*)(api::command_list *, Params...)>
+	{
+		static void record(addon_event ev, api::command_list *cmd_list, Params... params)
+		{
+			record(addon_event_stream::get_or_create(cmd_list), ev, params...);
+		}
+		static void record(addon_event_stream &stream, addon_event ev, Params... params)
+		{
+			uint8_t *data = stream.append(ev, static_cast<uint32_t>((sizeof(Params) + ... + 0)));
+			((std::memcpy(data, &params, sizeof(Params)), data += sizeof(Params)), ...);
+		}
+
+		static void replay(api::command_list *cmd_list, const uint8_t *data, const std::vector<void *> &callbacks)
+		{
+			std::tuple<Params...> params;
+			std::apply([data](Params &... values) mutable {
+				((std::memcpy(&values, data, sizeof(Params)), data += sizeof(Params)), ...);
+			}, params);
+
+			for (size_t cb = 0, count = callbacks.size(); cb < count; ++cb)
+				std::apply([cmd_list, callback = reinterpret_cast<ret(*)(api::command_list *, Params...)>(callbacks[cb])](const Params &... values) {
+					// The command was already recorded, so the return value of callbacks of events that can skip it has no meaning here
+					callback(cmd_list, values...);
+				}, params);
+		}
+	};
+}
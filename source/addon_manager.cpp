@@ -9,6 +9,9 @@
 #include "addon_manager.hpp"
 #include "dll_log.hpp"
 #include "ini_file.hpp"
+#include <mutex>
+#include <array>
+#include <memory>
 
 extern void register_addon_depth();
 extern void unregister_addon_depth();
@@ -120,9 +123,116 @@ static const char *addon_event_to_string(reshade::addon_event ev)
 bool reshade::addon_enabled = true;
 #endif
 bool reshade::addon_all_loaded = true;
-std::vector<void *> reshade::addon_event_list[static_cast<uint32_t>(reshade::addon_event::max)];
+std::atomic<const std::vector<void *> *> reshade::addon_event_list[static_cast<uint32_t>(reshade::addon_event::max)] = {};
+std::atomic<uint64_t> reshade::addon_event_mask[(static_cast<uint32_t>(reshade::addon_event::max) + 63) / 64] = {};
+std::atomic<const std::vector<void *> *> reshade::addon_batched_event_list[static_cast<uint32_t>(reshade::addon_event::max)] = {};
+std::atomic<uint64_t> reshade::addon_batched_event_mask[(static_cast<uint32_t>(reshade::addon_event::max) + 63) / 64] = {};
 std::vector<reshade::addon_info> reshade::addon_loaded_info;
 static unsigned long s_reference_count = 0;
+static std::mutex s_event_list_mutex;
+// Lists that were replaced, but may still be iterated by threads that are invoking events, are freed once no invocation can still see them (only modified while holding 's_event_list_mutex')
+epoch_reclaimer<std::vector<void *>> reshade::addon_event_list_reclaimer;
+
+template <typename F>
+static void modify_addon_event_list(reshade::addon_event ev, F modify, bool batched = false)
+{
+	const std::unique_lock<std::mutex> lock(s_event_list_mutex);
+
+	std::atomic<const std::vector<void *> *> &event_list = (batched ? reshade::addon_batched_event_list : reshade::addon_event_list)[static_cast<uint32_t>(ev)];
+	std::atomic<uint64_t> *const event_mask = batched ? reshade::addon_batched_event_mask : reshade::addon_event_mask;
+
+	const std::vector<void *> *const old_event_list = event_list.load(std::memory_order_relaxed);
+
+	std::vector<void *> new_event_list;
+	if (old_event_list != nullptr)
+		new_event_list = *old_event_list;
+
+	modify(new_event_list);
+
+	event_list.store(new_event_list.empty() ? nullptr : new std::vector<void *>(std::move(new_event_list)));
+
+	const uint64_t event_bit = 1ull << (static_cast<uint32_t>(ev) % 64);
+	if (event_list.load(std::memory_order_relaxed) != nullptr)
+		event_mask[static_cast<uint32_t>(ev) / 64].fetch_or(event_bit, std::memory_order_relaxed);
+	else
+		event_mask[static_cast<uint32_t>(ev) / 64].fetch_and(~event_bit, std::memory_order_relaxed);
+
+	addon_event_list_reclaimer.retire(old_event_list);
+}
+
+void reshade::reclaim_retired_addon_event_lists()
+{
+	// Avoid taking the lock on every present when there is nothing to free
+	if (!addon_event_list_reclaimer.has_retired())
+		return;
+
+	const std::unique_lock<std::mutex> lock(s_event_list_mutex);
+
+	addon_event_list_reclaimer.reclaim();
+}
+
+using replay_batched_event_func = void(*)(reshade::api::command_list *cmd_list, const uint8_t *data, const std::vector<void *> &callbacks);
+
+template <reshade::addon_event ev>
+static constexpr replay_batched_event_func get_replay_batched_event_func()
+{
+	if constexpr (reshade::is_batchable_addon_event<ev>())
+		return &reshade::addon_event_batching<typename reshade::addon_event_traits<ev>::decl>::replay;
+	else
+		return nullptr;
+}
+template <size_t... events>
+static constexpr auto make_replay_batched_event_table(std::index_sequence<events...>)
+{
+	return std::array<replay_batched_event_func, sizeof...(events)> { get_replay_batched_event_func<static_cast<reshade::addon_event>(events)>()... };
+}
+
+// Table of functions that decode recorded event arguments, or null for events that cannot be batched
+static constexpr auto s_replay_batched_event_table = make_replay_batched_event_table(std::make_index_sequence<static_cast<size_t>(reshade::addon_event::max)>());
+
+void reshade::execute_batched_addon_events(api::command_queue *queue, api::command_list *cmd_list)
+{
+	addon_event_stream *const stream = addon_event_stream::get(cmd_list);
+	if (stream == nullptr || stream->data.empty())
+		return;
+
+	stream->for_each([cmd_list](addon_event ev, const uint8_t *data) {
+		// Callbacks may have been unregistered since the event was recorded
+		if (addon_batched_event_list[static_cast<uint32_t>(ev)].load(std::memory_order_relaxed) == nullptr)
+			return;
+
+		const epoch_reclaimer<std::vector<void *>>::read_guard guard(addon_event_list_reclaimer);
+
+		if (const std::vector<void *> *const callbacks = addon_batched_event_list[static_cast<uint32_t>(ev)].load())
+			s_replay_batched_event_table[static_cast<uint32_t>(ev)](cmd_list, data, *callbacks);
+	});
+
+	// Immediate command lists continue recording after they were flushed, so only deliver their events once
+	// Other command lists may be executed multiple times, so keep their events around until they are reset
+	if (queue->get_immediate_command_list() == cmd_list)
+		stream->data.clear();
+}
+void reshade::execute_secondary_batched_addon_events(api::command_list *cmd_list, api::command_list *secondary_cmd_list)
+{
+	const addon_event_stream *const secondary_stream = addon_event_stream::get(secondary_cmd_list);
+	if (secondary_stream == nullptr || secondary_stream->data.empty())
+		return;
+
+	addon_event_stream::get_or_create(cmd_list).append(*secondary_stream);
+}
+void reshade::reset_batched_addon_events(api::command_list *cmd_list, bool destroy)
+{
+	if (destroy)
+	{
+		if (addon_event_stream::get(cmd_list) != nullptr)
+			cmd_list->destroy_private_data<addon_event_stream>();
+	}
+	else
+	{
+		if (addon_event_stream *const stream = addon_event_stream::get(cmd_list))
+			stream->data.clear();
+	}
+}
 
 void reshade::load_addons()
 {
@@ -300,10 +410,18 @@ void reshade::unload_addons()
 
 #ifndef NDEBUG
 	// All events should have been unregistered at this point
-	for (const std::vector<void *> &event_info : addon_event_list)
-		assert(event_info.empty());
+	for (const std::atomic<const std::vector<void *> *> &event_info : addon_event_list)
+		assert(event_info.load() == nullptr);
+	for (const std::atomic<const std::vector<void *> *> &event_info : addon_batched_event_list)
+		assert(event_info.load() == nullptr);
 #endif
 
+	{
+		const std::unique_lock<std::mutex> lock(s_event_list_mutex);
+		// No more events are invoked after the last reference was released, so can free all replaced lists right away
+		addon_event_list_reclaimer.clear();
+	}
+
 	addon_loaded_info.clear();
 }
 
@@ -437,6 +555,11 @@ void ReShadeUnregisterAddon(HMODULE module)
 		const auto &last_event_callback = info->event_callbacks.back();
 		ReShadeUnregisterEvent(static_cast<reshade::addon_event>(last_event_callback.first), last_event_callback.second);
 	}
+	while (!info->batched_event_callbacks.empty())
+	{
+		const auto &last_event_callback = info->batched_event_callbacks.back();
+		ReShadeUnregisterBatchedEvent(static_cast<reshade::addon_event>(last_event_callback.first), last_event_callback.second);
+	}
 
 #if RESHADE_GUI
 	// Unregister all overlay callbacks associated with this add-on
@@ -473,8 +596,9 @@ void ReShadeRegisterEvent(reshade::addon_event ev, void *callback)
 	}
 #endif
 
-	std::vector<void *> &event_list = reshade::addon_event_list[static_cast<uint32_t>(ev)];
-	event_list.push_back(callback);
+	modify_addon_event_list(ev, [callback](std::vector<void *> &event_list) {
+		event_list.push_back(callback);
+	});
 
 	info->event_callbacks.emplace_back(static_cast<uint32_t>(ev), callback);
 
@@ -496,8 +620,9 @@ void ReShadeUnregisterEvent(reshade::addon_event ev, void *callback)
 		return;
 #endif
 
-	std::vector<void *> &event_list = reshade::addon_event_list[static_cast<uint32_t>(ev)];
-	event_list.erase(std::remove(event_list.begin(), event_list.end(), callback), event_list.end());
+	modify_addon_event_list(ev, [callback](std::vector<void *> &event_list) {
+		event_list.erase(std::remove(event_list.begin(), event_list.end(), callback), event_list.end());
+	});
 
 	info->event_callbacks.erase(std::remove(info->event_callbacks.begin(), info->event_callbacks.end(), std::make_pair(static_cast<uint32_t>(ev), callback)), info->event_callbacks.end());
 
@@ -506,6 +631,63 @@ void ReShadeUnregisterEvent(reshade::addon_event ev, void *callback)
 #endif
 }
 
+void ReShadeRegisterBatchedEvent(reshade::addon_event ev, void *callback)
+{
+	if (ev >= reshade::addon_event::max)
+		return;
+
+	reshade::addon_info *const info = reshade::find_addon(callback);
+	if (info == nullptr)
+	{
+		LOG(ERROR) << "Could not find associated add-on and therefore failed to register a batched event.";
+		return;
+	}
+
+#if RESHADE_ADDON == 1
+	if (info->handle != g_module_handle && (ev > reshade::addon_event::destroy_effect_runtime && ev < reshade::addon_event::present))
+	{
+		LOG(ERROR) << "Failed to register a batched event because only limited add-on functionality is available!";
+		return;
+	}
+#endif
+
+	// Only events with plain value arguments on a command list can be recorded
+	if (s_replay_batched_event_table[static_cast<uint32_t>(ev)] == nullptr)
+	{
+		LOG(ERROR) << "Failed to register a batched event because event " << static_cast<uint32_t>(ev) << " cannot be batched!";
+		return;
+	}
+
+	modify_addon_event_list(ev, [callback](std::vector<void *> &event_list) {
+		event_list.push_back(callback);
+	}, true);
+
+	info->batched_event_callbacks.emplace_back(static_cast<uint32_t>(ev), callback);
+
+#if RESHADE_VERBOSE_LOG
+	LOG(DEBUG) << "Registered batched event callback " << callback << " for event " << addon_event_to_string(ev) << '.';
+#endif
+}
+void ReShadeUnregisterBatchedEvent(reshade::addon_event ev, void *callback)
+{
+	if (ev >= reshade::addon_event::max)
+		return;
+
+	reshade::addon_info *const info = reshade::find_addon(callback);
+	if (info == nullptr)
+		return;
+
+	modify_addon_event_list(ev, [callback](std::vector<void *> &event_list) {
+		event_list.erase(std::remove(event_list.begin(), event_list.end(), callback), event_list.end());
+	}, true);
+
+	info->batched_event_callbacks.erase(std::remove(info->batched_event_callbacks.begin(), info->batched_event_callbacks.end(), std::make_pair(static_cast<uint32_t>(ev), callback)), info->batched_event_callbacks.end());
+
+#if RESHADE_VERBOSE_LOG
+	LOG(DEBUG) << "Unregistered batched event callback " << callback << " for event " << addon_event_to_string(ev) << '.';
+#endif
+}
+
 #if RESHADE_GUI
 
 void ReShadeRegisterOverlay(const char *title, void(*callback)(reshade::api::effect_runtime *runtime))
@@ -7,6 +7,9 @@
 
 #include "addon.hpp"
 #include "reshade_events.hpp"
+#include "epoch_reclaimer.hpp"
+#include "addon_event_stream.hpp"
+#include <atomic>
 
 #if RESHADE_ADDON
 
@@ -22,8 +25,28 @@ namespace reshade
 
 	/// <summary>
 	/// List of add-on event callbacks.
+	/// These lists are immutable once published, registration replaces them with a modified copy, so that events can be invoked without locking while callbacks are registered or unregistered concurrently.
 	/// </summary>
-	extern std::vector<void *> addon_event_list[];
+	extern std::atomic<const std::vector<void *> *> addon_event_list[];
+	/// <summary>
+	/// Bit mask of events with at least one registered callback.
+	/// </summary>
+	extern std::atomic<uint64_t> addon_event_mask[];
+
+	/// <summary>
+	/// List of add-on event callbacks that are called in bulk when a command list is executed, instead of immediately (see <see cref="ReShadeRegisterBatchedEvent"/>).
+	/// </summary>
+	extern std::atomic<const std::vector<void *> *> addon_batched_event_list[];
+	/// <summary>
+	/// Bit mask of events with at least one registered batched callback.
+	/// </summary>
+	extern std::atomic<uint64_t> addon_batched_event_mask[];
+
+	/// <summary>
+	/// Keeps event lists that were replaced alive until no invocation can still be iterating them.
+	/// Invocations have to hold a read guard of this while accessing a list.
+	/// </summary>
+	extern epoch_reclaimer<std::vector<void *>> addon_event_list_reclaimer;
 
 	/// <summary>
 	/// List of currently loaded add-ons.
@@ -51,14 +74,44 @@ namespace reshade
 	addon_info *find_addon(void *address);
 
 	/// <summary>
-	/// Checks whether any callbacks were registered for the specified <paramref name="ev"/>ent.
+	/// Checks whether any batched callbacks were registered for the specified <paramref name="ev"/>ent.
+	/// </summary>
+	template <addon_event ev>
+	__forceinline bool has_batched_addon_event()
+	{
+		return (addon_batched_event_mask[static_cast<uint32_t>(ev) / 64].load(std::memory_order_relaxed) & (1ull << (static_cast<uint32_t>(ev) % 64))) != 0;
+	}
+
+	/// <summary>
+	/// Checks whether any callbacks were registered for the specified <paramref name="ev"/>ent, including batched callbacks (which need the event to be invoked so it can be recorded).
 	/// </summary>
 	template <addon_event ev>
 	__forceinline bool has_addon_event()
 	{
-		return !addon_event_list[static_cast<uint32_t>(ev)].empty();
+		const bool has_event = (addon_event_mask[static_cast<uint32_t>(ev) / 64].load(std::memory_order_relaxed) & (1ull << (static_cast<uint32_t>(ev) % 64))) != 0;
+		if constexpr (is_batchable_addon_event<ev>())
+			return has_event || has_batched_addon_event<ev>();
+		else
+			return has_event;
 	}
 
+	/// <summary>
+	/// Calls batched callbacks for all events recorded on the specified command list.
+	/// </summary>
+	void execute_batched_addon_events(api::command_queue *queue, api::command_list *cmd_list);
+	/// <summary>
+	/// Frees event lists that were replaced by registering or unregistering callbacks and which no invocation can still be iterating.
+	/// </summary>
+	void reclaim_retired_addon_event_lists();
+	/// <summary>
+	/// Appends the events recorded on a secondary command list to the primary command list it is executed on.
+	/// </summary>
+	void execute_secondary_batched_addon_events(api::command_list *cmd_list, api::command_list *secondary_cmd_list);
+	/// <summary>
+	/// Discards events recorded on the specified command list, when it is reset or destroyed.
+	/// </summary>
+	void reset_batched_addon_events(api::command_list *cmd_list, bool destroy);
+
 	/// <summary>
 	/// Invokes all registered callbacks for the specified <typeparamref name="ev"/>ent.
 	/// </summary>
@@ -125,9 +178,31 @@ namespace reshade
 		if (!addon_enabled)
 			return;
 #endif
-		std::vector<void *> &event_list = addon_event_list[static_cast<uint32_t>(ev)];
-		for (size_t cb = 0, count = event_list.size(); cb < count; ++cb) // Generates better code than ranged-based for loop
-			reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list[cb])(std::forward<Args>(args)...);
+		// Only register with the reclaimer if there are callbacks, to keep the cost of events nobody listens to minimal
+		if (addon_event_list[static_cast<uint32_t>(ev)].load(std::memory_order_relaxed) != nullptr)
+		{
+			const epoch_reclaimer<std::vector<void *>>::read_guard guard(addon_event_list_reclaimer);
+
+			const std::vector<void *> *const event_list = addon_event_list[static_cast<uint32_t>(ev)].load();
+			if (event_list != nullptr)
+				for (size_t cb = 0, count = event_list->size(); cb < count; ++cb) // Generates better code than ranged-based for loop
+					reinterpret_cast<typename addon_event_traits<ev>::decl>((*event_list)[cb])(std::forward<Args>(args)...);
+		}
+
+		if constexpr (is_batchable_addon_event<ev>())
+			if (has_batched_addon_event<ev>())
+				addon_event_batching<typename addon_event_traits<ev>::decl>::record(ev, std::forward<Args>(args)...);
+
+		if constexpr (ev == addon_event::present)
+			reclaim_retired_addon_event_lists();
+		if constexpr (ev == addon_event::execute_command_list)
+			execute_batched_addon_events(std::forward<Args>(args)...);
+		if constexpr (ev == addon_event::execute_secondary_command_list)
+			execute_secondary_batched_addon_events(std::forward<Args>(args)...);
+		if constexpr (ev == addon_event::reset_command_list)
+			reset_batched_addon_events(std::forward<Args>(args)..., false);
+		if constexpr (ev == addon_event::destroy_command_list)
+			reset_batched_addon_events(std::forward<Args>(args)..., true);
 	}
 	/// <summary>
 	/// Invokes registered callbacks for the specified <typeparamref name="ev"/>ent until a callback reports back as having handled this event by returning <see langword="true"/>.
@@ -139,10 +214,21 @@ namespace reshade
 		if (!addon_enabled)
 			return false;
 #endif
-		std::vector<void *> &event_list = addon_event_list[static_cast<uint32_t>(ev)];
-		for (size_t cb = 0, count = event_list.size(); cb < count; ++cb)
-			if (reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list[cb])(std::forward<Args>(args)...))
-				return true;
+		if (addon_event_list[static_cast<uint32_t>(ev)].load(std::memory_order_relaxed) != nullptr)
+		{
+			const epoch_reclaimer<std::vector<void *>>::read_guard guard(addon_event_list_reclaimer);
+
+			const std::vector<void *> *const event_list = addon_event_list[static_cast<uint32_t>(ev)].load();
+			if (event_list != nullptr)
+				for (size_t cb = 0, count = event_list->size(); cb < count; ++cb)
+					if (reinterpret_cast<typename addon_event_traits<ev>::decl>((*event_list)[cb])(std::forward<Args>(args)...))
+						return true;
+		}
+
+		// Only record commands that were not skipped by a callback above, since those are never executed
+		if constexpr (is_batchable_addon_event<ev>())
+			if (has_batched_addon_event<ev>())
+				addon_event_batching<typename addon_event_traits<ev>::decl>::record(ev, std::forward<Args>(args)...);
 		return false;
 	}
 }
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <algorithm>
+
+/// <summary>
+/// An index of address ranges, optimized for frequent look ups and rare modifications.
+/// Look ups binary search an immutable snapshot of the visible parts of the ranges and never wait on modifications, which are serialized between threads and publish a new snapshot (copy-on-write).
+/// The previous snapshot is freed once all look ups that could still be reading from it finished (read-copy-update).
+/// </summary>
+/// <remarks>
+/// Every modification copies the entire snapshot, so this only suits sets of ranges that change rarely compared to how often they are looked up (e.g. buffer creation versus descriptor updates).
+/// Freeing replaced snapshots never waits on look ups, they are instead kept around until a later modification observes that no look up can still be reading from them.
+/// Ranges may alias (e.g. placed resources in the same heap memory). The most recently added range then shadows the parts of other ranges it overlaps, while the rest of those ranges stays visible, and erasing it makes them visible again.
+/// </remarks>
+template <typename TValue>
+class address_range_map
+{
+	struct entry
+	{
+		uint64_t address;
+		uint64_t size;
+		TValue value;
+		// Start address of the range this is a visible part of, so that offsets are relative to the range and not to the part
+		uint64_t base_address;
+	};
+
+	using snapshot = std::vector<entry>;
+
+public:
+	address_range_map() :
+		_snapshot(new snapshot()) {}
+	~address_range_map()
+	{
+		delete _snapshot.load(std::memory_order_relaxed);
+
+		for (const retired_snapshot &retired : _retired)
+			delete retired.data;
+	}
+
+	/// <summary>
+	/// Finds the range that contains the specified <paramref name="address"/>.
+	/// </summary>
+	/// <param name="address">Address to look up.</param>
+	/// <param name="out_value">Pointer to a variable that is set to the value associated with the range containing the address.</param>
+	/// <param name="out_offset">Optional pointer to a variable that is set to the offset of the address from the start of that range.</param>
+	/// <returns><see langword="true"/> if a range containing the address was found, <see langword="false"/> otherwise.</returns>
+	bool find(uint64_t address, TValue *out_value, uint64_t *out_offset = nullptr) const
+	{
+		assert(out_value != nullptr);
+
+		// Keep the snapshot alive for the duration of the look up, in case a modification replaces it concurrently
+		const read_guard guard(*this);
+		const snapshot *const data = _snapshot.load();
+
+		// Find the last part that starts at or before the address, which is the only one that can contain it, since the visible parts do not overlap
+		auto it = upper_bound(*data, address);
+		if (it == data->begin())
+			return false;
+		--it;
+
+		if (address - it->address >= it->size)
+			return false;
+
+		*out_value = it->value;
+		if (out_offset != nullptr)
+			*out_offset = address - it->base_address;
+		return true;
+	}
+
+	/// <summary>
+	/// Adds a range to the index, which shadows the parts of any existing ranges it overlaps.
+	/// </summary>
+	/// <param name="address">Start address of the range.</param>
+	/// <param name="size">Size of the range in bytes.</param>
+	/// <param name="value">Value to associate with the range.</param>
+	void insert(uint64_t address, uint64_t size, const TValue &value)
+	{
+		if (size == 0)
+			return;
+
+		const std::unique_lock<std::mutex> lock(_mutex);
+
+		const entry range = { address, size, value, address };
+		_ranges.push_back(range);
+
+		auto data = std::make_unique<snapshot>(*_snapshot.load());
+		insert_part(*data, range);
+
+		publish(data.release());
+	}
+
+	/// <summary>
+	/// Removes the range associated with the specified <paramref name="value"/> from the index.
+	/// </summary>
+	/// <param name="value">Value to look up.</param>
+	/// <returns><see langword="true"/> if a range associated with the value existed and was removed, <see langword="false"/> otherwise.</returns>
+	bool erase(const TValue &value)
+	{
+		const std::unique_lock<std::mutex> lock(_mutex);
+
+		const auto range_it = std::find_if(_ranges.begin(), _ranges.end(),
+			[&value](const entry &range) { return range.value == value; });
+		if (range_it == _ranges.end())
+			return false;
+
+		const entry erased = *range_it;
+		_ranges.erase(range_it);
+
+		auto data = std::make_unique<snapshot>(*_snapshot.load());
+		data->erase(std::remove_if(data->begin(), data->end(),
+			[&value](const entry &part) { return part.value == value; }), data->end());
+
+		// Repaint the area the range covered with all remaining ranges that overlap it, in the order they were added in, so that more recently added ranges shadow older ones again
+		for (const entry &range : _ranges)
+		{
+			if (!overlaps(range, erased))
+				continue;
+
+			entry part = range;
+			part.address = std::max(range.address, erased.address);
+			part.size = std::min(range.address + range.size, erased.address + erased.size) - part.address;
+			insert_part(*data, part);
+		}
+
+		publish(data.release());
+		return true;
+	}
+
+	/// <summary>
+	/// Removes all ranges from the index.
+	/// </summary>
+	void clear()
+	{
+		const std::unique_lock<std::mutex> lock(_mutex);
+
+		_ranges.clear();
+		publish(new snapshot());
+	}
+
+	/// <summary>
+	/// Gets the number of ranges in the index, including ones that are shadowed by other ranges.
+	/// </summary>
+	size_t size() const
+	{
+		const std::unique_lock<std::mutex> lock(_mutex);
+		return _ranges.size();
+	}
+
+private:
+	/// <summary>
+	/// Registers a look up with the reader counter of the current epoch, so that modifications do not free the snapshot it reads from before it finished.
+	/// </summary>
+	class read_guard
+	{
+	public:
+		explicit read_guard(const address_range_map &map) :
+			_readers(map._readers[map._epoch.load() & 1])
+		{
+			_readers.fetch_add(1);
+		}
+		~read_guard()
+		{
+			_readers.fetch_sub(1);
+		}
+
+	private:
+		std::atomic<uint32_t> &_readers;
+	};
+
+	template <typename T>
+	static auto upper_bound(T &data, uint64_t address)
+	{
+		return std::upper_bound(data.begin(), data.end(), address,
+			[](uint64_t key, const entry &part) { return key < part.address; });
+	}
+	static bool overlaps(const entry &a, const entry &b)
+	{
+		return a.address < b.address + b.size && b.address < a.address + a.size;
+	}
+
+	static void insert_part(snapshot &data, const entry &part)
+	{
+		auto it = upper_bound(data, part.address);
+
+		// Find all parts that overlap the new one (the predecessor is the only one starting before it that can overlap)
+		if (it != data.begin() && overlaps(*(it - 1), part))
+			--it;
+		auto last = it;
+		while (last != data.end() && overlaps(*last, part))
+			++last;
+
+		// Only the first and last overlapped parts can extend beyond the new one, so keep what sticks out of those
+		entry parts[3];
+		size_t num_parts = 0;
+		if (it != last && it->address < part.address)
+		{
+			parts[num_parts] = *it;
+			parts[num_parts++].size = part.address - it->address;
+		}
+		parts[num_parts++] = part;
+		if (it != last && (last - 1)->address + (last - 1)->size > part.address + part.size)
+		{
+			parts[num_parts] = *(last - 1);
+			parts[num_parts].address = part.address + part.size;
+			parts[num_parts++].size = (last - 1)->address + (last - 1)->size - (part.address + part.size);
+		}
+
+		it = data.erase(it, last);
+		data.insert(it, parts, parts + num_parts);
+	}
+
+	void publish(const snapshot *data)
+	{
+		// Any look up that still reads the old snapshot registered with one of the two epochs before this exchange, while any look up that registers after it reads the new snapshot
+		_retired.push_back({ _snapshot.exchange(data) });
+
+		// Flip the epoch, so that new look ups register with the other reader counter and the current one can drain
+		_epoch.fetch_add(1);
+
+		// Once a reader counter was observed to be zero after a snapshot was replaced, none of the look ups that registered with it can still be reading that snapshot
+		// Only free a snapshot once this was the case for both counters, rather than waiting for them here while holding the lock
+		for (uint32_t i = 0; i < 2; ++i)
+			if (_readers[i].load() == 0)
+				for (retired_snapshot &retired : _retired)
+					retired.drained[i] = true;
+
+		_retired.erase(std::remove_if(_retired.begin(), _retired.end(),
+			[](const retired_snapshot &retired) {
+				if (!retired.drained[0] || !retired.drained[1])
+					return false;
+				delete retired.data;
+				return true;
+			}), _retired.end());
+	}
+
+	struct retired_snapshot
+	{
+		const snapshot *data;
+		bool drained[2] = {};
+	};
+
+	mutable std::mutex _mutex;
+	std::atomic<const snapshot *> _snapshot;
+	std::atomic<uint32_t> _epoch = 0;
+	mutable std::atomic<uint32_t> _readers[2] = {};
+	// All ranges in the index, in the order they were added in (only accessed while holding the mutex)
+	std::vector<entry> _ranges;
+	// Snapshots that were replaced, but may still be read by look ups (only accessed while holding the mutex)
+	std::vector<retired_snapshot> _retired;
+};
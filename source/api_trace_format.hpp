@@ -0,0 +1,665 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <reshade_api.hpp>
+#include <vector>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <algorithm>
+#include <type_traits>
+
+namespace api_trace
+{
+	using namespace reshade::api;
+
+	/// <summary>
+	/// The traced calls, which each map to a line in the text format.
+	/// </summary>
+	enum class trace_event : uint16_t
+	{
+		// Holds additional arguments of the preceding record, for calls that have more than fit into a single record
+		continuation,
+
+		begin_frame,
+		end_frame,
+		present,
+
+		barrier,
+		begin_render_pass,
+		end_render_pass,
+		bind_render_targets_and_depth_stencil,
+		bind_pipeline,
+		bind_pipeline_state,
+		bind_viewports,
+		bind_scissor_rects,
+		push_constants,
+		push_descriptors,
+		bind_descriptor_table,
+		bind_index_buffer,
+		bind_vertex_buffer,
+		draw,
+		draw_indexed,
+		dispatch,
+		draw_or_dispatch_indirect,
+		copy_resource,
+		copy_buffer_region,
+		copy_buffer_to_texture,
+		copy_texture_region,
+		copy_texture_to_buffer,
+		resolve_texture_region,
+		clear_depth_stencil_view,
+		clear_render_target_view,
+		clear_unordered_access_view_uint,
+		clear_unordered_access_view_float,
+		generate_mipmaps,
+		begin_query,
+		end_query,
+		copy_query_heap_results,
+
+		create_sampler,
+		destroy_sampler,
+		create_resource,
+		destroy_resource,
+		create_resource_view,
+		destroy_resource_view,
+	};
+
+	/// <summary>
+	/// A fixed-size record of a single traced call in the binary trace file.
+	/// Calls with more arguments than fit into one record are followed by <see cref="trace_event::continuation"/> records holding the rest.
+	/// </summary>
+	struct trace_record
+	{
+		static constexpr uint32_t max_args = 6;
+
+		trace_event event;
+		// Total number of arguments of the call (including those in continuation records), or the number of arguments in this record for continuation records
+		uint16_t num_args;
+		uint32_t thread_id;
+		// Value of the performance counter when the call was made, used to restore the order of calls made on different threads
+		uint64_t timestamp;
+		uint64_t args[max_args];
+	};
+
+	static_assert(sizeof(trace_record) == 64);
+
+	/// <summary>
+	/// Header at the start of a binary trace file, which is followed by a sequence of <see cref="trace_record"/> entries.
+	/// </summary>
+	struct trace_file_header
+	{
+		static constexpr uint32_t magic_value = 0x52544152; // "RATR"
+		static constexpr uint32_t version_value = 1;
+
+		uint32_t magic = magic_value;
+		uint32_t version = version_value;
+		// Frequency of the performance counter the record timestamps were taken with, in counts per second
+		uint64_t timestamp_frequency = 0;
+	};
+
+	/// <summary>
+	/// Gets the number of records a call with the specified number of arguments takes up.
+	/// </summary>
+	inline uint32_t num_records_for_args(uint32_t num_args)
+	{
+		return num_args <= trace_record::max_args ? 1 : 1 + (num_args - trace_record::max_args + trace_record::max_args - 1) / trace_record::max_args;
+	}
+
+	/// <summary>
+	/// Converts a value to a record argument.
+	/// </summary>
+	inline uint64_t to_arg(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+	template <typename T>
+	inline uint64_t to_arg(T value)
+	{
+		return static_cast<uint64_t>(value);
+	}
+
+	/// <summary>
+	/// Gets the number of arguments a structure takes up when stored with <see cref="struct_to_args"/>.
+	/// </summary>
+	template <typename T>
+	constexpr uint32_t num_struct_args = static_cast<uint32_t>((sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+
+	/// <summary>
+	/// Stores the bytes of a plain structure in consecutive record arguments.
+	/// </summary>
+	template <typename T>
+	inline void struct_to_args(const T &value, uint64_t *args)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		std::memset(args, 0, num_struct_args<T> * sizeof(uint64_t));
+		std::memcpy(args, &value, sizeof(T));
+	}
+	/// <summary>
+	/// Restores a plain structure from the record arguments starting at <paramref name="first"/> (returns a default value if there are not enough arguments).
+	/// </summary>
+	template <typename T>
+	inline T struct_from_args(const uint64_t *args, uint32_t num_args, uint32_t first)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		T value = {};
+		if (num_args >= first + num_struct_args<T>)
+			std::memcpy(&value, args + first, sizeof(T));
+		return value;
+	}
+
+	/// <summary>
+	/// Converts a record argument back to a value.
+	/// </summary>
+	template <typename T>
+	inline T from_arg(uint64_t arg)
+	{
+		if constexpr (std::is_same_v<T, float>)
+		{
+			const uint32_t bits = static_cast<uint32_t>(arg);
+			float value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+		else if constexpr (std::is_same_v<T, void *>)
+		{
+			return reinterpret_cast<void *>(static_cast<uintptr_t>(arg));
+		}
+		else
+		{
+			return static_cast<T>(arg);
+		}
+	}
+
+	inline auto to_string(resource_type value)
+	{
+		switch (value)
+		{
+		case resource_type::buffer:
+			return "buffer";
+		case resource_type::texture_1d:
+			return "texture_1d";
+		case resource_type::texture_2d:
+			return "texture_2d";
+		case resource_type::texture_3d:
+			return "texture_3d";
+		case resource_type::surface:
+			return "surface";
+		default:
+			return "unknown";
+		}
+	}
+	inline auto to_string(shader_stage value)
+	{
+		switch (value)
+		{
+		case shader_stage::vertex:
+			return "vertex";
+		case shader_stage::hull:
+			return "hull";
+		case shader_stage::domain:
+			return "domain";
+		case shader_stage::geometry:
+			return "geometry";
+		case shader_stage::pixel:
+			return "pixel";
+		case shader_stage::compute:
+			return "compute";
+		case shader_stage::all:
+			return "all";
+		case shader_stage::all_graphics:
+			return "all_graphics";
+		default:
+			return "unknown";
+		}
+	}
+	inline auto to_string(pipeline_stage value)
+	{
+		switch (value)
+		{
+		case pipeline_stage::vertex_shader:
+			return "vertex_shader";
+		case pipeline_stage::hull_shader:
+			return "hull_shader";
+		case pipeline_stage::domain_shader:
+			return "domain_shader";
+		case pipeline_stage::geometry_shader:
+			return "geometry_shader";
+		case pipeline_stage::pixel_shader:
+			return "pixel_shader";
+		case pipeline_stage::compute_shader:
+			return "compute_shader";
+		case pipeline_stage::input_assembler:
+			return "input_assembler";
+		case pipeline_stage::stream_output:
+			return "stream_output";
+		case pipeline_stage::rasterizer:
+			return "rasterizer";
+		case pipeline_stage::depth_stencil:
+			return "depth_stencil";
+		case pipeline_stage::output_merger:
+			return "output_merger";
+		case pipeline_stage::all:
+			return "all";
+		case pipeline_stage::all_graphics:
+			return "all_graphics";
+		case pipeline_stage::all_shader_stages:
+			return "all_shader_stages";
+		default:
+			return "unknown";
+		}
+	}
+	inline auto to_string(descriptor_type value)
+	{
+		switch (value)
+		{
+		case descriptor_type::sampler:
+			return "sampler";
+		case descriptor_type::sampler_with_resource_view:
+			return "sampler_with_resource_view";
+		case descriptor_type::shader_resource_view:
+			return "shader_resource_view";
+		case descriptor_type::unordered_access_view:
+			return "unordered_access_view";
+		case descriptor_type::constant_buffer:
+			return "constant_buffer";
+		default:
+			return "unknown";
+		}
+	}
+	inline auto to_string(dynamic_state value)
+	{
+		switch (value)
+		{
+		default:
+		case dynamic_state::unknown:
+			return "unknown";
+		case dynamic_state::alpha_test_enable:
+			return "alpha_test_enable";
+		case dynamic_state::alpha_reference_value:
+			return "alpha_reference_value";
+		case dynamic_state::alpha_func:
+			return "alpha_func";
+		case dynamic_state::srgb_write_enable:
+			return "srgb_write_enable";
+		case dynamic_state::primitive_topology:
+			return "primitive_topology";
+		case dynamic_state::sample_mask:
+			return "sample_mask";
+		case dynamic_state::alpha_to_coverage_enable:
+			return "alpha_to_coverage_enable";
+		case dynamic_state::blend_enable:
+			return "blend_enable";
+		case dynamic_state::logic_op_enable:
+			return "logic_op_enable";
+		case dynamic_state::color_blend_op:
+			return "color_blend_op";
+		case dynamic_state::source_color_blend_factor:
+			return "src_color_blend_factor";
+		case dynamic_state::dest_color_blend_factor:
+			return "dst_color_blend_factor";
+		case dynamic_state::alpha_blend_op:
+			return "alpha_blend_op";
+		case dynamic_state::source_alpha_blend_factor:
+			return "src_alpha_blend_factor";
+		case dynamic_state::dest_alpha_blend_factor:
+			return "dst_alpha_blend_factor";
+		case dynamic_state::logic_op:
+			return "logic_op";
+		case dynamic_state::blend_constant:
+			return "blend_constant";
+		case dynamic_state::render_target_write_mask:
+			return "render_target_write_mask";
+		case dynamic_state::fill_mode:
+			return "fill_mode";
+		case dynamic_state::cull_mode:
+			return "cull_mode";
+		case dynamic_state::front_counter_clockwise:
+			return "front_counter_clockwise";
+		case dynamic_state::depth_bias:
+			return "depth_bias";
+		case dynamic_state::depth_bias_clamp:
+			return "depth_bias_clamp";
+		case dynamic_state::depth_bias_slope_scaled:
+			return "depth_bias_slope_scaled";
+		case dynamic_state::depth_clip_enable:
+			return "depth_clip_enable";
+		case dynamic_state::scissor_enable:
+			return "scissor_enable";
+		case dynamic_state::multisample_enable:
+			return "multisample_enable";
+		case dynamic_state::antialiased_line_enable:
+			return "antialiased_line_enable";
+		case dynamic_state::depth_enable:
+			return "depth_enable";
+		case dynamic_state::depth_write_mask:
+			return "depth_write_mask";
+		case dynamic_state::depth_func:
+			return "depth_func";
+		case dynamic_state::stencil_enable:
+			return "stencil_enable";
+		case dynamic_state::front_stencil_read_mask:
+			return "front_stencil_read_mask";
+		case dynamic_state::front_stencil_write_mask:
+			return "front_stencil_write_mask";
+		case dynamic_state::front_stencil_reference_value:
+			return "front_stencil_reference_value";
+		case dynamic_state::front_stencil_func:
+			return "front_stencil_func";
+		case dynamic_state::front_stencil_pass_op:
+			return "front_stencil_pass_op";
+		case dynamic_state::front_stencil_fail_op:
+			return "front_stencil_fail_op";
+		case dynamic_state::front_stencil_depth_fail_op:
+			return "front_stencil_depth_fail_op";
+		case dynamic_state::back_stencil_read_mask:
+			return "back_stencil_read_mask";
+		case dynamic_state::back_stencil_write_mask:
+			return "back_stencil_write_mask";
+		case dynamic_state::back_stencil_reference_value:
+			return "back_stencil_reference_value";
+		case dynamic_state::back_stencil_func:
+			return "back_stencil_func";
+		case dynamic_state::back_stencil_pass_op:
+			return "back_stencil_pass_op";
+		case dynamic_state::back_stencil_fail_op:
+			return "back_stencil_fail_op";
+		case dynamic_state::back_stencil_depth_fail_op:
+			return "back_stencil_depth_fail_op";
+		}
+	}
+	inline auto to_string(resource_usage value)
+	{
+		switch (value)
+		{
+		default:
+		case resource_usage::undefined:
+			return "undefined";
+		case resource_usage::index_buffer:
+			return "index_buffer";
+		case resource_usage::vertex_buffer:
+			return "vertex_buffer";
+		case resource_usage::constant_buffer:
+			return "constant_buffer";
+		case resource_usage::stream_output:
+			return "stream_output";
+		case resource_usage::indirect_argument:
+			return "indirect_argument";
+		case resource_usage::depth_stencil:
+		case resource_usage::depth_stencil_read:
+		case resource_usage::depth_stencil_write:
+			return "depth_stencil";
+		case resource_usage::render_target:
+			return "render_target";
+		case resource_usage::shader_resource:
+		case resource_usage::shader_resource_pixel:
+		case resource_usage::shader_resource_non_pixel:
+			return "shader_resource";
+		case resource_usage::unordered_access:
+			return "unordered_access";
+		case resource_usage::copy_dest:
+			return "copy_dest";
+		case resource_usage::copy_source:
+			return "copy_source";
+		case resource_usage::resolve_dest:
+			return "resolve_dest";
+		case resource_usage::resolve_source:
+			return "resolve_source";
+		case resource_usage::general:
+			return "general";
+		case resource_usage::present:
+			return "present";
+		case resource_usage::cpu_access:
+			return "cpu_access";
+		}
+	}
+	inline auto to_string(query_type value)
+	{
+		switch (value)
+		{
+		case query_type::occlusion:
+			return "occlusion";
+		case query_type::binary_occlusion:
+			return "binary_occlusion";
+		case query_type::timestamp:
+			return "timestamp";
+		case query_type::pipeline_statistics:
+			return "pipeline_statistics";
+		case query_type::stream_output_statistics_0:
+			return "stream_output_statistics_0";
+		case query_type::stream_output_statistics_1:
+			return "stream_output_statistics_1";
+		case query_type::stream_output_statistics_2:
+			return "stream_output_statistics_2";
+		case query_type::stream_output_statistics_3:
+			return "stream_output_statistics_3";
+		default:
+			return "unknown";
+		}
+	}
+
+	/// <summary>
+	/// Writes the text representation of a traced call to the specified stream (without a trailing new line).
+	/// </summary>
+	/// <param name="s">Stream to write to.</param>
+	/// <param name="event">Type of the call.</param>
+	/// <param name="args">Arguments of the call, which have to be <paramref name="num_args"/> long.</param>
+	/// <param name="num_args">Number of arguments of the call.</param>
+	inline void format_trace_event(std::ostream &s, trace_event event, const uint64_t *args, uint32_t num_args)
+	{
+		const auto arg = [args, num_args](uint32_t index) { return index < num_args ? args[index] : 0; };
+		const auto ptr = [&arg](uint32_t index) { return from_arg<void *>(arg(index)); };
+
+		switch (event)
+		{
+		case trace_event::begin_frame:
+			s << "--- Frame ---";
+			break;
+		case trace_event::end_frame:
+			s << "--- End Frame ---";
+			break;
+		case trace_event::present:
+			s << "present()";
+			break;
+		case trace_event::barrier:
+			s << "barrier(" << ptr(0) << ", " << to_string(from_arg<resource_usage>(arg(1))) << ", " << to_string(from_arg<resource_usage>(arg(2))) << ")";
+			break;
+		case trace_event::begin_render_pass:
+			s << "begin_render_pass(" << arg(0) << ", { ";
+			for (uint32_t i = 0; i < arg(0); ++i)
+				s << ptr(2 + i) << ", ";
+			s << " }, " << ptr(1) << ")";
+			break;
+		case trace_event::end_render_pass:
+			s << "end_render_pass()";
+			break;
+		case trace_event::bind_render_targets_and_depth_stencil:
+			s << "bind_render_targets_and_depth_stencil(" << arg(0) << ", { ";
+			for (uint32_t i = 0; i < arg(0); ++i)
+				s << ptr(2 + i) << ", ";
+			s << " }, " << ptr(1) << ")";
+			break;
+		case trace_event::bind_pipeline:
+			s << "bind_pipeline(" << to_string(from_arg<pipeline_stage>(arg(0))) << ", " << ptr(1) << ")";
+			break;
+		case trace_event::bind_pipeline_state:
+			s << "bind_pipeline_state(" << to_string(from_arg<dynamic_state>(arg(0))) << ", " << arg(1) << ")";
+			break;
+		case trace_event::bind_viewports:
+			s << "bind_viewports(" << arg(0) << ", " << arg(1) << ", { ... })";
+			break;
+		case trace_event::bind_scissor_rects:
+			s << "bind_scissor_rects(" << arg(0) << ", " << arg(1) << ", { ... })";
+			break;
+		case trace_event::push_constants:
+			s << "push_constants(" << to_string(from_arg<shader_stage>(arg(0))) << ", " << ptr(1) << ", " << arg(2) << ", " << arg(3) << ", " << arg(4) << ", { ";
+			for (uint32_t i = 0; i < arg(4); ++i)
+				s << std::hex << arg(5 + i) << std::dec << ", ";
+			s << " })";
+			break;
+		case trace_event::push_descriptors:
+			s << "push_descriptors(" << to_string(from_arg<shader_stage>(arg(0))) << ", " << ptr(1) << ", " << arg(2) << ", { " << to_string(from_arg<descriptor_type>(arg(3))) << ", " << arg(4) << ", " << arg(5) << " })";
+			break;
+		case trace_event::bind_descriptor_table:
+			s << "bind_descriptor_table(" << to_string(from_arg<shader_stage>(arg(0))) << ", " << ptr(1) << ", " << arg(2) << ", " << ptr(3) << ")";
+			break;
+		case trace_event::bind_index_buffer:
+			s << "bind_index_buffer(" << ptr(0) << ", " << arg(1) << ", " << arg(2) << ")";
+			break;
+		case trace_event::bind_vertex_buffer:
+			s << "bind_vertex_buffer(" << arg(0) << ", " << ptr(1) << ", " << arg(2) << ", " << arg(3) << ")";
+			break;
+		case trace_event::draw:
+			s << "draw(" << arg(0) << ", " << arg(1) << ", " << arg(2) << ", " << arg(3) << ")";
+			break;
+		case trace_event::draw_indexed:
+			s << "draw_indexed(" << arg(0) << ", " << arg(1) << ", " << arg(2) << ", " << from_arg<int32_t>(arg(3)) << ", " << arg(4) << ")";
+			break;
+		case trace_event::dispatch:
+			s << "dispatch(" << arg(0) << ", " << arg(1) << ", " << arg(2) << ")";
+			break;
+		case trace_event::draw_or_dispatch_indirect:
+			switch (from_arg<indirect_command>(arg(0)))
+			{
+			default:
+			case indirect_command::unknown:
+				s << "draw_or_dispatch_indirect(";
+				break;
+			case indirect_command::draw:
+				s << "draw_indirect(";
+				break;
+			case indirect_command::draw_indexed:
+				s << "draw_indexed_indirect(";
+				break;
+			case indirect_command::dispatch:
+				s << "dispatch_indirect(";
+				break;
+			}
+			s << ptr(1) << ", " << arg(2) << ", " << arg(3) << ", " << arg(4) << ")";
+			break;
+		case trace_event::copy_resource:
+			s << "copy_resource(" << ptr(0) << ", " << ptr(1) << ")";
+			break;
+		case trace_event::copy_buffer_region:
+			s << "copy_buffer_region(" << ptr(0) << ", " << arg(1) << ", " << ptr(2) << ", " << arg(3) << ", " << arg(4) << ")";
+			break;
+		case trace_event::copy_buffer_to_texture:
+			s << "copy_buffer_to_texture(" << ptr(0) << ", " << arg(1) << ", " << arg(2) << ", " << arg(3) << ", " << ptr(4) << ", " << arg(5) << ")";
+			break;
+		case trace_event::copy_texture_region:
+			s << "copy_texture_region(" << ptr(0) << ", " << arg(1) << ", " << ptr(2) << ", " << arg(3) << ", " << arg(4) << ")";
+			break;
+		case trace_event::copy_texture_to_buffer:
+			s << "copy_texture_to_buffer(" << ptr(0) << ", " << arg(1) << ", " << ptr(2) << ", " << arg(3) << ", " << arg(4) << ", " << arg(5) << ")";
+			break;
+		case trace_event::resolve_texture_region:
+			s << "resolve_texture_region(" << ptr(0) << ", " << arg(1) << ", { ... }, " << ptr(2) << ", " << arg(3) << ", " << from_arg<int32_t>(arg(4)) << ", " << from_arg<int32_t>(arg(5)) << ", " << from_arg<int32_t>(arg(6)) << ", " << arg(7) << ")";
+			break;
+		case trace_event::clear_depth_stencil_view:
+			s << "clear_depth_stencil_view(" << ptr(0) << ", " << from_arg<float>(arg(1)) << ", " << arg(2) << ")";
+			break;
+		case trace_event::clear_render_target_view:
+			s << "clear_render_target_view(" << ptr(0) << ", { " << from_arg<float>(arg(1)) << ", " << from_arg<float>(arg(2)) << ", " << from_arg<float>(arg(3)) << ", " << from_arg<float>(arg(4)) << " })";
+			break;
+		case trace_event::clear_unordered_access_view_uint:
+			s << "clear_unordered_access_view_uint(" << ptr(0) << ", { " << arg(1) << ", " << arg(2) << ", " << arg(3) << ", " << arg(4) << " })";
+			break;
+		case trace_event::clear_unordered_access_view_float:
+			s << "clear_unordered_access_view_float(" << ptr(0) << ", { " << from_arg<float>(arg(1)) << ", " << from_arg<float>(arg(2)) << ", " << from_arg<float>(arg(3)) << ", " << from_arg<float>(arg(4)) << " })";
+			break;
+		case trace_event::generate_mipmaps:
+			s << "generate_mipmaps(" << ptr(0) << ")";
+			break;
+		case trace_event::begin_query:
+			s << "begin_query(" << ptr(0) << ", " << to_string(from_arg<query_type>(arg(1))) << ", " << arg(2) << ")";
+			break;
+		case trace_event::end_query:
+			s << "end_query(" << ptr(0) << ", " << to_string(from_arg<query_type>(arg(1))) << ", " << arg(2) << ")";
+			break;
+		case trace_event::copy_query_heap_results:
+			s << "copy_query_heap_results(" << ptr(0) << ", " << to_string(from_arg<query_type>(arg(1))) << ", " << arg(2) << ", " << arg(3) << ", " << ptr(4) << ", " << arg(5) << ", " << arg(6) << ")";
+			break;
+		case trace_event::create_sampler:
+			s << "create_sampler(" << ptr(0) << ", " << static_cast<uint32_t>(struct_from_args<sampler_desc>(args, num_args, 1).filter) << ")";
+			break;
+		case trace_event::destroy_sampler:
+			s << "destroy_sampler(" << ptr(0) << ")";
+			break;
+		case trace_event::create_resource:
+			if (const resource_desc desc = struct_from_args<resource_desc>(args, num_args, 2);
+				desc.type == resource_type::buffer)
+				s << "create_resource(" << ptr(0) << ", " << to_string(desc.type) << ", " << desc.buffer.size << ", " << to_string(from_arg<resource_usage>(arg(1))) << ")";
+			else
+				s << "create_resource(" << ptr(0) << ", " << to_string(desc.type) << ", " << desc.texture.width << ", " << desc.texture.height << ", " << desc.texture.depth_or_layers << ", " << desc.texture.levels << ", " << static_cast<uint32_t>(desc.texture.format) << ", " << desc.texture.samples << ", " << to_string(from_arg<resource_usage>(arg(1))) << ")";
+			break;
+		case trace_event::destroy_resource:
+			s << "destroy_resource(" << ptr(0) << ")";
+			break;
+		case trace_event::create_resource_view:
+			s << "create_resource_view(" << ptr(0) << ", " << ptr(1) << ", " << to_string(from_arg<resource_usage>(arg(2))) << ", " << static_cast<uint32_t>(struct_from_args<resource_view_desc>(args, num_args, 3).format) << ")";
+			break;
+		case trace_event::destroy_resource_view:
+			s << "destroy_resource_view(" << ptr(0) << ")";
+			break;
+		default:
+			s << "unknown()";
+			break;
+		}
+	}
+
+	/// <summary>
+	/// A traced call reassembled from its records.
+	/// </summary>
+	struct trace_call
+	{
+		trace_event event;
+		uint32_t thread_id;
+		uint64_t timestamp;
+		std::vector<uint64_t> args;
+	};
+
+	/// <summary>
+	/// Reads all calls from a binary trace file and sorts them into the order they were made in.
+	/// </summary>
+	/// <param name="input">Stream to read the file from (opened in binary mode).</param>
+	/// <param name="header">Receives the file header.</param>
+	/// <param name="calls">Receives the calls.</param>
+	/// <returns><see langword="true"/> if the file was read successfully, <see langword="false"/> if it is not a trace file or has an unsupported version.</returns>
+	inline bool read_trace_file(std::istream &input, trace_file_header &header, std::vector<trace_call> &calls)
+	{
+		if (!input.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != trace_file_header::magic_value || header.version != trace_file_header::version_value)
+			return false;
+
+		for (trace_record record; input.read(reinterpret_cast<char *>(&record), sizeof(record));)
+		{
+			const uint32_t num_record_args = std::min<uint32_t>(record.num_args, trace_record::max_args);
+
+			if (record.event == trace_event::continuation)
+			{
+				// Records of a single call are always written next to each other, so this belongs to the last call
+				if (!calls.empty())
+					calls.back().args.insert(calls.back().args.end(), record.args, record.args + num_record_args);
+				continue;
+			}
+
+			trace_call &call = calls.emplace_back();
+			call.event = record.event;
+			call.thread_id = record.thread_id;
+			call.timestamp = record.timestamp;
+			call.args.reserve(record.num_args);
+			call.args.assign(record.args, record.args + num_record_args);
+		}
+
+		// Each thread writes its calls in blocks, so restore the global order of calls (while keeping the order of calls made on the same thread)
+		std::stable_sort(calls.begin(), calls.end(),
+			[](const trace_call &lhs, const trace_call &rhs) { return lhs.timestamp < rhs.timestamp; });
+
+		return true;
+	}
+}
@@ -0,0 +1,550 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include "api_trace_format.hpp"
+#include <chrono>
+#include <unordered_map>
+
+namespace api_trace
+{
+	/// <summary>
+	/// Results of replaying a trace.
+	/// </summary>
+	struct replay_statistics
+	{
+		// Time it took to issue all the calls of each frame (including the flush at the end of the frame), in milliseconds
+		std::vector<double> frame_times;
+		uint64_t num_calls = 0;
+		// Number of calls that could not be replayed, because they refer to objects that are not part of the trace (pipeline layouts, descriptor tables and query heaps) or that failed to be created
+		// This includes all draw calls and dispatches on devices that execute commands, since no pipeline is bound to them
+		uint64_t num_skipped_calls = 0;
+		// Number of objects of the trace that failed to be created when it was loaded
+		uint32_t num_failed_objects = 0;
+	};
+
+	/// <summary>
+	/// Replays the command stream in a binary trace file on a device.
+	/// </summary>
+	/// <remarks>
+	/// Samplers, resources and resource views are recreated from their recorded descriptions (without their contents) once when the trace is loaded, so that replaying it only issues commands.
+	/// While replaying, the recorded create and destroy calls only change which of these objects a recorded handle refers to (handles may be reused by the application during the capture).
+	/// All commands are issued to the immediate command list of the queue, which is flushed at the end of every frame.
+	/// The state of every recreated resource is tracked across replays, so that barriers transition from the state it is actually in (which differs from the recorded one for resources that existed before the capture started) and commands find their resources in the state they require.
+	/// Pipelines are only recorded by handle, not by their shaders and states, so draw calls and dispatches are only issued on the null device (which never executes them), with a stand-in pipeline bound for every recorded one.
+	/// </remarks>
+	class trace_replayer
+	{
+	public:
+		trace_replayer() = default;
+		~trace_replayer()
+		{
+			unload();
+		}
+
+		trace_replayer(const trace_replayer &) = delete;
+		trace_replayer &operator=(const trace_replayer &) = delete;
+
+		/// <summary>
+		/// Reads the calls from a binary trace file and creates all objects they use on the specified <paramref name="device"/>.
+		/// </summary>
+		/// <returns><see langword="true"/> if the file was read successfully, <see langword="false"/> otherwise.</returns>
+		bool load(device *device, std::istream &input)
+		{
+			unload();
+
+			if (trace_file_header header; !read_trace_file(input, header, _calls))
+			{
+				_calls.clear();
+				return false;
+			}
+
+			_device = device;
+			_issue_draw_calls = device->get_api() == device_api::null;
+
+			for (const trace_call &call : _calls)
+			{
+				const uint64_t *const args = call.args.data();
+				const uint32_t num_args = static_cast<uint32_t>(call.args.size());
+				const auto arg = [args, num_args](uint32_t index) { return index < num_args ? args[index] : 0; };
+
+				switch (call.event)
+				{
+				case trace_event::create_sampler:
+				{
+					sampler &handle = _created_samplers.emplace_back();
+					if (!device->create_sampler(struct_from_args<sampler_desc>(args, num_args, 1), &handle))
+					{
+						handle = { 0 };
+						_num_failed_objects++;
+					}
+					break;
+				}
+				case trace_event::create_resource:
+				{
+					created_resource &created = _created_resources.emplace_back();
+					created.state = from_arg<resource_usage>(arg(1));
+					if (device->create_resource(struct_from_args<resource_desc>(args, num_args, 2), nullptr, created.state, &created.handle))
+					{
+						_resources[arg(0)] = _created_resources.size() - 1;
+					}
+					else
+					{
+						created.handle = { 0 };
+						_resources.erase(arg(0));
+						_num_failed_objects++;
+					}
+					break;
+				}
+				case trace_event::destroy_resource:
+					_resources.erase(arg(0));
+					break;
+				case trace_event::create_resource_view:
+				{
+					// Views are created for the resource the recorded handle referred to at this point of the trace
+					created_view &created = _created_views.emplace_back();
+					if (const auto it = _resources.find(arg(1));
+						it != _resources.end() && device->create_resource_view(_created_resources[it->second].handle, from_arg<resource_usage>(arg(2)), struct_from_args<resource_view_desc>(args, num_args, 3), &created.handle))
+					{
+						created.resource_index = it->second;
+					}
+					else
+					{
+						created.handle = { 0 };
+						_num_failed_objects++;
+					}
+					break;
+				}
+				case trace_event::bind_pipeline:
+					// Bind an empty pipeline in place of every recorded one, which is enough for the null device to deliver the same events for them
+					if (pipeline handle; _issue_draw_calls && arg(1) != 0 && _pipelines.find(arg(1)) == _pipelines.end() && device->create_pipeline({ 0 }, 0, nullptr, &handle))
+						_pipelines[arg(1)] = handle;
+					break;
+				}
+			}
+
+			// Only the recreated objects are kept, which recorded handle refers to which of them is determined again during every replay
+			_resources.clear();
+			return true;
+		}
+
+		/// <summary>
+		/// Destroys all objects that were created for the loaded trace and releases its calls.
+		/// The queue the trace was replayed on has to be idle.
+		/// </summary>
+		void unload()
+		{
+			if (_device != nullptr)
+			{
+				for (const auto &[recorded, handle] : _pipelines)
+					_device->destroy_pipeline(handle);
+				for (const created_view &view : _created_views)
+					_device->destroy_resource_view(view.handle);
+				for (const created_resource &res : _created_resources)
+					_device->destroy_resource(res.handle);
+				for (const sampler handle : _created_samplers)
+					_device->destroy_sampler(handle);
+			}
+
+			_device = nullptr;
+			_calls.clear();
+			_pipelines.clear();
+			_created_samplers.clear();
+			_created_resources.clear();
+			_created_views.clear();
+			_num_failed_objects = 0;
+		}
+
+		/// <summary>
+		/// Replays the loaded calls once on the device they were loaded for.
+		/// </summary>
+		/// <param name="queue">Queue to issue commands to.</param>
+		/// <param name="stats">Receives the results.</param>
+		/// <param name="cmd_list">Optional command list to record the commands to instead of the immediate command list of the <paramref name="queue"/>. Submitting it is up to the caller.</param>
+		void replay(command_queue *queue, replay_statistics &stats, command_list *cmd_list = nullptr)
+		{
+			if (_device == nullptr)
+				return;
+
+			if (cmd_list == nullptr)
+				cmd_list = queue->get_immediate_command_list();
+
+			stats.num_failed_objects = _num_failed_objects;
+
+			size_t next_resource = 0;
+			size_t next_view = 0;
+
+			auto frame_start = std::chrono::high_resolution_clock::now();
+
+			for (const trace_call &call : _calls)
+			{
+				const uint64_t recorded = call.args.empty() ? 0 : call.args[0];
+
+				switch (call.event)
+				{
+				case trace_event::begin_frame:
+					frame_start = std::chrono::high_resolution_clock::now();
+					continue;
+				case trace_event::end_frame:
+					queue->flush_immediate_command_list();
+
+					stats.frame_times.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frame_start).count());
+					continue;
+				// Samplers are only used through descriptors, which are not part of the trace, so there is nothing to map them for
+				case trace_event::create_sampler:
+				case trace_event::destroy_sampler:
+					continue;
+				// Objects were created in the same order when the trace was loaded, so the next one of the matching type is the one created by this call
+				case trace_event::create_resource:
+					map_created(_resources, recorded, next_resource, _created_resources[next_resource].handle != 0);
+					next_resource++;
+					continue;
+				case trace_event::create_resource_view:
+					map_created(_resource_views, recorded, next_view, _created_views[next_view].handle != 0);
+					next_view++;
+					continue;
+				case trace_event::destroy_resource:
+					_resources.erase(recorded);
+					continue;
+				case trace_event::destroy_resource_view:
+					_resource_views.erase(recorded);
+					continue;
+				}
+
+				stats.num_calls++;
+				if (!replay_call(cmd_list, call.event, call.args.data(), static_cast<uint32_t>(call.args.size())))
+					stats.num_skipped_calls++;
+			}
+
+			queue->flush_immediate_command_list();
+			queue->wait_idle();
+
+			_resources.clear();
+			_resource_views.clear();
+		}
+
+	private:
+		struct created_resource
+		{
+			resource handle = { 0 };
+			// Current state of the resource, which is tracked across replays
+			resource_usage state = resource_usage::undefined;
+		};
+		struct created_view
+		{
+			resource_view handle = { 0 };
+			size_t resource_index = 0;
+		};
+
+		static void map_created(std::unordered_map<uint64_t, size_t> &map, uint64_t recorded, size_t index, bool created)
+		{
+			if (created)
+				map[recorded] = index;
+			else
+				map.erase(recorded);
+		}
+
+		/// <summary>
+		/// Looks up the recreated object a recorded handle currently refers to, with null handles mapping to themselves.
+		/// </summary>
+		template <typename T, typename C>
+		static bool map_handle(const std::unordered_map<uint64_t, size_t> &map, const std::vector<C> &created, uint64_t recorded, T &handle)
+		{
+			if (recorded == 0)
+			{
+				handle = { 0 };
+				return true;
+			}
+
+			if (const auto it = map.find(recorded); it != map.end())
+			{
+				handle = created[it->second].handle;
+				return true;
+			}
+
+			return false;
+		}
+
+		/// <summary>
+		/// Transitions a recreated resource from the state it is currently in to the specified <paramref name="state"/>.
+		/// </summary>
+		void transition_created(command_list *cmd_list, size_t index, resource_usage state)
+		{
+			created_resource &created = _created_resources[index];
+			if (created.state == state)
+				return;
+
+			cmd_list->barrier(1, &created.handle, &created.state, &state);
+			created.state = state;
+		}
+		void transition(command_list *cmd_list, uint64_t recorded, resource_usage state)
+		{
+			if (const auto it = _resources.find(recorded); it != _resources.end())
+				transition_created(cmd_list, it->second, state);
+		}
+		void transition_view(command_list *cmd_list, uint64_t recorded_view, resource_usage state)
+		{
+			if (const auto it = _resource_views.find(recorded_view); it != _resource_views.end())
+				transition_created(cmd_list, _created_views[it->second].resource_index, state);
+		}
+
+		bool replay_call(command_list *cmd_list, trace_event event, const uint64_t *args, uint32_t num_args)
+		{
+			const auto arg = [args, num_args](uint32_t index) { return index < num_args ? args[index] : 0; };
+			const auto res = [this, &arg](uint32_t index, resource &handle) { return map_handle(_resources, _created_resources, arg(index), handle); };
+			const auto view = [this, &arg](uint32_t index, resource_view &handle) { return map_handle(_resource_views, _created_views, arg(index), handle); };
+
+			switch (event)
+			{
+			case trace_event::present:
+				return true;
+			case trace_event::barrier:
+				if (resource resource; res(0, resource) && resource != 0)
+				{
+					const resource_usage old_state = from_arg<resource_usage>(arg(1));
+					const resource_usage new_state = from_arg<resource_usage>(arg(2));
+					// UAV barriers do not change the state, so only issue them if the resource is actually in that state
+					if (old_state == resource_usage::unordered_access && new_state == resource_usage::unordered_access)
+					{
+						if (_created_resources[_resources.at(arg(0))].state == resource_usage::unordered_access)
+							cmd_list->barrier(1, &resource, &old_state, &new_state);
+						return true;
+					}
+					// The recorded old state is only known to match for resources that were created during the capture, so transition from the tracked state instead
+					transition(cmd_list, arg(0), new_state);
+					return true;
+				}
+				return false;
+			case trace_event::begin_render_pass:
+			{
+				// Load and store operations are not recorded, so this always loads and stores the contents
+				const uint32_t count = std::min(static_cast<uint32_t>(arg(0)), 8u);
+				render_pass_render_target_desc rts[8];
+				for (uint32_t i = 0; i < count; ++i)
+					if (!view(2 + i, rts[i].view))
+						return false;
+				render_pass_depth_stencil_desc ds;
+				if (!view(1, ds.view))
+					return false;
+				for (uint32_t i = 0; i < count; ++i)
+					transition_view(cmd_list, arg(2 + i), resource_usage::render_target);
+				transition_view(cmd_list, arg(1), resource_usage::depth_stencil);
+				cmd_list->begin_render_pass(count, rts, ds.view != 0 ? &ds : nullptr);
+				return true;
+			}
+			case trace_event::end_render_pass:
+				cmd_list->end_render_pass();
+				return true;
+			case trace_event::bind_render_targets_and_depth_stencil:
+			{
+				const uint32_t count = std::min(static_cast<uint32_t>(arg(0)), 8u);
+				resource_view rtvs[8], dsv;
+				for (uint32_t i = 0; i < count; ++i)
+					if (!view(2 + i, rtvs[i]))
+						return false;
+				if (!view(1, dsv))
+					return false;
+				for (uint32_t i = 0; i < count; ++i)
+					transition_view(cmd_list, arg(2 + i), resource_usage::render_target);
+				transition_view(cmd_list, arg(1), resource_usage::depth_stencil);
+				cmd_list->bind_render_targets_and_depth_stencil(count, rtvs, dsv);
+				return true;
+			}
+			case trace_event::bind_pipeline_state:
+			{
+				const dynamic_state state = from_arg<dynamic_state>(arg(0));
+				const uint32_t value = static_cast<uint32_t>(arg(1));
+				cmd_list->bind_pipeline_states(1, &state, &value);
+				return true;
+			}
+			case trace_event::bind_viewports:
+			{
+				const uint32_t count = static_cast<uint32_t>(arg(1));
+				if (num_args < 2 + count * num_struct_args<viewport>)
+					return false;
+				std::vector<viewport> viewports(count);
+				for (uint32_t i = 0; i < count; ++i)
+					viewports[i] = struct_from_args<viewport>(args, num_args, 2 + i * num_struct_args<viewport>);
+				cmd_list->bind_viewports(static_cast<uint32_t>(arg(0)), count, viewports.data());
+				return true;
+			}
+			case trace_event::bind_scissor_rects:
+			{
+				const uint32_t count = static_cast<uint32_t>(arg(1));
+				if (num_args < 2 + count * num_struct_args<rect>)
+					return false;
+				std::vector<rect> rects(count);
+				for (uint32_t i = 0; i < count; ++i)
+					rects[i] = struct_from_args<rect>(args, num_args, 2 + i * num_struct_args<rect>);
+				cmd_list->bind_scissor_rects(static_cast<uint32_t>(arg(0)), count, rects.data());
+				return true;
+			}
+			case trace_event::bind_index_buffer:
+				if (resource buffer; res(0, buffer))
+				{
+					cmd_list->bind_index_buffer(buffer, arg(1), static_cast<uint32_t>(arg(2)));
+					return true;
+				}
+				return false;
+			case trace_event::bind_vertex_buffer:
+				if (resource buffer; res(1, buffer))
+				{
+					const uint64_t offset = arg(2);
+					const uint32_t stride = static_cast<uint32_t>(arg(3));
+					cmd_list->bind_vertex_buffers(static_cast<uint32_t>(arg(0)), 1, &buffer, &offset, &stride);
+					return true;
+				}
+				return false;
+			case trace_event::bind_pipeline:
+				if (const auto it = _pipelines.find(arg(1)); it != _pipelines.end())
+				{
+					cmd_list->bind_pipeline(from_arg<pipeline_stage>(arg(0)), it->second);
+					return true;
+				}
+				return false;
+			case trace_event::draw:
+				if (!_issue_draw_calls)
+					return false;
+				cmd_list->draw(static_cast<uint32_t>(arg(0)), static_cast<uint32_t>(arg(1)), static_cast<uint32_t>(arg(2)), static_cast<uint32_t>(arg(3)));
+				return true;
+			case trace_event::draw_indexed:
+				if (!_issue_draw_calls)
+					return false;
+				cmd_list->draw_indexed(static_cast<uint32_t>(arg(0)), static_cast<uint32_t>(arg(1)), static_cast<uint32_t>(arg(2)), from_arg<int32_t>(arg(3)), static_cast<uint32_t>(arg(4)));
+				return true;
+			case trace_event::dispatch:
+				if (!_issue_draw_calls)
+					return false;
+				cmd_list->dispatch(static_cast<uint32_t>(arg(0)), static_cast<uint32_t>(arg(1)), static_cast<uint32_t>(arg(2)));
+				return true;
+			case trace_event::draw_or_dispatch_indirect:
+				if (resource buffer; _issue_draw_calls && res(1, buffer) && buffer != 0)
+				{
+					transition(cmd_list, arg(1), resource_usage::indirect_argument);
+					cmd_list->draw_or_dispatch_indirect(from_arg<indirect_command>(arg(0)), buffer, arg(2), static_cast<uint32_t>(arg(3)), static_cast<uint32_t>(arg(4)));
+					return true;
+				}
+				return false;
+			case trace_event::copy_resource:
+				if (resource src, dst; res(0, src) && res(1, dst) && src != 0 && dst != 0)
+				{
+					transition(cmd_list, arg(0), resource_usage::copy_source);
+					transition(cmd_list, arg(1), resource_usage::copy_dest);
+					cmd_list->copy_resource(src, dst);
+					return true;
+				}
+				return false;
+			case trace_event::copy_buffer_region:
+				if (resource src, dst; res(0, src) && res(2, dst) && src != 0 && dst != 0)
+				{
+					transition(cmd_list, arg(0), resource_usage::copy_source);
+					transition(cmd_list, arg(2), resource_usage::copy_dest);
+					cmd_list->copy_buffer_region(src, arg(1), dst, arg(3), arg(4));
+					return true;
+				}
+				return false;
+			case trace_event::copy_buffer_to_texture:
+				if (resource src, dst; res(0, src) && res(4, dst) && src != 0 && dst != 0)
+				{
+					transition(cmd_list, arg(0), resource_usage::copy_source);
+					transition(cmd_list, arg(4), resource_usage::copy_dest);
+					cmd_list->copy_buffer_to_texture(src, arg(1), static_cast<uint32_t>(arg(2)), static_cast<uint32_t>(arg(3)), dst, static_cast<uint32_t>(arg(5)));
+					return true;
+				}
+				return false;
+			case trace_event::copy_texture_region:
+				if (resource src, dst; res(0, src) && res(2, dst) && src != 0 && dst != 0)
+				{
+					transition(cmd_list, arg(0), resource_usage::copy_source);
+					transition(cmd_list, arg(2), resource_usage::copy_dest);
+					cmd_list->copy_texture_region(src, static_cast<uint32_t>(arg(1)), nullptr, dst, static_cast<uint32_t>(arg(3)), nullptr, from_arg<filter_mode>(arg(4)));
+					return true;
+				}
+				return false;
+			case trace_event::copy_texture_to_buffer:
+				if (resource src, dst; res(0, src) && res(2, dst) && src != 0 && dst != 0)
+				{
+					transition(cmd_list, arg(0), resource_usage::copy_source);
+					transition(cmd_list, arg(2), resource_usage::copy_dest);
+					cmd_list->copy_texture_to_buffer(src, static_cast<uint32_t>(arg(1)), nullptr, dst, arg(3), static_cast<uint32_t>(arg(4)), static_cast<uint32_t>(arg(5)));
+					return true;
+				}
+				return false;
+			case trace_event::resolve_texture_region:
+				if (resource src, dst; res(0, src) && res(2, dst) && src != 0 && dst != 0)
+				{
+					transition(cmd_list, arg(0), resource_usage::resolve_source);
+					transition(cmd_list, arg(2), resource_usage::resolve_dest);
+					cmd_list->resolve_texture_region(src, static_cast<uint32_t>(arg(1)), nullptr, dst, static_cast<uint32_t>(arg(3)), from_arg<int32_t>(arg(4)), from_arg<int32_t>(arg(5)), from_arg<int32_t>(arg(6)), from_arg<format>(arg(7)));
+					return true;
+				}
+				return false;
+			case trace_event::clear_depth_stencil_view:
+				if (resource_view dsv; view(0, dsv) && dsv != 0)
+				{
+					const float depth = from_arg<float>(arg(1));
+					const uint8_t stencil = static_cast<uint8_t>(arg(2));
+					transition_view(cmd_list, arg(0), resource_usage::depth_stencil_write);
+					cmd_list->clear_depth_stencil_view(dsv, &depth, &stencil);
+					return true;
+				}
+				return false;
+			case trace_event::clear_render_target_view:
+				if (resource_view rtv; view(0, rtv) && rtv != 0)
+				{
+					const float color[4] = { from_arg<float>(arg(1)), from_arg<float>(arg(2)), from_arg<float>(arg(3)), from_arg<float>(arg(4)) };
+					transition_view(cmd_list, arg(0), resource_usage::render_target);
+					cmd_list->clear_render_target_view(rtv, color);
+					return true;
+				}
+				return false;
+			case trace_event::clear_unordered_access_view_uint:
+				if (resource_view uav; view(0, uav) && uav != 0)
+				{
+					const uint32_t values[4] = { static_cast<uint32_t>(arg(1)), static_cast<uint32_t>(arg(2)), static_cast<uint32_t>(arg(3)), static_cast<uint32_t>(arg(4)) };
+					transition_view(cmd_list, arg(0), resource_usage::unordered_access);
+					cmd_list->clear_unordered_access_view_uint(uav, values);
+					return true;
+				}
+				return false;
+			case trace_event::clear_unordered_access_view_float:
+				if (resource_view uav; view(0, uav) && uav != 0)
+				{
+					const float values[4] = { from_arg<float>(arg(1)), from_arg<float>(arg(2)), from_arg<float>(arg(3)), from_arg<float>(arg(4)) };
+					transition_view(cmd_list, arg(0), resource_usage::unordered_access);
+					cmd_list->clear_unordered_access_view_float(uav, values);
+					return true;
+				}
+				return false;
+			case trace_event::generate_mipmaps:
+				if (resource_view srv; view(0, srv) && srv != 0)
+				{
+					transition_view(cmd_list, arg(0), resource_usage::shader_resource);
+					cmd_list->generate_mipmaps(srv);
+					return true;
+				}
+				return false;
+			default:
+				// Pipeline layouts, descriptor tables and query heaps are not part of the trace, so there is nothing to bind or use
+				return false;
+			}
+		}
+
+		device *_device = nullptr;
+		std::vector<trace_call> _calls;
+		// Objects created for the trace when it was loaded, in the order they are created in the trace
+		std::vector<sampler> _created_samplers;
+		std::vector<created_resource> _created_resources;
+		std::vector<created_view> _created_views;
+		uint32_t _num_failed_objects = 0;
+		// Stand-in pipeline for every recorded pipeline handle (only on the null device)
+		std::unordered_map<uint64_t, pipeline> _pipelines;
+		// Index of the created object every recorded handle currently refers to, which changes as the replay passes the recorded create and destroy calls
+		std::unordered_map<uint64_t, size_t> _resources;
+		std::unordered_map<uint64_t, size_t> _resource_views;
+		bool _issue_draw_calls = false;
+	};
+}
@@ -1218,6 +1218,12 @@ HRESULT STDMETHODCALLTYPE D3D11DeviceContext::FinishCommandList(BOOL RestoreDefe
 	{
 		reshade::invoke_addon_event<reshade::addon_event::reset_command_list>(this);
 	}
+	else
+	{
+		// The deferred context keeps its state, but the commands recorded so far moved to the command list regardless, so discard the events recorded for batched callbacks too
+		// Otherwise they would be added again to the next command list that is created from this deferred context
+		reshade::reset_batched_addon_events(this, false);
+	}
 #endif
 
 	return hr;
@@ -1445,11 +1445,7 @@ void reshade::d3d12::device_impl::register_resource(ID3D12Resource *resource)
 		desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
 	{
 		if (const D3D12_GPU_VIRTUAL_ADDRESS address = resource->GetGPUVirtualAddress())
-		{
-			const std::unique_lock<std::shared_mutex> lock(_resource_mutex);
-
-			_buffer_gpu_addresses.emplace_back(resource, D3D12_GPU_VIRTUAL_ADDRESS_RANGE { address, desc.Width });
-		}
+			_buffer_gpu_addresses.insert(address, desc.Width, resource);
 	}
 #endif
 }
@@ -1460,18 +1456,7 @@ void reshade::d3d12::device_impl::unregister_resource(ID3D12Resource *resource)
 #if RESHADE_ADDON >= 2
 	if (const D3D12_RESOURCE_DESC desc = resource->GetDesc();
 		desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
-	{
-		const std::unique_lock<std::shared_mutex> lock(_resource_mutex);
-
-		if (const auto it = std::find_if(_buffer_gpu_addresses.begin(), _buffer_gpu_addresses.end(),
-				[resource](const std::pair<ID3D12Resource *, D3D12_GPU_VIRTUAL_ADDRESS_RANGE> &buffer_info) {
-					return buffer_info.first == resource;
-				});
-			it != _buffer_gpu_addresses.end())
-		{
-			_buffer_gpu_addresses.erase(it);
-		}
-	}
+		_buffer_gpu_addresses.erase(resource);
 #endif
 
 #if 0
@@ -1509,19 +1494,10 @@ bool reshade::d3d12::device_impl::resolve_gpu_address(D3D12_GPU_VIRTUAL_ADDRESS
 	if (!address)
 		return true;
 
-	const std::shared_lock<std::shared_mutex> lock(_resource_mutex);
-
-	for (const auto &buffer_info : _buffer_gpu_addresses)
+	if (ID3D12Resource *resource = nullptr;
+		_buffer_gpu_addresses.find(address, &resource, out_offset))
 	{
-		if (address < buffer_info.second.StartAddress)
-			continue;
-
-		const UINT64 address_offset = address - buffer_info.second.StartAddress;
-		if (address_offset >= buffer_info.second.SizeInBytes)
-			continue;
-
-		*out_offset = address_offset;
-		*out_resource = to_handle(buffer_info.first);
+		*out_resource = to_handle(resource);
 		return true;
 	}
 
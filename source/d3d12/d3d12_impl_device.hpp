@@ -6,6 +6,7 @@
 #pragma once
 
 #include "descriptor_heap.hpp"
+#include "address_range_map.hpp"
 #include "reshade_api_object_impl.hpp"
 #include <unordered_map>
 #include <concurrent_vector.h>
@@ -157,7 +158,7 @@ namespace reshade::d3d12
 		mutable std::shared_mutex _resource_mutex;
 #if RESHADE_ADDON >= 2
 		concurrency::concurrent_vector<D3D12DescriptorHeap *> _descriptor_heaps;
-		std::vector<std::pair<ID3D12Resource *, D3D12_GPU_VIRTUAL_ADDRESS_RANGE>> _buffer_gpu_addresses; // TODO: Replace with interval tree
+		address_range_map<ID3D12Resource *> _buffer_gpu_addresses;
 #endif
 		std::unordered_map<SIZE_T, std::pair<ID3D12Resource *, api::resource_view_desc>> _views;
 
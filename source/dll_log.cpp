@@ -4,6 +4,14 @@
  */
 
 #include "dll_log.hpp"
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
 #include <Windows.h>
 
 struct scoped_file_handle
@@ -25,9 +33,365 @@ private:
 	HANDLE handle = INVALID_HANDLE_VALUE;
 };
 
+/// <summary>
+/// Single producer, single consumer ring of log lines, so that threads can queue messages without taking a lock.
+/// Messages are formatted directly into a reserved slot, which keeps the memory of previous lines, so that queuing a line does not allocate in the common case.
+/// </summary>
+struct thread_log_buffer
+{
+	static constexpr size_t capacity = 512;
+
+	std::string *reserve()
+	{
+		const size_t index = write_index.load(std::memory_order_relaxed);
+		if (index - read_index.load(std::memory_order_acquire) >= capacity)
+			return nullptr;
+
+		reserved = true;
+
+		std::string &line = records[index % capacity].line;
+		line.clear();
+		return &line;
+	}
+	void commit(uint64_t sequence)
+	{
+		const size_t index = write_index.load(std::memory_order_relaxed);
+		records[index % capacity].sequence = sequence;
+
+		reserved = false;
+		write_index.store(index + 1, std::memory_order_release);
+	}
+
+	bool empty() const
+	{
+		return read_index.load(std::memory_order_acquire) == write_index.load(std::memory_order_acquire);
+	}
+
+	struct record
+	{
+		uint64_t sequence;
+		std::string line;
+	} records[capacity];
+	std::atomic<size_t> read_index = 0;
+	std::atomic<size_t> write_index = 0;
+	std::atomic<bool> thread_exited = false;
+	// Set while the owning thread formats a message into a reserved slot (only accessed by the owning thread)
+	bool reserved = false;
+	// Index up to which the current flush reads lines (only accessed while holding the buffers mutex)
+	size_t flush_index = 0;
+};
+
 static scoped_file_handle s_file_handle;
+static std::mutex s_file_mutex;
+
+static std::mutex s_buffers_mutex;
+static std::vector<std::shared_ptr<thread_log_buffer>> s_buffers;
+static std::atomic<size_t> s_dropped_lines = 0;
+// Global order in which lines were logged, so that lines from different threads are written in that order
+static std::atomic<uint64_t> s_next_sequence = 0;
+
+static std::mutex s_writer_mutex;
+static std::condition_variable s_writer_wake;
+static std::atomic<bool> s_writer_pending = false;
+static std::atomic<bool> s_writer_running = false;
+static bool s_writer_exit = false;
+
+static void write_lines(const std::string &lines, bool wait = true)
+{
+	if (lines.empty())
+		return;
+
+	{
+		std::unique_lock<std::mutex> lock(s_file_mutex, std::defer_lock);
+		if (wait)
+			lock.lock();
+		else if (!lock.try_lock())
+			return;
+
+		if (s_file_handle != INVALID_HANDLE_VALUE)
+		{
+			DWORD written = 0;
+			WriteFile(s_file_handle, lines.data(), static_cast<DWORD>(lines.size()), &written, nullptr);
+			assert(written == lines.size());
+		}
+	}
+
+#ifndef NDEBUG
+	// Write lines to the debug output
+	OutputDebugStringA(lines.c_str());
+#endif
+}
+static void append_line(std::string &lines, const std::string &line)
+{
+	// Replace all LF with CRLF and terminate line
+	for (size_t offset = 0, next; offset <= line.size(); offset = next + 1)
+	{
+		next = line.find('\n', offset);
+		if (next == std::string::npos)
+			next = line.size();
+
+		lines.append(line, offset, next - offset);
+		lines += "\r\n";
+	}
+}
+
+/// <summary>
+/// Writes all queued lines of all threads to the log file, in the order they were logged in.
+/// </summary>
+/// <param name="wait">Set to <see langword="false"/> to give up instead of waiting when another thread is holding the locks.</param>
+static void flush_buffers(bool wait = true)
+{
+	std::unique_lock<std::mutex> lock(s_buffers_mutex, std::defer_lock);
+	if (wait)
+		lock.lock();
+	else if (!lock.try_lock())
+		return;
+
+	struct queued_line
+	{
+		uint64_t sequence;
+		const std::string *line;
+	};
+
+	// Only accessed while holding the lock, so reuse its memory between flushes
+	static std::vector<queued_line> queued_lines;
+	queued_lines.clear();
+
+	for (const std::shared_ptr<thread_log_buffer> &buffer : s_buffers)
+	{
+		buffer->flush_index = buffer->write_index.load(std::memory_order_acquire);
+
+		for (size_t index = buffer->read_index.load(std::memory_order_relaxed); index < buffer->flush_index; ++index)
+		{
+			const thread_log_buffer::record &record = buffer->records[index % thread_log_buffer::capacity];
+			queued_lines.push_back({ record.sequence, &record.line });
+		}
+	}
+
+	// Merge the lines of all threads by their sequence number
+	std::sort(queued_lines.begin(), queued_lines.end(),
+		[](const queued_line &a, const queued_line &b) { return a.sequence < b.sequence; });
+
+	std::string lines;
+	for (const queued_line &queued : queued_lines)
+		append_line(lines, *queued.line);
+
+	// The slots can only be reused by their threads after the lines were copied out of them
+	for (auto it = s_buffers.begin(); it != s_buffers.end();)
+	{
+		const std::shared_ptr<thread_log_buffer> &buffer = *it;
+
+		buffer->read_index.store(buffer->flush_index, std::memory_order_release);
+
+		// Remove buffers of threads that exited once everything they logged was written
+		if (buffer->thread_exited.load(std::memory_order_acquire) && buffer->empty())
+			it = s_buffers.erase(it);
+		else
+			++it;
+	}
+
+	if (const size_t dropped_lines = s_dropped_lines.exchange(0);
+		dropped_lines != 0)
+		append_line(lines, "Dropped " + std::to_string(dropped_lines) + " log messages because they were logged faster than they could be written.");
+
+	// Keep holding the lock while writing, so that batches flushed by different threads cannot be written out of order
+	write_lines(lines, wait);
+}
+
+/// <summary>
+/// Background thread that collects queued messages from all threads and writes them to the log file in batches.
+/// </summary>
+static struct log_writer
+{
+	~log_writer()
+	{
+		stop();
+	}
+
+	void start()
+	{
+		if (thread != nullptr)
+			return;
+
+		exited_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (exited_event == nullptr)
+			return;
+
+		s_writer_exit = false;
+
+		// Use 'CreateThread' rather than 'std::thread', since this is called from 'DllMain' during initialization
+		s_writer_running = true;
+		thread = CreateThread(nullptr, 0, &thread_main, this, 0, nullptr);
+		if (thread == nullptr)
+		{
+			s_writer_running = false;
+			CloseHandle(exited_event);
+			exited_event = nullptr;
+		}
+	}
+
+	void stop()
+	{
+		if (thread == nullptr)
+			return;
+
+		{
+			const std::unique_lock<std::mutex> lock(s_writer_mutex);
+			s_writer_exit = true;
+		}
+		s_writer_wake.notify_one();
+
+		// This is called during 'DLL_PROCESS_DETACH' with the loader lock held, which the thread needs to exit, so cannot wait for it to exit
+		// Wait for it to leave its loop instead, or for it to be gone already, which is the case when the process is exiting (all other threads were terminated then)
+		const HANDLE wait_handles[2] = { exited_event, thread };
+		const bool left_loop = WaitForMultipleObjects(2, wait_handles, FALSE, INFINITE) == WAIT_OBJECT_0;
 
-reshade::log::message::message(level level)
+		// After signaling, the thread only returns from 'thread_main' before it blocks on the loader lock outside this module, so give it a moment to do that before this module is unloaded
+		if (left_loop)
+			WaitForSingleObject(thread, 100);
+
+		CloseHandle(exited_event);
+		exited_event = nullptr;
+		CloseHandle(thread);
+		thread = nullptr;
+
+		s_writer_running = false;
+
+		// Write anything that was logged since the thread left its loop
+		// If the thread was terminated instead, it may have been in the middle of writing, in which case the locks it held are never released, so do not wait for them
+		flush_buffers(left_loop);
+	}
+
+	static DWORD WINAPI thread_main(LPVOID param)
+	{
+		const auto writer = static_cast<log_writer *>(param);
+
+		{
+			std::unique_lock<std::mutex> lock(s_writer_mutex);
+
+			while (!s_writer_exit)
+			{
+				s_writer_wake.wait(lock, []() { return s_writer_exit || s_writer_pending.load(std::memory_order_relaxed); });
+				s_writer_pending.store(false, std::memory_order_relaxed);
+
+				lock.unlock();
+				flush_buffers();
+				lock.lock();
+			}
+		}
+
+		// Signal only after the lock was released
+		SetEvent(writer->exited_event);
+		return 0;
+	}
+
+	HANDLE thread = nullptr;
+	HANDLE exited_event = nullptr;
+} s_writer;
+
+static thread_log_buffer &get_thread_buffer()
+{
+	// Each thread gets its own buffer, which is registered once and then written to without locking
+	static thread_local struct thread_buffer_owner
+	{
+		thread_buffer_owner() : buffer(std::make_shared<thread_log_buffer>())
+		{
+			const std::unique_lock<std::mutex> lock(s_buffers_mutex);
+			s_buffers.push_back(buffer);
+		}
+		~thread_buffer_owner()
+		{
+			buffer->thread_exited.store(true, std::memory_order_release);
+		}
+
+		const std::shared_ptr<thread_log_buffer> buffer;
+	} owner;
+
+	return *owner.buffer;
+}
+
+/// <summary>
+/// Gets the string a new message is formatted into, which is a slot in the queue of the calling thread if possible, or <paramref name="direct_line"/> if the message should be written directly.
+/// </summary>
+/// <returns>Pointer to the string to format the message into, or <see langword="nullptr"/> if the message is dropped.</returns>
+static std::string *begin_line(reshade::log::level level, std::string &direct_line)
+{
+	// Write directly while there is no background thread (before a log file was opened or after the writer exited)
+	if (!s_writer_running.load(std::memory_order_relaxed))
+		return &direct_line;
+
+	thread_log_buffer &buffer = get_thread_buffer();
+
+	// A message may be logged while formatting another one on the same thread, which cannot use the next slot while the other one still has it reserved
+	if (buffer.reserved)
+		return &direct_line;
+
+	std::string *line;
+	while ((line = buffer.reserve()) == nullptr)
+	{
+		switch (level)
+		{
+		case reshade::log::level::error:
+			// Errors are written right away anyway, so make space directly
+			flush_buffers();
+			break;
+		case reshade::log::level::warning:
+			// Never drop warnings, block until there is space for them instead
+			// Writer thread may have been terminated already during process exit, in which case make space directly
+			if (!s_writer_running.load(std::memory_order_relaxed) || WaitForSingleObject(s_writer.thread, 0) != WAIT_TIMEOUT)
+				flush_buffers();
+			else
+				std::this_thread::yield();
+			break;
+		default:
+			// Drop less important messages when the buffer is full
+			s_dropped_lines++;
+			return nullptr;
+		}
+	}
+
+	return line;
+}
+static void end_line(reshade::log::level level, std::string *line, std::string &direct_line)
+{
+	if (line == nullptr)
+		return;
+
+	if (line == &direct_line)
+	{
+		std::string lines;
+		append_line(lines, direct_line);
+		write_lines(lines);
+		return;
+	}
+
+	get_thread_buffer().commit(s_next_sequence.fetch_add(1, std::memory_order_relaxed));
+
+	// Write errors right away, so that they are in the log file even if the application crashes immediately after
+	// Write everything that was queued before them too, so that the order of lines in the file is kept
+	if (level == reshade::log::level::error)
+	{
+		flush_buffers();
+		return;
+	}
+
+	// Only wake the writer when it is not already about to run
+	if (!s_writer_pending.exchange(true))
+	{
+		const std::unique_lock<std::mutex> lock(s_writer_mutex);
+		s_writer_wake.notify_one();
+	}
+}
+
+static char *format_decimal(char *p, unsigned long value, int digits)
+{
+	for (int i = digits - 1; i >= 0; --i, value /= 10)
+		p[i] = '0' + (value % 10);
+	return p + digits;
+}
+
+reshade::log::message::message(level level) :
+	_line_stream(&_line_buffer)
 {
 	static constexpr char level_names[][6] = { "ERROR", "WARN ", "INFO ", "DEBUG" };
 
@@ -36,52 +400,61 @@ reshade::log::message::message(level level)
 	if (static_cast<size_t>(level) > std::size(level_names))
 		level = level::debug;
 
+	_level = level;
+
+	_line_buffer.line = begin_line(level, _direct_line);
+	if (_line_buffer.line == nullptr)
+	{
+		// Skip all formatting of a message that is dropped
+		_line_stream.setstate(std::ios::badbit);
+		return;
+	}
+
 	SYSTEMTIME time;
 	GetLocalTime(&time);
 
+	// Format line prefix by hand, which is much cheaper than going through the stream formatting
+	char prefix[64];
+	char *p = prefix;
+#if RESHADE_VERBOSE_LOG
+	p = format_decimal(p, time.wYear, 4); *p++ = '-';
+	p = format_decimal(p, time.wMonth, 2); *p++ = '-';
+	p = format_decimal(p, time.wDay, 2); *p++ = 'T';
+#endif
+	p = format_decimal(p, time.wHour, 2); *p++ = ':';
+	p = format_decimal(p, time.wMinute, 2); *p++ = ':';
+	p = format_decimal(p, time.wSecond, 2); *p++ = ':';
+	p = format_decimal(p, time.wMilliseconds, 3); *p++ = ' ';
+	*p++ = '[';
+	const DWORD thread_id = GetCurrentThreadId();
+	int thread_id_digits = 5;
+	for (DWORD value = thread_id / 100000; value != 0; value /= 10)
+		thread_id_digits++;
+	p = format_decimal(p, thread_id, thread_id_digits);
+	*p++ = ']';
+	std::memcpy(p, " | ", 3); p += 3;
+	std::memcpy(p, level_names[static_cast<size_t>(level) - 1], 5); p += 5;
+	std::memcpy(p, " | ", 3); p += 3;
+
 	// Set default line stream settings
 	_line_stream.setf(std::ios::left);
 	_line_stream.setf(std::ios::showbase);
 
 	// Start a new line
-	_line_stream << std::right << std::setfill('0')
-#if RESHADE_VERBOSE_LOG
-		<< std::setw(4) << time.wYear << '-'
-		<< std::setw(2) << time.wMonth << '-'
-		<< std::setw(2) << time.wDay << 'T'
-#endif
-		<< std::setw(2) << time.wHour << ':'
-		<< std::setw(2) << time.wMinute << ':'
-		<< std::setw(2) << time.wSecond << ':'
-		<< std::setw(3) << time.wMilliseconds << ' '
-		<< '[' << std::setw(5) << GetCurrentThreadId() << ']' << std::setfill(' ') << " | "
-		<< level_names[static_cast<size_t>(level) - 1] << " | " << std::left;
+	_line_buffer.line->append(prefix, p - prefix);
 }
 reshade::log::message::~message()
 {
-	std::string line_string = _line_stream.str();
-	line_string += '\n'; // Terminate line with line feed
-
-	// Replace all LF with CRLF
-	for (size_t offset = 0; (offset = line_string.find('\n', offset)) != std::string::npos; offset += 2)
-		line_string.replace(offset, 1, "\r\n", 2);
-
-	// Write line to the log file
-	if (s_file_handle != INVALID_HANDLE_VALUE)
-	{
-		DWORD written = 0;
-		WriteFile(s_file_handle, line_string.data(), static_cast<DWORD>(line_string.size()), &written, nullptr);
-		assert(written == line_string.size());
-	}
-
-#ifndef NDEBUG
-	// Write line to the debug output
-	OutputDebugStringA(line_string.c_str());
-#endif
+	end_line(_level, _line_buffer.line, _direct_line);
 }
 
 bool reshade::log::open_log_file(const std::filesystem::path &path, std::error_code &ec)
 {
+	// Write out anything that is still queued for the previous file
+	flush_buffers();
+
+	const std::unique_lock<std::mutex> lock(s_file_mutex);
+
 	// Close the previous file first
 	// Do this here, instead of in 'scoped_file_handle::operator=', so that the old handle is closed before the new handle is created
 	if (s_file_handle != INVALID_HANDLE_VALUE)
@@ -92,6 +465,8 @@ bool reshade::log::open_log_file(const std::filesystem::path &path, std::error_c
 
 	if (s_file_handle != INVALID_HANDLE_VALUE)
 	{
+		s_writer.start();
+
 		// Last error may be ERROR_ALREADY_EXISTS if an existing file was overwritten, which can be ignored
 		ec.clear();
 		return true;
@@ -102,3 +477,8 @@ bool reshade::log::open_log_file(const std::filesystem::path &path, std::error_c
 		return false;
 	}
 }
+
+void reshade::log::stop_writer_thread()
+{
+	s_writer.stop();
+}
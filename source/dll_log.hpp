@@ -39,7 +39,14 @@ namespace reshade::log
 	bool open_log_file(const std::filesystem::path &path, std::error_code &ec);
 
 	/// <summary>
-	/// Constructs a single log message including current time and level and writes it to the open log file.
+	/// Stops the background thread that writes queued messages and writes everything that is still queued directly.
+	/// Messages logged afterwards are written directly too. This has to be called before the module is unloaded.
+	/// </summary>
+	void stop_writer_thread();
+
+	/// <summary>
+	/// Constructs a single log message including current time and level and queues it for writing to the open log file.
+	/// Messages are written on a background thread, so that logging does not stall the calling thread on file I/O.
 	/// </summary>
 	struct message
 	{
@@ -147,6 +154,33 @@ namespace reshade::log
 		}
 
 	private:
-		std::ostringstream _line_stream;
+		/// <summary>
+		/// Stream buffer that appends to a string, so that messages are formatted directly into the line that is queued for writing.
+		/// </summary>
+		class line_buffer : public std::streambuf
+		{
+		public:
+			std::string *line = nullptr;
+
+		protected:
+			int_type overflow(int_type c) override
+			{
+				if (line != nullptr && !traits_type::eq_int_type(c, traits_type::eof()))
+					line->push_back(traits_type::to_char_type(c));
+				return traits_type::not_eof(c);
+			}
+			std::streamsize xsputn(const char *s, std::streamsize n) override
+			{
+				if (line != nullptr)
+					line->append(s, static_cast<size_t>(n));
+				return n;
+			}
+		};
+
+		level _level;
+		// Used instead of a queued line when the message is written directly
+		std::string _direct_line;
+		line_buffer _line_buffer;
+		std::ostream _line_stream;
 	};
 }
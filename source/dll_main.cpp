@@ -359,6 +359,9 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 #endif
 
 			LOG(INFO) << "Finished exiting.";
+
+			// Stop the log writer thread before this module is unloaded, since it executes code of it
+			reshade::log::stop_writer_thread();
 			break;
 		}
 	}
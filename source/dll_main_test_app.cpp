@@ -11,6 +11,12 @@
 #include "addon_manager.hpp"
 #include "com_ptr.hpp"
 #include "ini_file.hpp"
+#include "duration_histogram.hpp"
+#include "null/null_impl_command_queue.hpp"
+#include "null/null_impl_swapchain.hpp"
+#include "api_trace_replay.hpp"
+#include <chrono>
+#include <fstream>
 #include <d3d9.h>
 #include <d3d11.h>
 #include <d3d12.h>
@@ -62,6 +68,154 @@ static LONG APIENTRY HookD3DKMTQueryAdapterInfo(const void *pData)
 	return reshade::hooks::call(HookD3DKMTQueryAdapterInfo)(pData);
 }
 
+static int run_null_device(LONG width, LONG height, LPSTR lpCmdLine)
+{
+	uint32_t num_frames = 1000;
+	if (LPSTR frames_arg = std::strstr(lpCmdLine, "-frames "))
+		num_frames = std::strtoul(frames_arg + 8, nullptr, 10);
+
+	LOG(INFO) << "Running " << num_frames << " frames on null device with a " << static_cast<uint32_t>(width) << 'x' << static_cast<uint32_t>(height) << " back buffer ...";
+
+	const auto device = new reshade::null::device_impl();
+	const auto queue = new reshade::null::command_queue_impl(device);
+
+	// Optionally replay a binary trace written by the API trace add-on before every frame, so that add-ons and the effect runtime see the same commands they would in the application
+	// The objects of the trace are created once while loading it, so the frame times only include issuing its commands
+	api_trace::trace_replayer replayer;
+	bool replay_trace = false;
+	if (LPSTR replay_arg = std::strstr(lpCmdLine, "-replay "))
+	{
+		std::string trace_path = replay_arg + 8;
+		trace_path = trace_path.substr(0, trace_path.find(" -"));
+		trace_path.erase(std::remove(trace_path.begin(), trace_path.end(), '"'), trace_path.end());
+
+		if (std::ifstream input(std::filesystem::u8path(trace_path), std::ios::binary); !input || !replayer.load(device, input))
+		{
+			LOG(ERROR) << "Failed to load API trace " << trace_path << " for replay!";
+
+			delete queue;
+			delete device;
+			return EXIT_FAILURE;
+		}
+
+		replay_trace = true;
+	}
+
+#if RESHADE_ADDON
+	reshade::load_addons();
+
+	reshade::invoke_addon_event<reshade::addon_event::init_device>(device);
+	reshade::invoke_addon_event<reshade::addon_event::init_command_queue>(queue);
+#endif
+
+	// Stands in for a command list of the application, which invokes add-on events for the replayed commands
+	const auto app_cmd_list = replay_trace ? new reshade::null::command_list_impl(device, true) : nullptr;
+	api_trace::replay_statistics replay_stats;
+
+	const auto swapchain = new reshade::null::swapchain_impl(
+		device,
+		reshade::api::resource_desc(width, height, 1, 1, reshade::api::format::r8g8b8a8_unorm, 1, reshade::api::memory_heap::gpu_only, reshade::api::resource_usage::render_target | reshade::api::resource_usage::copy_source | reshade::api::resource_usage::copy_dest),
+		3);
+
+	const auto init_start = std::chrono::high_resolution_clock::now();
+
+	reshade::create_effect_runtime(swapchain, queue);
+#if RESHADE_ADDON
+	reshade::invoke_addon_event<reshade::addon_event::init_swapchain>(swapchain);
+#endif
+	reshade::init_effect_runtime(swapchain);
+
+	const auto init_end = std::chrono::high_resolution_clock::now();
+
+	LOG(INFO) << "Effect runtime initialization took " << std::chrono::duration<double, std::milli>(init_end - init_start).count() << " ms.";
+
+	duration_histogram<600> frame_times;
+
+	for (uint32_t frame = 0; frame < num_frames; ++frame)
+	{
+		const auto frame_start = std::chrono::high_resolution_clock::now();
+
+		if (replay_trace)
+		{
+			replayer.replay(queue, replay_stats, app_cmd_list);
+
+#if RESHADE_ADDON
+			reshade::invoke_addon_event<reshade::addon_event::close_command_list>(app_cmd_list);
+			reshade::invoke_addon_event<reshade::addon_event::execute_command_list>(queue, app_cmd_list);
+			reshade::invoke_addon_event<reshade::addon_event::reset_command_list>(app_cmd_list);
+#endif
+		}
+
+#if RESHADE_ADDON
+		reshade::invoke_addon_event<reshade::addon_event::present>(queue, swapchain, nullptr, nullptr, 0, nullptr);
+#endif
+		reshade::present_effect_runtime(swapchain, queue);
+		queue->flush_immediate_command_list();
+		swapchain->present();
+
+		frame_times.append(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - frame_start).count());
+	}
+
+	// Statistics only cover the most recent frames, so that effect compilation during the first few frames does not skew them
+	LOG(INFO) << "CPU frame time over the last " << frame_times.count() << " frames (in microseconds):"
+		<< " mean " << frame_times.mean() / 1000
+		<< ", 50th percentile " << frame_times.percentile(50.0) / 1000
+		<< ", 95th percentile " << frame_times.percentile(95.0) / 1000
+		<< ", 99th percentile " << frame_times.percentile(99.0) / 1000
+		<< ", max " << frame_times.max() / 1000;
+
+	if (replay_trace)
+		LOG(INFO) << "Replayed " << replay_stats.frame_times.size() << " trace frames with " << replay_stats.num_calls << " calls (" << replay_stats.num_skipped_calls << " skipped) in total, " << replay_stats.num_failed_objects << " objects of the trace failed to create.";
+
+	const reshade::null::device_stats &stats = device->get_stats();
+	LOG(INFO) << "Live objects: "
+		<< stats.num_resources << " resources, "
+		<< stats.num_resource_views << " resource views, "
+		<< stats.num_samplers << " samplers, "
+		<< stats.num_pipelines << " pipelines, "
+		<< stats.num_pipeline_layouts << " pipeline layouts, "
+		<< stats.num_descriptor_tables << " descriptor tables, "
+		<< stats.num_query_heaps << " query heaps, "
+		<< stats.num_fences << " fences";
+	LOG(INFO) << "Memory: "
+		<< stats.resource_bytes / 1024 << " KiB in resources, "
+		<< stats.allocated_bytes / 1024 << " KiB allocated (peak " << stats.peak_allocated_bytes / 1024 << " KiB, " << stats.num_allocations << " allocations), "
+		<< stats.shader_code_bytes / 1024 << " KiB of shader code";
+	LOG(INFO) << "Commands: "
+		<< stats.num_commands << " total, "
+		<< stats.num_draws << " draws, "
+		<< stats.num_dispatches << " dispatches, "
+		<< stats.num_copies << " copies, "
+		<< stats.num_clears << " clears, "
+		<< stats.num_barriers << " barriers, "
+		<< stats.num_render_passes << " render passes in "
+		<< stats.num_submits << " submits";
+	LOG(INFO) << "Time spent creating resources " << stats.create_resource_time / 1000000 << " ms, creating pipelines " << stats.create_pipeline_time / 1000000 << " ms, updating resources " << stats.update_resource_time / 1000000 << " ms.";
+
+	reshade::reset_effect_runtime(swapchain);
+#if RESHADE_ADDON
+	reshade::invoke_addon_event<reshade::addon_event::destroy_swapchain>(swapchain);
+#endif
+	reshade::destroy_effect_runtime(swapchain);
+
+	delete swapchain;
+	delete app_cmd_list;
+
+	replayer.unload();
+
+#if RESHADE_ADDON
+	reshade::invoke_addon_event<reshade::addon_event::destroy_command_queue>(queue);
+	reshade::invoke_addon_event<reshade::addon_event::destroy_device>(device);
+
+	reshade::unload_addons();
+#endif
+
+	delete queue;
+	delete device;
+
+	return EXIT_SUCCESS;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow)
 {
 	g_module_handle = hInstance;
@@ -109,6 +263,16 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 	if (LPSTR height_arg = std::strstr(lpCmdLine, "-height "))
 		window_h = std::strtol(height_arg + 8, nullptr, 10);
 
+	// The null device renders nothing, so run it without a window and exit after a fixed number of frames
+	if (strstr(lpCmdLine, "-null"))
+	{
+		const int result = run_null_device(window_w, window_h, lpCmdLine);
+
+		reshade::hooks::uninstall();
+
+		return result;
+	}
+
 	const LONG window_x = (GetSystemMetrics(SM_CXSCREEN) - window_w) / 2;
 	const LONG window_y = (GetSystemMetrics(SM_CYSCREEN) - window_h) / 2;
 
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// Fixed-size log-linear histogram of the most recent <typeparamref name="SAMPLES"/> durations (in nanoseconds), which allows querying percentiles over a sliding window.
+/// Values are grouped into 64 linear sub-buckets per power of two, so reported percentiles are within ~1.6% of the exact value.
+/// A single thread may append samples, while any number of other threads may query statistics concurrently without locking.
+/// </summary>
+template <size_t SAMPLES>
+class duration_histogram
+{
+	static_assert(SAMPLES > 0 && SAMPLES <= 0xFFFF, "sample counts have to fit into a 16-bit bucket counter");
+
+	static constexpr uint32_t SUB_BUCKET_BITS = 7;
+	static constexpr uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	static constexpr uint32_t SUB_BUCKET_HALF_COUNT = SUB_BUCKET_COUNT / 2;
+	static constexpr uint32_t MAX_VALUE_BITS = 41; // Clamp at ~36 minutes
+	static constexpr uint32_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 2) * SUB_BUCKET_HALF_COUNT;
+
+public:
+	duration_histogram() { clear(); }
+	duration_histogram(const duration_histogram &other) { *this = other; }
+
+	duration_histogram &operator=(const duration_histogram &other)
+	{
+		_index = other._index;
+		for (size_t i = 0; i < SAMPLES; i++)
+			_samples[i] = other._samples[i];
+		for (size_t i = 0; i < BUCKET_COUNT; i++)
+			_counts[i].store(other._counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		_count.store(other._count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		_sum.store(other._sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		return *this;
+	}
+
+	void clear()
+	{
+		_index = 0;
+		for (size_t i = 0; i < SAMPLES; i++)
+			_samples[i] = 0;
+		for (size_t i = 0; i < BUCKET_COUNT; i++)
+			_counts[i].store(0, std::memory_order_relaxed);
+		_count.store(0, std::memory_order_relaxed);
+		_sum.store(0, std::memory_order_relaxed);
+	}
+
+	void append(uint64_t value)
+	{
+		const size_t count = _count.load(std::memory_order_relaxed);
+
+		// Evict the oldest sample once the window is full
+		if (count == SAMPLES)
+		{
+			const uint64_t old_value = _samples[_index];
+			std::atomic<uint16_t> &old_bucket = _counts[bucket_index(old_value)];
+			old_bucket.store(old_bucket.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+			_sum.store(_sum.load(std::memory_order_relaxed) - old_value, std::memory_order_relaxed);
+		}
+		else
+		{
+			_count.store(count + 1, std::memory_order_relaxed);
+		}
+
+		_samples[_index] = value;
+		_index = (_index + 1) % SAMPLES;
+
+		std::atomic<uint16_t> &bucket = _counts[bucket_index(value)];
+		bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		_sum.store(_sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Gets the number of samples currently in the window.
+	/// </summary>
+	size_t count() const { return _count.load(std::memory_order_relaxed); }
+
+	/// <summary>
+	/// Gets the arithmetic mean of all samples in the window.
+	/// </summary>
+	uint64_t mean() const
+	{
+		const size_t count = _count.load(std::memory_order_relaxed);
+		return count != 0 ? _sum.load(std::memory_order_relaxed) / count : 0;
+	}
+
+	/// <summary>
+	/// Gets the value below or equal to which the specified <paramref name="percentile"/> of samples in the window fall (e.g. 99.0 for p99).
+	/// </summary>
+	uint64_t percentile(double percentile) const
+	{
+		const size_t count = _count.load(std::memory_order_relaxed);
+		if (count == 0)
+			return 0;
+
+		size_t rank = static_cast<size_t>(percentile * 0.01 * count + 0.5);
+		rank = rank < 1 ? 1 : rank > count ? count : rank;
+
+		size_t accum = 0;
+		for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+			if ((accum += _counts[i].load(std::memory_order_relaxed)) >= rank)
+				return highest_equivalent_value(i);
+
+		// Counters may be modified concurrently, in which case simply fall back to the largest value seen
+		return max();
+	}
+
+	/// <summary>
+	/// Gets the largest sample in the window.
+	/// </summary>
+	uint64_t max() const
+	{
+		for (uint32_t i = BUCKET_COUNT; i-- > 0;)
+			if (_counts[i].load(std::memory_order_relaxed) != 0)
+				return highest_equivalent_value(i);
+		return 0;
+	}
+
+private:
+	static uint32_t bucket_index(uint64_t value)
+	{
+		if (value < SUB_BUCKET_COUNT)
+			return static_cast<uint32_t>(value);
+
+		uint32_t msb = 63;
+		while ((value >> msb) == 0)
+			msb--;
+		if (msb >= MAX_VALUE_BITS)
+			return BUCKET_COUNT - 1;
+
+		// Keep the most significant bits as the linear sub-bucket index, which is always in the upper half of the sub-bucket range
+		const uint32_t shift = msb - SUB_BUCKET_BITS + 1;
+		return shift * SUB_BUCKET_HALF_COUNT + static_cast<uint32_t>(value >> shift);
+	}
+	static uint64_t highest_equivalent_value(uint32_t index)
+	{
+		if (index < SUB_BUCKET_COUNT)
+			return index;
+
+		const uint32_t shift = index / SUB_BUCKET_HALF_COUNT - 1;
+		const uint64_t sub_bucket = index - shift * SUB_BUCKET_HALF_COUNT;
+		return ((sub_bucket + 1) << shift) - 1;
+	}
+
+	size_t _index;
+	uint64_t _samples[SAMPLES];
+	std::atomic<uint16_t> _counts[BUCKET_COUNT];
+	std::atomic<size_t> _count;
+	std::atomic<uint64_t> _sum;
+};
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+/// <summary>
+/// Defers freeing objects that were replaced in a lock-free published pointer until no reader can still be accessing them (read-copy-update).
+/// Readers register with one of two reader counters for the duration of their access, and a replaced object is only freed once both counters were observed to be zero after it was replaced.
+/// </summary>
+/// <remarks>
+/// Freeing never waits on readers, replaced objects are instead kept around until a later call to <see cref="reclaim"/> finds that their grace period ended.
+/// Calls to <see cref="retire"/>, <see cref="reclaim"/> and <see cref="clear"/> have to be serialized by the caller.
+/// </remarks>
+template <typename T>
+class epoch_reclaimer
+{
+public:
+	/// <summary>
+	/// Registers a reader with the reader counter of the current epoch, which keeps objects it may access from being freed until it is destroyed.
+	/// The published pointer has to be loaded after this was constructed (with sequentially consistent ordering).
+	/// </summary>
+	class read_guard
+	{
+	public:
+		explicit read_guard(epoch_reclaimer &reclaimer) :
+			_readers(reclaimer._readers[reclaimer._epoch.load() & 1])
+		{
+			_readers.fetch_add(1);
+		}
+		~read_guard()
+		{
+			_readers.fetch_sub(1);
+		}
+
+		read_guard(const read_guard &) = delete;
+		read_guard &operator=(const read_guard &) = delete;
+
+	private:
+		std::atomic<uint32_t> &_readers;
+	};
+
+	epoch_reclaimer() = default;
+	~epoch_reclaimer()
+	{
+		clear();
+	}
+
+	epoch_reclaimer(const epoch_reclaimer &) = delete;
+	epoch_reclaimer &operator=(const epoch_reclaimer &) = delete;
+
+	/// <summary>
+	/// Gets a boolean indicating whether there are replaced objects that were not freed yet.
+	/// </summary>
+	bool has_retired() const { return _has_retired.load(std::memory_order_relaxed); }
+
+	/// <summary>
+	/// Hands over an object that was replaced in the published pointer, to be freed once no reader can still be accessing it.
+	/// The published pointer has to be replaced before calling this (with sequentially consistent ordering).
+	/// </summary>
+	void retire(const T *data)
+	{
+		if (data == nullptr)
+			return;
+
+		// Any reader that registers after the published pointer was replaced reads the new object, so only readers that registered before can still be accessing this one
+		_retired.push_back({ data });
+		_has_retired.store(true, std::memory_order_relaxed);
+
+		reclaim();
+	}
+
+	/// <summary>
+	/// Frees replaced objects whose grace period ended, without waiting for readers.
+	/// </summary>
+	void reclaim()
+	{
+		// Once a reader counter was observed to be zero after an object was replaced, none of the readers that registered with it can still be accessing that object
+		for (uint32_t i = 0; i < 2; ++i)
+			if (_readers[i].load() == 0)
+				for (retired_object &retired : _retired)
+					retired.drained[i] = true;
+
+		_retired.erase(std::remove_if(_retired.begin(), _retired.end(),
+			[](const retired_object &retired) {
+				if (!retired.drained[0] || !retired.drained[1])
+					return false;
+				delete retired.data;
+				return true;
+			}), _retired.end());
+
+		// Flip the epoch, so that new readers register with the other reader counter and the current one can drain until the next call
+		if (!_retired.empty())
+			_epoch.fetch_add(1);
+		else
+			_has_retired.store(false, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Frees all replaced objects right away, which is only safe once it is known that there are no more readers.
+	/// </summary>
+	void clear()
+	{
+		for (const retired_object &retired : _retired)
+			delete retired.data;
+		_retired.clear();
+		_has_retired.store(false, std::memory_order_relaxed);
+	}
+
+private:
+	struct retired_object
+	{
+		const T *data;
+		bool drained[2] = {};
+	};
+
+	std::atomic<uint32_t> _epoch = 0;
+	std::atomic<uint32_t> _readers[2] = {};
+	std::atomic<bool> _has_retired = false;
+	std::vector<retired_object> _retired;
+};
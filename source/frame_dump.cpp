@@ -0,0 +1,387 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "frame_dump.hpp"
+#include "dll_log.hpp"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+static constexpr uint32_t file_magic = 0x44465352; // 'RSFD'
+static constexpr uint32_t frame_magic = 0x454D5246; // 'FRME'
+
+// Maximum amount of frame data that may be waiting to be compressed and written at any time (at least one frame per thread is always allowed)
+static constexpr size_t queue_memory_limit = 512 * 1024 * 1024;
+
+static size_t encode_qoi(const uint8_t *pixels, size_t num_pixels, uint8_t *out)
+{
+	// See https://qoiformat.org/qoi-specification.pdf
+	uint8_t *const out_begin = out;
+
+	uint32_t index[64] = {};
+	uint32_t prev = 0xFF000000;
+	uint32_t run = 0;
+
+	for (size_t i = 0; i < num_pixels; ++i)
+	{
+		uint32_t px;
+		std::memcpy(&px, pixels + 4 * i, 4);
+
+		if (px == prev)
+		{
+			if (++run == 62)
+			{
+				*out++ = static_cast<uint8_t>(0xC0 | (run - 1));
+				run = 0;
+			}
+			continue;
+		}
+
+		if (run != 0)
+		{
+			*out++ = static_cast<uint8_t>(0xC0 | (run - 1));
+			run = 0;
+		}
+
+		const uint8_t r = px & 0xFF, g = (px >> 8) & 0xFF, b = (px >> 16) & 0xFF, a = px >> 24;
+		const uint32_t hash = (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+
+		if (index[hash] == px)
+		{
+			*out++ = static_cast<uint8_t>(hash);
+		}
+		else
+		{
+			index[hash] = px;
+
+			if (a == (prev >> 24))
+			{
+				const int8_t vr = static_cast<int8_t>(r - (prev & 0xFF));
+				const int8_t vg = static_cast<int8_t>(g - ((prev >> 8) & 0xFF));
+				const int8_t vb = static_cast<int8_t>(b - ((prev >> 16) & 0xFF));
+				const int8_t vg_r = vr - vg;
+				const int8_t vg_b = vb - vg;
+
+				if (vr >= -2 && vr <= 1 && vg >= -2 && vg <= 1 && vb >= -2 && vb <= 1)
+				{
+					*out++ = static_cast<uint8_t>(0x40 | ((vr + 2) << 4) | ((vg + 2) << 2) | (vb + 2));
+				}
+				else if (vg_r >= -8 && vg_r <= 7 && vg >= -32 && vg <= 31 && vg_b >= -8 && vg_b <= 7)
+				{
+					*out++ = static_cast<uint8_t>(0x80 | (vg + 32));
+					*out++ = static_cast<uint8_t>(((vg_r + 8) << 4) | (vg_b + 8));
+				}
+				else
+				{
+					*out++ = 0xFE;
+					*out++ = r;
+					*out++ = g;
+					*out++ = b;
+				}
+			}
+			else
+			{
+				*out++ = 0xFF;
+				*out++ = r;
+				*out++ = g;
+				*out++ = b;
+				*out++ = a;
+			}
+		}
+
+		prev = px;
+	}
+
+	if (run != 0)
+		*out++ = static_cast<uint8_t>(0xC0 | (run - 1));
+
+	return out - out_begin;
+}
+
+static bool decode_qoi(const uint8_t *data, size_t size, uint8_t *pixels, size_t num_pixels)
+{
+	// Inverse of 'encode_qoi' above
+	const uint8_t *const data_end = data + size;
+
+	uint32_t index[64] = {};
+	uint32_t px = 0xFF000000;
+
+	for (size_t i = 0; i < num_pixels;)
+	{
+		if (data == data_end)
+			return false;
+
+		const uint8_t op = *data++;
+
+		if (op == 0xFE || op == 0xFF)
+		{
+			const size_t num_channels = op == 0xFE ? 3 : 4;
+			if (static_cast<size_t>(data_end - data) < num_channels)
+				return false;
+
+			px = (px & 0xFF000000) | data[0] | (data[1] << 8) | (data[2] << 16);
+			if (op == 0xFF)
+				px = (px & 0x00FFFFFF) | (static_cast<uint32_t>(data[3]) << 24);
+			data += num_channels;
+		}
+		else if ((op & 0xC0) == 0x00)
+		{
+			px = index[op];
+		}
+		else if ((op & 0xC0) == 0x40)
+		{
+			const uint8_t r = static_cast<uint8_t>((px & 0xFF) + ((op >> 4) & 0x3) - 2);
+			const uint8_t g = static_cast<uint8_t>(((px >> 8) & 0xFF) + ((op >> 2) & 0x3) - 2);
+			const uint8_t b = static_cast<uint8_t>(((px >> 16) & 0xFF) + (op & 0x3) - 2);
+			px = (px & 0xFF000000) | r | (g << 8) | (b << 16);
+		}
+		else if ((op & 0xC0) == 0x80)
+		{
+			if (data == data_end)
+				return false;
+
+			const int vg = (op & 0x3F) - 32;
+			const uint8_t r = static_cast<uint8_t>((px & 0xFF) + vg + ((*data >> 4) & 0xF) - 8);
+			const uint8_t g = static_cast<uint8_t>(((px >> 8) & 0xFF) + vg);
+			const uint8_t b = static_cast<uint8_t>(((px >> 16) & 0xFF) + vg + (*data & 0xF) - 8);
+			px = (px & 0xFF000000) | r | (g << 8) | (b << 16);
+			data++;
+		}
+		else
+		{
+			const size_t run = (op & 0x3F) + 1;
+			if (run > num_pixels - i)
+				return false;
+
+			for (size_t k = 0; k < run; ++k, ++i)
+				std::memcpy(pixels + 4 * i, &px, 4);
+			continue;
+		}
+
+		const uint8_t r = px & 0xFF, g = (px >> 8) & 0xFF, b = (px >> 16) & 0xFF, a = px >> 24;
+		index[(r * 3 + g * 5 + b * 7 + a * 11) % 64] = px;
+
+		std::memcpy(pixels + 4 * i, &px, 4);
+		++i;
+	}
+
+	return data == data_end;
+}
+
+reshade::frame_dump_writer::~frame_dump_writer()
+{
+	close();
+}
+
+bool reshade::frame_dump_writer::open(const std::filesystem::path &path, uint32_t width, uint32_t height, compression method)
+{
+	close();
+
+	_file.open(path, std::ios::binary | std::ios::trunc);
+	if (!_file)
+	{
+		LOG(ERROR) << "Failed to open frame dump file " << path << '!';
+		return false;
+	}
+
+	const file_header header = { file_magic, 1, width, height, 4, method };
+	_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	_path = path;
+	_width = width;
+	_height = height;
+	_method = method;
+	_closing = false;
+	_write_failed = false;
+	_frames_written = 0;
+	_frames_skipped = 0;
+	_next_frame_index = 0;
+	_next_queue_index = 0;
+	_next_write_index = 0;
+
+	// Compressing a large frame takes longer than a frame interval, so spread consecutive frames across a few threads
+	const size_t num_threads = method != compression::none ? std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, 4) : 1;
+	// Allow enough frames to be queued to absorb a slow disk for a while, before frames have to be skipped
+	_max_queued_frames = std::max(num_threads, queue_memory_limit / (static_cast<size_t>(width) * static_cast<size_t>(height) * 4));
+
+	for (size_t i = 0; i < num_threads; ++i)
+		_threads.emplace_back(&frame_dump_writer::thread_main, this);
+
+	return true;
+}
+
+bool reshade::frame_dump_writer::close()
+{
+	if (!_file.is_open())
+		return true;
+
+	{ const std::unique_lock<std::mutex> lock(_mutex);
+		_closing = true;
+	}
+
+	_queue_condition.notify_all();
+
+	for (std::thread &thread : _threads)
+		thread.join();
+	_threads.clear();
+
+	_queue.clear();
+	_free_buffers.clear();
+
+	_file.close();
+	if (!_file)
+		_write_failed = true;
+
+	return !_write_failed;
+}
+
+std::vector<uint8_t> reshade::frame_dump_writer::allocate_frame()
+{
+	std::vector<uint8_t> pixels;
+
+	{ const std::unique_lock<std::mutex> lock(_mutex);
+		if (!_free_buffers.empty())
+		{
+			pixels = std::move(_free_buffers.back());
+			_free_buffers.pop_back();
+		}
+	}
+
+	pixels.resize(static_cast<size_t>(_width) * static_cast<size_t>(_height) * 4);
+	return pixels;
+}
+
+bool reshade::frame_dump_writer::write_frame(std::vector<uint8_t> &&pixels, uint64_t timestamp)
+{
+	assert(pixels.size() == static_cast<size_t>(_width) * static_cast<size_t>(_height) * 4);
+
+	{ const std::unique_lock<std::mutex> lock(_mutex);
+		const uint64_t frame_index = _next_frame_index++;
+
+		// Frames that are compressed but not yet written count as well, since they still hold on to their pixel data
+		if (_next_queue_index - _next_write_index >= _max_queued_frames)
+		{
+			_frames_skipped.fetch_add(1, std::memory_order_relaxed);
+			_free_buffers.push_back(std::move(pixels));
+			return false;
+		}
+
+		_queue.push_back({ _next_queue_index++, frame_index, timestamp, std::move(pixels) });
+	}
+
+	_queue_condition.notify_one();
+
+	return true;
+}
+
+void reshade::frame_dump_writer::thread_main()
+{
+	const size_t num_pixels = static_cast<size_t>(_width) * static_cast<size_t>(_height);
+
+	// Worst case of QOI is a full RGBA operation for every pixel
+	std::vector<uint8_t> compressed(_method == compression::qoi ? num_pixels * 5 : 0);
+
+	while (true)
+	{
+		queued_frame frame;
+
+		{ std::unique_lock<std::mutex> lock(_mutex);
+			_queue_condition.wait(lock, [this]() { return !_queue.empty() || _closing; });
+			if (_queue.empty())
+				break;
+
+			frame = std::move(_queue.front());
+			_queue.pop_front();
+		}
+
+		frame_header header = { frame_magic, compression::none, frame.frame_index, frame.timestamp, frame.pixels.size() };
+		const uint8_t *data = frame.pixels.data();
+
+		if (_method == compression::qoi)
+		{
+			// Fall back to storing the frame uncompressed in the rare case where that is smaller
+			if (const size_t compressed_size = encode_qoi(frame.pixels.data(), num_pixels, compressed.data());
+				compressed_size < frame.pixels.size())
+			{
+				header.method = compression::qoi;
+				header.data_size = compressed_size;
+				data = compressed.data();
+			}
+		}
+
+		// Append frames to the file in the order they were queued in, even if a later frame finished compressing first
+		{ std::unique_lock<std::mutex> lock(_mutex);
+			_write_condition.wait(lock, [this, &frame]() { return _next_write_index == frame.queue_index; });
+		}
+
+		_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		_file.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(header.data_size));
+
+		if (_file)
+			_frames_written.fetch_add(1, std::memory_order_relaxed);
+		else if (!_write_failed.exchange(true))
+			LOG(ERROR) << "Failed to write frame " << frame.frame_index << " to frame dump file " << _path << '!';
+
+		{ const std::unique_lock<std::mutex> lock(_mutex);
+			_next_write_index++;
+			_free_buffers.push_back(std::move(frame.pixels));
+		}
+
+		_write_condition.notify_all();
+	}
+}
+
+bool reshade::frame_dump_reader::open(const std::filesystem::path &path)
+{
+	_file.close();
+	_file.clear();
+	_file.open(path, std::ios::binary);
+	if (!_file)
+		return false;
+
+	if (!_file.read(reinterpret_cast<char *>(&_header), sizeof(_header)) ||
+		_header.magic != file_magic || _header.version != 1 || _header.channels != 4)
+	{
+		LOG(ERROR) << "File " << path << " is not a valid frame dump!";
+		_file.close();
+		return false;
+	}
+
+	return true;
+}
+
+bool reshade::frame_dump_reader::read_frame(std::vector<uint8_t> &pixels, frame_dump_writer::frame_header *out_header)
+{
+	frame_dump_writer::frame_header header;
+	if (!_file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != frame_magic)
+		return false;
+
+	const size_t num_pixels = static_cast<size_t>(_header.width) * static_cast<size_t>(_header.height);
+	pixels.resize(num_pixels * 4);
+
+	switch (header.method)
+	{
+	case frame_dump_writer::compression::none:
+		if (header.data_size != pixels.size() ||
+			!_file.read(reinterpret_cast<char *>(pixels.data()), static_cast<std::streamsize>(pixels.size())))
+			return false;
+		break;
+	case frame_dump_writer::compression::qoi:
+		// Compression is only used if the result is smaller than the raw pixel data (see 'frame_dump_writer::thread_main')
+		if (header.data_size >= pixels.size())
+			return false;
+		_compressed.resize(static_cast<size_t>(header.data_size));
+		if (!_file.read(reinterpret_cast<char *>(_compressed.data()), static_cast<std::streamsize>(_compressed.size())) ||
+			!decode_qoi(_compressed.data(), _compressed.size(), pixels.data(), num_pixels))
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	if (out_header != nullptr)
+		*out_header = header;
+	return true;
+}
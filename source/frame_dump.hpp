@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// Streams a sequence of RGBA8 frames into a single append-only container file.
+	/// Frames are compressed on a small pool of background threads and then appended to the file in submission order.
+	/// The queue of frames waiting for that is bounded by memory, frames submitted while it is full are skipped rather than stalling the submitting thread.
+	/// </summary>
+	/// <remarks>
+	/// The container starts with a <see cref="file_header"/>, followed by one <see cref="frame_header"/> plus payload per frame.
+	/// The payload is either the raw pixel data or a QOI chunk stream (without the QOI file header and end marker, since the dimensions are stored in the file header).
+	/// </remarks>
+	class frame_dump_writer
+	{
+	public:
+		enum class compression : uint32_t
+		{
+			none = 0,
+			qoi = 1,
+		};
+
+		struct file_header
+		{
+			uint32_t magic; // 'RSFD'
+			uint32_t version;
+			uint32_t width;
+			uint32_t height;
+			uint32_t channels;
+			compression method;
+			uint32_t reserved[2];
+		};
+
+		struct frame_header
+		{
+			uint32_t magic; // 'FRME'
+			compression method;
+			uint64_t frame_index; // Counts skipped frames too, so that they show up as gaps
+			uint64_t timestamp; // Nanoseconds since the start of the dump
+			uint64_t data_size;
+		};
+
+		frame_dump_writer() = default;
+		~frame_dump_writer();
+
+		frame_dump_writer(const frame_dump_writer &) = delete;
+		frame_dump_writer &operator=(const frame_dump_writer &) = delete;
+
+		/// <summary>
+		/// Creates the container file and starts the background threads.
+		/// </summary>
+		/// <param name="path">Path to the container file to create. An existing file is overwritten.</param>
+		/// <param name="width">Width of every frame in pixels.</param>
+		/// <param name="height">Height of every frame in pixels.</param>
+		/// <param name="method">Compression method to apply to the frames.</param>
+		/// <returns><see langword="true"/> if the file was successfully created, <see langword="false"/> otherwise.</returns>
+		bool open(const std::filesystem::path &path, uint32_t width, uint32_t height, compression method);
+		/// <summary>
+		/// Waits for all queued frames to be written and closes the container file.
+		/// </summary>
+		/// <returns><see langword="true"/> if all frames were written successfully, <see langword="false"/> otherwise.</returns>
+		bool close();
+
+		/// <summary>
+		/// Gets a pixel buffer large enough to hold a single frame, reusing the storage of frames that were already written if possible.
+		/// </summary>
+		std::vector<uint8_t> allocate_frame();
+
+		/// <summary>
+		/// Queues a frame for compression and writing, without waiting for either.
+		/// </summary>
+		/// <param name="pixels">RGBA8 pixel data of the frame, as returned by <see cref="allocate_frame"/>.</param>
+		/// <param name="timestamp">Nanoseconds since the start of the dump at which the frame was presented.</param>
+		/// <returns><see langword="true"/> if the frame was queued, or <see langword="false"/> if it was skipped because the queue is full (when compression or the disk cannot keep up).</returns>
+		bool write_frame(std::vector<uint8_t> &&pixels, uint64_t timestamp);
+
+		const std::filesystem::path &path() const { return _path; }
+		uint64_t frame_count() const { return _frames_written.load(std::memory_order_relaxed); }
+		uint64_t skipped_frame_count() const { return _frames_skipped.load(std::memory_order_relaxed); }
+
+	private:
+		struct queued_frame
+		{
+			uint64_t queue_index;
+			uint64_t frame_index;
+			uint64_t timestamp;
+			std::vector<uint8_t> pixels;
+		};
+
+		void thread_main();
+
+		std::filesystem::path _path;
+		std::ofstream _file;
+		uint32_t _width = 0;
+		uint32_t _height = 0;
+		compression _method = compression::none;
+
+		std::vector<std::thread> _threads;
+		std::mutex _mutex;
+		std::condition_variable _queue_condition;
+		std::condition_variable _write_condition;
+		std::deque<queued_frame> _queue;
+		size_t _max_queued_frames = 0;
+		std::vector<std::vector<uint8_t>> _free_buffers;
+		uint64_t _next_frame_index = 0;
+		uint64_t _next_queue_index = 0;
+		uint64_t _next_write_index = 0;
+		bool _closing = false;
+		std::atomic<bool> _write_failed = false;
+		std::atomic<uint64_t> _frames_written = 0;
+		std::atomic<uint64_t> _frames_skipped = 0;
+	};
+
+	/// <summary>
+	/// Reads back the frames of a container file written by <see cref="frame_dump_writer"/>, in the order they were written in.
+	/// </summary>
+	class frame_dump_reader
+	{
+	public:
+		/// <summary>
+		/// Opens an existing container file and validates its header.
+		/// </summary>
+		/// <param name="path">Path to the container file to open.</param>
+		/// <returns><see langword="true"/> if the file is a valid frame dump, <see langword="false"/> otherwise.</returns>
+		bool open(const std::filesystem::path &path);
+
+		/// <summary>
+		/// Reads the next frame from the container file and decompresses it.
+		/// </summary>
+		/// <param name="pixels">Vector that is resized to and filled with the RGBA8 pixel data of the frame.</param>
+		/// <param name="out_header">Optional pointer to a variable that is set to the header of the frame (with the size of the stored payload).</param>
+		/// <returns><see langword="true"/> if a frame was read, <see langword="false"/> if the end of the file was reached or the frame is corrupted.</returns>
+		bool read_frame(std::vector<uint8_t> &pixels, frame_dump_writer::frame_header *out_header = nullptr);
+
+		uint32_t width() const { return _header.width; }
+		uint32_t height() const { return _header.height; }
+
+	private:
+		std::ifstream _file;
+		frame_dump_writer::file_header _header = {};
+		std::vector<uint8_t> _compressed;
+	};
+}
@@ -7,7 +7,7 @@
 #include <cctype>
 #include <cassert>
 #include <fstream>
-#include <sstream>
+#include <algorithm>
 #include <shared_mutex>
 
 static std::shared_mutex s_ini_cache_mutex;
@@ -23,6 +23,22 @@ ini_file::ini_file(const std::filesystem::path &path) : _path(path)
 	load();
 }
 
+static std::string_view trim(std::string_view str, const char chars[] = " \t\r")
+{
+	const size_t first = str.find_first_not_of(chars);
+	if (first == std::string_view::npos)
+		return std::string_view();
+	return str.substr(first, str.find_last_not_of(chars) + 1 - first);
+}
+
+static bool compare_case_insensitive(const std::string *a, const std::string *b)
+{
+	return std::lexicographical_compare(a->begin(), a->end(), b->begin(), b->end(),
+		[](std::string::value_type lhs, std::string::value_type rhs) {
+			return std::toupper(static_cast<unsigned char>(lhs)) < std::toupper(static_cast<unsigned char>(rhs));
+		});
+}
+
 bool ini_file::load()
 {
 	std::error_code ec;
@@ -33,22 +49,39 @@ bool ini_file::load()
 	// Clear when file does not exist too
 	_sections.clear();
 
-	std::ifstream file(_path);
-	if (!file)
-		return false;
+	// Read the entire file into memory at once and parse it in place, instead of going through it line by line with a stream
+	std::string data;
+	{
+		std::ifstream file(_path, std::ios::binary);
+		if (!file)
+			return false;
+
+		const uintmax_t file_size = std::filesystem::file_size(_path, ec);
+		if (ec)
+			return false;
+
+		data.resize(static_cast<size_t>(file_size));
+		if (!file.read(data.data(), data.size()))
+			return false;
+	}
 
 	_modified = false;
 	_modified_at = modified_at;
 
-	file.imbue(std::locale("en-us.UTF-8"));
+	std::string_view remaining = data;
 	// Remove BOM (0xefbbbf means 0xfeff)
-	if (file.get() != 0xef || file.get() != 0xbb || file.get() != 0xbf)
-		file.seekg(0, std::ios::beg);
+	if (remaining.size() >= 3 && remaining.compare(0, 3, "\xef\xbb\xbf") == 0)
+		remaining.remove_prefix(3);
 
-	std::string line, section;
-	while (std::getline(file, line))
+	// Keep track of the current section, so that it only has to be looked up once per section instead of once per line
+	std::string_view section_name;
+	section_type *section = nullptr;
+
+	while (!remaining.empty())
 	{
-		trim(line);
+		const size_t line_end = remaining.find('\n');
+		std::string_view line = trim(remaining.substr(0, line_end));
+		remaining.remove_prefix(line_end != std::string_view::npos ? line_end + 1 : remaining.size());
 
 		if (line.empty() || line[0] == ';' || line[0] == '/' || line[0] == '#')
 			continue;
@@ -56,54 +89,52 @@ bool ini_file::load()
 		// Read section name
 		if (line[0] == '[')
 		{
-			section = trim(line.substr(0, line.find(']')), " \t[]");
+			section_name = trim(line.substr(0, line.find(']')), " \t[]");
+			section = nullptr;
 			continue;
 		}
 
+		// Only create section once it actually has content
+		if (section == nullptr)
+			section = &_sections[std::string(section_name)];
+
 		// Read section content
 		const size_t assign_index = line.find('=');
-		if (assign_index != std::string::npos)
+		if (assign_index != std::string_view::npos)
 		{
-			const std::string key = trim(line.substr(0, assign_index));
-			const std::string value = trim(line.substr(assign_index + 1));
+			const std::string_view key = trim(line.substr(0, assign_index));
+			const std::string_view value = trim(line.substr(assign_index + 1));
 
+			// Append to key if it already exists
+			ini_file::value_type &elements = section->try_emplace(std::string(key)).first->second;
 			if (value.empty())
-			{
-				_sections[section].insert({ key, {} });
 				continue;
-			}
 
-			// Append to key if it already exists
-			ini_file::value_type &elements = _sections[section][key];
-			for (size_t offset = 0, base = 0, len = value.size(); offset <= len;)
+			std::string *element = &elements.emplace_back();
+			for (size_t offset = 0, len = value.size(); offset <= len;)
 			{
-				// Treat ",," as an escaped comma and only split on single ","
 				const size_t found = std::min(value.find(',', offset), len);
+				element->append(value.data() + offset, found - offset);
+
+				if (found == len)
+					break;
+
+				// Treat ",," as an escaped comma and only split on single ","
 				if (found + 1 < len && value[found + 1] == ',')
 				{
+					element->push_back(',');
 					offset = found + 2;
 				}
 				else
 				{
-					std::string &element = elements.emplace_back();
-					element.reserve(found - base);
-
-					while (base < found)
-					{
-						const char c = value[base++];
-						element += c;
-
-						if (c == ',' && base < found && value[base] == ',')
-							base++; // Skip second comma in a ",," escape sequence
-					}
-
-					offset = base = found + 1;
+					element = &elements.emplace_back();
+					offset = found + 1;
 				}
 			}
 		}
 		else
 		{
-			_sections[section].insert({ line, {} });
+			section->try_emplace(std::string(line));
 		}
 	}
 
@@ -122,74 +153,73 @@ bool ini_file::save()
 	if (!ec && (modified_at - _modified_at) > std::chrono::seconds(2))
 		return false; // File exists and was modified on disk and therefore may have different data, so cannot save
 
-	std::stringstream data;
-	std::vector<std::string> section_names, key_names;
+	std::string data;
+	std::vector<const std::string *> section_names, key_names;
 
 	section_names.reserve(_sections.size());
 	for (const std::pair<const std::string, section_type> &section : _sections)
-		section_names.push_back(section.first);
+		section_names.push_back(&section.first);
 
 	// Sort sections to generate consistent files
-	std::sort(section_names.begin(), section_names.end(),
-		[](std::string a, std::string b) {
-			std::transform(a.begin(), a.end(), a.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(std::toupper(c)); });
-			std::transform(b.begin(), b.end(), b.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(std::toupper(c)); });
-			return a < b;
-		});
+	std::sort(section_names.begin(), section_names.end(), compare_case_insensitive);
 
-	for (const std::string &section_name : section_names)
+	for (const std::string *section_name : section_names)
 	{
-		if (const section_type &keys = _sections.at(section_name); !keys.empty())
+		if (const section_type &keys = _sections.at(*section_name); !keys.empty())
 		{
 			key_names.clear();
 			key_names.reserve(keys.size());
 			for (const std::pair<const std::string, value_type> &key : keys)
-				key_names.push_back(key.first);
+				key_names.push_back(&key.first);
 
-			std::sort(key_names.begin(), key_names.end(),
-				[](std::string a, std::string b) {
-					std::transform(a.begin(), a.end(), a.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(std::toupper(c)); });
-					std::transform(b.begin(), b.end(), b.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(std::toupper(c)); });
-					return a < b;
-				});
+			std::sort(key_names.begin(), key_names.end(), compare_case_insensitive);
 
 			// Empty section should have been sorted to the top, so do not need to append it before keys
-			if (!section_name.empty())
-				data << '[' << section_name << ']' << '\n';
+			if (!section_name->empty())
+			{
+				data += '[';
+				data += *section_name;
+				data += ']';
+				data += '\n';
+			}
 
-			for (const std::string &key_name : key_names)
+			for (const std::string *key_name : key_names)
 			{
-				data << key_name << '=';
+				data += *key_name;
+				data += '=';
 
-				if (const ini_file::value_type &elements = keys.at(key_name); !elements.empty())
+				if (const ini_file::value_type &elements = keys.at(*key_name); !elements.empty())
 				{
-					std::string value;
+					const size_t value_offset = data.size();
 					for (const std::string &element : elements)
 					{
 						// Empty elements mess with escaped commas, so simply skip them
 						if (element.empty())
 							continue;
 
-						value.reserve(value.size() + element.size() + 1);
-						for (const char c : element)
-							value.append(c == ',' ? 2 : 1, c);
-						value += ','; // Separate multiple values with a comma
+						for (size_t offset = 0, len = element.size(); offset < len;)
+						{
+							const size_t found = std::min(element.find(',', offset), len - 1);
+							data.append(element, offset, found + 1 - offset);
+							if (element[found] == ',')
+								data += ','; // Escape commas in the element by doubling them
+							offset = found + 1;
+						}
+						data += ','; // Separate multiple values with a comma
 					}
 
 					// Remove the last comma
-					if (!value.empty())
+					if (data.size() != value_offset)
 					{
-						assert(value.back() == ',');
-						value.pop_back();
+						assert(data.back() == ',');
+						data.pop_back();
 					}
-
-					data << value;
 				}
 
-				data << '\n';
+				data += '\n';
 			}
 
-			data << '\n';
+			data += '\n';
 		}
 	}
 
@@ -197,12 +227,8 @@ bool ini_file::save()
 	if (!file)
 		return false;
 
-	file.imbue(std::locale("en-us.UTF-8"));
-
-	const std::string str = data.str();
-
 	// Flush stream to disk before updating last write time
-	const bool fail = !(file.write(str.data(), str.size()) && file.flush());
+	const bool fail = !(file.write(data.data(), data.size()) && file.flush());
 	file.close();
 	if (fail)
 		return false;
@@ -6,6 +6,9 @@
 #pragma once
 
 #include <string>
+#include <limits>
+#include <charconv>
+#include <type_traits>
 #include <vector>
 #include <filesystem>
 #include <unordered_map>
@@ -281,6 +284,57 @@ public:
 	static ini_file &load_cache(const std::filesystem::path &path);
 
 private:
+	/// <summary>
+	/// Parses a number from the specified value without going through the C runtime locale machinery.
+	/// Accepts the same input as the 'strto*' family of functions: Leading whitespace, a leading '+' or '-' sign, trailing characters that are not part of the number (which are ignored)
+	/// and for floating-point types also hexadecimal notation, infinity and NaN. Returns zero if the value does not start with a number.
+	/// Unlike those functions, the decimal point is always '.', independent of the locale the application may have set.
+	/// Integers that are out of range are clamped like with 'strtol', but floating-point values that are out of range of a double return zero rather than infinity.
+	/// </summary>
+	template <typename T>
+	static T convert_number(const std::vector<std::string> &values, size_t i)
+	{
+		if (i >= values.size())
+			return T(0);
+
+		const char *first = values[i].data();
+		const char *const last = first + values[i].size();
+		while (first < last && (*first == ' ' || (*first >= '\t' && *first <= '\r')))
+			++first;
+
+		bool negative = false;
+		if (first < last && (*first == '+' || *first == '-'))
+			negative = *first++ == '-';
+
+		if constexpr (std::is_floating_point_v<T>)
+		{
+			// Parse through a double, like 'strtod' followed by a cast would
+			double result = 0.0;
+			if (first < last && *first == '-')
+				return T(0); // 'from_chars' would accept a second sign
+			else if (last - first > 2 && first[0] == '0' && (first[1] == 'x' || first[1] == 'X') && first[2] != '-')
+				std::from_chars(first + 2, last, result, std::chars_format::hex);
+			else
+				std::from_chars(first, last, result);
+			return static_cast<T>(negative ? -result : result);
+		}
+		else
+		{
+			// Parse the magnitude without sign, so that negative values wrap around for unsigned types, same as with 'strtoul'
+			std::make_unsigned_t<T> magnitude = 0;
+			if (std::from_chars(first, last, magnitude).ec == std::errc::result_out_of_range)
+				return negative && std::is_signed_v<T> ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+
+			if constexpr (std::is_signed_v<T>)
+			{
+				if (magnitude > static_cast<std::make_unsigned_t<T>>(std::numeric_limits<T>::max()) + (negative ? 1u : 0u))
+					return negative ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+			}
+
+			return static_cast<T>(negative ? 0 - magnitude : magnitude);
+		}
+	}
+
 	template <typename T>
 	static const T convert(const std::vector<std::string> &values, size_t i) = delete;
 	template <>
@@ -301,32 +355,32 @@ private:
 	template <>
 	static const long convert(const std::vector<std::string> &values, size_t i)
 	{
-		return i < values.size() ? std::strtol(values[i].c_str(), nullptr, 10) : 0l;
+		return convert_number<long>(values, i);
 	}
 	template <>
 	static const unsigned long convert(const std::vector<std::string> &values, size_t i)
 	{
-		return i < values.size() ? std::strtoul(values[i].c_str(), nullptr, 10) : 0ul;
+		return convert_number<unsigned long>(values, i);
 	}
 	template <>
 	static const long long convert(const std::vector<std::string> &values, size_t i)
 	{
-		return i < values.size() ? std::strtoll(values[i].c_str(), nullptr, 10) : 0ll;
+		return convert_number<long long>(values, i);
 	}
 	template <>
 	static const unsigned long long convert(const std::vector<std::string> &values, size_t i)
 	{
-		return i < values.size() ? std::strtoull(values[i].c_str(), nullptr, 10) : 0ull;
+		return convert_number<unsigned long long>(values, i);
 	}
 	template <>
 	static const float convert(const std::vector<std::string> &values, size_t i)
 	{
-		return static_cast<float>(convert<double>(values, i));
+		return convert_number<float>(values, i);
 	}
 	template <>
 	static const double convert(const std::vector<std::string> &values, size_t i)
 	{
-		return i < values.size() ? std::strtod(values[i].c_str(), nullptr) : 0.0;
+		return convert_number<double>(values, i);
 	}
 	template <>
 	static const std::string convert(const std::vector<std::string> &values, size_t i)
@@ -0,0 +1,451 @@
+/*
+ * Copyright (C) 2019 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cassert>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+/// <summary>
+/// A growable open-addressing hash table, optimized for frequent look ups and rare modifications.
+/// Look ups never lock and never wait, while adding or removing entries is serialized between threads.
+/// Tables replaced by a rebuild are kept as spares and reused by later rebuilds of the same capacity, so that memory stays bounded when keys are added and removed repeatedly.
+/// Tables are allocated with <typeparamref name="TAllocator"/> (rebound to the internal types), values with the global operator new.
+/// The key values "one" and "zero" hold a special meaning (see <see cref="no_value"/> and <see cref="tombstone_value"/>), so do not use them.
+/// </summary>
+template <typename TKey, typename TValue, typename TAllocator = std::allocator<uint8_t>>
+class lockfree_hash_map : lockfree_hash_map<TKey, TValue *, TAllocator>
+{
+public:
+	lockfree_hash_map() = default;
+	explicit lockfree_hash_map(const TAllocator &allocator) :
+		lockfree_hash_map<TKey, TValue *, TAllocator>(allocator) {}
+	~lockfree_hash_map()
+	{
+		clear(); // Free all pointers
+	}
+
+	using lockfree_hash_map<TKey, TValue *, TAllocator>::no_value;
+	using lockfree_hash_map<TKey, TValue *, TAllocator>::tombstone_value;
+
+	/// <summary>
+	/// Gets the value associated with the specified <paramref name="key"/>.
+	/// This is a weak look up and may fail if another thread is erasing a value at the same time.
+	/// </summary>
+	/// <param name="key">Key to look up.</param>
+	/// <returns>Reference to the associated value.</returns>
+	TValue &at(TKey key) const
+	{
+		TValue *const value = lockfree_hash_map<TKey, TValue *, TAllocator>::at(key);
+		if (value != nullptr)
+			return *value;
+
+		assert(false);
+		return default_value(); // Fall back if key does not exist
+	}
+
+	/// <summary>
+	/// Adds the specified key-value pair to the table.
+	/// </summary>
+	/// <param name="key">Key to add.</param>
+	/// <param name="args">Constructor arguments to use for creation.</param>
+	/// <returns>Reference to the newly added value.</returns>
+	template <typename... Args>
+	TValue &emplace(TKey key, Args... args)
+	{
+		// Create a pointer to the new value using copy construction
+		TValue *const new_value = new TValue(std::forward<Args>(args)...);
+		if (lockfree_hash_map<TKey, TValue *, TAllocator>::emplace(key, new_value))
+			return *new_value;
+		delete new_value;
+
+		assert(false);
+		return default_value(); // Fall back if key already exists
+	}
+
+	/// <summary>
+	/// Removes the value associated with the specified <paramref name="key"/> from the table.
+	/// </summary>
+	/// <param name="key">Key to look up.</param>
+	/// <returns><see langword="true"/> if the key existed and was removed, <see langword="false"/> otherwise.</returns>
+	bool erase(TKey key)
+	{
+		TValue *const old_value = lockfree_hash_map<TKey, TValue *, TAllocator>::erase(key);
+		if (old_value != nullptr)
+		{
+			delete old_value;
+			return true;
+		}
+		return false;
+	}
+	/// <summary>
+	/// Removes and returns the value associated with the specified <paramref name="key"/> from the table.
+	/// </summary>
+	/// <param name="key">Key to look up.</param>
+	/// <param name="value">Value associated with that key.</param>
+	/// <returns><see langword="true"/> if the key existed and was removed, <see langword="false"/> otherwise.</returns>
+	bool erase(TKey key, TValue &value)
+	{
+		TValue *const old_value = lockfree_hash_map<TKey, TValue *, TAllocator>::erase(key);
+		if (old_value != nullptr)
+		{
+			// Move value to output argument and delete its pointer (which is no longer in use now)
+			value = std::move(*old_value);
+			delete old_value;
+			return true;
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// Clears the entire table and deletes all values.
+	/// </summary>
+	void clear()
+	{
+		lockfree_hash_map<TKey, TValue *, TAllocator>::erase_all([](TValue *old_value) { delete old_value; });
+	}
+
+private:
+	static inline TValue &default_value()
+	{
+		// Make default value thread local, so no data races occur after multiple threads failed to access a value
+		static thread_local TValue _ = {}; return _;
+	}
+};
+
+/// <summary>
+/// Overload of the lock-free hash table for pointer value types, which avoids an extra indirection and stores the pointers directly.
+/// </summary>
+template <typename TKey, typename TValue, typename TAllocator>
+class lockfree_hash_map<TKey, TValue *, TAllocator>
+{
+	using TValuePtr = TValue *;
+
+	struct entry
+	{
+		std::atomic<TKey> key = no_value;
+		// Atomic, since a look up that is still reading a table may race with a rebuild that reuses it (the result of which the look up then discards)
+		std::atomic<TValuePtr> value = nullptr;
+	};
+
+	struct table
+	{
+		explicit table(uint32_t capacity_bits, entry *entries) :
+			capacity_bits(capacity_bits), entries(entries) {}
+
+		size_t capacity() const { return size_t(1) << capacity_bits; }
+
+		const uint32_t capacity_bits;
+		// Number of entries that are either in use or tombstones, since neither can be used for new keys (tombstones are only dropped by a rebuild)
+		size_t num_occupied = 0;
+		entry *const entries;
+	};
+
+	using table_allocator = typename std::allocator_traits<TAllocator>::template rebind_alloc<table>;
+	using entry_allocator = typename std::allocator_traits<TAllocator>::template rebind_alloc<entry>;
+
+	static_assert(std::is_trivially_destructible_v<entry>);
+
+public:
+	lockfree_hash_map() = default;
+	explicit lockfree_hash_map(const TAllocator &allocator) :
+		_allocator(allocator) {}
+	~lockfree_hash_map()
+	{
+		destroy_table(_table.load(std::memory_order_relaxed));
+		for (table *const spare : _spare_tables)
+			destroy_table(spare);
+	}
+
+	lockfree_hash_map(const lockfree_hash_map &) = delete;
+	lockfree_hash_map &operator=(const lockfree_hash_map &) = delete;
+
+	/// <summary>
+	/// Special key indicating that the entry is empty.
+	/// </summary>
+	static constexpr TKey no_value = (TKey)0;
+	/// <summary>
+	/// Special key indicating that the entry was erased.
+	/// </summary>
+	static constexpr TKey tombstone_value = (TKey)-1;
+
+	/// <summary>
+	/// Gets the pointer associated with the specified <paramref name="key"/>.
+	/// This is a weak look up and may fail if another thread is erasing a value at the same time.
+	/// </summary>
+	/// <param name="key">Key to look up.</param>
+	/// <returns>Pointer associated with the key, or <see langword="nullptr"/> if it was not found.</returns>
+	TValuePtr at(TKey key) const
+	{
+		assert(key != no_value && key != tombstone_value);
+
+		while (true)
+		{
+			// Tables are never freed while the map is alive, but a table that was replaced may be reused by a rebuild while it is still being read, which changes the generation
+			const uint32_t generation = _generation.load(std::memory_order_acquire);
+
+			const table *const data = _table.load(std::memory_order_acquire);
+			if (data == nullptr)
+				return nullptr;
+
+			const TValuePtr value = find_value(data, key);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (_generation.load(std::memory_order_relaxed) == generation)
+				return value;
+		}
+	}
+
+	/// <summary>
+	/// Adds the specified key-pointer pair to the table.
+	/// </summary>
+	/// <param name="key">Key to add.</param>
+	/// <param name="value">Pointer to add.</param>
+	/// <returns><see langword="true"/> if the key-pointer pair was added successfully, or <see langword="false"/> if the key already exists.</returns>
+	bool emplace(TKey key, TValuePtr value)
+	{
+		assert(key != no_value && key != tombstone_value);
+
+		const std::unique_lock<std::mutex> lock(_mutex);
+
+		table *data = _table.load(std::memory_order_relaxed);
+		if (data != nullptr && find_index(data, key) != SIZE_MAX)
+			return false;
+
+		// Keep load factor (including tombstones) below 3/4, so that probe sequences stay short
+		if (data == nullptr || (data->num_occupied + 1) * 4 > data->capacity() * 3)
+			data = rebuild(data, _size + 1);
+
+		const size_t mask = data->capacity() - 1;
+
+		for (size_t i = hash_index(key, data->capacity_bits);; i = (i + 1) & mask)
+		{
+			// Never reuse tombstones, so that a concurrent reader which just matched a key always sees the pointer belonging to it
+			if (data->entries[i].key.load(std::memory_order_relaxed) == no_value)
+			{
+				data->entries[i].value.store(value, std::memory_order_relaxed);
+				data->entries[i].key.store(key, std::memory_order_release);
+				break;
+			}
+		}
+
+		data->num_occupied++;
+		_size++;
+
+		return true;
+	}
+
+	/// <summary>
+	/// Removes and returns the pointer associated with the specified <paramref name="key"/> from the table.
+	/// </summary>
+	/// <param name="key">Key to look up.</param>
+	/// <returns>Removed pointer if the key existed, <see langword="nullptr"/> otherwise.</returns>
+	TValuePtr erase(TKey key)
+	{
+		if (key == no_value || key == tombstone_value) // Cannot remove special keys
+			return nullptr;
+
+		const std::unique_lock<std::mutex> lock(_mutex);
+
+		table *const data = _table.load(std::memory_order_relaxed);
+		if (data == nullptr)
+			return nullptr;
+
+		const size_t index = find_index(data, key);
+		if (index == SIZE_MAX)
+			return nullptr;
+
+		const TValuePtr old_value = data->entries[index].value.load(std::memory_order_relaxed);
+		data->entries[index].key.store(tombstone_value, std::memory_order_release);
+		_size--;
+
+		return old_value;
+	}
+
+	/// <summary>
+	/// Clears the entire table.
+	/// </summary>
+	void clear()
+	{
+		erase_all([](TValuePtr) {});
+	}
+
+	/// <summary>
+	/// Gets the number of keys currently in the table.
+	/// </summary>
+	size_t size() const
+	{
+		const std::unique_lock<std::mutex> lock(_mutex);
+		return _size;
+	}
+
+protected:
+	template <typename F>
+	void erase_all(F on_erase)
+	{
+		const std::unique_lock<std::mutex> lock(_mutex);
+
+		table *const data = _table.load(std::memory_order_relaxed);
+		if (data == nullptr)
+			return;
+
+		for (size_t i = 0; i < data->capacity(); ++i)
+		{
+			if (const TKey old_key = data->entries[i].key.load(std::memory_order_relaxed);
+				old_key != no_value && old_key != tombstone_value)
+			{
+				data->entries[i].key.store(tombstone_value, std::memory_order_release);
+				on_erase(data->entries[i].value.load(std::memory_order_relaxed));
+			}
+		}
+
+		_size = 0;
+	}
+
+private:
+	static size_t hash_index(TKey key, uint32_t capacity_bits)
+	{
+		// Keys are often pointers with the lower bits all zero, so mix the hash (Fibonacci hashing) and take the upper bits as the index
+		const uint64_t hash = static_cast<uint64_t>(std::hash<TKey>()(key)) * 0x9E3779B97F4A7C15ull;
+		return static_cast<size_t>(hash >> (64 - capacity_bits));
+	}
+
+	static TValuePtr find_value(const table *data, TKey key)
+	{
+		const size_t mask = data->capacity() - 1;
+
+		for (size_t i = hash_index(key, data->capacity_bits), probe = 0; probe <= mask; i = (i + 1) & mask, ++probe)
+		{
+			if (const TKey test_key = data->entries[i].key.load(std::memory_order_acquire);
+				test_key == key)
+			{
+				// The pointer is guaranteed to be valid at this point, since it is written before the key and entries are never reused for another key (unless the whole table is reused, which the generation check in the caller detects)
+				return data->entries[i].value.load(std::memory_order_relaxed);
+			}
+			else if (test_key == no_value)
+			{
+				// Reached the end of the probe sequence
+				break;
+			}
+		}
+
+		return nullptr;
+	}
+
+	static size_t find_index(const table *data, TKey key)
+	{
+		const size_t mask = data->capacity() - 1;
+
+		for (size_t i = hash_index(key, data->capacity_bits), probe = 0; probe <= mask; i = (i + 1) & mask, ++probe)
+		{
+			if (const TKey test_key = data->entries[i].key.load(std::memory_order_relaxed);
+				test_key == key)
+				return i;
+			else if (test_key == no_value)
+				break;
+		}
+
+		return SIZE_MAX;
+	}
+
+	table *create_table(uint32_t capacity_bits)
+	{
+		entry_allocator entry_alloc(_allocator);
+		entry *const entries = std::allocator_traits<entry_allocator>::allocate(entry_alloc, size_t(1) << capacity_bits);
+		for (size_t i = 0; i < (size_t(1) << capacity_bits); ++i)
+			std::allocator_traits<entry_allocator>::construct(entry_alloc, entries + i);
+
+		table_allocator table_alloc(_allocator);
+		table *const new_table = std::allocator_traits<table_allocator>::allocate(table_alloc, 1);
+		std::allocator_traits<table_allocator>::construct(table_alloc, new_table, capacity_bits, entries);
+		return new_table;
+	}
+	void destroy_table(table *data)
+	{
+		if (data == nullptr)
+			return;
+
+		entry_allocator entry_alloc(_allocator);
+		std::allocator_traits<entry_allocator>::deallocate(entry_alloc, data->entries, data->capacity());
+
+		table_allocator table_alloc(_allocator);
+		std::allocator_traits<table_allocator>::destroy(table_alloc, data);
+		std::allocator_traits<table_allocator>::deallocate(table_alloc, data, 1);
+	}
+
+	table *rebuild(table *old_table, size_t min_size)
+	{
+		// Size new table so that it is at most half full after the rebuild, which also drops all tombstones
+		uint32_t capacity_bits = 4;
+		while ((size_t(1) << capacity_bits) < min_size * 2)
+			capacity_bits++;
+
+		table *new_table = nullptr;
+		if (const auto it = std::find_if(_spare_tables.begin(), _spare_tables.end(), [capacity_bits](const table *spare) { return spare->capacity_bits == capacity_bits; });
+			it != _spare_tables.end())
+		{
+			new_table = *it;
+			_spare_tables.erase(it);
+
+			// Make look ups that may still be reading the spare table (because they loaded it before it was replaced) retry, before it is overwritten
+			_generation.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			for (size_t i = 0; i < new_table->capacity(); ++i)
+				new_table->entries[i].key.store(no_value, std::memory_order_relaxed);
+			new_table->num_occupied = 0;
+		}
+		else
+		{
+			new_table = create_table(capacity_bits);
+		}
+
+		if (old_table != nullptr)
+		{
+			const size_t mask = new_table->capacity() - 1;
+
+			for (size_t i = 0; i < old_table->capacity(); ++i)
+			{
+				const TKey key = old_table->entries[i].key.load(std::memory_order_relaxed);
+				if (key == no_value || key == tombstone_value)
+					continue;
+
+				size_t k = hash_index(key, capacity_bits);
+				while (new_table->entries[k].key.load(std::memory_order_relaxed) != no_value)
+					k = (k + 1) & mask;
+
+				new_table->entries[k].value.store(old_table->entries[i].value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				new_table->entries[k].key.store(key, std::memory_order_relaxed);
+				new_table->num_occupied++;
+			}
+		}
+
+		// Publish the new table, after which readers no longer access the old one (apart from those that already loaded it)
+		_table.store(new_table, std::memory_order_release);
+
+		// Other threads may still be reading from the old table, so keep it around for reuse instead of freeing it
+		if (old_table != nullptr)
+			_spare_tables.push_back(old_table);
+
+		return new_table;
+	}
+
+	std::atomic<table *> _table = nullptr;
+	// Incremented whenever a spare table is reused, so that look ups can detect that the table they were reading was overwritten (next to the table pointer, so that look ups only touch a single cache line)
+	std::atomic<uint32_t> _generation = 0;
+	mutable std::mutex _mutex;
+	size_t _size = 0;
+	// A table is only allocated if there is no spare of the same capacity, so there are never more than two tables of any capacity, which bounds the memory held by the map to a few times that of its largest table
+	std::vector<table *> _spare_tables;
+	TAllocator _allocator;
+};
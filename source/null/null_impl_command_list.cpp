@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "null_impl_command_list.hpp"
+#include "addon_manager.hpp"
+#include <chrono>
+
+reshade::null::command_list_impl::command_list_impl(device_impl *device, bool invoke_addon_events) :
+	api_object_impl(nullptr),
+	_device_impl(device),
+	_invoke_addon_events(invoke_addon_events)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events)
+		invoke_addon_event<addon_event::init_command_list>(this);
+#endif
+}
+reshade::null::command_list_impl::~command_list_impl()
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events)
+		invoke_addon_event<addon_event::destroy_command_list>(this);
+#endif
+}
+
+reshade::api::device *reshade::null::command_list_impl::get_device()
+{
+	return _device_impl;
+}
+
+void reshade::null::command_list_impl::barrier(uint32_t count, const api::resource *resources, const api::resource_usage *old_states, const api::resource_usage *new_states)
+{
+	if (count == 0)
+		return;
+
+	count_command(&device_stats::num_barriers);
+
+#if RESHADE_ADDON >= 2
+	if (_invoke_addon_events)
+		invoke_addon_event<addon_event::barrier>(this, count, resources, old_states, new_states);
+#endif
+}
+
+void reshade::null::command_list_impl::begin_render_pass(uint32_t count, const api::render_pass_render_target_desc *rts, const api::render_pass_depth_stencil_desc *ds)
+{
+	count_command(&device_stats::num_render_passes);
+
+#if RESHADE_ADDON >= 2
+	if (_invoke_addon_events)
+		invoke_addon_event<addon_event::begin_render_pass>(this, count, rts, ds);
+#endif
+}
+void reshade::null::command_list_impl::end_render_pass()
+{
+	count_command();
+
+#if RESHADE_ADDON >= 2
+	if (_invoke_addon_events)
+		invoke_addon_event<addon_event::end_render_pass>(this);
+#endif
+}
+void reshade::null::command_list_impl::bind_render_targets_and_depth_stencil(uint32_t count, const api::resource_view *rtvs, api::resource_view dsv)
+{
+	count_command();
+
+#if RESHADE_ADDON >= 2
+	if (_invoke_addon_events)
+		invoke_addon_event<addon_event::bind_render_targets_and_depth_stencil>(this, count, rtvs, dsv);
+#endif
+}
+
+void reshade::null::command_list_impl::bind_pipeline(api::pipeline_stage, api::pipeline)
+{
+	count_command();
+}
+void reshade::null::command_list_impl::bind_pipeline_states(uint32_t count, const api::dynamic_state *states, const uint32_t *values)
+{
+	count_command();
+
+#if RESHADE_ADDON >= 2
+	if (_invoke_addon_events)
+		invoke_addon_event<addon_event::bind_pipeline_states>(this, count, states, values);
+#endif
+}
+void reshade::null::command_list_impl::bind_viewports(uint32_t first, uint32_t count, const api::viewport *viewports)
+{
+	count_command();
+
+#if RESHADE_ADDON >= 2
+	if (_invoke_addon_events)
+		invoke_addon_event<addon_event::bind_viewports>(this, first, count, viewports);
+#endif
+}
+void reshade::null::command_list_impl::bind_scissor_rects(uint32_t first, uint32_t count, const api::rect *rects)
+{
+	count_command();
+
+#if RESHADE_ADDON >= 2
+	if (_invoke_addon_events)
+		invoke_addon_event<addon_event::bind_scissor_rects>(this, first, count, rects);
+#endif
+}
+
+void reshade::null::command_list_impl::push_constants(api::shader_stage, api::pipeline_layout, uint32_t, uint32_t, uint32_t, const void *)
+{
+	count_command();
+}
+void reshade::null::command_list_impl::push_descriptors(api::shader_stage, api::pipeline_layout, uint32_t, const api::descriptor_table_update &)
+{
+	count_command();
+}
+void reshade::null::command_list_impl::bind_descriptor_tables(api::shader_stage, api::pipeline_layout, uint32_t, uint32_t, const api::descriptor_table *)
+{
+	count_command();
+}
+
+void reshade::null::command_list_impl::bind_index_buffer(api::resource buffer, uint64_t offset, uint32_t index_size)
+{
+	count_command();
+
+#if RESHADE_ADDON >= 2
+	if (_invoke_addon_events)
+		invoke_addon_event<addon_event::bind_index_buffer>(this, buffer, offset, index_size);
+#endif
+}
+void reshade::null::command_list_impl::bind_vertex_buffers(uint32_t first, uint32_t count, const api::resource *buffers, const uint64_t *offsets, const uint32_t *strides)
+{
+	count_command();
+
+#if RESHADE_ADDON >= 2
+	if (_invoke_addon_events)
+		invoke_addon_event<addon_event::bind_vertex_buffers>(this, first, count, buffers, offsets, strides);
+#endif
+}
+void reshade::null::command_list_impl::bind_stream_output_buffers(uint32_t, uint32_t, const api::resource *, const uint64_t *, const uint64_t *, const api::resource *, const uint64_t *)
+{
+	count_command();
+}
+
+void reshade::null::command_list_impl::draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::draw>(this, vertex_count, instance_count, first_vertex, first_instance))
+		return;
+#endif
+
+	count_command(&device_stats::num_draws);
+}
+void reshade::null::command_list_impl::draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::draw_indexed>(this, index_count, instance_count, first_index, vertex_offset, first_instance))
+		return;
+#endif
+
+	count_command(&device_stats::num_draws);
+}
+void reshade::null::command_list_impl::dispatch(uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::dispatch>(this, group_count_x, group_count_y, group_count_z))
+		return;
+#endif
+
+	count_command(&device_stats::num_dispatches);
+}
+void reshade::null::command_list_impl::draw_or_dispatch_indirect(api::indirect_command type, api::resource buffer, uint64_t offset, uint32_t draw_count, uint32_t stride)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::draw_or_dispatch_indirect>(this, type, buffer, offset, draw_count, stride))
+		return;
+#endif
+
+	count_command(type == api::indirect_command::dispatch ? &device_stats::num_dispatches : &device_stats::num_draws);
+}
+
+void reshade::null::command_list_impl::copy_resource(api::resource source, api::resource dest)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::copy_resource>(this, source, dest))
+		return;
+#endif
+
+	count_command(&device_stats::num_copies);
+}
+void reshade::null::command_list_impl::copy_buffer_region(api::resource source, uint64_t source_offset, api::resource dest, uint64_t dest_offset, uint64_t size)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::copy_buffer_region>(this, source, source_offset, dest, dest_offset, size))
+		return;
+#endif
+
+	count_command(&device_stats::num_copies);
+}
+void reshade::null::command_list_impl::copy_buffer_to_texture(api::resource source, uint64_t source_offset, uint32_t row_length, uint32_t slice_height, api::resource dest, uint32_t dest_subresource, const api::subresource_box *dest_box)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::copy_buffer_to_texture>(this, source, source_offset, row_length, slice_height, dest, dest_subresource, dest_box))
+		return;
+#endif
+
+	count_command(&device_stats::num_copies);
+}
+void reshade::null::command_list_impl::copy_texture_region(api::resource source, uint32_t source_subresource, const api::subresource_box *source_box, api::resource dest, uint32_t dest_subresource, const api::subresource_box *dest_box, api::filter_mode filter)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::copy_texture_region>(this, source, source_subresource, source_box, dest, dest_subresource, dest_box, filter))
+		return;
+#endif
+
+	count_command(&device_stats::num_copies);
+}
+void reshade::null::command_list_impl::copy_texture_to_buffer(api::resource source, uint32_t source_subresource, const api::subresource_box *source_box, api::resource dest, uint64_t dest_offset, uint32_t row_length, uint32_t slice_height)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::copy_texture_to_buffer>(this, source, source_subresource, source_box, dest, dest_offset, row_length, slice_height))
+		return;
+#endif
+
+	count_command(&device_stats::num_copies);
+}
+void reshade::null::command_list_impl::resolve_texture_region(api::resource source, uint32_t source_subresource, const api::subresource_box *source_box, api::resource dest, uint32_t dest_subresource, int32_t dest_x, int32_t dest_y, int32_t dest_z, api::format format)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::resolve_texture_region>(this, source, source_subresource, source_box, dest, dest_subresource, dest_x, dest_y, dest_z, format))
+		return;
+#endif
+
+	count_command(&device_stats::num_copies);
+}
+
+void reshade::null::command_list_impl::clear_depth_stencil_view(api::resource_view dsv, const float *depth, const uint8_t *stencil, uint32_t rect_count, const api::rect *rects)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::clear_depth_stencil_view>(this, dsv, depth, stencil, rect_count, rects))
+		return;
+#endif
+
+	count_command(&device_stats::num_clears);
+}
+void reshade::null::command_list_impl::clear_render_target_view(api::resource_view rtv, const float color[4], uint32_t rect_count, const api::rect *rects)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::clear_render_target_view>(this, rtv, color, rect_count, rects))
+		return;
+#endif
+
+	count_command(&device_stats::num_clears);
+}
+void reshade::null::command_list_impl::clear_unordered_access_view_uint(api::resource_view uav, const uint32_t values[4], uint32_t rect_count, const api::rect *rects)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::clear_unordered_access_view_uint>(this, uav, values, rect_count, rects))
+		return;
+#endif
+
+	count_command(&device_stats::num_clears);
+}
+void reshade::null::command_list_impl::clear_unordered_access_view_float(api::resource_view uav, const float values[4], uint32_t rect_count, const api::rect *rects)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::clear_unordered_access_view_float>(this, uav, values, rect_count, rects))
+		return;
+#endif
+
+	count_command(&device_stats::num_clears);
+}
+
+void reshade::null::command_list_impl::generate_mipmaps(api::resource_view srv)
+{
+#if RESHADE_ADDON
+	if (_invoke_addon_events && invoke_addon_event<addon_event::generate_mipmaps>(this, srv))
+		return;
+#endif
+
+	count_command();
+}
+
+void reshade::null::command_list_impl::begin_query(api::query_heap, api::query_type, uint32_t)
+{
+	count_command();
+}
+void reshade::null::command_list_impl::end_query(api::query_heap heap, api::query_type type, uint32_t index)
+{
+	count_command();
+
+	assert(heap != 0);
+	const auto heap_impl = reinterpret_cast<query_heap_impl *>(heap.handle);
+	assert(index < heap_impl->results.size());
+
+	// Commands are complete the moment they are recorded, so timestamps are taken right away (in nanoseconds, to match the timestamp frequency of the command queue)
+	if (type == api::query_type::timestamp)
+		heap_impl->results[index] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+void reshade::null::command_list_impl::copy_query_heap_results(api::query_heap, api::query_type, uint32_t, uint32_t, api::resource, uint64_t, uint32_t)
+{
+	count_command(&device_stats::num_copies);
+}
+
+void reshade::null::command_list_impl::begin_debug_event(const char *, const float[4])
+{
+}
+void reshade::null::command_list_impl::end_debug_event()
+{
+}
+void reshade::null::command_list_impl::insert_debug_marker(const char *, const float[4])
+{
+}
+
+void reshade::null::command_list_impl::count_command(std::atomic<uint64_t> device_stats::*category)
+{
+	_device_impl->_stats.num_commands++;
+
+	if (category != nullptr)
+		(_device_impl->_stats.*category)++;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "null_impl_command_queue.hpp"
+
+reshade::null::command_queue_impl::command_queue_impl(device_impl *device) :
+	api_object_impl(nullptr),
+	_device_impl(device)
+{
+	_immediate_cmd_list = new command_list_impl(device);
+}
+reshade::null::command_queue_impl::~command_queue_impl()
+{
+	delete _immediate_cmd_list;
+}
+
+reshade::api::device *reshade::null::command_queue_impl::get_device()
+{
+	return _device_impl;
+}
+
+void reshade::null::command_queue_impl::wait_idle() const
+{
+	// Nothing is ever executed, so the queue is always idle
+}
+
+void reshade::null::command_queue_impl::flush_immediate_command_list() const
+{
+	_device_impl->_stats.num_submits++;
+}
+
+void reshade::null::command_queue_impl::begin_debug_event(const char *, const float[4])
+{
+}
+void reshade::null::command_queue_impl::end_debug_event()
+{
+}
+void reshade::null::command_queue_impl::insert_debug_marker(const char *, const float[4])
+{
+}
+
+bool reshade::null::command_queue_impl::wait(api::fence fence, uint64_t value)
+{
+	return _device_impl->wait(fence, value, 0);
+}
+bool reshade::null::command_queue_impl::signal(api::fence fence, uint64_t value)
+{
+	return _device_impl->signal(fence, value);
+}
+
+uint64_t reshade::null::command_queue_impl::get_timestamp_frequency() const
+{
+	// Timestamp queries are written in nanoseconds
+	return 1000000000;
+}
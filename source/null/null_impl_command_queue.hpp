@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "null_impl_command_list.hpp"
+
+namespace reshade::null
+{
+	class command_queue_impl : public api::api_object_impl<void *, api::command_queue>
+	{
+	public:
+		command_queue_impl(device_impl *device);
+		~command_queue_impl();
+
+		api::device *get_device() final;
+
+		api::command_queue_type get_type() const final { return api::command_queue_type::graphics | api::command_queue_type::compute | api::command_queue_type::copy; }
+
+		void wait_idle() const final;
+
+		void flush_immediate_command_list() const final;
+
+		api::command_list *get_immediate_command_list() final { return _immediate_cmd_list; }
+
+		void begin_debug_event(const char *label, const float color[4]) final;
+		void end_debug_event() final;
+		void insert_debug_marker(const char *label, const float color[4]) final;
+
+		bool wait(api::fence fence, uint64_t value) final;
+		bool signal(api::fence fence, uint64_t value) final;
+
+		uint64_t get_timestamp_frequency() const final;
+
+	private:
+		device_impl *const _device_impl;
+		command_list_impl *_immediate_cmd_list = nullptr;
+	};
+}
@@ -0,0 +1,625 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "null_impl_device.hpp"
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+using namespace reshade;
+
+namespace
+{
+	/// <summary>
+	/// Adds the time elapsed since construction to the specified counter when going out of scope.
+	/// </summary>
+	struct scoped_timer
+	{
+		explicit scoped_timer(std::atomic<uint64_t> &counter) : counter(counter), start(std::chrono::high_resolution_clock::now()) {}
+		~scoped_timer()
+		{
+			counter += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		std::atomic<uint64_t> &counter;
+		const std::chrono::high_resolution_clock::time_point start;
+	};
+
+	// Descriptors of all types are stored in 'api::buffer_range' sized slots, so convert between the two
+	void store_descriptor(api::descriptor_type type, const void *descriptors, uint32_t index, api::buffer_range &slot)
+	{
+		switch (type)
+		{
+		case api::descriptor_type::sampler:
+			slot = { { static_cast<const api::sampler *>(descriptors)[index].handle }, 0, 0 };
+			break;
+		case api::descriptor_type::sampler_with_resource_view:
+			slot = { { static_cast<const api::sampler_with_resource_view *>(descriptors)[index].sampler.handle }, static_cast<const api::sampler_with_resource_view *>(descriptors)[index].view.handle, 0 };
+			break;
+		case api::descriptor_type::shader_resource_view:
+		case api::descriptor_type::unordered_access_view:
+			slot = { { static_cast<const api::resource_view *>(descriptors)[index].handle }, 0, 0 };
+			break;
+		case api::descriptor_type::constant_buffer:
+		case api::descriptor_type::shader_storage_buffer:
+			slot = static_cast<const api::buffer_range *>(descriptors)[index];
+			break;
+		}
+	}
+}
+
+reshade::null::device_impl::device_impl() :
+	api_object_impl(nullptr)
+{
+}
+reshade::null::device_impl::~device_impl()
+{
+	// All objects should have been destroyed by their owners at this point
+	assert(_stats.num_samplers == 0 && _stats.num_resources == 0 && _stats.num_resource_views == 0);
+	assert(_stats.num_pipelines == 0 && _stats.num_pipeline_layouts == 0 && _stats.num_descriptor_tables == 0 && _stats.num_query_heaps == 0 && _stats.num_fences == 0);
+}
+
+reshade::api::device_properties reshade::null::device_impl::get_properties() const
+{
+	api::device_properties props;
+	props.api_version = 0x1300; // Vulkan 1.3
+	std::strcpy(props.description, "Null device");
+
+	return props;
+}
+
+bool reshade::null::device_impl::check_capability(api::device_caps capability) const
+{
+	switch (capability)
+	{
+	case api::device_caps::bind_render_targets_and_depth_stencil:
+	case api::device_caps::shared_resource:
+	case api::device_caps::shared_resource_nt_handle:
+	case api::device_caps::shared_fence:
+	case api::device_caps::shared_fence_nt_handle:
+		// There is nothing to share with other devices or processes
+		return false;
+	default:
+		return true;
+	}
+}
+bool reshade::null::device_impl::check_format_support(api::format format, api::resource_usage) const
+{
+	// Any format that can be laid out in memory is supported for any usage
+	return format_row_pitch(format, 1) != 0;
+}
+
+bool reshade::null::device_impl::create_sampler(const api::sampler_desc &, api::sampler *out_handle)
+{
+	// Samplers have no state other than their description, which is not needed, so just hand out unique handles
+	*out_handle = { reinterpret_cast<uintptr_t>(new uint8_t()) };
+
+	_stats.num_samplers++;
+
+	return true;
+}
+void reshade::null::device_impl::destroy_sampler(api::sampler handle)
+{
+	if (handle == 0)
+		return;
+
+	delete reinterpret_cast<uint8_t *>(handle.handle);
+
+	_stats.num_samplers--;
+}
+
+bool reshade::null::device_impl::create_resource(const api::resource_desc &desc, const api::subresource_data *initial_data, api::resource_usage, api::resource *out_handle, void **)
+{
+	*out_handle = { 0 };
+
+	// There is nothing to share resources with
+	if ((desc.flags & api::resource_flags::shared) != 0)
+		return false;
+
+	const scoped_timer timer(_stats.create_resource_time);
+
+	const auto impl = new resource_impl();
+	impl->desc = desc;
+	impl->size = 0;
+
+	if (desc.type == api::resource_type::buffer)
+	{
+		impl->size = desc.buffer.size;
+		impl->subresources.push_back({ 0, 0, 0 });
+	}
+	else
+	{
+		const uint32_t levels = std::max<uint32_t>(desc.texture.levels, 1);
+		const uint32_t layers = desc.type == api::resource_type::texture_3d ? 1 : std::max<uint32_t>(desc.texture.depth_or_layers, 1);
+
+		impl->subresources.reserve(static_cast<size_t>(levels) * layers);
+
+		for (uint32_t layer = 0; layer < layers; ++layer)
+		{
+			for (uint32_t level = 0; level < levels; ++level)
+			{
+				const uint32_t width = std::max(1u, desc.texture.width >> level);
+				const uint32_t height = std::max(1u, desc.texture.height >> level);
+				const uint32_t depth = desc.type == api::resource_type::texture_3d ? std::max(1u, static_cast<uint32_t>(desc.texture.depth_or_layers) >> level) : 1u;
+
+				resource_impl::subresource_layout &layout = impl->subresources.emplace_back();
+				layout.offset = impl->size;
+				layout.row_pitch = format_row_pitch(desc.texture.format, width);
+				layout.slice_pitch = format_slice_pitch(desc.texture.format, layout.row_pitch, height);
+
+				impl->size += static_cast<uint64_t>(layout.slice_pitch) * depth;
+			}
+		}
+
+		// Multisampled textures occupy the space of all their samples
+		impl->size *= std::max<uint16_t>(desc.texture.samples, 1);
+	}
+
+	_stats.num_resources++;
+	_stats.resource_bytes += impl->size;
+
+	*out_handle = { reinterpret_cast<uintptr_t>(impl) };
+
+	if (initial_data != nullptr)
+	{
+		if (desc.type == api::resource_type::buffer)
+			update_buffer_region(initial_data->data, *out_handle, 0, desc.buffer.size);
+		else
+			for (uint32_t subresource = 0; subresource < impl->subresources.size(); ++subresource)
+				update_texture_region(initial_data[subresource], *out_handle, subresource, nullptr);
+	}
+
+	return true;
+}
+void reshade::null::device_impl::destroy_resource(api::resource handle)
+{
+	if (handle == 0)
+		return;
+
+	const auto impl = reinterpret_cast<resource_impl *>(handle.handle);
+
+	if (impl->data != nullptr)
+		_stats.allocated_bytes -= impl->size;
+
+	_stats.num_resources--;
+	_stats.resource_bytes -= impl->size;
+
+	delete impl;
+}
+
+reshade::api::resource_desc reshade::null::device_impl::get_resource_desc(api::resource resource) const
+{
+	assert(resource != 0);
+
+	return reinterpret_cast<const resource_impl *>(resource.handle)->desc;
+}
+
+bool reshade::null::device_impl::create_resource_view(api::resource resource, api::resource_usage usage_type, const api::resource_view_desc &desc, api::resource_view *out_handle)
+{
+	*out_handle = { 0 };
+
+	if (resource == 0)
+		return false;
+
+	const auto impl = new resource_view_impl();
+	impl->resource = resource;
+	impl->usage_type = usage_type;
+	impl->desc = desc;
+
+	// Fill in the format of the resource if the view does not specify one, like a real device would
+	if (impl->desc.format == api::format::unknown)
+		impl->desc.format = reinterpret_cast<const resource_impl *>(resource.handle)->desc.texture.format;
+
+	_stats.num_resource_views++;
+
+	*out_handle = { reinterpret_cast<uintptr_t>(impl) };
+	return true;
+}
+void reshade::null::device_impl::destroy_resource_view(api::resource_view handle)
+{
+	if (handle == 0)
+		return;
+
+	delete reinterpret_cast<resource_view_impl *>(handle.handle);
+
+	_stats.num_resource_views--;
+}
+
+reshade::api::resource reshade::null::device_impl::get_resource_from_view(api::resource_view view) const
+{
+	assert(view != 0);
+
+	return reinterpret_cast<const resource_view_impl *>(view.handle)->resource;
+}
+reshade::api::resource_view_desc reshade::null::device_impl::get_resource_view_desc(api::resource_view view) const
+{
+	assert(view != 0);
+
+	return reinterpret_cast<const resource_view_impl *>(view.handle)->desc;
+}
+
+bool reshade::null::device_impl::map_buffer_region(api::resource resource, uint64_t offset, uint64_t size, api::map_access, void **out_data)
+{
+	if (out_data == nullptr)
+		return false;
+	*out_data = nullptr;
+
+	assert(resource != 0);
+	const auto impl = reinterpret_cast<resource_impl *>(resource.handle);
+
+	if (impl->desc.type != api::resource_type::buffer || offset > impl->size || (size != UINT64_MAX && offset + size > impl->size))
+		return false;
+
+	*out_data = get_resource_data(impl) + offset;
+	return true;
+}
+void reshade::null::device_impl::unmap_buffer_region(api::resource)
+{
+}
+bool reshade::null::device_impl::map_texture_region(api::resource resource, uint32_t subresource, const api::subresource_box *box, api::map_access, api::subresource_data *out_data)
+{
+	if (out_data == nullptr)
+		return false;
+	out_data->data = nullptr;
+	out_data->row_pitch = 0;
+	out_data->slice_pitch = 0;
+
+	assert(resource != 0);
+	const auto impl = reinterpret_cast<resource_impl *>(resource.handle);
+
+	if (impl->desc.type == api::resource_type::buffer || subresource >= impl->subresources.size())
+		return false;
+
+	const resource_impl::subresource_layout &layout = impl->subresources[subresource];
+
+	uint64_t offset = layout.offset;
+	if (box != nullptr)
+		offset += static_cast<uint64_t>(box->front) * layout.slice_pitch + format_slice_pitch(impl->desc.texture.format, layout.row_pitch, box->top) + format_row_pitch(impl->desc.texture.format, box->left);
+
+	out_data->data = get_resource_data(impl) + offset;
+	out_data->row_pitch = layout.row_pitch;
+	out_data->slice_pitch = layout.slice_pitch;
+	return true;
+}
+void reshade::null::device_impl::unmap_texture_region(api::resource, uint32_t)
+{
+}
+
+void reshade::null::device_impl::update_buffer_region(const void *data, api::resource resource, uint64_t offset, uint64_t size)
+{
+	assert(resource != 0);
+	assert(data != nullptr);
+
+	const scoped_timer timer(_stats.update_resource_time);
+
+	const auto impl = reinterpret_cast<resource_impl *>(resource.handle);
+	assert(impl->desc.type == api::resource_type::buffer && offset + size <= impl->size);
+
+	std::memcpy(get_resource_data(impl) + offset, data, static_cast<size_t>(size));
+}
+void reshade::null::device_impl::update_texture_region(const api::subresource_data &data, api::resource resource, uint32_t subresource, const api::subresource_box *box)
+{
+	assert(resource != 0);
+	assert(data.data != nullptr);
+
+	const scoped_timer timer(_stats.update_resource_time);
+
+	const auto impl = reinterpret_cast<resource_impl *>(resource.handle);
+	assert(impl->desc.type != api::resource_type::buffer && subresource < impl->subresources.size());
+
+	const uint32_t level = subresource % std::max<uint32_t>(impl->desc.texture.levels, 1);
+	const uint32_t width = box != nullptr ? box->width() : std::max(1u, impl->desc.texture.width >> level);
+	const uint32_t height = box != nullptr ? box->height() : std::max(1u, impl->desc.texture.height >> level);
+	const uint32_t depth = box != nullptr ? box->depth() : impl->desc.type == api::resource_type::texture_3d ? std::max(1u, static_cast<uint32_t>(impl->desc.texture.depth_or_layers) >> level) : 1u;
+
+	api::subresource_data mapped_data;
+	if (!map_texture_region(resource, subresource, box, api::map_access::write_only, &mapped_data))
+		return;
+
+	const uint32_t row_size = format_row_pitch(impl->desc.texture.format, width);
+	const uint32_t num_rows = row_size != 0 ? format_slice_pitch(impl->desc.texture.format, row_size, height) / row_size : 0;
+
+	for (uint32_t z = 0; z < depth; ++z)
+		for (uint32_t y = 0; y < num_rows; ++y)
+			std::memcpy(
+				static_cast<uint8_t *>(mapped_data.data) + z * mapped_data.slice_pitch + y * mapped_data.row_pitch,
+				static_cast<const uint8_t *>(data.data) + z * data.slice_pitch + y * data.row_pitch,
+				std::min(row_size, data.row_pitch != 0 ? data.row_pitch : row_size));
+}
+
+bool reshade::null::device_impl::create_pipeline(api::pipeline_layout layout, uint32_t subobject_count, const api::pipeline_subobject *subobjects, api::pipeline *out_handle)
+{
+	const scoped_timer timer(_stats.create_pipeline_time);
+
+	const auto impl = new pipeline_impl();
+	impl->layout = layout;
+
+	uint64_t total_code_size = 0;
+
+	for (uint32_t i = 0; i < subobject_count; ++i)
+	{
+		switch (subobjects[i].type)
+		{
+		case api::pipeline_subobject_type::vertex_shader:
+		case api::pipeline_subobject_type::hull_shader:
+		case api::pipeline_subobject_type::domain_shader:
+		case api::pipeline_subobject_type::geometry_shader:
+		case api::pipeline_subobject_type::pixel_shader:
+		case api::pipeline_subobject_type::compute_shader:
+		case api::pipeline_subobject_type::amplification_shader:
+		case api::pipeline_subobject_type::mesh_shader:
+			for (uint32_t k = 0; k < subobjects[i].count; ++k)
+			{
+				const api::shader_desc &desc = static_cast<const api::shader_desc *>(subobjects[i].data)[k];
+				if (desc.code_size == 0)
+					continue;
+
+				pipeline_impl::shader &shader = impl->shaders.emplace_back();
+				shader.type = subobjects[i].type;
+				shader.code.assign(static_cast<const uint8_t *>(desc.code), static_cast<const uint8_t *>(desc.code) + desc.code_size);
+				if (desc.entry_point != nullptr)
+					shader.entry_point = desc.entry_point;
+
+				total_code_size += desc.code_size;
+			}
+			break;
+		}
+	}
+
+	_stats.num_pipelines++;
+	_stats.shader_code_bytes += total_code_size;
+
+	*out_handle = { reinterpret_cast<uintptr_t>(impl) };
+	return true;
+}
+void reshade::null::device_impl::destroy_pipeline(api::pipeline handle)
+{
+	if (handle == 0)
+		return;
+
+	const auto impl = reinterpret_cast<pipeline_impl *>(handle.handle);
+
+	for (const pipeline_impl::shader &shader : impl->shaders)
+		_stats.shader_code_bytes -= shader.code.size();
+
+	_stats.num_pipelines--;
+
+	delete impl;
+}
+
+bool reshade::null::device_impl::create_pipeline_layout(uint32_t param_count, const api::pipeline_layout_param *params, api::pipeline_layout *out_handle)
+{
+	const auto impl = new pipeline_layout_impl();
+	impl->params.assign(params, params + param_count);
+	impl->ranges.resize(param_count);
+
+	for (uint32_t i = 0; i < param_count; ++i)
+	{
+		if (params[i].type != api::pipeline_layout_param_type::descriptor_table && params[i].type != api::pipeline_layout_param_type::push_descriptors_with_ranges)
+			continue;
+
+		// Keep a copy of the ranges, since the pointer passed in is only valid during this call
+		impl->ranges[i].assign(params[i].descriptor_table.ranges, params[i].descriptor_table.ranges + params[i].descriptor_table.count);
+		impl->params[i].descriptor_table.ranges = impl->ranges[i].data();
+	}
+
+	_stats.num_pipeline_layouts++;
+
+	*out_handle = { reinterpret_cast<uintptr_t>(impl) };
+	return true;
+}
+void reshade::null::device_impl::destroy_pipeline_layout(api::pipeline_layout handle)
+{
+	if (handle == 0)
+		return;
+
+	delete reinterpret_cast<pipeline_layout_impl *>(handle.handle);
+
+	_stats.num_pipeline_layouts--;
+}
+
+bool reshade::null::device_impl::allocate_descriptor_tables(uint32_t count, api::pipeline_layout layout, uint32_t layout_param, api::descriptor_table *out_tables)
+{
+	const auto layout_impl = reinterpret_cast<const pipeline_layout_impl *>(layout.handle);
+
+	if (layout_impl == nullptr || layout_param >= layout_impl->params.size())
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			out_tables[i] = { 0 };
+		return false;
+	}
+
+	// Make room for the highest binding of all ranges in the table
+	uint32_t num_descriptors = 0;
+	for (const api::descriptor_range &range : layout_impl->ranges[layout_param])
+		num_descriptors = std::max(num_descriptors, range.binding + std::max(range.count, range.array_size));
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const auto impl = new descriptor_table_impl();
+		impl->layout = layout;
+		impl->layout_param = layout_param;
+		impl->descriptors.resize(num_descriptors);
+
+		out_tables[i] = { reinterpret_cast<uintptr_t>(impl) };
+	}
+
+	_stats.num_descriptor_tables += count;
+
+	return true;
+}
+void reshade::null::device_impl::free_descriptor_tables(uint32_t count, const api::descriptor_table *tables)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (tables[i] == 0)
+			continue;
+
+		delete reinterpret_cast<descriptor_table_impl *>(tables[i].handle);
+
+		_stats.num_descriptor_tables--;
+	}
+}
+
+void reshade::null::device_impl::get_descriptor_heap_offset(api::descriptor_table table, uint32_t binding, uint32_t array_offset, api::descriptor_heap *out_heap, uint32_t *out_offset) const
+{
+	assert(table != 0 && out_heap != nullptr && out_offset != nullptr);
+
+	// Each table is its own heap
+	*out_heap = { table.handle };
+	*out_offset = binding + array_offset;
+}
+
+void reshade::null::device_impl::copy_descriptor_tables(uint32_t count, const api::descriptor_table_copy *copies)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const api::descriptor_table_copy &copy = copies[i];
+
+		const auto source_impl = reinterpret_cast<const descriptor_table_impl *>(copy.source_table.handle);
+		const auto dest_impl = reinterpret_cast<descriptor_table_impl *>(copy.dest_table.handle);
+
+		const size_t source_offset = static_cast<size_t>(copy.source_binding) + copy.source_array_offset;
+		const size_t dest_offset = static_cast<size_t>(copy.dest_binding) + copy.dest_array_offset;
+
+		if (dest_impl->descriptors.size() < dest_offset + copy.count)
+			dest_impl->descriptors.resize(dest_offset + copy.count);
+
+		for (uint32_t k = 0; k < copy.count; ++k)
+			dest_impl->descriptors[dest_offset + k] = source_offset + k < source_impl->descriptors.size() ? source_impl->descriptors[source_offset + k] : api::buffer_range {};
+	}
+}
+void reshade::null::device_impl::update_descriptor_tables(uint32_t count, const api::descriptor_table_update *updates)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const api::descriptor_table_update &update = updates[i];
+
+		const auto impl = reinterpret_cast<descriptor_table_impl *>(update.table.handle);
+
+		const size_t offset = static_cast<size_t>(update.binding) + update.array_offset;
+
+		if (impl->descriptors.size() < offset + update.count)
+			impl->descriptors.resize(offset + update.count);
+
+		for (uint32_t k = 0; k < update.count; ++k)
+			store_descriptor(update.type, update.descriptors, k, impl->descriptors[offset + k]);
+	}
+}
+
+bool reshade::null::device_impl::create_query_heap(api::query_type type, uint32_t size, api::query_heap *out_handle)
+{
+	const auto impl = new query_heap_impl();
+	impl->type = type;
+	impl->results.resize(size);
+
+	_stats.num_query_heaps++;
+
+	*out_handle = { reinterpret_cast<uintptr_t>(impl) };
+	return true;
+}
+void reshade::null::device_impl::destroy_query_heap(api::query_heap handle)
+{
+	if (handle == 0)
+		return;
+
+	delete reinterpret_cast<query_heap_impl *>(handle.handle);
+
+	_stats.num_query_heaps--;
+}
+
+bool reshade::null::device_impl::get_query_heap_results(api::query_heap heap, uint32_t first, uint32_t count, void *results, uint32_t stride)
+{
+	assert(heap != 0);
+	assert(stride >= sizeof(uint64_t));
+
+	const auto impl = reinterpret_cast<const query_heap_impl *>(heap.handle);
+
+	if (first + count > impl->results.size())
+		return false;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint8_t *const result = static_cast<uint8_t *>(results) + static_cast<size_t>(i) * stride;
+
+		// Queries that return structures (like pipeline statistics) have all other members zeroed
+		std::memset(result, 0, stride);
+		std::memcpy(result, &impl->results[first + i], sizeof(uint64_t));
+	}
+
+	return true;
+}
+
+void reshade::null::device_impl::set_resource_name(api::resource, const char *)
+{
+}
+void reshade::null::device_impl::set_resource_view_name(api::resource_view, const char *)
+{
+}
+
+bool reshade::null::device_impl::create_fence(uint64_t initial_value, api::fence_flags flags, api::fence *out_handle, void **)
+{
+	*out_handle = { 0 };
+
+	if ((flags & api::fence_flags::shared) != 0)
+		return false;
+
+	const auto impl = new fence_impl();
+	impl->current_value = initial_value;
+
+	_stats.num_fences++;
+
+	*out_handle = { reinterpret_cast<uintptr_t>(impl) };
+	return true;
+}
+void reshade::null::device_impl::destroy_fence(api::fence handle)
+{
+	if (handle == 0)
+		return;
+
+	delete reinterpret_cast<fence_impl *>(handle.handle);
+
+	_stats.num_fences--;
+}
+
+uint64_t reshade::null::device_impl::get_completed_fence_value(api::fence fence) const
+{
+	assert(fence != 0);
+
+	return reinterpret_cast<const fence_impl *>(fence.handle)->current_value;
+}
+
+bool reshade::null::device_impl::wait(api::fence fence, uint64_t value, uint64_t)
+{
+	assert(fence != 0);
+
+	// Work completes as soon as it is submitted, so there is never anything to wait for, only values that were not signaled yet
+	return reinterpret_cast<const fence_impl *>(fence.handle)->current_value >= value;
+}
+bool reshade::null::device_impl::signal(api::fence fence, uint64_t value)
+{
+	assert(fence != 0);
+
+	reinterpret_cast<fence_impl *>(fence.handle)->current_value = value;
+	return true;
+}
+
+uint8_t *reshade::null::device_impl::get_resource_data(resource_impl *impl)
+{
+	const std::unique_lock<std::mutex> lock(_allocation_mutex);
+
+	if (impl->data == nullptr)
+	{
+		impl->data.reset(new uint8_t[static_cast<size_t>(impl->size)]());
+
+		_stats.num_allocations++;
+
+		const uint64_t allocated_bytes = (_stats.allocated_bytes += impl->size);
+		for (uint64_t peak = _stats.peak_allocated_bytes; allocated_bytes > peak && !_stats.peak_allocated_bytes.compare_exchange_weak(peak, allocated_bytes);)
+			continue;
+	}
+
+	return impl->data.get();
+}
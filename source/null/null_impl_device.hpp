@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "reshade_api_object_impl.hpp"
+#include <mutex>
+#include <memory>
+#include <string>
+
+namespace reshade::null
+{
+	struct resource_impl
+	{
+		struct subresource_layout
+		{
+			uint64_t offset;
+			uint32_t row_pitch;
+			uint32_t slice_pitch;
+		};
+
+		api::resource_desc desc;
+		uint64_t size;
+		std::vector<subresource_layout> subresources;
+		// Host memory is only allocated the first time the contents of the resource are accessed, since commands are never executed
+		std::unique_ptr<uint8_t[]> data;
+	};
+
+	struct resource_view_impl
+	{
+		api::resource resource;
+		api::resource_usage usage_type;
+		api::resource_view_desc desc;
+	};
+
+	struct pipeline_impl
+	{
+		struct shader
+		{
+			api::pipeline_subobject_type type;
+			std::vector<uint8_t> code;
+			std::string entry_point;
+		};
+
+		api::pipeline_layout layout;
+		std::vector<shader> shaders;
+	};
+
+	struct pipeline_layout_impl
+	{
+		std::vector<api::pipeline_layout_param> params;
+		std::vector<std::vector<api::descriptor_range>> ranges;
+	};
+
+	struct descriptor_table_impl
+	{
+		api::pipeline_layout layout;
+		uint32_t layout_param;
+		// Large enough to hold any descriptor type (the largest being 'api::buffer_range')
+		std::vector<api::buffer_range> descriptors;
+	};
+
+	struct query_heap_impl
+	{
+		api::query_type type;
+		std::vector<uint64_t> results;
+	};
+
+	struct fence_impl
+	{
+		std::atomic<uint64_t> current_value;
+	};
+
+	/// <summary>
+	/// Counters of the objects and memory a null device holds, which can be read from any thread at any time.
+	/// </summary>
+	struct device_stats
+	{
+		std::atomic<uint32_t> num_samplers = 0;
+		std::atomic<uint32_t> num_resources = 0;
+		std::atomic<uint32_t> num_resource_views = 0;
+		std::atomic<uint32_t> num_pipelines = 0;
+		std::atomic<uint32_t> num_pipeline_layouts = 0;
+		std::atomic<uint32_t> num_descriptor_tables = 0;
+		std::atomic<uint32_t> num_query_heaps = 0;
+		std::atomic<uint32_t> num_fences = 0;
+
+		// Size of all live resources (whether or not host memory was allocated for them yet)
+		std::atomic<uint64_t> resource_bytes = 0;
+		// Number of host memory allocations done for resource contents over the lifetime of the device
+		std::atomic<uint64_t> num_allocations = 0;
+		std::atomic<uint64_t> allocated_bytes = 0;
+		std::atomic<uint64_t> peak_allocated_bytes = 0;
+		// Size of the shader code held by all live pipelines
+		std::atomic<uint64_t> shader_code_bytes = 0;
+
+		// Number of commands recorded on all command lists over the lifetime of the device
+		std::atomic<uint64_t> num_commands = 0;
+		std::atomic<uint64_t> num_draws = 0;
+		std::atomic<uint64_t> num_dispatches = 0;
+		std::atomic<uint64_t> num_copies = 0;
+		std::atomic<uint64_t> num_clears = 0;
+		std::atomic<uint64_t> num_barriers = 0;
+		std::atomic<uint64_t> num_render_passes = 0;
+		std::atomic<uint64_t> num_submits = 0;
+
+		// Time spent in the respective device functions, in nanoseconds
+		std::atomic<uint64_t> create_resource_time = 0;
+		std::atomic<uint64_t> create_pipeline_time = 0;
+		std::atomic<uint64_t> update_resource_time = 0;
+	};
+
+	/// <summary>
+	/// Device that implements the API entirely in host memory, without any graphics driver or window.
+	/// Resources are plain host allocations, pipelines hold on to the shader code they were created with, and commands are counted, but never executed.
+	/// </summary>
+	/// <remarks>
+	/// This reports itself as <see cref="api::device_api::null"/>, so that add-ons can detect it and do not try to cast native handles (which are all zero) to objects of a real graphics API.
+	/// The effect runtime treats it like a Vulkan device and generates SPIR-V (which needs no external shader compiler).
+	/// </remarks>
+	class device_impl : public api::api_object_impl<void *, api::device>
+	{
+		friend class command_list_impl;
+		friend class command_queue_impl;
+
+	public:
+		device_impl();
+		~device_impl();
+
+		api::device_api get_api() const final { return api::device_api::null; }
+
+		api::device_properties get_properties() const final;
+
+		bool check_capability(api::device_caps capability) const final;
+		bool check_format_support(api::format format, api::resource_usage usage) const final;
+
+		bool create_sampler(const api::sampler_desc &desc, api::sampler *out_handle) final;
+		void destroy_sampler(api::sampler handle) final;
+
+		bool create_resource(const api::resource_desc &desc, const api::subresource_data *initial_data, api::resource_usage initial_state, api::resource *out_handle, void **shared_handle = nullptr) final;
+		void destroy_resource(api::resource handle) final;
+
+		api::resource_desc get_resource_desc(api::resource resource) const final;
+
+		bool create_resource_view(api::resource resource, api::resource_usage usage_type, const api::resource_view_desc &desc, api::resource_view *out_handle) final;
+		void destroy_resource_view(api::resource_view handle) final;
+
+		api::resource get_resource_from_view(api::resource_view view) const final;
+		api::resource_view_desc get_resource_view_desc(api::resource_view view) const final;
+
+		bool map_buffer_region(api::resource resource, uint64_t offset, uint64_t size, api::map_access access, void **out_data) final;
+		void unmap_buffer_region(api::resource resource) final;
+		bool map_texture_region(api::resource resource, uint32_t subresource, const api::subresource_box *box, api::map_access access, api::subresource_data *out_data) final;
+		void unmap_texture_region(api::resource resource, uint32_t subresource) final;
+
+		void update_buffer_region(const void *data, api::resource resource, uint64_t offset, uint64_t size) final;
+		void update_texture_region(const api::subresource_data &data, api::resource resource, uint32_t subresource, const api::subresource_box *box) final;
+
+		bool create_pipeline(api::pipeline_layout layout, uint32_t subobject_count, const api::pipeline_subobject *subobjects, api::pipeline *out_handle) final;
+		void destroy_pipeline(api::pipeline handle) final;
+
+		bool create_pipeline_layout(uint32_t param_count, const api::pipeline_layout_param *params, api::pipeline_layout *out_handle) final;
+		void destroy_pipeline_layout(api::pipeline_layout handle) final;
+
+		bool allocate_descriptor_tables(uint32_t count, api::pipeline_layout layout, uint32_t layout_param, api::descriptor_table *out_tables) final;
+		void free_descriptor_tables(uint32_t count, const api::descriptor_table *tables) final;
+
+		void get_descriptor_heap_offset(api::descriptor_table table, uint32_t binding, uint32_t array_offset, api::descriptor_heap *out_heap, uint32_t *out_offset) const final;
+
+		void copy_descriptor_tables(uint32_t count, const api::descriptor_table_copy *copies) final;
+		void update_descriptor_tables(uint32_t count, const api::descriptor_table_update *updates) final;
+
+		bool create_query_heap(api::query_type type, uint32_t size, api::query_heap *out_handle) final;
+		void destroy_query_heap(api::query_heap handle) final;
+
+		bool get_query_heap_results(api::query_heap heap, uint32_t first, uint32_t count, void *results, uint32_t stride) final;
+
+		void set_resource_name(api::resource handle, const char *name) final;
+		void set_resource_view_name(api::resource_view handle, const char *name) final;
+
+		bool create_fence(uint64_t initial_value, api::fence_flags flags, api::fence *out_handle, void **shared_handle = nullptr) final;
+		void destroy_fence(api::fence handle) final;
+
+		uint64_t get_completed_fence_value(api::fence fence) const final;
+
+		bool wait(api::fence fence, uint64_t value, uint64_t timeout) final;
+		bool signal(api::fence fence, uint64_t value) final;
+
+		const device_stats &get_stats() const { return _stats; }
+
+	private:
+		uint8_t *get_resource_data(resource_impl *impl);
+
+		device_stats _stats;
+		std::mutex _allocation_mutex;
+	};
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "null_impl_swapchain.hpp"
+
+reshade::null::swapchain_impl::swapchain_impl(device_impl *device, const api::resource_desc &back_buffer_desc, uint32_t back_buffer_count) :
+	api_object_impl(nullptr),
+	_device_impl(device)
+{
+	_back_buffers.resize(back_buffer_count);
+
+	for (api::resource &back_buffer : _back_buffers)
+		_device_impl->create_resource(back_buffer_desc, nullptr, api::resource_usage::present, &back_buffer);
+}
+reshade::null::swapchain_impl::~swapchain_impl()
+{
+	for (const api::resource back_buffer : _back_buffers)
+		_device_impl->destroy_resource(back_buffer);
+}
+
+reshade::api::device *reshade::null::swapchain_impl::get_device()
+{
+	return _device_impl;
+}
+
+reshade::api::resource reshade::null::swapchain_impl::get_back_buffer(uint32_t index)
+{
+	return _back_buffers[index];
+}
+
+uint32_t reshade::null::swapchain_impl::get_back_buffer_count() const
+{
+	return static_cast<uint32_t>(_back_buffers.size());
+}
+uint32_t reshade::null::swapchain_impl::get_current_back_buffer_index() const
+{
+	return _swap_index;
+}
+
+bool reshade::null::swapchain_impl::check_color_space_support(api::color_space color_space) const
+{
+	return color_space == api::color_space::srgb_nonlinear;
+}
+
+void reshade::null::swapchain_impl::present()
+{
+	_swap_index = (_swap_index + 1) % static_cast<uint32_t>(_back_buffers.size());
+}
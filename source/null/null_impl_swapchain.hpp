@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "null_impl_device.hpp"
+
+namespace reshade::null
+{
+	/// <summary>
+	/// Swap chain without a window, whose back buffers are regular resources created on the null device.
+	/// </summary>
+	class swapchain_impl : public api::api_object_impl<void *, api::swapchain>
+	{
+	public:
+		swapchain_impl(device_impl *device, const api::resource_desc &back_buffer_desc, uint32_t back_buffer_count);
+		~swapchain_impl();
+
+		api::device *get_device() final;
+
+		void *get_hwnd() const final { return nullptr; }
+
+		api::resource get_back_buffer(uint32_t index) final;
+
+		uint32_t get_back_buffer_count() const final;
+		uint32_t get_current_back_buffer_index() const final;
+
+		bool check_color_space_support(api::color_space color_space) const final;
+
+		api::color_space get_color_space() const final { return api::color_space::srgb_nonlinear; }
+
+		/// <summary>
+		/// Advances to the next back buffer, like presenting would on a real swap chain.
+		/// </summary>
+		void present();
+
+	private:
+		device_impl *const _device_impl;
+		std::vector<api::resource> _back_buffers;
+		uint32_t _swap_index = 0;
+	};
+}
@@ -18,7 +18,7 @@
 #include "dll_log.hpp"
 #include "com_utils.hpp"
 #include "hook_manager.hpp"
-#include "lockfree_linear_map.hpp"
+#include "lockfree_hash_map.hpp"
 #include <functional>
 #include <ivrclientcore.h>
 
@@ -199,7 +199,7 @@ static vr::EVRCompositorError on_vr_submit_opengl(vr::IVRCompositor *compositor,
 static vr::EVRCompositorError on_vr_submit_vulkan(vr::IVRCompositor *compositor, vr::EVREye eye, const vr::VRVulkanTextureData_t *texture, vr::EColorSpace color_space, const vr::VRTextureBounds_t *bounds, vr::EVRSubmitFlags flags,
 	std::function<vr::EVRCompositorError(vr::EVREye eye, void *texture, const vr::VRTextureBounds_t *bounds, vr::EVRSubmitFlags flags)> submit)
 {
-	extern lockfree_linear_map<void *, reshade::vulkan::device_impl *, 8> g_vulkan_devices;
+	extern lockfree_hash_map<void *, reshade::vulkan::device_impl *> g_vulkan_devices;
 
 	reshade::vulkan::device_impl *device = g_vulkan_devices.at(dispatch_key_from_handle(texture->m_pDevice));
 	if (device == nullptr)
@@ -4,9 +4,9 @@
  */
 
 #include "openxr_hooks.hpp"
-#include "lockfree_linear_map.hpp"
+#include "lockfree_hash_map.hpp"
 
-extern lockfree_linear_map<XrInstance, openxr_dispatch_table, 16> g_openxr_instances;
+extern lockfree_hash_map<XrInstance, openxr_dispatch_table> g_openxr_instances;
 
 #define HOOK_PROC(name) \
 	if (0 == std::strcmp(pName, "xr" #name)) { \
@@ -5,10 +5,10 @@
 
 #include "openxr_hooks.hpp"
 #include "dll_log.hpp"
-#include "lockfree_linear_map.hpp"
+#include "lockfree_hash_map.hpp"
 #include <common/loader_interfaces.h>
 
-lockfree_linear_map<XrInstance, openxr_dispatch_table, 16> g_openxr_instances;
+lockfree_hash_map<XrInstance, openxr_dispatch_table> g_openxr_instances;
 
 #define GET_DISPATCH_PTR(name) \
 	PFN_xr##name trampoline = g_openxr_instances.at(instance).name; \
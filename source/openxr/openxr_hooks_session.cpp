@@ -18,7 +18,7 @@
 #include "dll_log.hpp"
 #include "com_utils.hpp"
 #include "hook_manager.hpp"
-#include "lockfree_linear_map.hpp"
+#include "lockfree_hash_map.hpp"
 #include <deque>
 
 #define XR_USE_GRAPHICS_API_D3D11
@@ -41,9 +41,9 @@ struct openxr_swapchain_data
 	uint32_t last_released_index = 0;
 };
 
-extern lockfree_linear_map<XrInstance, openxr_dispatch_table, 16> g_openxr_instances;
-static lockfree_linear_map<XrSession, openxr_session_data, 16> s_openxr_sessions;
-static lockfree_linear_map<XrSwapchain, openxr_swapchain_data, 16> s_openxr_swapchains;
+extern lockfree_hash_map<XrInstance, openxr_dispatch_table> g_openxr_instances;
+static lockfree_hash_map<XrSession, openxr_session_data> s_openxr_sessions;
+static lockfree_hash_map<XrSwapchain, openxr_swapchain_data> s_openxr_swapchains;
 
 #define GET_DISPATCH_PTR_FROM(name, data) \
 	assert((data) != nullptr); \
@@ -124,7 +124,7 @@ XrResult XRAPI_CALL xrCreateSession(XrInstance instance, const XrSessionCreateIn
 		else
 		if (const auto binding_vulkan = find_in_structure_chain<XrGraphicsBindingVulkanKHR>(pCreateInfo, XR_TYPE_GRAPHICS_BINDING_VULKAN_KHR))
 		{
-			extern lockfree_linear_map<void *, reshade::vulkan::device_impl *, 8> g_vulkan_devices;
+			extern lockfree_hash_map<void *, reshade::vulkan::device_impl *> g_vulkan_devices;
 
 			if (reshade::vulkan::device_impl *const device = g_vulkan_devices.at(dispatch_key_from_handle(binding_vulkan->device)))
 			{
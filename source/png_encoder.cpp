@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "png_encoder.hpp"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <fpng.h>
+
+static uint32_t read_be32(const uint8_t *data)
+{
+	return (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+static void write_be32(std::vector<uint8_t> &data, uint32_t value)
+{
+	data.push_back((value >> 24) & 0xFF);
+	data.push_back((value >> 16) & 0xFF);
+	data.push_back((value >> 8) & 0xFF);
+	data.push_back(value & 0xFF);
+}
+
+static uint32_t calc_crc32(const uint8_t *data, size_t size, uint32_t crc = 0xFFFFFFFF)
+{
+	static const struct crc32_table
+	{
+		crc32_table()
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t value = i;
+				for (int k = 0; k < 8; ++k)
+					value = (value & 1) ? 0xEDB88320 ^ (value >> 1) : (value >> 1);
+				entries[i] = value;
+			}
+		}
+
+		uint32_t entries[256];
+	} table;
+
+	for (size_t i = 0; i < size; ++i)
+		crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc;
+}
+
+static uint32_t combine_adler32(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+	// See 'adler32_combine' in zlib
+	constexpr uint32_t base = 65521;
+
+	const uint32_t rem = static_cast<uint32_t>(size2 % base);
+	uint32_t sum1 = adler1 & 0xFFFF;
+	uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % base);
+	sum1 += (adler2 & 0xFFFF) + base - 1;
+	sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + base - rem;
+	if (sum1 >= base) sum1 -= base;
+	if (sum1 >= base) sum1 -= base;
+	if (sum2 >= (base << 1)) sum2 -= (base << 1);
+	if (sum2 >= base) sum2 -= base;
+	return sum1 | (sum2 << 16);
+}
+
+namespace
+{
+	struct bit_reader
+	{
+		const uint8_t *data;
+		size_t size;
+		size_t position = 0; // In bits
+
+		uint32_t peek(uint32_t count) const
+		{
+			assert(count <= 32);
+
+			uint64_t value = 0;
+			if (const size_t offset = position / 8;
+				offset + 8 <= size)
+				std::memcpy(&value, data + offset, 8);
+			else
+				for (size_t i = 0; offset + i < size && i < 8; ++i)
+					value |= static_cast<uint64_t>(data[offset + i]) << (i * 8);
+
+			return static_cast<uint32_t>((value >> (position % 8)) & ((1ull << count) - 1));
+		}
+		uint32_t read(uint32_t count)
+		{
+			const uint32_t value = peek(count);
+			position += count;
+			return value;
+		}
+
+		bool overflowed() const { return position > size * 8; }
+	};
+
+	struct huffman_table
+	{
+		static constexpr uint32_t max_bits = 15;
+
+		bool build(const uint8_t *lengths, uint32_t count)
+		{
+			uint32_t num_codes[max_bits + 1] = {};
+			for (uint32_t i = 0; i < count; ++i)
+				num_codes[lengths[i]]++;
+			num_codes[0] = 0;
+
+			uint32_t next_code[max_bits + 1] = {};
+			for (uint32_t bits = 1, code = 0; bits <= max_bits; ++bits)
+			{
+				code = (code + num_codes[bits - 1]) << 1;
+				next_code[bits] = code;
+			}
+
+			// Each entry stores the symbol in the lower 9 bits and the code length in the upper bits, indexed by the bit-reversed code (since codes are packed starting with the most significant bit)
+			entries.assign(1 << max_bits, 0);
+			for (uint32_t symbol = 0; symbol < count; ++symbol)
+			{
+				const uint32_t length = lengths[symbol];
+				if (length == 0)
+					continue;
+
+				const uint32_t code = next_code[length]++;
+				if (code >= (1u << length))
+					return false; // Over-subscribed code lengths
+
+				uint32_t reversed_code = 0;
+				for (uint32_t i = 0; i < length; ++i)
+					reversed_code |= ((code >> i) & 1) << (length - 1 - i);
+
+				for (uint32_t i = reversed_code; i < (1u << max_bits); i += (1u << length))
+					entries[i] = static_cast<uint16_t>(symbol | (length << 9));
+			}
+
+			return true;
+		}
+
+		bool decode(bit_reader &reader, uint32_t &symbol) const
+		{
+			const uint16_t entry = entries[reader.peek(max_bits)];
+			if ((entry >> 9) == 0)
+				return false;
+			reader.position += entry >> 9;
+			symbol = entry & 0x1FF;
+			return true;
+		}
+
+		std::vector<uint16_t> entries;
+	};
+}
+
+/// <summary>
+/// Walks through a raw deflate stream to find where its final block begins and where the stream ends (both in bits).
+/// This does not produce any output, it only decodes symbols far enough to be able to skip over them.
+/// </summary>
+static bool find_deflate_stream_end(const uint8_t *data, size_t size, size_t &final_block_position, size_t &end_position)
+{
+	static constexpr uint16_t length_extra_bits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static constexpr uint16_t distance_extra_bits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	static constexpr uint8_t code_length_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	bit_reader reader { data, size };
+	huffman_table literal_table, distance_table;
+
+	for (bool final_block = false; !final_block;)
+	{
+		final_block_position = reader.position;
+		final_block = reader.read(1) != 0;
+
+		switch (reader.read(2))
+		{
+		case 0: // Stored block
+		{
+			reader.position = (reader.position + 7) & ~size_t(7);
+			const uint32_t length = reader.read(16);
+			if ((reader.read(16) ^ 0xFFFF) != length)
+				return false;
+			reader.position += length * 8;
+			continue;
+		}
+		case 1: // Fixed Huffman codes
+		{
+			uint8_t lengths[288 + 32];
+			std::fill_n(lengths + 0, 144, static_cast<uint8_t>(8));
+			std::fill_n(lengths + 144, 112, static_cast<uint8_t>(9));
+			std::fill_n(lengths + 256, 24, static_cast<uint8_t>(7));
+			std::fill_n(lengths + 280, 8, static_cast<uint8_t>(8));
+			std::fill_n(lengths + 288, 32, static_cast<uint8_t>(5));
+			if (!literal_table.build(lengths, 288) || !distance_table.build(lengths + 288, 32))
+				return false;
+			break;
+		}
+		case 2: // Dynamic Huffman codes
+		{
+			const uint32_t num_literal_codes = reader.read(5) + 257;
+			const uint32_t num_distance_codes = reader.read(5) + 1;
+			const uint32_t num_code_length_codes = reader.read(4) + 4;
+
+			uint8_t code_length_lengths[19] = {};
+			for (uint32_t i = 0; i < num_code_length_codes; ++i)
+				code_length_lengths[code_length_order[i]] = static_cast<uint8_t>(reader.read(3));
+
+			huffman_table code_length_table;
+			if (!code_length_table.build(code_length_lengths, 19))
+				return false;
+
+			uint8_t lengths[288 + 32] = {};
+			for (uint32_t i = 0, symbol; i < num_literal_codes + num_distance_codes;)
+			{
+				if (!code_length_table.decode(reader, symbol))
+					return false;
+
+				uint32_t repeat = 1;
+				uint8_t value = 0;
+				if (symbol < 16)
+					value = static_cast<uint8_t>(symbol);
+				else if (symbol == 16 && i != 0)
+					value = lengths[i - 1], repeat = 3 + reader.read(2);
+				else if (symbol == 17)
+					repeat = 3 + reader.read(3);
+				else if (symbol == 18)
+					repeat = 11 + reader.read(7);
+				else
+					return false;
+
+				if (i + repeat > num_literal_codes + num_distance_codes)
+					return false;
+				for (; repeat != 0; --repeat)
+					lengths[i++] = value;
+			}
+
+			if (!literal_table.build(lengths, num_literal_codes) || !distance_table.build(lengths + num_literal_codes, num_distance_codes))
+				return false;
+			break;
+		}
+		default:
+			return false;
+		}
+
+		for (uint32_t symbol; ;)
+		{
+			if (!literal_table.decode(reader, symbol) || reader.overflowed())
+				return false;
+
+			if (symbol < 256)
+				continue;
+			if (symbol == 256)
+				break;
+			if (symbol > 285)
+				return false;
+
+			reader.position += length_extra_bits[symbol - 257];
+
+			if (!distance_table.decode(reader, symbol) || symbol >= 30)
+				return false;
+
+			reader.position += distance_extra_bits[symbol];
+		}
+	}
+
+	end_position = reader.position;
+	return !reader.overflowed();
+}
+
+namespace
+{
+	struct png_stripe
+	{
+		std::vector<uint8_t> encoded_data;
+		std::vector<uint8_t> deflate_data;
+		size_t final_block_position = 0;
+		size_t end_position = 0;
+		uint32_t adler = 0;
+		const uint8_t *ihdr = nullptr;
+		bool success = false;
+	};
+}
+
+static bool encode_png_stripe(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t num_channels, png_stripe &stripe)
+{
+	// Each stripe is encoded as an independent PNG file, which is then taken apart again to get at the deflate stream
+	// This works because 'fpng' does not filter the first row of an image against a previous row, so the rows of a stripe do not depend on the previous stripe
+	if (!fpng::fpng_encode_image_to_memory(pixels, width, height, num_channels, stripe.encoded_data))
+		return false;
+
+	const uint8_t *const data = stripe.encoded_data.data();
+	const size_t size = stripe.encoded_data.size();
+
+	for (size_t offset = 8; offset + 12 <= size;)
+	{
+		const uint32_t chunk_size = read_be32(data + offset);
+		if (offset + 12 + chunk_size > size)
+			return false;
+
+		const uint8_t *const chunk_type = data + offset + 4;
+		if (std::memcmp(chunk_type, "IHDR", 4) == 0)
+			stripe.ihdr = data + offset;
+		else if (std::memcmp(chunk_type, "IDAT", 4) == 0)
+			stripe.deflate_data.insert(stripe.deflate_data.end(), data + offset + 8, data + offset + 8 + chunk_size);
+
+		offset += 12 + chunk_size;
+	}
+
+	// Check and remove zlib header and Adler-32 checksum, so that only the raw deflate stream remains
+	if (stripe.ihdr == nullptr || stripe.deflate_data.size() < 6 || (stripe.deflate_data[0] & 0x0F) != 8 || (stripe.deflate_data[1] & 0x20) != 0)
+		return false;
+
+	stripe.adler = read_be32(stripe.deflate_data.data() + stripe.deflate_data.size() - 4);
+	stripe.deflate_data.erase(stripe.deflate_data.end() - 4, stripe.deflate_data.end());
+	stripe.deflate_data.erase(stripe.deflate_data.begin(), stripe.deflate_data.begin() + 2);
+
+	return find_deflate_stream_end(stripe.deflate_data.data(), stripe.deflate_data.size(), stripe.final_block_position, stripe.end_position);
+}
+
+struct reshade::png_encoder::encode_job
+{
+	const uint8_t *pixels;
+	uint32_t width;
+	uint32_t height;
+	uint32_t num_channels;
+	uint32_t stripe_height;
+	std::vector<png_stripe> stripes;
+	// Number of stripes that were handed to other threads and are not finished yet (protected by the mutex of the encoder)
+	uint32_t num_pending_stripes;
+
+	void encode_stripe(uint32_t i)
+	{
+		const uint32_t y = i * stripe_height;
+		stripes[i].success = y < height && encode_png_stripe(pixels + static_cast<size_t>(y) * width * num_channels, width, std::min(stripe_height, height - y), num_channels, stripes[i]);
+	}
+};
+
+reshade::png_encoder::png_encoder(uint32_t max_threads) :
+	_max_threads(max_threads != 0 ? max_threads : std::max(std::thread::hardware_concurrency(), 1u))
+{
+}
+reshade::png_encoder::~png_encoder()
+{
+	{ const std::unique_lock<std::mutex> lock(_mutex);
+		assert(_tasks.empty());
+		_exit = true;
+	}
+
+	_task_available.notify_all();
+
+	for (std::thread &thread : _threads)
+		thread.join();
+}
+
+void reshade::png_encoder::worker_main()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true)
+	{
+		_task_available.wait(lock, [this]() { return _exit || !_tasks.empty(); });
+		if (_exit)
+			break;
+
+		run_task(lock);
+	}
+}
+void reshade::png_encoder::run_task(std::unique_lock<std::mutex> &lock)
+{
+	const auto [job, i] = _tasks.front();
+	_tasks.pop_front();
+
+	lock.unlock();
+	job->encode_stripe(i);
+	lock.lock();
+
+	job->num_pending_stripes--;
+	_task_finished.notify_all();
+}
+
+bool reshade::png_encoder::encode(const void *pixels, uint32_t width, uint32_t height, uint32_t num_channels, std::vector<uint8_t> &encoded_data)
+{
+	// Only split large images, where the gain from encoding in parallel outweighs the cost of stitching the results back together
+	constexpr uint32_t min_stripe_height = 128;
+	const uint32_t num_stripes = std::min(_max_threads, height / min_stripe_height);
+
+	if (num_stripes <= 1)
+		return fpng::fpng_encode_image_to_memory(pixels, width, height, num_channels, encoded_data);
+
+	const size_t row_pitch = static_cast<size_t>(width) * num_channels;
+	const uint32_t stripe_height = (height + num_stripes - 1) / num_stripes;
+
+	encode_job job = { static_cast<const uint8_t *>(pixels), width, height, num_channels, stripe_height, std::vector<png_stripe>(num_stripes), num_stripes - 1 };
+	{ const std::unique_lock<std::mutex> lock(_mutex);
+		// Start more threads as needed, the calling thread encodes the first stripe itself
+		while (_threads.size() < num_stripes - 1)
+			_threads.emplace_back(&png_encoder::worker_main, this);
+
+		for (uint32_t i = 1; i < num_stripes; ++i)
+			_tasks.emplace_back(&job, i);
+	}
+
+	_task_available.notify_all();
+
+	job.encode_stripe(0);
+
+	{ std::unique_lock<std::mutex> lock(_mutex);
+		// Help with stripes that are still queued (which may belong to images other threads are encoding at the same time), rather than only waiting for them
+		while (job.num_pending_stripes != 0)
+		{
+			if (!_tasks.empty())
+				run_task(lock);
+			else
+				_task_finished.wait(lock);
+		}
+	}
+
+	const std::vector<png_stripe> &stripes = job.stripes;
+
+	if (std::any_of(stripes.begin(), stripes.end(), [](const png_stripe &stripe) { return !stripe.success; }))
+		return fpng::fpng_encode_image_to_memory(pixels, width, height, num_channels, encoded_data);
+
+	encoded_data.clear();
+
+	// Write PNG signature
+	const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	encoded_data.insert(encoded_data.end(), signature, signature + 8);
+
+	// Write header chunk of the first stripe, but with the height of the entire image
+	{
+		const size_t chunk_offset = encoded_data.size();
+		encoded_data.insert(encoded_data.end(), stripes[0].ihdr, stripes[0].ihdr + 8 + 13);
+		encoded_data[chunk_offset + 12] = (height >> 24) & 0xFF;
+		encoded_data[chunk_offset + 13] = (height >> 16) & 0xFF;
+		encoded_data[chunk_offset + 14] = (height >> 8) & 0xFF;
+		encoded_data[chunk_offset + 15] = height & 0xFF;
+		write_be32(encoded_data, calc_crc32(encoded_data.data() + chunk_offset + 4, 4 + 13) ^ 0xFFFFFFFF);
+	}
+
+	// Write data chunk with a single zlib stream made up of the deflate streams of all stripes
+	{
+		const size_t chunk_offset = encoded_data.size();
+		write_be32(encoded_data, 0); // Size is filled in below
+		encoded_data.insert(encoded_data.end(), { 'I', 'D', 'A', 'T', 0x78, 0x01 });
+
+		uint32_t adler = 1;
+
+		for (uint32_t i = 0; i < num_stripes; ++i)
+		{
+			const png_stripe &stripe = stripes[i];
+
+			// Every stripe starts on a byte boundary (see below), so its stream can be copied as is, including any stored blocks, which need to be byte aligned relative to the start of the stream
+			const size_t num_bytes = (stripe.end_position + 7) / 8;
+			const uint32_t remaining_bits = stripe.end_position % 8;
+
+			encoded_data.insert(encoded_data.end(), stripe.deflate_data.data(), stripe.deflate_data.data() + num_bytes);
+			if (remaining_bits != 0)
+				encoded_data.back() &= (1 << remaining_bits) - 1;
+
+			if (i != num_stripes - 1)
+			{
+				// Clear the final block flag on all but the last stripe, so that decoding continues with the next stripe
+				const size_t final_block_offset = encoded_data.size() - num_bytes + stripe.final_block_position / 8;
+				encoded_data[final_block_offset] &= ~(1 << (stripe.final_block_position % 8));
+
+				// Terminate the stripe with an empty stored block, which pads the stream to the next byte boundary
+				// Its 3 header bits (not final, stored) are zero, so they fit into the unused bits of the last byte or need one more byte, followed by the zero length and its complement
+				if (remaining_bits == 0 || remaining_bits > 5)
+					encoded_data.push_back(0);
+				encoded_data.insert(encoded_data.end(), { 0x00, 0x00, 0xFF, 0xFF });
+			}
+
+			const size_t stripe_data_size = (row_pitch + 1) * std::min(stripe_height, height - i * stripe_height);
+			adler = combine_adler32(adler, stripe.adler, stripe_data_size);
+		}
+
+		write_be32(encoded_data, adler);
+
+		const uint32_t chunk_size = static_cast<uint32_t>(encoded_data.size() - chunk_offset - 8);
+		encoded_data[chunk_offset + 0] = (chunk_size >> 24) & 0xFF;
+		encoded_data[chunk_offset + 1] = (chunk_size >> 16) & 0xFF;
+		encoded_data[chunk_offset + 2] = (chunk_size >> 8) & 0xFF;
+		encoded_data[chunk_offset + 3] = chunk_size & 0xFF;
+		write_be32(encoded_data, calc_crc32(encoded_data.data() + chunk_offset + 4, 4 + chunk_size) ^ 0xFFFFFFFF);
+	}
+
+	// Write end chunk
+	write_be32(encoded_data, 0);
+	encoded_data.insert(encoded_data.end(), { 'I', 'E', 'N', 'D' });
+	write_be32(encoded_data, calc_crc32(encoded_data.data() + encoded_data.size() - 4, 4) ^ 0xFFFFFFFF);
+
+	return true;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+
+namespace reshade
+{
+	/// <summary>
+	/// Encodes 8-bit RGB or RGBA images into PNG files in memory.
+	/// Large images are split into horizontal stripes that are compressed on multiple threads and then stitched together into a single valid PNG.
+	/// The threads are created on first use and kept around for later images, until the encoder is destroyed.
+	/// </summary>
+	class png_encoder
+	{
+	public:
+		/// <summary>
+		/// Creates an encoder without starting any threads yet.
+		/// </summary>
+		/// <param name="max_threads">Maximum number of threads to encode stripes of an image on (including the calling thread), or zero to use as many as there are hardware threads.</param>
+		explicit png_encoder(uint32_t max_threads = 0);
+		/// <summary>
+		/// Stops all threads of this encoder. Must not be called while an image is still being encoded.
+		/// </summary>
+		~png_encoder();
+
+		png_encoder(const png_encoder &) = delete;
+		png_encoder &operator=(const png_encoder &) = delete;
+
+		/// <summary>
+		/// Encodes an image into a PNG file in memory. This may be called from multiple threads concurrently, in which case they share the threads of this encoder.
+		/// </summary>
+		/// <param name="pixels">Pointer to the tightly packed image data.</param>
+		/// <param name="width">Width of the image in pixels.</param>
+		/// <param name="height">Height of the image in pixels.</param>
+		/// <param name="num_channels">Number of channels per pixel (3 or 4).</param>
+		/// <param name="encoded_data">Vector that is filled with the encoded PNG file.</param>
+		/// <returns><see langword="true"/> if the image was successfully encoded, <see langword="false"/> otherwise.</returns>
+		bool encode(const void *pixels, uint32_t width, uint32_t height, uint32_t num_channels, std::vector<uint8_t> &encoded_data);
+
+	private:
+		struct encode_job;
+
+		void worker_main();
+		void run_task(std::unique_lock<std::mutex> &lock);
+
+		const uint32_t _max_threads;
+		std::mutex _mutex;
+		std::condition_variable _task_available;
+		std::condition_variable _task_finished;
+		// Stripes waiting to be encoded, identified by the image they belong to and their index in it
+		std::deque<std::pair<encode_job *, uint32_t>> _tasks;
+		std::vector<std::thread> _threads;
+		bool _exit = false;
+	};
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "preset_library.hpp"
+#include "dll_log.hpp"
+#include "ini_file.hpp"
+#include <limits>
+#include <algorithm>
+#include <Windows.h>
+
+static std::wstring make_index_key(const std::filesystem::path &path)
+{
+	// Paths are case-insensitive on Windows, so normalize them for lookup
+	std::wstring key = path.native();
+	std::transform(key.begin(), key.end(), key.begin(), towlower);
+	return key;
+}
+
+// Keep the index of a few directories around, so that switching between them (e.g. via preset shortcuts) does not require scanning them again
+static constexpr size_t max_indexed_directories = 8;
+
+reshade::preset_library::~preset_library()
+{
+	{
+		const std::unique_lock<std::mutex> lock(_scan_mutex);
+		_cancel_scan = true;
+	}
+
+	if (_scan_thread.joinable())
+		_scan_thread.join();
+
+	for (const auto &[key, index] : _directories)
+		if (index->change_notification != nullptr)
+			FindCloseChangeNotification(index->change_notification);
+}
+
+void reshade::preset_library::add_directory(const std::filesystem::path &directory)
+{
+	const std::unique_lock<std::mutex> lock(_scan_mutex);
+
+	std::shared_ptr<directory_index> &index = _directories[make_index_key(directory)];
+	if (index != nullptr)
+	{
+		index->last_used = ++_use_counter;
+		return;
+	}
+
+	index = std::make_shared<directory_index>();
+	index->path = directory;
+	index->last_used = ++_use_counter;
+
+	// Get notified about files being added, removed, renamed or written to, so that the index can be updated incrementally
+	index->change_notification = FindFirstChangeNotificationW(directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+	if (index->change_notification == INVALID_HANDLE_VALUE)
+		index->change_notification = nullptr;
+
+	index->scan_pending = true;
+
+	// Forget about the least recently used directory once there are too many (a scan that is still running on it keeps it alive until done)
+	if (_directories.size() > max_indexed_directories)
+	{
+		const auto lru_it = std::min_element(_directories.begin(), _directories.end(),
+			[](const auto &lhs, const auto &rhs) { return lhs.second->last_used < rhs.second->last_used; });
+
+		if (lru_it->second->change_notification != nullptr)
+			FindCloseChangeNotification(lru_it->second->change_notification);
+		lru_it->second->change_notification = nullptr;
+		lru_it->second->scan_pending = false;
+
+		_directories.erase(lru_it);
+	}
+
+	start_scan();
+}
+
+void reshade::preset_library::update()
+{
+	const std::unique_lock<std::mutex> lock(_scan_mutex);
+
+	bool changed = false;
+	for (const auto &[key, index] : _directories)
+	{
+		if (index->change_notification == nullptr || WaitForSingleObject(index->change_notification, 0) != WAIT_OBJECT_0)
+			continue;
+
+		FindNextChangeNotification(index->change_notification);
+
+		index->scan_pending = true;
+		changed = true;
+	}
+
+	if (changed)
+		start_scan();
+}
+
+bool reshade::preset_library::is_scanning() const
+{
+	const std::unique_lock<std::mutex> lock(_scan_mutex);
+
+	return _scan_running;
+}
+bool reshade::preset_library::is_indexed(const std::filesystem::path &directory) const
+{
+	const std::unique_lock<std::mutex> lock(_scan_mutex);
+
+	const auto it = _directories.find(make_index_key(directory));
+	return it != _directories.end() && it->second->scan_completed;
+}
+
+bool reshade::preset_library::contains(const std::filesystem::path &path) const
+{
+	const std::shared_ptr<const directory_index> index = find_index(path.parent_path());
+	if (index == nullptr)
+		return false;
+
+	const std::shared_lock<std::shared_mutex> lock(_presets_mutex);
+
+	return index->preset_indices.find(make_index_key(path)) != index->preset_indices.end();
+}
+
+bool reshade::preset_library::find_next(const std::filesystem::path &directory, const std::filesystem::path &current_path, const std::wstring &filter_text, bool reversed, std::filesystem::path &next_path) const
+{
+	const std::shared_ptr<const directory_index> index = find_index(directory);
+	if (index == nullptr)
+		return false;
+
+	const std::shared_lock<std::shared_mutex> lock(_presets_mutex);
+
+	const std::vector<preset> &presets = index->presets;
+	if (presets.empty())
+		return false; // No valid preset files were found, so nothing more to do
+
+	const auto matches_filter = [&filter_text](const preset &preset) {
+		if (filter_text.empty())
+			return true;
+		const std::wstring preset_name = preset.path.stem();
+		return std::search(preset_name.cbegin(), preset_name.cend(), filter_text.cbegin(), filter_text.cend(),
+			[](auto c1, auto c2) { return towlower(c1) == towlower(c2); }) != preset_name.cend();
+	};
+
+	const size_t num_presets = presets.size();
+
+	size_t current_index = std::numeric_limits<size_t>::max();
+	if (const auto it = index->preset_indices.find(make_index_key(current_path));
+		it != index->preset_indices.end())
+	{
+		current_index = it->second;
+	}
+	else
+	{
+		// The current path may refer to one of the presets in a different way (e.g. through a link or with a relative path), so compare the actual files as a fallback
+		std::error_code ec;
+		for (size_t i = 0; i < num_presets && current_index == std::numeric_limits<size_t>::max(); ++i)
+			if (std::filesystem::equivalent(presets[i].path, current_path, ec))
+				current_index = i;
+	}
+
+	if (current_index != std::numeric_limits<size_t>::max())
+	{
+		// Current preset was found in the index, so use the matching file before or after it
+		for (size_t offset = 1; offset < num_presets; ++offset)
+		{
+			const preset &preset = presets[reversed ? (current_index + num_presets - offset) % num_presets : (current_index + offset) % num_presets];
+			if (matches_filter(preset))
+			{
+				next_path = preset.path;
+				return true;
+			}
+		}
+
+		// Current preset is the only one matching the filter
+		next_path = presets[current_index].path;
+		return true;
+	}
+	else
+	{
+		// Current preset was not in the index, so just use the first or last matching file
+		for (size_t offset = 0; offset < num_presets; ++offset)
+		{
+			const preset &preset = presets[reversed ? num_presets - 1 - offset : offset];
+			if (matches_filter(preset))
+			{
+				next_path = preset.path;
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+std::shared_ptr<const reshade::preset_library::directory_index> reshade::preset_library::find_index(const std::filesystem::path &directory) const
+{
+	const std::unique_lock<std::mutex> lock(_scan_mutex);
+
+	// Never wait for a scan here, a directory that was not scanned yet is simply not part of the index
+	if (const auto it = _directories.find(make_index_key(directory));
+		it != _directories.end() && it->second->scan_completed)
+		return it->second;
+	return nullptr;
+}
+
+void reshade::preset_library::start_scan()
+{
+	// Expects '_scan_mutex' to be locked by the caller
+	// A running scan will pick up pending directories once it is done with the current one
+	if (_scan_running)
+		return;
+
+	if (_scan_thread.joinable())
+		_scan_thread.join();
+
+	_scan_running = true;
+	_scan_thread = std::thread(&preset_library::scan_thread_main, this);
+}
+
+void reshade::preset_library::scan_thread_main()
+{
+	std::unique_lock<std::mutex> lock(_scan_mutex);
+
+	while (!_cancel_scan)
+	{
+		const auto pending_it = std::find_if(_directories.begin(), _directories.end(),
+			[](const auto &entry) { return entry.second->scan_pending; });
+		if (pending_it == _directories.end())
+			break;
+
+		// Hold on to the index, in case the directory is removed from the library while it is being scanned
+		const std::shared_ptr<directory_index> index = pending_it->second;
+		index->scan_pending = false;
+		const std::filesystem::path directory = index->path;
+
+		lock.unlock();
+
+		// Keep existing entries around, so that files which did not change since the last scan do not have to be parsed again
+		std::unordered_map<std::wstring, preset> previous_presets;
+		{
+			const std::shared_lock<std::shared_mutex> presets_lock(_presets_mutex);
+
+			for (const preset &preset : index->presets)
+				previous_presets.emplace(make_index_key(preset.path), preset);
+		}
+
+		std::vector<preset> presets;
+		size_t num_parsed_presets = 0;
+
+		std::error_code ec; // This is here to ignore file system errors below
+		for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, ec))
+		{
+			if (_cancel_scan)
+				break;
+
+			// First make sure the extension matches, before diving into the file system
+			if (const std::filesystem::path ext = entry.path().extension();
+				ext != L".ini" && ext != L".txt")
+				continue;
+
+			if (!entry.is_regular_file(ec))
+				continue;
+
+			// Directory iteration caches the file attributes, so this does not have to query the file system again
+			const std::filesystem::file_time_type modified_at = entry.last_write_time(ec);
+			if (ec)
+				continue;
+
+			if (const auto it = previous_presets.find(make_index_key(entry.path()));
+				it != previous_presets.end() && it->second.modified_at == modified_at)
+			{
+				presets.push_back(std::move(it->second));
+				continue;
+			}
+
+			// Do not use the INI cache here, to avoid keeping every file in the directory in memory
+			const ini_file preset_file(entry.path());
+			num_parsed_presets++;
+
+			// Ensure the file has a technique list, which should make it a preset
+			std::vector<std::string> techniques;
+			if (!preset_file.get({}, "Techniques", techniques))
+				continue;
+
+			preset &preset = presets.emplace_back();
+			preset.path = entry.path();
+			preset.modified_at = modified_at;
+
+			for (const std::string &technique : techniques)
+			{
+				if (const size_t at_pos = technique.find('@');
+					at_pos != std::string::npos)
+				{
+					std::string effect_file = technique.substr(at_pos + 1);
+					if (std::find(preset.effect_files.cbegin(), preset.effect_files.cend(), effect_file) == preset.effect_files.cend())
+						preset.effect_files.push_back(std::move(effect_file));
+				}
+			}
+
+			preset.techniques = std::move(techniques);
+		}
+
+		std::sort(presets.begin(), presets.end(),
+			[](const preset &lhs, const preset &rhs) { return lhs.path < rhs.path; });
+
+		lock.lock();
+
+		if (_cancel_scan)
+			break;
+
+		LOG(DEBUG) << "Indexed " << presets.size() << " presets in " << directory << " (parsed " << num_parsed_presets << " files).";
+
+		{
+			const std::unique_lock<std::shared_mutex> presets_lock(_presets_mutex);
+
+			index->presets = std::move(presets);
+			index->preset_indices.clear();
+			index->preset_indices.reserve(index->presets.size());
+			for (size_t i = 0; i < index->presets.size(); ++i)
+				index->preset_indices.emplace(make_index_key(index->presets[i].path), i);
+		}
+
+		index->scan_completed = true;
+	}
+
+	_scan_running = false;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace reshade
+{
+	/// <summary>
+	/// Index of all the presets in a few recently used directories, which is built and kept up to date on a background thread.
+	/// This avoids having to open every candidate preset file on the calling thread when e.g. cycling through presets or browsing for one.
+	/// </summary>
+	class preset_library
+	{
+	public:
+		/// <summary>
+		/// Describes a single valid preset file found in an indexed directory.
+		/// </summary>
+		struct preset
+		{
+			std::filesystem::path path;
+			std::filesystem::file_time_type modified_at;
+			std::vector<std::string> techniques;
+			std::vector<std::string> effect_files;
+		};
+
+		preset_library() = default;
+		~preset_library();
+
+		preset_library(const preset_library &) = delete;
+		preset_library &operator=(const preset_library &) = delete;
+
+		/// <summary>
+		/// Adds a directory to the index and starts scanning it in the background.
+		/// Only marks the directory as recently used if it is already indexed, in which case the existing index is kept.
+		/// </summary>
+		/// <param name="directory">Absolute path to the directory containing preset files.</param>
+		void add_directory(const std::filesystem::path &directory);
+
+		/// <summary>
+		/// Checks whether any of the indexed directories changed on disk and if so starts an incremental rescan of them in the background.
+		/// </summary>
+		void update();
+
+		/// <summary>
+		/// Gets a boolean indicating whether a background scan is currently in progress.
+		/// </summary>
+		bool is_scanning() const;
+		/// <summary>
+		/// Gets a boolean indicating whether the specified <paramref name="directory"/> was scanned at least once, so that its index can be used.
+		/// </summary>
+		bool is_indexed(const std::filesystem::path &directory) const;
+
+		/// <summary>
+		/// Checks whether the specified <paramref name="path"/> is a valid preset file in the index of its directory.
+		/// </summary>
+		bool contains(const std::filesystem::path &path) const;
+
+		/// <summary>
+		/// Finds the preset that follows (or precedes if <paramref name="reversed"/> is <see langword="true"/>) the specified <paramref name="current_path"/> in the index of the specified <paramref name="directory"/>.
+		/// Only presets whose name contains the <paramref name="filter_text"/> are considered, with the exception of the current one.
+		/// This never waits for a scan, so fails if the directory was not indexed yet (see <see cref="is_indexed"/>).
+		/// </summary>
+		/// <param name="next_path">Path that is set to the found preset file.</param>
+		/// <returns><see langword="true"/> if a preset was found, <see langword="false"/> if there are no matching presets or the directory was not indexed yet.</returns>
+		bool find_next(const std::filesystem::path &directory, const std::filesystem::path &current_path, const std::wstring &filter_text, bool reversed, std::filesystem::path &next_path) const;
+
+	private:
+		struct directory_index
+		{
+			std::filesystem::path path;
+			void *change_notification = nullptr;
+			uint64_t last_used = 0;
+			bool scan_pending = false;
+			bool scan_completed = false;
+
+			// Only accessed while holding '_presets_mutex'
+			std::vector<preset> presets;
+			std::unordered_map<std::wstring, size_t> preset_indices;
+		};
+
+		std::shared_ptr<const directory_index> find_index(const std::filesystem::path &directory) const;
+
+		void start_scan();
+		void scan_thread_main();
+
+		mutable std::mutex _scan_mutex;
+		std::thread _scan_thread;
+		bool _scan_running = false;
+		std::atomic<bool> _cancel_scan = false;
+		uint64_t _use_counter = 0;
+		std::unordered_map<std::wstring, std::shared_ptr<directory_index>> _directories;
+
+		mutable std::shared_mutex _presets_mutex;
+	};
+}
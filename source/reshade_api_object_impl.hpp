@@ -6,8 +6,12 @@
 #pragma once
 
 #include "reshade_api_device.hpp"
+#include <mutex>
+#include <atomic>
 #include <vector>
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 
 namespace reshade
 {
@@ -21,6 +25,89 @@ namespace reshade
 
 namespace reshade::api
 {
+	/// <summary>
+	/// Process-wide registry that assigns each private data GUID a small integer slot the first time it is used.
+	/// Lookups are lock-free, only registering a new GUID takes a lock.
+	/// </summary>
+	class private_data_slots
+	{
+	public:
+		static constexpr uint32_t invalid_slot = 0xFFFFFFFF;
+		static constexpr uint32_t max_slots = 1024;
+
+		static uint32_t find(const uint8_t guid[16])
+		{
+			uint64_t key[2];
+			std::memcpy(key, guid, 16);
+
+			for (size_t i = 0, index = hash(key); i < max_guids; ++i, index = (index + 1) % max_guids)
+			{
+				const entry &entry = s_entries[index];
+
+				// Slot is published last with release semantics, so the GUID is visible once it is non-zero
+				const uint32_t slot_plus_one = entry.slot_plus_one.load(std::memory_order_acquire);
+				if (slot_plus_one == 0)
+					break;
+				if (entry.guid[0] == key[0] && entry.guid[1] == key[1])
+					return slot_plus_one - 1;
+			}
+
+			return invalid_slot;
+		}
+		static uint32_t find_or_register(const uint8_t guid[16])
+		{
+			if (const uint32_t slot = find(guid);
+				slot != invalid_slot)
+				return slot;
+
+			uint64_t key[2];
+			std::memcpy(key, guid, 16);
+
+			const std::unique_lock<std::mutex> lock(s_mutex);
+
+			for (size_t i = 0, index = hash(key); i < max_guids; ++i, index = (index + 1) % max_guids)
+			{
+				entry &entry = s_entries[index];
+
+				if (const uint32_t slot_plus_one = entry.slot_plus_one.load(std::memory_order_relaxed);
+					slot_plus_one != 0)
+				{
+					// Another thread may have registered the same GUID in the meantime
+					if (entry.guid[0] == key[0] && entry.guid[1] == key[1])
+						return slot_plus_one - 1;
+					continue;
+				}
+
+				entry.guid[0] = key[0];
+				entry.guid[1] = key[1];
+				entry.slot_plus_one.store(++s_num_slots, std::memory_order_release);
+				return s_num_slots - 1;
+			}
+
+			assert(false); // Ran out of GUID entries
+			return invalid_slot;
+		}
+
+	private:
+		static constexpr size_t max_guids = max_slots;
+
+		struct entry
+		{
+			uint64_t guid[2];
+			std::atomic<uint32_t> slot_plus_one;
+		};
+
+		static size_t hash(const uint64_t key[2])
+		{
+			const uint64_t h = (key[0] ^ key[1]) * 0x9E3779B97F4A7C15ull;
+			return static_cast<size_t>(h >> 32) % max_guids;
+		}
+
+		static inline std::mutex s_mutex;
+		static inline uint32_t s_num_slots = 0;
+		static inline entry s_entries[max_guids] = {};
+	};
+
 	template <typename T, typename... api_object_base>
 	class api_object_impl : public api_object_base...
 	{
@@ -34,36 +121,44 @@ namespace reshade::api
 		{
 			assert(data != nullptr);
 
-			for (auto it = _private_data.begin(); it != _private_data.end(); ++it)
-			{
-				if (std::memcmp(it->guid, guid, 16) == 0)
-				{
-					*data = it->data;
-					return;
-				}
-			}
-
-			*data = 0;
+			const uint32_t slot = private_data_slots::find(guid);
+			if (slot < num_inline_slots)
+				*data = _private_data[slot].load(std::memory_order_acquire);
+			else if (const std::atomic<uint64_t> *const overflow = _private_data_overflow.load(std::memory_order_acquire);
+				slot != private_data_slots::invalid_slot && overflow != nullptr)
+				*data = overflow[slot - num_inline_slots].load(std::memory_order_acquire);
+			else
+				*data = 0;
 		}
 		void set_private_data(const uint8_t guid[16], const uint64_t data)  final
 		{
-			for (auto it = _private_data.begin(); it != _private_data.end(); ++it)
+			// Avoid registering a slot just to clear data that was never set
+			const uint32_t slot = data != 0 ? private_data_slots::find_or_register(guid) : private_data_slots::find(guid);
+			if (slot == private_data_slots::invalid_slot)
+				return;
+
+			if (slot < num_inline_slots)
+			{
+				_private_data[slot].store(data, std::memory_order_release);
+			}
+			else
 			{
-				if (std::memcmp(it->guid, guid, 16) == 0)
+				std::atomic<uint64_t> *overflow = _private_data_overflow.load(std::memory_order_acquire);
+				if (overflow == nullptr)
 				{
-					if (data != 0)
-						it->data = data;
+					if (data == 0)
+						return;
+
+					// The overflow slots are allocated once with room for all possible slots and never resized, so that concurrent readers never see them move
+					// Another thread may have allocated them in the meantime, in which case its array is used
+					std::atomic<uint64_t> *const new_overflow = new std::atomic<uint64_t>[num_overflow_slots]();
+					if (_private_data_overflow.compare_exchange_strong(overflow, new_overflow, std::memory_order_acq_rel, std::memory_order_acquire))
+						overflow = new_overflow;
 					else
-						_private_data.erase(it);
-					return;
+						delete[] new_overflow;
 				}
-			}
 
-			if (data != 0)
-			{
-				_private_data.push_back({ data, {
-					reinterpret_cast<const uint64_t *>(guid)[0],
-					reinterpret_cast<const uint64_t *>(guid)[1] } });
+				overflow[slot - num_inline_slots].store(data, std::memory_order_release);
 			}
 		}
 
@@ -77,17 +172,23 @@ namespace reshade::api
 		~api_object_impl()
 		{
 			// All user data should ideally have been removed before destruction, to avoid leaks
-			assert(_private_data.empty());
+			assert(std::all_of(std::begin(_private_data), std::end(_private_data), [](const std::atomic<uint64_t> &data) { return data.load(std::memory_order_relaxed) == 0; }));
+
+			if (std::atomic<uint64_t> *const overflow = _private_data_overflow.load(std::memory_order_relaxed);
+				overflow != nullptr)
+			{
+				assert(std::all_of(overflow, overflow + num_overflow_slots, [](const std::atomic<uint64_t> &data) { return data.load(std::memory_order_relaxed) == 0; }));
+				delete[] overflow;
+			}
 		}
 
 	private:
-		struct private_data
-		{
-			uint64_t data;
-			uint64_t guid[2];
-		};
+		// The first few slots are stored inline, which covers all GUIDs in typical setups with a handful of add-ons
+		static constexpr uint32_t num_inline_slots = 8;
+		static constexpr uint32_t num_overflow_slots = private_data_slots::max_slots - num_inline_slots;
 
-		std::vector<private_data> _private_data;
+		std::atomic<uint64_t> _private_data[num_inline_slots] = {};
+		std::atomic<std::atomic<uint64_t> *> _private_data_overflow = nullptr;
 	};
 }
 
@@ -18,11 +18,15 @@
 #include "com_ptr.hpp"
 #include "platform_utils.hpp"
 #include "reshade_api_object_impl.hpp"
+#include "reshade_api_format_convert.hpp"
+#include "png_encoder.hpp"
+#include "frame_dump.hpp"
 #include <set>
 #include <thread>
 #include <cctype>
 #include <cstring>
 #include <fstream>
+#include <charconv>
 #include <algorithm>
 #include <numeric>
 #include <fpng.h>
@@ -211,6 +215,30 @@ static inline int format_color_bit_depth(reshade::api::format value)
 }
 #endif
 
+static void strip_alpha_channel(uint8_t *pixels, size_t num_pixels)
+{
+	// Pack four RGBA pixels into three RGB words at a time, which avoids the overlapping unaligned stores of a per-pixel loop
+	size_t i = 0;
+	for (; i + 4 <= num_pixels; i += 4)
+	{
+		uint32_t p[4];
+		std::memcpy(p, pixels + 4 * i, sizeof(p));
+
+		const uint32_t packed[3] = {
+			(p[0] & 0xFFFFFF) | (p[1] << 24),
+			((p[1] >> 8) & 0xFFFF) | (p[2] << 16),
+			((p[2] >> 16) & 0xFF) | (p[3] << 8)
+		};
+		std::memcpy(pixels + 3 * i, packed, sizeof(packed));
+	}
+	for (; i < num_pixels; ++i)
+	{
+		pixels[3 * i + 0] = pixels[4 * i + 0];
+		pixels[3 * i + 1] = pixels[4 * i + 1];
+		pixels[3 * i + 2] = pixels[4 * i + 2];
+	}
+}
+
 static std::shared_mutex s_runtime_config_names_mutex;
 static std::unordered_set<std::string> s_runtime_config_names;
 
@@ -288,7 +316,8 @@ reshade::runtime::runtime(api::swapchain *swapchain, api::command_queue *graphic
 	_screenshot_path(L".\\"),
 	_screenshot_name("%AppName% %Date% %Time%"),
 	_screenshot_post_save_command_arguments("\"%TargetPath%\""),
-	_screenshot_post_save_command_working_directory(L".\\")
+	_screenshot_post_save_command_working_directory(L".\\"),
+	_png_encoder(std::make_unique<png_encoder>())
 {
 	assert(swapchain != nullptr && graphics_queue != nullptr);
 
@@ -308,6 +337,7 @@ reshade::runtime::runtime(api::swapchain *swapchain, api::command_queue *graphic
 		_renderer_id |= 0x10000;
 		break;
 	case api::device_api::vulkan:
+	case api::device_api::null: // Compile effects to SPIR-V like on Vulkan, which does not need an external shader compiler
 		_renderer_id |= 0x20000;
 		break;
 	}
@@ -624,6 +654,10 @@ void reshade::runtime::on_reset()
 	else
 		return; // Nothing to do if the runtime was already destroyed or not successfully initialized in the first place
 
+	// Finish saving any screenshots and dumped frames that are still in flight
+	process_pending_screenshots(true);
+	stop_frame_dump();
+
 #if RESHADE_FX
 	// Already performs a wait for idle, so no need to do it again before destroying resources below
 	destroy_effects();
@@ -673,6 +707,12 @@ void reshade::runtime::on_reset()
 	_device->destroy_fence(_queue_sync_fence);
 	_queue_sync_fence = {};
 
+	for (const api::resource readback_texture : _readback_textures)
+		_device->destroy_resource(readback_texture);
+	_readback_textures.clear();
+	_device->destroy_fence(_readback_fence);
+	_readback_fence = {};
+
 	_width = _height = 0;
 
 #if RESHADE_GUI
@@ -723,6 +763,12 @@ void reshade::runtime::on_present(api::command_queue *present_queue)
 	_block_effect_reload_this_frame = false;
 #endif
 
+	// Read back screenshots taken in previous frames that the GPU has finished copying by now
+	if (!_pending_screenshots.empty())
+		process_pending_screenshots(false);
+	if (!_pending_frame_dumps.empty())
+		process_pending_frame_dumps(std::numeric_limits<size_t>::max());
+
 	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
 
 	capture_state(cmd_list, _app_state);
@@ -771,9 +817,13 @@ void reshade::runtime::on_present(api::command_queue *present_queue)
 	if (_should_save_screenshot)
 		save_screenshot();
 
+	if (_frame_dump != nullptr)
+		capture_frame_dump();
+
 	_frame_count++;
 	const auto current_time = std::chrono::high_resolution_clock::now();
 	_last_frame_duration = current_time - _last_present_time; _last_present_time = current_time;
+	_frame_time_statistics.append(std::chrono::duration_cast<std::chrono::nanoseconds>(_last_frame_duration).count());
 
 #ifdef NDEBUG
 	// Lock input so it cannot be modified by other threads while we are reading it here
@@ -813,6 +863,14 @@ void reshade::runtime::on_present(api::command_queue *present_queue)
 			_should_save_screenshot = true; // Remember that we want to save a screenshot next frame
 		}
 
+		if (_input->is_key_pressed(_frame_dump_key_data, _force_shortcut_modifiers))
+		{
+			if (_frame_dump != nullptr)
+				stop_frame_dump();
+			else
+				start_frame_dump();
+		}
+
 #if RESHADE_FX
 		// Do not allow the following shortcuts while effects are being loaded or initialized (since they affect that state)
 		if (!is_loading())
@@ -987,6 +1045,7 @@ void reshade::runtime::load_config()
 	};
 
 	config_get("INPUT", "ForceShortcutModifiers", _force_shortcut_modifiers);
+	config_get("INPUT", "KeyFrameDump", _frame_dump_key_data);
 	config_get("INPUT", "KeyScreenshot", _screenshot_key_data);
 #if RESHADE_FX
 	config_get("INPUT", "KeyEffects", _effects_key_data);
@@ -1027,6 +1086,9 @@ void reshade::runtime::load_config()
 	else if (!resolve_preset_path(_current_preset_path, ec))
 		_current_preset_path = g_reshade_base_path / L"ReShadePreset.ini";
 
+	// Start indexing the presets next to the current one early, so that the index is ready by the time the user wants to switch presets
+	_preset_library.add_directory(_current_preset_path.parent_path());
+
 	std::vector<unsigned int> preset_key_data;
 	std::vector<std::filesystem::path> preset_shortcut_paths;
 	config_get("GENERAL", "PresetShortcutKeys", preset_key_data);
@@ -1038,6 +1100,18 @@ void reshade::runtime::load_config()
 		preset_shortcut shortcut;
 		shortcut.preset_path = preset_shortcut_paths[i];
 		std::copy_n(&preset_key_data[i * 4], 4, shortcut.key_data);
+
+		// Shortcuts may cycle through the presets in a directory too, so index those early as well
+		if (std::filesystem::path shortcut_path = shortcut.preset_path; resolve_path(shortcut_path, ec))
+		{
+			if (std::filesystem::is_directory(shortcut_path, ec))
+				_preset_library.add_directory(shortcut_path);
+		}
+		else if (shortcut_path.has_filename())
+		{
+			_preset_library.add_directory(shortcut_path.parent_path());
+		}
+
 		_preset_shortcuts.push_back(std::move(shortcut));
 	}
 #endif
@@ -1048,6 +1122,7 @@ void reshade::runtime::load_config()
 	config_get("SCREENSHOT", "FileFormat", _screenshot_format);
 	config_get("SCREENSHOT", "FileNaming", _screenshot_name);
 	config_get("SCREENSHOT", "JPEGQuality", _screenshot_jpeg_quality);
+	config_get("SCREENSHOT", "FrameDumpCompression", _frame_dump_compression);
 #if RESHADE_FX
 	config_get("SCREENSHOT", "SaveBeforeShot", _screenshot_save_before);
 	config_get("SCREENSHOT", "SavePresetFile", _screenshot_include_preset);
@@ -1069,6 +1144,7 @@ void reshade::runtime::save_config() const
 	ini_file &config = ini_file::load_cache(_config_path);
 
 	config.set("INPUT", "ForceShortcutModifiers", _force_shortcut_modifiers);
+	config.set("INPUT", "KeyFrameDump", _frame_dump_key_data);
 	config.set("INPUT", "KeyScreenshot", _screenshot_key_data);
 #if RESHADE_FX
 	config.set("INPUT", "KeyEffects", _effects_key_data);
@@ -1116,6 +1192,7 @@ void reshade::runtime::save_config() const
 	config.set("SCREENSHOT", "FileFormat", _screenshot_format);
 	config.set("SCREENSHOT", "FileNaming", _screenshot_name);
 	config.set("SCREENSHOT", "JPEGQuality", _screenshot_jpeg_quality);
+	config.set("SCREENSHOT", "FrameDumpCompression", _frame_dump_compression);
 #if RESHADE_FX
 	config.set("SCREENSHOT", "SaveBeforeShot", _screenshot_save_before);
 	config.set("SCREENSHOT", "SavePresetFile", _screenshot_include_preset);
@@ -1431,49 +1508,62 @@ bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path,
 		}
 	}
 
-	size_t current_preset_index = std::numeric_limits<size_t>::max();
-	std::vector<std::filesystem::path> preset_paths;
+	// Look up the preset in the index of the directory instead of opening every file in it, which is rebuilt in the background when the directory changes
+	_preset_library.add_directory(filter_path);
+	_preset_library.update();
 
-	for (std::filesystem::path preset_path : std::filesystem::directory_iterator(filter_path, std::filesystem::directory_options::skip_permission_denied, ec))
+	if (_preset_library.is_indexed(filter_path))
 	{
-		// Skip anything that is not a valid preset file
-		if (!resolve_preset_path(preset_path, ec))
-			continue;
+		if (!_preset_library.find_next(filter_path, _current_preset_path, filter_text.native(), reversed, _current_preset_path))
+			return false; // No valid preset files were found, so nothing more to do
+	}
+	else
+	{
+		// The background scan of the directory has not finished yet, so look through it here instead of waiting for that
+		size_t current_preset_index = std::numeric_limits<size_t>::max();
+		std::vector<std::filesystem::path> preset_paths;
 
-		// Keep track of the index of the current preset in the list of found preset files that is being build
-		if (std::filesystem::equivalent(preset_path, _current_preset_path, ec))
+		for (std::filesystem::path preset_path : std::filesystem::directory_iterator(filter_path, std::filesystem::directory_options::skip_permission_denied, ec))
 		{
-			current_preset_index = preset_paths.size();
-			preset_paths.push_back(std::move(preset_path));
-			continue;
-		}
+			// Skip anything that is not a valid preset file
+			if (!resolve_preset_path(preset_path, ec))
+				continue;
 
-		const std::wstring preset_name = preset_path.stem();
-		// Only add those files that are matching the filter text
-		if (filter_text.empty() ||
-			std::search(preset_name.cbegin(), preset_name.cend(), filter_text.native().begin(), filter_text.native().end(),
-				[](auto c1, auto c2) { return towlower(c1) == towlower(c2); }) != preset_name.cend())
-			preset_paths.push_back(std::move(preset_path));
-	}
+			// Keep track of the index of the current preset in the list of found preset files that is being build
+			if (std::filesystem::equivalent(preset_path, _current_preset_path, ec))
+			{
+				current_preset_index = preset_paths.size();
+				preset_paths.push_back(std::move(preset_path));
+				continue;
+			}
 
-	if (preset_paths.empty())
-		return false; // No valid preset files were found, so nothing more to do
+			const std::wstring preset_name = preset_path.stem();
+			// Only add those files that are matching the filter text
+			if (filter_text.empty() ||
+				std::search(preset_name.cbegin(), preset_name.cend(), filter_text.native().begin(), filter_text.native().end(),
+					[](auto c1, auto c2) { return towlower(c1) == towlower(c2); }) != preset_name.cend())
+				preset_paths.push_back(std::move(preset_path));
+		}
 
-	if (current_preset_index == std::numeric_limits<size_t>::max())
-	{
-		// Current preset was not in the filter path, so just use the first or last file
-		if (reversed)
-			_current_preset_path = preset_paths.back();
-		else
-			_current_preset_path = preset_paths.front();
-	}
-	else
-	{
-		// Current preset was found in the filter path, so use the file before or after it
-		if (auto it = std::next(preset_paths.begin(), current_preset_index); reversed)
-			_current_preset_path = (it == preset_paths.begin()) ? preset_paths.back() : *(--it);
+		if (preset_paths.empty())
+			return false; // No valid preset files were found, so nothing more to do
+
+		if (current_preset_index == std::numeric_limits<size_t>::max())
+		{
+			// Current preset was not in the filter path, so just use the first or last file
+			if (reversed)
+				_current_preset_path = preset_paths.back();
+			else
+				_current_preset_path = preset_paths.front();
+		}
 		else
-			_current_preset_path = (it == std::prev(preset_paths.end())) ? preset_paths.front() : *(++it);
+		{
+			// Current preset was found in the filter path, so use the file before or after it
+			if (auto it = std::next(preset_paths.begin(), current_preset_index); reversed)
+				_current_preset_path = (it == preset_paths.begin()) ? preset_paths.back() : *(--it);
+			else
+				_current_preset_path = (it == std::prev(preset_paths.end())) ? preset_paths.front() : *(++it);
+		}
 	}
 
 	_last_preset_switching_time = _last_present_time;
@@ -2357,9 +2447,22 @@ bool reshade::runtime::create_effect(size_t effect_index)
 		spec_constants.push_back(id);
 	}
 
-	// Create optional query heap for time measurements
-	if (!_device->create_query_heap(api::query_type::timestamp, static_cast<uint32_t>(effect.module.techniques.size() * 2 * 4), &effect.query_heap))
+	// Create optional query heaps for time measurements, with a timestamp before each technique and after each of its passes for every frame in flight
+	uint32_t num_timestamp_queries = 0;
+	uint32_t num_pipeline_statistics_queries = 0;
+	for (const reshadefx::technique_info &info : effect.module.techniques)
+	{
+		num_timestamp_queries += static_cast<uint32_t>(info.passes.size() + 1) * 4;
+		num_pipeline_statistics_queries += static_cast<uint32_t>(info.passes.size()) * 4;
+	}
+
+	if (!_device->create_query_heap(api::query_type::timestamp, num_timestamp_queries, &effect.query_heap))
 		LOG(ERROR) << "Failed to create query heap for effect file " << effect.source_file << '!';
+	// Pipeline statistics are only read back as a full structure with D3D10, D3D11 and Vulkan (and the null device, which behaves like Vulkan), so skip them elsewhere
+	// The query heap for them is only created once they are gathered (see 'update_effects')
+	if (const api::device_api device_api = _device->get_api();
+		device_api == api::device_api::d3d10 || device_api == api::device_api::d3d11 || device_api == api::device_api::vulkan || device_api == api::device_api::null)
+		effect.num_pipeline_statistics_queries = num_pipeline_statistics_queries;
 
 	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
 
@@ -2545,7 +2648,8 @@ bool reshade::runtime::create_effect(size_t effect_index)
 
 	// Initialize techniques and passes
 	size_t total_pass_index = 0;
-	size_t technique_index_in_effect = 0;
+	uint32_t query_index = 0;
+	uint32_t pipeline_statistics_query_index = 0;
 
 	for (technique &tech : _techniques)
 	{
@@ -2554,8 +2658,12 @@ bool reshade::runtime::create_effect(size_t effect_index)
 
 		tech.passes_data.resize(tech.passes.size());
 
-		// Offset index so that a query exists for each command frame and two subsequent ones are used for before/after stamps
-		tech.query_base_index = static_cast<uint32_t>(technique_index_in_effect++ * 2 * 4);
+		// Offset index so that a set of queries exists for each command frame, consisting of a timestamp before the technique and one after each pass
+		tech.query_base_index = query_index;
+		query_index += static_cast<uint32_t>(tech.passes.size() + 1) * 4;
+		tech.pipeline_statistics_query_base_index = pipeline_statistics_query_index;
+		pipeline_statistics_query_index += static_cast<uint32_t>(tech.passes.size()) * 4;
+		std::fill_n(tech.query_slots, 4, technique::query_slot {});
 
 		for (size_t pass_index = 0; pass_index < tech.passes.size(); ++pass_index, ++total_pass_index)
 		{
@@ -2960,6 +3068,9 @@ void reshade::runtime::destroy_effect(size_t effect_index)
 
 		_device->destroy_query_heap(effect.query_heap);
 		effect.query_heap = {};
+		_device->destroy_query_heap(effect.pipeline_statistics_query_heap);
+		effect.pipeline_statistics_query_heap = {};
+		effect.num_pipeline_statistics_queries = 0;
 
 		effect.texture_semantic_to_binding.clear();
 	}
@@ -3004,218 +3115,707 @@ void reshade::runtime::destroy_effect(size_t effect_index)
 	// Do not clear effect here, since it is common to be reused immediately
 }
 
-void reshade::runtime::load_textures()
+static bool get_texture_data_layout(reshadefx::texture_format format, int &type_size, int &num_channels)
 {
-	for (texture &tex : _textures)
+	switch (format)
+	{
+	case reshadefx::texture_format::r8:
+		type_size = 1;
+		num_channels = 1;
+		return true;
+	case reshadefx::texture_format::r16:
+	case reshadefx::texture_format::r16f:
+		type_size = 2;
+		num_channels = 1;
+		return true;
+	case reshadefx::texture_format::r32i:
+	case reshadefx::texture_format::r32u:
+	case reshadefx::texture_format::r32f:
+		type_size = 4;
+		num_channels = 1;
+		return true;
+	case reshadefx::texture_format::rg8:
+		type_size = 1;
+		num_channels = 2;
+		return true;
+	case reshadefx::texture_format::rg16:
+	case reshadefx::texture_format::rg16f:
+		type_size = 2;
+		num_channels = 1;
+		return true;
+	case reshadefx::texture_format::rg32f:
+		type_size = 4;
+		num_channels = 2;
+		return true;
+	case reshadefx::texture_format::rgba8:
+	case reshadefx::texture_format::rgb10a2:
+		type_size = 1;
+		num_channels = 4;
+		return true;
+	case reshadefx::texture_format::rgba16:
+	case reshadefx::texture_format::rgba16f:
+		type_size = 2;
+		num_channels = 4;
+		return true;
+	case reshadefx::texture_format::rgba32f:
+		type_size = 4;
+		num_channels = 4;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void resize_texture_data(const void *pixels, uint32_t width, uint32_t height, void *resized, uint32_t resized_width, uint32_t resized_height, int type_size, int num_channels)
+{
+	if (type_size == 4)
+		stbir_resize_float(static_cast<const float *>(pixels), width, height, 0, static_cast<float *>(resized), resized_width, resized_height, 0, num_channels);
+	else if (type_size == 2)
+		stbir_resize_uint16_generic(static_cast<const uint16_t *>(pixels), width, height, 0, static_cast<uint16_t *>(resized), resized_width, resized_height, 0, num_channels, -1, 0, STBIR_EDGE_CLAMP, STBIR_FILTER_DEFAULT, STBIR_COLORSPACE_LINEAR, nullptr);
+	else
+		stbir_resize_uint8(static_cast<const uint8_t *>(pixels), width, height, 0, static_cast<uint8_t *>(resized), resized_width, resized_height, 0, num_channels);
+}
+
+static size_t calc_mipmap_chain_size(uint32_t width, uint32_t height, uint32_t levels, int type_size, int num_channels)
+{
+	size_t size = 0;
+	for (uint32_t level = 0; level < levels; ++level)
+		size += static_cast<size_t>(std::max(1u, width >> level)) * static_cast<size_t>(std::max(1u, height >> level)) * static_cast<size_t>(type_size * num_channels);
+	return size;
+}
+
+template <typename T>
+static void downsample_texture_data(const T *src, uint32_t src_width, uint32_t src_height, T *dst, uint32_t dst_width, uint32_t dst_height, int num_channels)
+{
+	// Simple 2x2 box filter, which matches what the mipmap generation compute shader does with bilinear filtering at texel centers
+	for (uint32_t y = 0; y < dst_height; ++y)
 	{
-		if (tex.resource == 0 || !tex.semantic.empty())
-			continue; // Ignore textures that are not created yet and those that are handled in the runtime implementation
+		const uint32_t y0 = std::min(y * 2 + 0, src_height - 1);
+		const uint32_t y1 = std::min(y * 2 + 1, src_height - 1);
 
-		std::filesystem::path source_path = std::filesystem::u8path(tex.annotation_as_string("source"));
-		// Ignore textures that have no image file attached to them (e.g. plain render targets)
-		if (source_path.empty())
+		for (uint32_t x = 0; x < dst_width; ++x)
+		{
+			const uint32_t x0 = std::min(x * 2 + 0, src_width - 1);
+			const uint32_t x1 = std::min(x * 2 + 1, src_width - 1);
+
+			for (int c = 0; c < num_channels; ++c)
+			{
+				const auto sum =
+					src[(static_cast<size_t>(y0) * src_width + x0) * num_channels + c] +
+					src[(static_cast<size_t>(y0) * src_width + x1) * num_channels + c] +
+					src[(static_cast<size_t>(y1) * src_width + x0) * num_channels + c] +
+					src[(static_cast<size_t>(y1) * src_width + x1) * num_channels + c];
+
+				if constexpr (std::is_floating_point_v<T>)
+					dst[(static_cast<size_t>(y) * dst_width + x) * num_channels + c] = sum * T(0.25);
+				else
+					dst[(static_cast<size_t>(y) * dst_width + x) * num_channels + c] = static_cast<T>((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+static void *generate_texture_mipmaps(const void *pixels, uint32_t width, uint32_t height, uint32_t levels, int type_size, int num_channels)
+{
+	if (type_size != 1 && type_size != 4)
+		return nullptr;
+
+	uint8_t *const data = static_cast<uint8_t *>(std::malloc(calc_mipmap_chain_size(width, height, levels, type_size, num_channels)));
+	if (data == nullptr)
+		return nullptr;
+
+	std::memcpy(data, pixels, calc_mipmap_chain_size(width, height, 1, type_size, num_channels));
+
+	size_t offset = 0;
+	for (uint32_t level = 1; level < levels; ++level)
+	{
+		const uint32_t src_width = std::max(1u, width >> (level - 1));
+		const uint32_t src_height = std::max(1u, height >> (level - 1));
+		const uint32_t dst_width = std::max(1u, width >> level);
+		const uint32_t dst_height = std::max(1u, height >> level);
+
+		// Compute offsets in 'size_t', since the size of a level can exceed the range of 32-bit integers with large floating-point textures
+		uint8_t *const src = data + offset;
+		offset += static_cast<size_t>(src_width) * static_cast<size_t>(src_height) * static_cast<size_t>(type_size * num_channels);
+		uint8_t *const dst = data + offset;
+
+		if (type_size == 4)
+			downsample_texture_data(reinterpret_cast<const float *>(src), src_width, src_height, reinterpret_cast<float *>(dst), dst_width, dst_height, num_channels);
+		else
+			downsample_texture_data(src, src_width, src_height, dst, dst_width, dst_height, num_channels);
+	}
+
+	return data;
+}
+
+// Upper limit for the total size of cached texture data, after which the least recently used entries are removed again
+static constexpr uintmax_t texture_cache_budget = 512 * 1024 * 1024;
+
+static void trim_texture_cache(const std::filesystem::path &cache_path)
+{
+	struct cache_entry
+	{
+		std::filesystem::path path;
+		std::filesystem::file_time_type last_used;
+		uintmax_t size;
+	};
+
+	std::error_code ec;
+	uintmax_t total_size = 0;
+	std::vector<cache_entry> entries;
+
+	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(cache_path, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		const std::filesystem::path filename = entry.path().filename();
+		if (filename.native().compare(0, 12, L"reshade-tex-") != 0 || entry.path().extension() != L".tex")
 			continue;
 
-		// Search for image file using the provided search paths unless the path provided is already absolute
-		if (!find_file(_texture_search_paths, source_path))
+		// Cache hits update the modification time of an entry, so it tracks when it was last used
+		cache_entry &cached = entries.emplace_back();
+		cached.path = entry.path();
+		cached.last_used = entry.last_write_time(ec);
+		cached.size = entry.file_size(ec);
+		if (ec)
 		{
-			LOG(ERROR) << "Source " << source_path << " for texture '" << tex.unique_name << "' was not found in any of the texture search paths!";
-			_last_reload_successful = false;
+			entries.pop_back();
+			ec.clear();
 			continue;
 		}
 
-		std::error_code ec;
-		const uintmax_t file_size = std::filesystem::file_size(source_path, ec);
+		total_size += cached.size;
+	}
 
-		void *pixels = nullptr;
-		int width = 0, height = 1, depth = 1, channels = 0;
-		const bool is_floating_point_format = (tex.format == reshadefx::texture_format::r32f || tex.format == reshadefx::texture_format::rg32f || tex.format == reshadefx::texture_format::rgba32f);
+	if (total_size <= texture_cache_budget)
+		return;
 
-		if (auto file = std::ifstream(source_path, std::ios::binary))
-		{
-			if (source_path.extension() == L".cube")
-			{
-				if (!is_floating_point_format)
-				{
-					LOG(ERROR) << "Source " << source_path << " for texture '" << tex.unique_name << "' is a Cube LUT file, which can only be loaded into textures with a floating-point format!";
-					_last_reload_successful = false;
-					continue;
-				}
+	std::sort(entries.begin(), entries.end(),
+		[](const cache_entry &lhs, const cache_entry &rhs) { return lhs.last_used < rhs.last_used; });
 
-				float domain_min[3] = { 0.0f, 0.0f, 0.0f };
-				float domain_max[3] = { 1.0f, 1.0f, 1.0f };
+	for (const cache_entry &entry : entries)
+	{
+		if (total_size <= texture_cache_budget)
+			break;
 
-				// Read header information
-				std::string line;
-				while (std::getline(file, line))
-				{
-					if (line.empty() || line[0] == '#')
-						continue; // Skip lines with comments
+		if (std::filesystem::remove(entry.path, ec))
+			total_size -= entry.size;
+	}
+}
 
-					char *p = line.data();
+static void *load_cube_lut(const std::string_view data, int &width, int &height, int &depth)
+{
+	const auto parse_floats = [](std::string_view line, float *values, size_t count) {
+		const char *p = line.data(), *const end = line.data() + line.size();
+		for (size_t i = 0; i < count; ++i)
+		{
+			while (p < end && (*p == ' ' || *p == '\t'))
+				p++;
+			if (p < end && *p == '+')
+				p++;
+			// Leaves the value unchanged (zero) and does not advance if there is no valid number
+			p = std::from_chars(p, end, values[i]).ptr;
+		}
+	};
+	const auto parse_size = [](std::string_view line) {
+		int value = 0;
+		const char *p = line.data(), *const end = line.data() + line.size();
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+		std::from_chars(p, end, value);
+		return value;
+	};
 
-					if (line.rfind("TITLE", 0) == 0)
-						continue; // Skip optional line with title
+	void *pixels = nullptr;
+	size_t num_values = 0;
 
-					if (line.rfind("DOMAIN_MIN", 0) == 0)
-					{
-						p += 10;
-						domain_min[0] = static_cast<float>(std::strtod(p, &p));
-						domain_min[1] = static_cast<float>(std::strtod(p, &p));
-						domain_min[2] = static_cast<float>(std::strtod(p, &p));
-						continue;
-					}
-					if (line.rfind("DOMAIN_MAX", 0) == 0)
-					{
-						p += 10;
-						domain_max[0] = static_cast<float>(std::strtod(p, &p));
-						domain_max[1] = static_cast<float>(std::strtod(p, &p));
-						domain_max[2] = static_cast<float>(std::strtod(p, &p));
-						continue;
-					}
+	float domain_min[3] = { 0.0f, 0.0f, 0.0f };
+	float domain_max[3] = { 1.0f, 1.0f, 1.0f };
 
-					if (line.rfind("LUT_1D_SIZE", 0) == 0)
-					{
-						if (pixels != nullptr)
-							break;
-						width = std::strtol(p + 11, nullptr, 10);
-						pixels = std::malloc(static_cast<size_t>(width) * 4 * sizeof(float));
-						continue;
-					}
-					if (line.rfind("LUT_3D_SIZE", 0) == 0)
-					{
-						if (pixels != nullptr)
-							break;
-						width = height = depth = std::strtol(p + 11, nullptr, 10);
-						pixels = std::malloc(static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4 * sizeof(float));
-						continue;
-					}
+	size_t offset = 0;
+	std::string_view line;
+	const auto next_line = [&data, &offset, &line]() {
+		if (offset >= data.size())
+			return false;
+		size_t line_end = data.find('\n', offset);
+		if (line_end == std::string_view::npos)
+			line_end = data.size();
+		line = data.substr(offset, line_end - offset);
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+		offset = line_end + 1;
+		return true;
+	};
 
-					// Line has no known keyword, so assume this is where the table data starts and roll back a line to continue reading that below
-					file.seekg(-static_cast<std::streampos>(line.size() + 1), std::ios::cur);
-					break;
-				}
+	// Read header information
+	size_t table_offset = data.size();
+	while (true)
+	{
+		const size_t line_offset = offset;
+		if (!next_line())
+			break;
 
-				// Read table data
-				if (pixels != nullptr)
-				{
-					size_t index = 0;
-					while (std::getline(file, line) && (index + 4) <= (static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4))
-					{
-						if (line.empty() || line[0] == '#')
-							continue; // Skip lines with comments
+		if (line.empty() || line[0] == '#')
+			continue; // Skip lines with comments
 
-						char *p = line.data();
+		if (line.rfind("TITLE", 0) == 0)
+			continue; // Skip optional line with title
 
-						static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[0] - domain_min[0]) + domain_min[0];
-						static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[1] - domain_min[1]) + domain_min[1];
-						static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[2] - domain_min[2]) + domain_min[2];
-						static_cast<float *>(pixels)[index++] = 1.0f;
-					}
-				}
-			}
-			else
-			{
-				// Read texture data into memory in one go since that is faster than reading chunk by chunk
-				std::vector<stbi_uc> file_data(static_cast<size_t>(file_size));
-				file.read(reinterpret_cast<char *>(file_data.data()), file_data.size());
-				file.close();
-
-				if (is_floating_point_format)
-					pixels = stbi_loadf_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
-				else if (stbi_dds_test_memory(file_data.data(), static_cast<int>(file_data.size())))
-					pixels = stbi_dds_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &depth, &channels, STBI_rgb_alpha);
-				else
-					pixels = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
-			}
+		if (line.rfind("DOMAIN_MIN", 0) == 0)
+		{
+			parse_floats(line.substr(10), domain_min, 3);
+			continue;
 		}
-
-		if (ec || pixels == nullptr)
+		if (line.rfind("DOMAIN_MAX", 0) == 0)
 		{
-			LOG(ERROR) << "Failed to load " << source_path << " for texture '" << tex.unique_name << "' with error code " << ec.value() << '!';
-			_last_reload_successful = false;
+			parse_floats(line.substr(10), domain_max, 3);
 			continue;
 		}
 
-		// Collapse data to the correct number of components per pixel based on the texture format
-		switch (tex.format)
+		if (line.rfind("LUT_1D_SIZE", 0) == 0)
 		{
-		case reshadefx::texture_format::r8:
-			for (size_t i = 4, k = 1; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 1)
-				static_cast<stbi_uc *>(pixels)[k] = static_cast<stbi_uc *>(pixels)[i];
-			break;
-		case reshadefx::texture_format::r32f:
-			for (size_t i = 4, k = 1; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 1)
-				static_cast<float *>(pixels)[k] = static_cast<float *>(pixels)[i];
-			break;
-		case reshadefx::texture_format::rg8:
-			for (size_t i = 4, k = 2; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 2)
-				static_cast<stbi_uc *>(pixels)[k + 0] = static_cast<stbi_uc *>(pixels)[i + 0],
-				static_cast<stbi_uc *>(pixels)[k + 1] = static_cast<stbi_uc *>(pixels)[i + 1];
-			break;
-		case reshadefx::texture_format::rg32f:
-			for (size_t i = 4, k = 2; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 2)
-				static_cast<float *>(pixels)[k + 0] = static_cast<float *>(pixels)[i + 0],
-				static_cast<float *>(pixels)[k + 1] = static_cast<float *>(pixels)[i + 1];
-			break;
-		case reshadefx::texture_format::rgba8:
-		case reshadefx::texture_format::rgba32f:
-			break;
-		default:
-			LOG(ERROR) << "Texture upload is not supported for format " << static_cast<int>(tex.format) << " of texture '" << tex.unique_name << "'!";
-			_last_reload_successful = false;
-			stbi_image_free(pixels);
+			if (pixels != nullptr)
+				break;
+			width = parse_size(line.substr(11));
+			num_values = static_cast<size_t>(std::max(width, 0)) * 4;
+			pixels = std::malloc(num_values * sizeof(float));
+			continue;
+		}
+		if (line.rfind("LUT_3D_SIZE", 0) == 0)
+		{
+			if (pixels != nullptr)
+				break;
+			width = height = depth = parse_size(line.substr(11));
+			num_values = static_cast<size_t>(std::max(width, 0)) * static_cast<size_t>(std::max(height, 0)) * static_cast<size_t>(std::max(depth, 0)) * 4;
+			pixels = std::malloc(num_values * sizeof(float));
 			continue;
 		}
 
-		update_texture(tex, width, height, depth, pixels);
+		// Line has no known keyword, so assume this is where the table data starts and roll back a line to continue reading that below
+		table_offset = line_offset;
+		break;
+	}
 
-		stbi_image_free(pixels);
+	if (pixels == nullptr)
+		return nullptr;
 
-		tex.loaded = true;
+	// Read table data
+	offset = table_offset;
+	for (size_t index = 0; (index + 4) <= num_values && next_line();)
+	{
+		if (line.empty() || line[0] == '#')
+			continue; // Skip lines with comments
+
+		float values[3] = { 0.0f, 0.0f, 0.0f };
+		parse_floats(line, values, 3);
+
+		static_cast<float *>(pixels)[index++] = values[0] * (domain_max[0] - domain_min[0]) + domain_min[0];
+		static_cast<float *>(pixels)[index++] = values[1] * (domain_max[1] - domain_min[1]) + domain_min[1];
+		static_cast<float *>(pixels)[index++] = values[2] * (domain_max[2] - domain_min[2]) + domain_min[2];
+		static_cast<float *>(pixels)[index++] = 1.0f;
 	}
 
-	_textures_loaded = true;
+	return pixels;
 }
-bool reshade::runtime::create_texture(texture &tex)
-{
-	// Do not create resource if it is a special reference, those are set in 'render_technique' and 'update_texture_bindings'
-	if (!tex.semantic.empty())
-		return true;
 
-	api::resource_type type = api::resource_type::unknown;
-	api::resource_view_type view_type = api::resource_view_type::unknown;
-
-	switch (tex.type)
+bool reshade::runtime::load_texture_source(texture_load_job &job) const
+{
+	// Search for image file using the provided search paths unless the path provided is already absolute
+	if (!find_file(_texture_search_paths, job.source_path))
 	{
-	case reshadefx::texture_type::texture_1d:
-		type = api::resource_type::texture_1d;
-		view_type = api::resource_view_type::texture_1d;
-		break;
-	case reshadefx::texture_type::texture_2d:
-		type = api::resource_type::texture_2d;
-		view_type = api::resource_view_type::texture_2d;
-		break;
-	case reshadefx::texture_type::texture_3d:
-		type = api::resource_type::texture_3d;
-		view_type = api::resource_view_type::texture_3d;
-		break;
+		LOG(ERROR) << "Source " << job.source_path << " for texture '" << job.texture_name << "' was not found in any of the texture search paths!";
+		return false;
 	}
 
-	api::format format = api::format::unknown;
-	api::format view_format = api::format::unknown;
-	api::format view_format_srgb = api::format::unknown;
+	std::error_code ec;
+	const uintmax_t file_size = std::filesystem::file_size(job.source_path, ec);
 
-	switch (tex.format)
+	int type_size = 0, num_channels = 0;
+	get_texture_data_layout(job.format, type_size, num_channels);
+
+	struct texture_cache_header
 	{
-	case reshadefx::texture_format::r8:
-		format = api::format::r8_unorm;
-		break;
-	case reshadefx::texture_format::r16:
-		format = api::format::r16_unorm;
-		break;
-	case reshadefx::texture_format::r16f:
-		format = api::format::r16_float;
+		uint32_t magic;
+		uint32_t format;
+		uint32_t width, height, levels;
+	};
+
+	// Decoded, resized and mipmapped image data of 2D textures is cached, so that later loads can skip all of that and only have to copy the data
+	// Identify the source by path, size and modification time and the target by its description, since the same image may be loaded into different textures
+	// Use a separate error code for the modification time, so that failing to query it only disables the cache, rather than failing the load below
+	std::string texture_cache_id;
+	const uint32_t requested_width = job.width;
+	const uint32_t requested_height = job.height;
+	if (std::error_code write_time_ec;
+		!_no_effect_cache && !ec && job.depth == 1 && job.source_path.extension() != L".cube")
+	{
+		const int64_t last_write_time = std::filesystem::last_write_time(job.source_path, write_time_ec).time_since_epoch().count();
+		if (!write_time_ec)
+			texture_cache_id = "tex-" + job.source_path.stem().u8string() + '-' + std::to_string(
+				std::hash<std::wstring>()(job.source_path.native()) ^
+				std::hash<uintmax_t>()(file_size) ^
+				std::hash<int64_t>()(last_write_time) ^
+				std::hash<std::string>()(std::to_string(static_cast<uint32_t>(job.format)) + '-' + std::to_string(job.width) + 'x' + std::to_string(job.height) + 'x' + std::to_string(job.levels)));
+
+		if (std::string cache_data;
+			!texture_cache_id.empty() && load_effect_cache(texture_cache_id, "tex", cache_data) && cache_data.size() >= sizeof(texture_cache_header))
+		{
+			texture_cache_header header;
+			std::memcpy(&header, cache_data.data(), sizeof(header));
+
+			if (header.magic == 0x31584554 /* 'TEX1' */ && header.format == static_cast<uint32_t>(job.format) && header.width == job.width && header.height == job.height && (header.levels == 1 || header.levels == job.levels))
+			{
+				const size_t data_size = calc_mipmap_chain_size(header.width, header.height, header.levels, type_size, num_channels);
+				if (cache_data.size() == sizeof(header) + data_size)
+				{
+					if (void *const pixels = std::malloc(data_size))
+					{
+						std::memcpy(pixels, cache_data.data() + sizeof(header), data_size);
+
+						job.pixels.reset(pixels);
+						job.levels = header.levels;
+
+						// Mark the entry as recently used, so that it is kept when the cache exceeds its budget
+						std::filesystem::last_write_time(g_reshade_base_path / _effect_cache_path / std::filesystem::u8path("reshade-" + texture_cache_id + ".tex"), std::filesystem::file_time_type::clock::now(), write_time_ec);
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	void *pixels = nullptr;
+	int width = 0, height = 1, depth = 1, channels = 0;
+	const bool is_floating_point_format = (job.format == reshadefx::texture_format::r32f || job.format == reshadefx::texture_format::rg32f || job.format == reshadefx::texture_format::rgba32f);
+
+	if (job.source_path.extension() == L".cube")
+	{
+		if (!is_floating_point_format)
+		{
+			LOG(ERROR) << "Source " << job.source_path << " for texture '" << job.texture_name << "' is a Cube LUT file, which can only be loaded into textures with a floating-point format!";
+			return false;
+		}
+
+		struct cube_lut_cache_header
+		{
+			uint32_t magic;
+			int32_t width, height, depth;
+		};
+
+		// Decoded table data is cached in binary form, so that subsequent loads only have to copy it
+		// Identify the source by path, size and modification time, since hashing its contents would mean reading the whole text file again
+		const std::string cache_id = "lut-" + job.source_path.stem().u8string() + '-' + std::to_string(
+			std::hash<std::wstring>()(job.source_path.native()) ^
+			std::hash<uintmax_t>()(file_size) ^
+			std::hash<int64_t>()(std::filesystem::last_write_time(job.source_path, ec).time_since_epoch().count()));
+
+		if (std::string cache_data;
+			!ec && load_effect_cache(cache_id, "lut", cache_data) && cache_data.size() >= sizeof(cube_lut_cache_header))
+		{
+			cube_lut_cache_header header;
+			std::memcpy(&header, cache_data.data(), sizeof(header));
+
+			const size_t data_size = static_cast<size_t>(header.width) * static_cast<size_t>(header.height) * static_cast<size_t>(header.depth) * 4 * sizeof(float);
+			if (header.magic == 0x42554331 /* 'CUB1' */ && header.width > 0 && header.height > 0 && header.depth > 0 && cache_data.size() == sizeof(header) + data_size)
+			{
+				width = header.width;
+				height = header.height;
+				depth = header.depth;
+
+				pixels = std::malloc(data_size);
+				if (pixels != nullptr)
+					std::memcpy(pixels, cache_data.data() + sizeof(header), data_size);
+			}
+		}
+
+		if (pixels == nullptr && !ec)
+		{
+			// Read the whole file into memory in one go and parse it from there
+			if (auto file = std::ifstream(job.source_path, std::ios::binary))
+			{
+				std::string file_data(static_cast<size_t>(file_size), '\0');
+				if (file.read(file_data.data(), file_data.size()))
+					pixels = load_cube_lut(file_data, width, height, depth);
+			}
+
+			if (pixels != nullptr && width > 0 && height > 0 && depth > 0)
+			{
+				const cube_lut_cache_header header = { 0x42554331 /* 'CUB1' */, width, height, depth };
+				const size_t data_size = static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4 * sizeof(float);
+
+				std::string cache_data(sizeof(header) + data_size, '\0');
+				std::memcpy(cache_data.data(), &header, sizeof(header));
+				std::memcpy(cache_data.data() + sizeof(header), pixels, data_size);
+				save_effect_cache(cache_id, "lut", cache_data);
+			}
+		}
+	}
+	else if (auto file = std::ifstream(job.source_path, std::ios::binary))
+	{
+		// Read texture data into memory in one go since that is faster than reading chunk by chunk
+		std::vector<stbi_uc> file_data(static_cast<size_t>(file_size));
+		file.read(reinterpret_cast<char *>(file_data.data()), file_data.size());
+		file.close();
+
+		if (is_floating_point_format)
+			pixels = stbi_loadf_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
+		else if (stbi_dds_test_memory(file_data.data(), static_cast<int>(file_data.size())))
+			pixels = stbi_dds_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &depth, &channels, STBI_rgb_alpha);
+		else
+			pixels = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
+	}
+
+	if (ec || pixels == nullptr)
+	{
+		LOG(ERROR) << "Failed to load " << job.source_path << " for texture '" << job.texture_name << "' with error code " << ec.value() << '!';
+		stbi_image_free(pixels);
+		return false;
+	}
+
+	// Collapse data to the correct number of components per pixel based on the texture format
+	switch (job.format)
+	{
+	case reshadefx::texture_format::r8:
+		for (size_t i = 4, k = 1; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 1)
+			static_cast<stbi_uc *>(pixels)[k] = static_cast<stbi_uc *>(pixels)[i];
+		break;
+	case reshadefx::texture_format::r32f:
+		for (size_t i = 4, k = 1; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 1)
+			static_cast<float *>(pixels)[k] = static_cast<float *>(pixels)[i];
+		break;
+	case reshadefx::texture_format::rg8:
+		for (size_t i = 4, k = 2; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 2)
+			static_cast<stbi_uc *>(pixels)[k + 0] = static_cast<stbi_uc *>(pixels)[i + 0],
+			static_cast<stbi_uc *>(pixels)[k + 1] = static_cast<stbi_uc *>(pixels)[i + 1];
+		break;
+	case reshadefx::texture_format::rg32f:
+		for (size_t i = 4, k = 2; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 2)
+			static_cast<float *>(pixels)[k + 0] = static_cast<float *>(pixels)[i + 0],
+			static_cast<float *>(pixels)[k + 1] = static_cast<float *>(pixels)[i + 1];
+		break;
+	case reshadefx::texture_format::rgba8:
+	case reshadefx::texture_format::rgba32f:
+		break;
+	default:
+		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<int>(job.format) << " of texture '" << job.texture_name << "'!";
+		stbi_image_free(pixels);
+		return false;
+	}
+
+	job.pixels.reset(pixels);
+
+	// Resize image data to the texture dimensions here already, so that this does not have to happen on the render thread during upload
+	if (depth == 1 && job.depth == 1 && (static_cast<uint32_t>(width) != job.width || static_cast<uint32_t>(height) != job.height))
+	{
+		LOG(INFO) << "Resizing image data for texture '" << job.texture_name << "' from " << width << "x" << height << " to " << job.width << "x" << job.height << '.';
+
+		void *const resized = std::malloc(static_cast<size_t>(job.width) * static_cast<size_t>(job.height) * static_cast<size_t>(type_size * num_channels));
+		if (resized == nullptr)
+			return false;
+
+		resize_texture_data(job.pixels.get(), width, height, resized, job.width, job.height, type_size, num_channels);
+
+		job.pixels.reset(resized);
+		width = job.width;
+		height = job.height;
+	}
+
+	job.width = width;
+	job.height = height;
+	job.depth = depth;
+
+	// Only cache the result if it matches the description it is identified by, which is not the case if the image could not be resized to it (e.g. because it has a depth)
+	if (job.depth != 1 || job.width != requested_width || job.height != requested_height)
+		texture_cache_id.clear();
+
+	// Only generate mipmaps on the CPU if the result is cached (the GPU generates them after upload otherwise, which is faster)
+	if (texture_cache_id.empty())
+	{
+		job.levels = 1;
+		return true;
+	}
+
+	// Generate mipmaps on the CPU here, so that they can be cached alongside the base level
+	if (job.levels > 1)
+	{
+		if (void *const mipmaps = generate_texture_mipmaps(job.pixels.get(), job.width, job.height, job.levels, type_size, num_channels))
+			job.pixels.reset(mipmaps);
+		else
+			job.levels = 1;
+	}
+
+	const texture_cache_header header = { 0x31584554 /* 'TEX1' */, static_cast<uint32_t>(job.format), job.width, job.height, job.levels };
+	const size_t data_size = calc_mipmap_chain_size(job.width, job.height, job.levels, type_size, num_channels);
+
+	std::string cache_data(sizeof(header) + data_size, '\0');
+	std::memcpy(cache_data.data(), &header, sizeof(header));
+	std::memcpy(cache_data.data() + sizeof(header), job.pixels.get(), data_size);
+	if (save_effect_cache(texture_cache_id, "tex", cache_data))
+		trim_texture_cache(g_reshade_base_path / _effect_cache_path);
+
+	return true;
+}
+
+void reshade::runtime::load_textures()
+{
+	auto jobs = std::make_shared<std::vector<texture_load_job>>();
+
+	for (size_t texture_index = 0; texture_index < _textures.size(); ++texture_index)
+	{
+		texture &tex = _textures[texture_index];
+
+		if (tex.resource == 0 || !tex.semantic.empty() || tex.loaded)
+			continue; // Ignore textures that are not created yet, those that are handled in the runtime implementation and those that were already loaded before
+
+		std::filesystem::path source_path = std::filesystem::u8path(tex.annotation_as_string("source"));
+		// Ignore textures that have no image file attached to them (e.g. plain render targets)
+		if (source_path.empty())
+			continue;
+
+		texture_load_job &job = jobs->emplace_back();
+		job.texture_index = texture_index;
+		job.texture_name = tex.unique_name;
+		job.source_path = std::move(source_path);
+		job.format = tex.format;
+		job.width = tex.width;
+		job.height = tex.height;
+		job.depth = tex.depth;
+		job.levels = tex.levels;
+
+		// Effects referencing this texture are not rendered until it was uploaded
+		for (const size_t effect_index : tex.shared)
+			_effects[effect_index].pending_textures++;
+	}
+
+	_reload_remaining_textures = jobs->size();
+
+	if (jobs->empty())
+		return;
+
+	// Decode and resize images on worker threads, so that only the final upload has to happen on the render thread (see 'upload_textures')
+	// Textures can vary wildly in size, so have the threads pull from a shared list, rather than splitting it up front
+	const size_t num_threads = std::min<size_t>(jobs->size(), std::max<size_t>(std::thread::hardware_concurrency(), 2u) - 1);
+	const auto next_job_index = std::make_shared<std::atomic<size_t>>(0);
+
+	// Keep track of the spawned threads, so the runtime cannot be destroyed while they are still running
+	for (size_t n = 0; n < num_threads; ++n)
+		_worker_threads.emplace_back([this, jobs, next_job_index]() {
+			for (size_t i; (i = (*next_job_index)++) < jobs->size();)
+			{
+				texture_load_job &job = (*jobs)[i];
+
+				// Skip decoding when initialization state changes (indicating that 'on_reset' was called in the meantime), but still hand off the job so the count stays consistent
+				if (_is_initialized && !load_texture_source(job))
+				{
+					job.pixels.reset();
+					_last_reload_successful = false;
+				}
+
+				{
+					const std::unique_lock<std::mutex> lock(_texture_upload_mutex);
+					_texture_upload_queue.push_back(std::move(job));
+				}
+
+				_reload_remaining_textures--;
+			}
+		});
+}
+bool reshade::runtime::upload_textures()
+{
+	// Check before taking the queue, since all jobs are guaranteed to have been queued once this reaches zero
+	const bool all_decoded = _reload_remaining_textures == 0;
+
+	std::vector<texture_load_job> jobs;
+	{
+		const std::unique_lock<std::mutex> lock(_texture_upload_mutex);
+		jobs.swap(_texture_upload_queue);
+	}
+
+	for (texture_load_job &job : jobs)
+	{
+		texture &tex = _textures[job.texture_index];
+		assert(tex.unique_name == job.texture_name);
+
+		for (const size_t effect_index : tex.shared)
+		{
+			assert(_effects[effect_index].pending_textures != 0);
+			_effects[effect_index].pending_textures--;
+		}
+
+		// Errors were already reported while decoding
+		if (job.pixels == nullptr)
+			continue;
+
+		if (job.levels > 1)
+		{
+			// Image data already contains all mipmap levels, so upload those directly instead of generating them on the GPU
+			int type_size = 0, num_channels = 0;
+			get_texture_data_layout(tex.format, type_size, num_channels);
+
+			api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+			cmd_list->barrier(tex.resource, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
+
+			const uint8_t *level_data = static_cast<const uint8_t *>(job.pixels.get());
+			for (uint32_t level = 0; level < job.levels; ++level)
+			{
+				const uint32_t level_width = std::max(1u, job.width >> level);
+				const uint32_t level_height = std::max(1u, job.height >> level);
+				const uint32_t row_pitch = level_width * static_cast<uint32_t>(type_size * num_channels);
+
+				_device->update_texture_region({ const_cast<uint8_t *>(level_data), row_pitch, row_pitch * level_height }, tex.resource, level);
+
+				level_data += static_cast<size_t>(row_pitch) * level_height;
+			}
+
+			cmd_list->barrier(tex.resource, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
+		}
+		else
+		{
+			update_texture(tex, job.width, job.height, job.depth, job.pixels.get());
+		}
+
+		tex.loaded = true;
+	}
+
+	return all_decoded;
+}
+bool reshade::runtime::create_texture(texture &tex)
+{
+	// Do not create resource if it is a special reference, those are set in 'render_technique' and 'update_texture_bindings'
+	if (!tex.semantic.empty())
+		return true;
+
+	api::resource_type type = api::resource_type::unknown;
+	api::resource_view_type view_type = api::resource_view_type::unknown;
+
+	switch (tex.type)
+	{
+	case reshadefx::texture_type::texture_1d:
+		type = api::resource_type::texture_1d;
+		view_type = api::resource_view_type::texture_1d;
+		break;
+	case reshadefx::texture_type::texture_2d:
+		type = api::resource_type::texture_2d;
+		view_type = api::resource_view_type::texture_2d;
+		break;
+	case reshadefx::texture_type::texture_3d:
+		type = api::resource_type::texture_3d;
+		view_type = api::resource_view_type::texture_3d;
+		break;
+	}
+
+	api::format format = api::format::unknown;
+	api::format view_format = api::format::unknown;
+	api::format view_format_srgb = api::format::unknown;
+
+	switch (tex.format)
+	{
+	case reshadefx::texture_format::r8:
+		format = api::format::r8_unorm;
+		break;
+	case reshadefx::texture_format::r16:
+		format = api::format::r16_unorm;
+		break;
+	case reshadefx::texture_format::r16f:
+		format = api::format::r16_float;
 		break;
 	case reshadefx::texture_format::r32i:
 		format = api::format::r32_sint;
@@ -3369,6 +3969,8 @@ void reshade::runtime::destroy_texture(texture &tex)
 	for (const api::resource_view uav : tex.uav)
 		_device->destroy_resource_view(uav);
 	tex.uav.clear();
+
+	tex.loaded = false;
 }
 
 void reshade::runtime::enable_technique(technique &tech)
@@ -3420,8 +4022,8 @@ void reshade::runtime::disable_technique(technique &tech)
 	const bool status_changed = tech.enabled;
 	tech.enabled = false;
 	tech.time_left = 0;
-	tech.average_cpu_duration.clear();
-	tech.average_gpu_duration.clear();
+	tech.cpu_duration.clear();
+	tech.gpu_duration.clear();
 
 	if (status_changed) // Decrease rendering reference count
 		_effects[tech.effect_index].rendering--;
@@ -3589,6 +4191,8 @@ void reshade::runtime::destroy_effects()
 	assert(_techniques.empty() && _technique_sorting.empty());
 
 	_textures_loaded = false;
+	_reload_remaining_textures = std::numeric_limits<size_t>::max();
+	_texture_upload_queue.clear();
 	_should_reload_effect = std::numeric_limits<size_t>::max();
 }
 
@@ -3640,7 +4244,7 @@ void reshade::runtime::clear_effect_cache()
 
 		const std::filesystem::path filename = entry.path().filename();
 		const std::filesystem::path extension = entry.path().extension();
-		if (filename.native().compare(0, 8, L"reshade-") != 0 || (extension != L".i" && extension != L".cso" && extension != L".asm"))
+		if (filename.native().compare(0, 8, L"reshade-") != 0 || (extension != L".i" && extension != L".cso" && extension != L".asm" && extension != L".lut" && extension != L".tex"))
 			continue;
 
 		std::filesystem::remove(entry, ec);
@@ -3764,6 +4368,22 @@ void reshade::runtime::update_effects()
 		_should_reload_effect = std::numeric_limits<size_t>::max();
 	}
 
+#if RESHADE_GUI
+	// Pipeline statistics queries are not supported everywhere and add overhead to every pass, so only create their query heaps once they are gathered the first time
+	if ((_gather_gpu_statistics && _gather_pass_statistics) || _timeline.is_recording())
+	{
+		for (effect &effect : _effects)
+		{
+			if (effect.num_pipeline_statistics_queries == 0 || effect.pipeline_statistics_query_heap != 0)
+				continue;
+
+			// Do not try again every frame if this is not supported
+			if (!_device->create_query_heap(api::query_type::pipeline_statistics, effect.num_pipeline_statistics_queries, &effect.pipeline_statistics_query_heap))
+				effect.num_pipeline_statistics_queries = 0;
+		}
+	}
+#endif
+
 	if (_reload_remaining_effects == 0)
 	{
 		// Clear the thread list now that they all have finished
@@ -3852,12 +4472,20 @@ void reshade::runtime::update_effects()
 
 	if (!_textures_loaded && _reload_create_queue.empty())
 	{
-		// Now that all effects were created, load all textures
-		load_textures();
+		// Now that all effects were created, start loading all textures in the background
+		if (_reload_remaining_textures == std::numeric_limits<size_t>::max())
+			load_textures();
+
+		// Upload those textures that finished loading, until all of them are done
+		if (upload_textures())
+		{
+			_textures_loaded = true;
+			_reload_remaining_textures = std::numeric_limits<size_t>::max();
 
 #if RESHADE_ADDON
-		invoke_addon_event<addon_event::reshade_reloaded_effects>(this);
+			invoke_addon_event<addon_event::reshade_reloaded_effects>(this);
 #endif
+		}
 	}
 }
 void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource_view rtv, api::resource_view rtv_srgb)
@@ -3868,7 +4496,8 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 	_effects_rendered_this_frame = true;
 
 	// Nothing to do here if effects are still loading or disabled globally
-	if (is_loading() || !_effects_enabled || _techniques.empty())
+	// Textures that are still loading are instead checked per effect below, so that effects can render as soon as their own textures are ready
+	if (_reload_remaining_effects != std::numeric_limits<size_t>::max() || !_reload_create_queue.empty() || !_effects_enabled || _techniques.empty())
 		return;
 
 #ifdef NDEBUG
@@ -4142,7 +4771,7 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 				disable_technique(tech);
 		}
 
-		if (tech.passes_data.empty() || !tech.enabled || (_should_save_screenshot && !tech.enabled_in_screenshot))
+		if (tech.passes_data.empty() || !tech.enabled || (_should_save_screenshot && !tech.enabled_in_screenshot) || _effects[tech.effect_index].pending_textures != 0)
 			continue; // Ignore techniques that are not fully loaded or currently disabled
 
 		render_technique(tech, cmd_list, back_buffer_resource, rtv, rtv_srgb);
@@ -4171,17 +4800,33 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 	const effect &effect = _effects[tech.effect_index];
 
 #if RESHADE_GUI
-	if (_gather_gpu_statistics && _timestamp_frequency != 0 && effect.query_heap != 0)
-	{
-		// Evaluate queries from oldest frame in queue
-		if (uint64_t timestamps[2];
-			_device->get_query_heap_results(effect.query_heap, tech.query_base_index + (_frame_count % 4) * 2, 2, timestamps, sizeof(uint64_t)))
-			tech.average_gpu_duration.append((timestamps[1] - timestamps[0]) * 1000000000ull / _timestamp_frequency);
+	const std::chrono::high_resolution_clock::time_point time_technique_started = std::chrono::high_resolution_clock::now();
 
-		cmd_list->end_query(effect.query_heap, api::query_type::timestamp, tech.query_base_index + (_frame_count % 4) * 2);
+	const uint32_t query_slot_index = _frame_count % 4;
+	const uint32_t timestamp_query_index = tech.query_base_index + query_slot_index * static_cast<uint32_t>(tech.passes.size() + 1);
+	const uint32_t pipeline_statistics_query_index = tech.pipeline_statistics_query_base_index + query_slot_index * static_cast<uint32_t>(tech.passes.size());
+
+	// Evaluate queries from oldest frame in queue (results that are not available yet are skipped, rather than waiting for them)
+	if (tech.query_slots[query_slot_index].pending)
+		evaluate_technique_queries(tech, query_slot_index);
+
+	const bool gather_gpu_statistics = (_gather_gpu_statistics || _timeline.is_recording()) && _timestamp_frequency != 0 && effect.query_heap != 0;
+	const bool gather_pass_statistics = gather_gpu_statistics && (_gather_pass_statistics || _timeline.is_recording());
+	const bool gather_pipeline_statistics = gather_pass_statistics && effect.pipeline_statistics_query_heap != 0;
+
+	if (gather_gpu_statistics)
+	{
+		cmd_list->end_query(effect.query_heap, api::query_type::timestamp, timestamp_query_index);
+
+		technique::query_slot &slot = tech.query_slots[query_slot_index];
+		slot.pending = true;
+		slot.per_pass = gather_pass_statistics;
+		slot.pipeline_statistics = gather_pipeline_statistics;
+		slot.frame_index = _frame_count;
+		slot.cpu_time = std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_started - _start_time).count();
 	}
 
-	const std::chrono::high_resolution_clock::time_point time_technique_started = std::chrono::high_resolution_clock::now();
+	std::chrono::high_resolution_clock::time_point time_pass_started = time_technique_started;
 #endif
 
 #ifndef NDEBUG
@@ -4226,6 +4871,11 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 		cmd_list->begin_debug_event((pass_info.name.empty() ? "Pass " + std::to_string(pass_index) : pass_info.name).c_str());
 #endif
 
+#if RESHADE_GUI
+		if (gather_pipeline_statistics)
+			cmd_list->begin_query(effect.pipeline_statistics_query_heap, api::query_type::pipeline_statistics, pipeline_statistics_query_index + static_cast<uint32_t>(pass_index));
+#endif
+
 		const uint32_t num_barriers = static_cast<uint32_t>(pass_data.modified_resources.size());
 
 		if (!pass_info.cs_entry_point.empty())
@@ -4372,6 +5022,28 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 		for (const api::resource_view modified_texture : pass_data.generate_mipmap_views)
 			cmd_list->generate_mipmaps(modified_texture);
 
+#if RESHADE_GUI
+		if (gather_pipeline_statistics)
+			cmd_list->end_query(effect.pipeline_statistics_query_heap, api::query_type::pipeline_statistics, pipeline_statistics_query_index + static_cast<uint32_t>(pass_index));
+		if (gather_pass_statistics)
+			cmd_list->end_query(effect.query_heap, api::query_type::timestamp, timestamp_query_index + static_cast<uint32_t>(pass_index) + 1);
+
+		if (_timeline.is_recording())
+		{
+			const std::chrono::high_resolution_clock::time_point time_pass_finished = std::chrono::high_resolution_clock::now();
+
+			_timeline.add_span({
+				trace_timeline::span_track::cpu, "pass",
+				pass_info.name.empty() ? "Pass " + std::to_string(pass_index) : pass_info.name,
+				effect.source_file.filename().u8string(),
+				_frame_count,
+				static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time_pass_started - _start_time).count()),
+				static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time_pass_finished - _start_time).count()) });
+
+			time_pass_started = time_pass_finished;
+		}
+#endif
+
 #ifndef NDEBUG
 		cmd_list->end_debug_event();
 #endif
@@ -4384,10 +5056,22 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 #if RESHADE_GUI
 	const std::chrono::high_resolution_clock::time_point time_technique_finished = std::chrono::high_resolution_clock::now();
 
-	tech.average_cpu_duration.append(std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_finished - time_technique_started).count());
+	tech.cpu_duration.append(std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_finished - time_technique_started).count());
 
-	if (_gather_gpu_statistics && _timestamp_frequency != 0 && effect.query_heap != 0)
-		cmd_list->end_query(effect.query_heap, api::query_type::timestamp, tech.query_base_index + (_frame_count % 4) * 2 + 1);
+	// The timestamp after the last pass was already written above when gathering statistics per pass
+	if (gather_gpu_statistics && !gather_pass_statistics)
+		cmd_list->end_query(effect.query_heap, api::query_type::timestamp, timestamp_query_index + static_cast<uint32_t>(tech.passes.size()));
+
+	if (_timeline.is_recording())
+	{
+		_timeline.add_span({
+			trace_timeline::span_track::cpu, "technique",
+			tech.name,
+			effect.source_file.filename().u8string(),
+			_frame_count,
+			static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_started - _start_time).count()),
+			static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_finished - _start_time).count()) });
+	}
 #endif
 
 #if RESHADE_ADDON
@@ -4400,6 +5084,79 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 #endif
 }
 
+#if RESHADE_GUI
+void reshade::runtime::evaluate_technique_queries(technique &tech, uint32_t query_slot_index)
+{
+	const effect &effect = _effects[tech.effect_index];
+	technique::query_slot &slot = tech.query_slots[query_slot_index];
+	slot.pending = false;
+
+	const uint32_t num_passes = static_cast<uint32_t>(tech.passes.size());
+	const uint32_t timestamp_query_index = tech.query_base_index + query_slot_index * (num_passes + 1);
+	const uint32_t pipeline_statistics_query_index = tech.pipeline_statistics_query_base_index + query_slot_index * num_passes;
+
+	temp_mem<uint64_t> timestamps(num_passes + 1);
+	if (slot.per_pass ?
+			!_device->get_query_heap_results(effect.query_heap, timestamp_query_index, num_passes + 1, timestamps.p, sizeof(uint64_t)) :
+			!_device->get_query_heap_results(effect.query_heap, timestamp_query_index, 1, &timestamps[0], sizeof(uint64_t)) ||
+			!_device->get_query_heap_results(effect.query_heap, timestamp_query_index + num_passes, 1, &timestamps[num_passes], sizeof(uint64_t)))
+		return;
+
+	tech.gpu_duration.append((timestamps[num_passes] - timestamps[0]) * 1000000000ull / _timestamp_frequency);
+
+	const bool record_timeline = _timeline.is_recording();
+	const std::string effect_name = record_timeline ? effect.source_file.filename().u8string() : std::string();
+
+	if (record_timeline)
+	{
+		_timeline.add_span({
+			trace_timeline::span_track::gpu, "technique",
+			tech.name,
+			effect_name,
+			slot.frame_index,
+			_timeline.convert_gpu_timestamp(timestamps[0], slot.cpu_time),
+			_timeline.convert_gpu_timestamp(timestamps[num_passes], slot.cpu_time) });
+	}
+
+	if (!slot.per_pass)
+		return;
+
+	for (uint32_t pass_index = 0; pass_index < num_passes; ++pass_index)
+	{
+		technique::pass_data &pass_data = tech.passes_data[pass_index];
+
+		pass_data.gpu_duration.append((timestamps[pass_index + 1] - timestamps[pass_index]) * 1000000000ull / _timestamp_frequency);
+
+		// Layout matches 'D3D11_QUERY_DATA_PIPELINE_STATISTICS' and the statistics enabled for Vulkan query pools
+		// 'D3D10_QUERY_DATA_PIPELINE_STATISTICS' only has the first 8 of those fields (there are no hull, domain or compute shaders in D3D10), and querying it fails if the size does not match exactly
+		uint64_t pipeline_statistics[11] = {};
+		const uint32_t pipeline_statistics_size = _device->get_api() == api::device_api::d3d10 ? 8 * sizeof(uint64_t) : sizeof(pipeline_statistics);
+		const bool has_pipeline_statistics = slot.pipeline_statistics &&
+			_device->get_query_heap_results(effect.pipeline_statistics_query_heap, pipeline_statistics_query_index + pass_index, 1, pipeline_statistics, pipeline_statistics_size);
+		if (has_pipeline_statistics)
+		{
+			pass_data.pixel_shader_invocations = pipeline_statistics[7];
+			pass_data.compute_shader_invocations = pipeline_statistics[10];
+		}
+
+		if (record_timeline)
+		{
+			const reshadefx::pass_info &pass_info = tech.passes[pass_index];
+
+			_timeline.add_span({
+				trace_timeline::span_track::gpu, "pass",
+				pass_info.name.empty() ? "Pass " + std::to_string(pass_index) : pass_info.name,
+				effect_name,
+				slot.frame_index,
+				_timeline.convert_gpu_timestamp(timestamps[pass_index], slot.cpu_time),
+				_timeline.convert_gpu_timestamp(timestamps[pass_index + 1], slot.cpu_time),
+				has_pipeline_statistics ? pipeline_statistics[7] : std::numeric_limits<uint64_t>::max(),
+				has_pipeline_statistics && pipeline_statistics_size == sizeof(pipeline_statistics) ? pipeline_statistics[10] : std::numeric_limits<uint64_t>::max() });
+		}
+	}
+}
+#endif
+
 void reshade::runtime::save_texture(const texture &tex)
 {
 	if (tex.type == reshadefx::texture_type::texture_3d)
@@ -4437,7 +5194,7 @@ void reshade::runtime::save_texture(const texture &tex)
 				{
 #if 1
 					std::vector<uint8_t> encoded_data;
-					save_success = fpng::fpng_encode_image_to_memory(pixels.data(), width, height, 4, encoded_data);
+					save_success = _png_encoder->encode(pixels.data(), width, height, 4, encoded_data);
 					write_callback(&file, encoded_data.data(), static_cast<int>(encoded_data.size()));
 #else
 					save_success = stbi_write_png_to_func(write_callback, &file, width, height, 4, pixels.data(), 0) != 0;
@@ -4472,53 +5229,8 @@ void reshade::runtime::update_texture(texture &tex, uint32_t width, uint32_t hei
 
 	int type_size;
 	int num_channels;
-	switch (tex.format)
-	{
-	case reshadefx::texture_format::r8:
-		type_size = 1;
-		num_channels = 1;
-		break;
-	case reshadefx::texture_format::r16:
-	case reshadefx::texture_format::r16f:
-		type_size = 2;
-		num_channels = 1;
-		break;
-	case reshadefx::texture_format::r32i:
-	case reshadefx::texture_format::r32u:
-	case reshadefx::texture_format::r32f:
-		type_size = 4;
-		num_channels = 1;
-		break;
-	case reshadefx::texture_format::rg8:
-		type_size = 1;
-		num_channels = 2;
-		break;
-	case reshadefx::texture_format::rg16:
-	case reshadefx::texture_format::rg16f:
-		type_size = 2;
-		num_channels = 1;
-		break;
-	case reshadefx::texture_format::rg32f:
-		type_size = 4;
-		num_channels = 2;
-		break;
-	case reshadefx::texture_format::rgba8:
-	case reshadefx::texture_format::rgb10a2:
-		type_size = 1;
-		num_channels = 4;
-		break;
-	case reshadefx::texture_format::rgba16:
-	case reshadefx::texture_format::rgba16f:
-		type_size = 2;
-		num_channels = 4;
-		break;
-	case reshadefx::texture_format::rgba32f:
-		type_size = 4;
-		num_channels = 4;
-		break;
-	default:
+	if (!get_texture_data_layout(tex.format, type_size, num_channels))
 		return;
-	}
 
 	void *upload_data = const_cast<void *>(pixels);
 
@@ -4530,12 +5242,7 @@ void reshade::runtime::update_texture(texture &tex, uint32_t width, uint32_t hei
 
 		resized.resize(static_cast<size_t>(tex.width) * static_cast<size_t>(tex.height) * static_cast<size_t>(tex.depth) * static_cast<size_t>(type_size * num_channels));
 
-		if (type_size == 4)
-			stbir_resize_float(static_cast<const float *>(pixels), width, height, 0, reinterpret_cast<float *>(resized.data()), tex.width, tex.height, 0, num_channels);
-		else if (type_size == 2)
-			stbir_resize_uint16_generic(static_cast<const uint16_t *>(pixels), width, height, 0, reinterpret_cast<uint16_t *>(resized.data()), tex.width, tex.height, 0, num_channels, -1, 0, STBIR_EDGE_CLAMP, STBIR_FILTER_DEFAULT, STBIR_COLORSPACE_LINEAR, nullptr);
-		else
-			stbir_resize_uint8(static_cast<const uint8_t *>(pixels), width, height, 0, resized.data(), tex.width, tex.height, 0, num_channels);
+		resize_texture_data(pixels, width, height, resized.data(), tex.width, tex.height, type_size, num_channels);
 
 		upload_data = resized.data();
 	}
@@ -4919,102 +5626,237 @@ void reshade::runtime::save_screenshot(const std::string_view postfix)
 
 	_last_screenshot_save_successful = true;
 
-	if (std::vector<uint8_t> pixels(static_cast<size_t>(_width) * static_cast<size_t>(_height) * 4);
-		capture_screenshot(pixels.data()))
-	{
 #if RESHADE_FX
-		const bool include_preset = _screenshot_include_preset && postfix.empty() && ini_file::flush_cache(_current_preset_path);
+	const bool include_preset = _screenshot_include_preset && postfix.empty() && ini_file::flush_cache(_current_preset_path);
 #else
-		const bool include_preset = false;
+	const bool include_preset = false;
 #endif
-		// Play screenshot sound
-		if (!_screenshot_sound_path.empty())
-			utils::play_sound_async(g_reshade_base_path / _screenshot_sound_path);
-
-		_worker_threads.emplace_back([this, screenshot_count, screenshot_path, pixels = std::move(pixels), include_preset]() mutable {
-			// Remove alpha channel
-			int comp = 4;
-			if (_screenshot_clear_alpha)
-			{
-				comp = 3;
-				for (size_t i = 0; i < static_cast<size_t>(_width) * static_cast<size_t>(_height); ++i)
-					*reinterpret_cast<uint32_t *>(pixels.data() + 3 * i) = *reinterpret_cast<const uint32_t *>(pixels.data() + 4 * i);
-			}
 
-			// Create screenshot directory if it does not exist
-			std::error_code ec;
-			_screenshot_directory_creation_successful = true;
-			if (!std::filesystem::exists(screenshot_path.parent_path(), ec))
-				if (!(_screenshot_directory_creation_successful = std::filesystem::create_directories(screenshot_path.parent_path(), ec)))
-					LOG(ERROR) << "Failed to create screenshot directory " << screenshot_path.parent_path() << " with error code " << ec.value() << '!';
+	// Only copy the back buffer here and read it back a few frames later, once the GPU is done with the copy, to avoid stalling
+	pending_screenshot &screenshot = _pending_screenshots.emplace_back();
+	screenshot.screenshot_path = screenshot_path;
+	screenshot.screenshot_count = screenshot_count;
+	screenshot.include_preset = include_preset;
 
-			// Default to a save failure unless it is reported to succeed below
-			bool save_success = false;
+	if (!begin_texture_readback(
+			_back_buffer_resolved != 0 ? _back_buffer_resolved : _swapchain->get_current_back_buffer(),
+			_back_buffer_resolved != 0 ? api::resource_usage::render_target : api::resource_usage::present,
+			screenshot.readback_texture, screenshot.fence_value))
+	{
+		_pending_screenshots.pop_back();
+		_last_screenshot_save_successful = false;
+		return;
+	}
 
-			if (auto file = std::ofstream(screenshot_path, std::ios::binary | std::ios::trunc))
-			{
-				const auto write_callback = [](void *context, void *data, int size) {
-					static_cast<std::ofstream *>(context)->write(static_cast<const char *>(data), size);
-				};
+	// Limit the number of screenshots in flight, and read back immediately when there is no fence to track completion
+	if (screenshot.fence_value == 0 || _pending_screenshots.size() > 4)
+		process_pending_screenshots(true);
+}
+void reshade::runtime::process_pending_screenshots(bool wait)
+{
+	size_t num_processed = 0;
 
-				switch (_screenshot_format)
-				{
-				case 0:
-					save_success = stbi_write_bmp_to_func(write_callback, &file, _width, _height, comp, pixels.data()) != 0;
-					break;
-				case 1:
-				{
+	for (pending_screenshot &screenshot : _pending_screenshots)
+	{
+		// Process screenshots in the order they were taken
+		if (!wait && screenshot.fence_value != 0 && _device->get_completed_fence_value(_readback_fence) < screenshot.fence_value)
+			break;
+
+		num_processed++;
+
+		if (std::vector<uint8_t> pixels(static_cast<size_t>(_width) * static_cast<size_t>(_height) * 4);
+			finish_texture_readback(screenshot.readback_texture, screenshot.fence_value, pixels.data()))
+		{
+			// Play screenshot sound
+			if (!_screenshot_sound_path.empty())
+				utils::play_sound_async(g_reshade_base_path / _screenshot_sound_path);
+
+			write_screenshot(screenshot.screenshot_path, screenshot.screenshot_count, screenshot.include_preset, std::move(pixels));
+		}
+		else
+		{
+			_last_screenshot_save_successful = false;
+		}
+	}
+
+	_pending_screenshots.erase(_pending_screenshots.begin(), _pending_screenshots.begin() + num_processed);
+}
+void reshade::runtime::write_screenshot(const std::filesystem::path &screenshot_path, unsigned int screenshot_count, bool include_preset, std::vector<uint8_t> &&pixels)
+{
+	_worker_threads.emplace_back([this, screenshot_count, screenshot_path, pixels = std::move(pixels), include_preset]() mutable {
+		// Remove alpha channel
+		int comp = 4;
+		if (_screenshot_clear_alpha)
+		{
+			comp = 3;
+			strip_alpha_channel(pixels.data(), static_cast<size_t>(_width) * static_cast<size_t>(_height));
+		}
+
+		// Create screenshot directory if it does not exist
+		std::error_code ec;
+		_screenshot_directory_creation_successful = true;
+		if (!std::filesystem::exists(screenshot_path.parent_path(), ec))
+			if (!(_screenshot_directory_creation_successful = std::filesystem::create_directories(screenshot_path.parent_path(), ec)))
+				LOG(ERROR) << "Failed to create screenshot directory " << screenshot_path.parent_path() << " with error code " << ec.value() << '!';
+
+		// Default to a save failure unless it is reported to succeed below
+		bool save_success = false;
+
+		if (auto file = std::ofstream(screenshot_path, std::ios::binary | std::ios::trunc))
+		{
+			const auto write_callback = [](void *context, void *data, int size) {
+				static_cast<std::ofstream *>(context)->write(static_cast<const char *>(data), size);
+			};
+
+			switch (_screenshot_format)
+			{
+			case 0:
+				save_success = stbi_write_bmp_to_func(write_callback, &file, _width, _height, comp, pixels.data()) != 0;
+				break;
+			case 1:
+			{
 #if 1
-					std::vector<uint8_t> encoded_data;
-					save_success = fpng::fpng_encode_image_to_memory(pixels.data(), _width, _height, comp, encoded_data);
-					write_callback(&file, encoded_data.data(), static_cast<int>(encoded_data.size()));
+				std::vector<uint8_t> encoded_data;
+				save_success = _png_encoder->encode(pixels.data(), _width, _height, comp, encoded_data);
+				write_callback(&file, encoded_data.data(), static_cast<int>(encoded_data.size()));
 #else
-					save_success = stbi_write_png_to_func(write_callback, &file, _width, _height, comp, pixels.data(), 0) != 0;
+				save_success = stbi_write_png_to_func(write_callback, &file, _width, _height, comp, pixels.data(), 0) != 0;
 #endif
-					break;
-				}
-				case 2:
-					save_success = stbi_write_jpg_to_func(write_callback, &file, _width, _height, comp, pixels.data(), _screenshot_jpeg_quality) != 0;
-					break;
-				}
-
-				if (!file)
-					save_success = false;
+				break;
+			}
+			case 2:
+				save_success = stbi_write_jpg_to_func(write_callback, &file, _width, _height, comp, pixels.data(), _screenshot_jpeg_quality) != 0;
+				break;
 			}
 
-			if (save_success)
-			{
-				execute_screenshot_post_save_command(screenshot_path, screenshot_count);
+			if (!file)
+				save_success = false;
+		}
+
+		if (save_success)
+		{
+			execute_screenshot_post_save_command(screenshot_path, screenshot_count);
 
 #if RESHADE_FX
-				if (include_preset)
-				{
-					std::filesystem::path screenshot_preset_path = screenshot_path;
-					screenshot_preset_path.replace_extension(L".ini");
+			if (include_preset)
+			{
+				std::filesystem::path screenshot_preset_path = screenshot_path;
+				screenshot_preset_path.replace_extension(L".ini");
 
-					// Preset was flushed to disk, so can just copy it over to the new location
-					if (!std::filesystem::copy_file(_current_preset_path, screenshot_preset_path, std::filesystem::copy_options::overwrite_existing, ec))
-						LOG(ERROR) << "Failed to copy preset file for screenshot to " << screenshot_preset_path << " with error code " << ec.value() << '!';
-				}
+				// Preset was flushed to disk, so can just copy it over to the new location
+				if (!std::filesystem::copy_file(_current_preset_path, screenshot_preset_path, std::filesystem::copy_options::overwrite_existing, ec))
+					LOG(ERROR) << "Failed to copy preset file for screenshot to " << screenshot_preset_path << " with error code " << ec.value() << '!';
+			}
 #endif
 
 #if RESHADE_ADDON
-				invoke_addon_event<addon_event::reshade_screenshot>(this, screenshot_path.u8string().c_str());
+			invoke_addon_event<addon_event::reshade_screenshot>(this, screenshot_path.u8string().c_str());
 #endif
-			}
-			else
-			{
-				LOG(ERROR) << "Failed to write screenshot to " << screenshot_path << '!';
-			}
+		}
+		else
+		{
+			LOG(ERROR) << "Failed to write screenshot to " << screenshot_path << '!';
+		}
 
-			if (_last_screenshot_save_successful)
-			{
-				_last_screenshot_time = std::chrono::high_resolution_clock::now();
-				_last_screenshot_file = screenshot_path;
-				_last_screenshot_save_successful = save_success;
-			}
-		});
+		if (_last_screenshot_save_successful)
+		{
+			_last_screenshot_time = std::chrono::high_resolution_clock::now();
+			_last_screenshot_file = screenshot_path;
+			_last_screenshot_save_successful = save_success;
+		}
+	});
+}
+void reshade::runtime::start_frame_dump()
+{
+	// A frame dump counts as a screenshot for the purpose of file naming, so that it gets its own count
+	const unsigned int frame_dump_count = ++_screenshot_count;
+
+	const std::string frame_dump_name = expand_macro_string(_screenshot_name, {
+		{ "AppName", g_target_executable_path.stem().u8string() },
+#if RESHADE_FX
+		{ "PresetName",  _current_preset_path.stem().u8string() },
+		{ "Count", std::to_string(frame_dump_count) }
+#endif
+	});
+
+	std::filesystem::path frame_dump_path = g_reshade_base_path / _screenshot_path / std::filesystem::u8path(frame_dump_name + ".rsfd");
+
+	std::error_code ec;
+	if (!std::filesystem::exists(frame_dump_path.parent_path(), ec))
+		std::filesystem::create_directories(frame_dump_path.parent_path(), ec);
+
+	// Never overwrite an earlier dump, which could otherwise happen if the file naming does not contain the time or count (or two dumps are started within the same second)
+	for (unsigned int index = 2; std::filesystem::exists(frame_dump_path, ec); ++index)
+		frame_dump_path = g_reshade_base_path / _screenshot_path / std::filesystem::u8path(frame_dump_name + ' ' + std::to_string(index) + ".rsfd");
+
+	auto frame_dump = std::make_unique<frame_dump_writer>();
+	if (!frame_dump->open(frame_dump_path, _width, _height, _frame_dump_compression != 0 ? frame_dump_writer::compression::qoi : frame_dump_writer::compression::none))
+		return;
+
+	LOG(INFO) << "Starting frame dump to " << frame_dump_path << '.';
+
+	_frame_dump = std::move(frame_dump);
+	_frame_dump_start_time = std::chrono::high_resolution_clock::now();
+}
+void reshade::runtime::stop_frame_dump()
+{
+	if (_frame_dump == nullptr)
+		return;
+
+	process_pending_frame_dumps(0);
+
+	const std::filesystem::path frame_dump_path = _frame_dump->path();
+
+	// Not reported through the 'reshade_screenshot' event, since add-ons handling it expect an image file
+	if (_frame_dump->close())
+	{
+		LOG(INFO) << "Finished frame dump to " << frame_dump_path << " with " << _frame_dump->frame_count() << " frames.";
+
+		if (const uint64_t skipped_frame_count = _frame_dump->skipped_frame_count(); skipped_frame_count != 0)
+			LOG(WARN) << "Skipped " << skipped_frame_count << " frames in frame dump to " << frame_dump_path << ", because they could not be compressed and written fast enough.";
+	}
+	else
+	{
+		LOG(ERROR) << "Failed to write frame dump to " << frame_dump_path << '!';
 	}
+
+	_frame_dump.reset();
+}
+void reshade::runtime::capture_frame_dump()
+{
+	pending_frame_dump &frame = _pending_frame_dumps.emplace_back();
+	frame.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - _frame_dump_start_time).count();
+
+	if (!begin_texture_readback(
+			_back_buffer_resolved != 0 ? _back_buffer_resolved : _swapchain->get_current_back_buffer(),
+			_back_buffer_resolved != 0 ? api::resource_usage::render_target : api::resource_usage::present,
+			frame.readback_texture, frame.fence_value))
+	{
+		_pending_frame_dumps.pop_back();
+		stop_frame_dump();
+		return;
+	}
+
+	// Keep a few frames in flight so that the GPU copy overlaps with the next frames, but wait rather than drop a frame when the readback falls behind
+	process_pending_frame_dumps(frame.fence_value != 0 ? 3 : 0);
+}
+void reshade::runtime::process_pending_frame_dumps(size_t max_frames_in_flight)
+{
+	size_t num_processed = 0;
+
+	for (pending_frame_dump &frame : _pending_frame_dumps)
+	{
+		if ((_pending_frame_dumps.size() - num_processed) <= max_frames_in_flight && frame.fence_value != 0 && _device->get_completed_fence_value(_readback_fence) < frame.fence_value)
+			break;
+
+		num_processed++;
+
+		if (std::vector<uint8_t> pixels = _frame_dump->allocate_frame();
+			finish_texture_readback(frame.readback_texture, frame.fence_value, pixels.data()))
+			_frame_dump->write_frame(std::move(pixels), frame.timestamp);
+	}
+
+	_pending_frame_dumps.erase(_pending_frame_dumps.begin(), _pending_frame_dumps.begin() + num_processed);
 }
 bool reshade::runtime::execute_screenshot_post_save_command(const std::filesystem::path &screenshot_path, unsigned int screenshot_count)
 {
@@ -5052,110 +5894,176 @@ bool reshade::runtime::execute_screenshot_post_save_command(const std::filesyste
 	return true;
 }
 
+static bool is_readback_format_supported(reshade::api::format format)
+{
+	return
+		format == reshade::api::format::r8_unorm ||
+		format == reshade::api::format::r8g8_unorm ||
+		format == reshade::api::format::r8g8b8a8_unorm ||
+		format == reshade::api::format::b8g8r8a8_unorm ||
+		format == reshade::api::format::r8g8b8x8_unorm ||
+		format == reshade::api::format::b8g8r8x8_unorm ||
+		format == reshade::api::format::r10g10b10a2_unorm ||
+		format == reshade::api::format::b10g10r10a2_unorm;
+}
+
+bool reshade::runtime::export_statistics(const std::filesystem::path &path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		LOG(ERROR) << "Failed to open statistics file " << path << " for writing!";
+		return false;
+	}
+
+	// Effect file and technique names may contain separators or quotes, so quote those as described in RFC 4180
+	// Line breaks are written as CRLF, since the file is opened in text mode
+	const auto write_field = [&file](const std::string &value) {
+		if (value.find_first_of(",\"\r\n") == std::string::npos)
+		{
+			file << value;
+			return;
+		}
+
+		file << '\"';
+		for (const char c : value)
+		{
+			if (c == '\"')
+				file << '\"';
+			file << c;
+		}
+		file << '\"';
+	};
+	const auto write_row = [&file, &write_field](const std::string &effect_name, const std::string &name, const char *type, const api::duration_statistics &stats) {
+		write_field(effect_name);
+		file << ',';
+		write_field(name);
+		file << ',' << type << ',' << stats.sample_count << ',' <<
+			stats.mean * 1e-6 << ',' << stats.p50 * 1e-6 << ',' << stats.p95 * 1e-6 << ',' << stats.p99 * 1e-6 << ',' << stats.max * 1e-6 << '\n';
+	};
+
+	file << "Effect,Technique,Type,Samples,Mean (ms),P50 (ms),P95 (ms),P99 (ms),Max (ms)\n";
+	file.setf(std::ios::fixed);
+	file.precision(3);
+
+	api::duration_statistics frame_time_stats;
+	get_frame_time_statistics(&frame_time_stats);
+	write_row(std::string(), std::string(), "Frame", frame_time_stats);
+
+#if RESHADE_FX
+	if (!is_loading())
+	{
+		for (size_t technique_index : _technique_sorting)
+		{
+			const technique &tech = _techniques[technique_index];
+			if (!tech.enabled)
+				continue;
+
+			const std::string effect_name = _effects[tech.effect_index].source_file.filename().u8string();
+
+			api::duration_statistics cpu_stats, gpu_stats;
+			get_technique_statistics(api::effect_technique { reinterpret_cast<uintptr_t>(&tech) }, &cpu_stats, &gpu_stats);
+			write_row(effect_name, tech.name, "CPU", cpu_stats);
+			if (gpu_stats.sample_count != 0)
+				write_row(effect_name, tech.name, "GPU", gpu_stats);
+		}
+	}
+#endif
+
+	return !file.fail();
+}
+
 bool reshade::runtime::get_texture_data(api::resource resource, api::resource_usage state, uint8_t *pixels)
+{
+	api::resource readback_texture = {};
+	uint64_t fence_value = 0;
+	if (!begin_texture_readback(resource, state, readback_texture, fence_value))
+		return false;
+
+	return finish_texture_readback(readback_texture, fence_value, pixels);
+}
+bool reshade::runtime::begin_texture_readback(api::resource resource, api::resource_usage state, api::resource &readback_texture, uint64_t &fence_value)
 {
 	const api::resource_desc desc = _device->get_resource_desc(resource);
 	const api::format view_format = api::format_to_default_typed(desc.texture.format, 0);
 
-	if (view_format != api::format::r8_unorm &&
-		view_format != api::format::r8g8_unorm &&
-		view_format != api::format::r8g8b8a8_unorm &&
-		view_format != api::format::b8g8r8a8_unorm &&
-		view_format != api::format::r8g8b8x8_unorm &&
-		view_format != api::format::b8g8r8x8_unorm &&
-		view_format != api::format::r10g10b10a2_unorm &&
-		view_format != api::format::b10g10r10a2_unorm)
+	if (!is_readback_format_supported(view_format))
 	{
 		LOG(ERROR) << "Screenshots are not supported for format " << static_cast<uint32_t>(desc.texture.format) << '!';
 		return false;
 	}
 
-	// Copy back buffer data into system memory buffer
-	api::resource intermediate;
-	if (!_device->create_resource(api::resource_desc(desc.texture.width, desc.texture.height, 1, 1, view_format, 1, api::memory_heap::gpu_to_cpu, api::resource_usage::copy_dest), nullptr, api::resource_usage::copy_dest, &intermediate))
+	// Reuse a previously created system memory texture if possible
+	readback_texture = {};
+	for (auto it = _readback_textures.begin(); it != _readback_textures.end(); ++it)
 	{
-		LOG(ERROR) << "Failed to create system memory texture for screenshot capture!";
-		return false;
+		if (const api::resource_desc readback_desc = _device->get_resource_desc(*it);
+			readback_desc.texture.width == desc.texture.width && readback_desc.texture.height == desc.texture.height && readback_desc.texture.format == view_format)
+		{
+			readback_texture = *it;
+			_readback_textures.erase(it);
+			break;
+		}
 	}
 
-	_device->set_resource_name(intermediate, "ReShade screenshot texture");
+	if (readback_texture == 0)
+	{
+		if (!_device->create_resource(api::resource_desc(desc.texture.width, desc.texture.height, 1, 1, view_format, 1, api::memory_heap::gpu_to_cpu, api::resource_usage::copy_dest), nullptr, api::resource_usage::copy_dest, &readback_texture))
+		{
+			LOG(ERROR) << "Failed to create system memory texture for screenshot capture!";
+			return false;
+		}
+
+		_device->set_resource_name(readback_texture, "ReShade screenshot texture");
+	}
 
+	// Copy back buffer data into system memory texture
 	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
 	cmd_list->barrier(resource, state, api::resource_usage::copy_source);
-	cmd_list->copy_texture_region(resource, 0, nullptr, intermediate, 0, nullptr);
+	cmd_list->copy_texture_region(resource, 0, nullptr, readback_texture, 0, nullptr);
 	cmd_list->barrier(resource, api::resource_usage::copy_source, state);
 
-	// Wait for any rendering by the application finish before submitting
-	// It may have submitted that to a different queue, so simply wait for all to idle here
-	_graphics_queue->wait_idle();
+	// Track completion of the copy with a fence if possible, so that the result can be read back later without waiting for the GPU to idle
+	if (_readback_fence == 0 && !_device->create_fence(_readback_fence_value, api::fence_flags::none, &_readback_fence))
+		_readback_fence = {};
 
-	// Copy data from intermediate image into output buffer
-	api::subresource_data mapped_data = {};
-	if (_device->map_texture_region(intermediate, 0, nullptr, api::map_access::read_only, &mapped_data))
+	fence_value = 0;
+	if (_readback_fence != 0 && _graphics_queue->signal(_readback_fence, _readback_fence_value + 1))
+		fence_value = ++_readback_fence_value;
+
+	return true;
+}
+bool reshade::runtime::finish_texture_readback(api::resource readback_texture, uint64_t fence_value, uint8_t *pixels)
+{
+	if (fence_value != 0)
+	{
+		_device->wait(_readback_fence, fence_value);
+	}
+	else
 	{
-		auto mapped_pixels = static_cast<const uint8_t *>(mapped_data.data);
-		const uint32_t pixels_row_pitch = desc.texture.width * 4;
+		// Wait for any rendering by the application finish before submitting
+		// It may have submitted that to a different queue, so simply wait for all to idle here
+		_graphics_queue->wait_idle();
+	}
 
-		for (size_t y = 0; y < desc.texture.height; ++y, pixels += pixels_row_pitch, mapped_pixels += mapped_data.row_pitch)
-		{
-			switch (view_format)
-			{
-			case api::format::r8_unorm:
-				for (size_t x = 0; x < desc.texture.width; ++x)
-				{
-					pixels[x * 4 + 0] = mapped_pixels[x];
-					pixels[x * 4 + 1] = 0;
-					pixels[x * 4 + 2] = 0;
-					pixels[x * 4 + 3] = 0xFF;
-				}
-				break;
-			case api::format::r8g8_unorm:
-				for (size_t x = 0; x < desc.texture.width; ++x)
-				{
-					pixels[x * 4 + 0] = mapped_pixels[x * 2 + 0];
-					pixels[x * 4 + 1] = mapped_pixels[x * 2 + 1];
-					pixels[x * 4 + 2] = 0;
-					pixels[x * 4 + 3] = 0xFF;
-				}
-				break;
-			case api::format::r8g8b8a8_unorm:
-			case api::format::r8g8b8x8_unorm:
-				std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
-				if (view_format == api::format::r8g8b8x8_unorm)
-					for (size_t x = 0; x < pixels_row_pitch; x += 4)
-						pixels[x + 3] = 0xFF;
-				break;
-			case api::format::b8g8r8a8_unorm:
-			case api::format::b8g8r8x8_unorm:
-				std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
-				// Format is BGRA, but output should be RGBA, so flip channels
-				for (size_t x = 0; x < pixels_row_pitch; x += 4)
-					std::swap(pixels[x + 0], pixels[x + 2]);
-				if (view_format == api::format::b8g8r8x8_unorm)
-					for (size_t x = 0; x < pixels_row_pitch; x += 4)
-						pixels[x + 3] = 0xFF;
-				break;
-			case api::format::r10g10b10a2_unorm:
-			case api::format::b10g10r10a2_unorm:
-				for (size_t x = 0; x < pixels_row_pitch; x += 4)
-				{
-					const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_pixels + x);
-					// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-					pixels[x + 0] = (( rgba & 0x000003FF)        /  4) & 0xFF;
-					pixels[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-					pixels[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-					pixels[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-					if (view_format == api::format::b10g10r10a2_unorm)
-						std::swap(pixels[x + 0], pixels[x + 2]);
-				}
-				break;
-			}
-		}
+	const api::resource_desc desc = _device->get_resource_desc(readback_texture);
 
-		_device->unmap_texture_region(intermediate, 0);
+	// Copy data from system memory texture into output buffer
+	api::subresource_data mapped_data = {};
+	if (_device->map_texture_region(readback_texture, 0, nullptr, api::map_access::read_only, &mapped_data))
+	{
+		api::convert_texture_to_rgba8(desc.texture.format, desc.texture.width, desc.texture.height, mapped_data.data, mapped_data.row_pitch, pixels, desc.texture.width * 4);
+
+		_device->unmap_texture_region(readback_texture, 0);
 	}
 
-	_device->destroy_resource(intermediate);
+	// Keep system memory texture around for the next capture (but only a few, since they may have been created for textures of various sizes)
+	_readback_textures.push_back(readback_texture);
+	if (_readback_textures.size() > 8)
+	{
+		_device->destroy_resource(_readback_textures.front());
+		_readback_textures.erase(_readback_textures.begin());
+	}
 
 	return mapped_data.data != nullptr;
 }
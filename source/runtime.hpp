@@ -8,9 +8,13 @@
 #include "reshade_api.hpp"
 #include "state_block.hpp"
 #include "imgui_code_editor.hpp"
+#include "preset_library.hpp"
+#include "duration_histogram.hpp"
+#include "trace_timeline.hpp"
 #include <chrono>
 #include <memory>
 #include <filesystem>
+#include <mutex>
 #include <atomic>
 #include <shared_mutex>
 
@@ -22,6 +26,7 @@ namespace reshade
 	struct uniform;
 	struct texture;
 	struct technique;
+	struct texture_load_job;
 
 	/// <summary>
 	/// The main ReShade post-processing effect runtime.
@@ -165,6 +170,14 @@ namespace reshade
 
 		void set_color_space(api::color_space color_space) final { _back_buffer_color_space = color_space; }
 
+		void get_frame_time_statistics(api::duration_statistics *out_statistics) const final;
+		bool get_technique_statistics(api::effect_technique technique, api::duration_statistics *out_cpu_statistics, api::duration_statistics *out_gpu_statistics) const final;
+
+		/// <summary>
+		/// Writes the current frame time and per-technique timing statistics to a CSV file.
+		/// </summary>
+		bool export_statistics(const std::filesystem::path &path) const;
+
 	private:
 		static void check_for_update();
 
@@ -183,6 +196,8 @@ namespace reshade
 		void destroy_effect(size_t effect_index);
 
 		void load_textures();
+		bool load_texture_source(texture_load_job &job) const;
+		bool upload_textures();
 		bool create_texture(texture &texture);
 		void destroy_texture(texture &texture);
 
@@ -204,6 +219,9 @@ namespace reshade
 
 		void update_effects();
 		void render_technique(technique &technique, api::command_list *cmd_list, api::resource back_buffer_resource, api::resource_view back_buffer_rtv, api::resource_view back_buffer_rtv_srgb);
+#if RESHADE_GUI
+		void evaluate_technique_queries(technique &technique, uint32_t query_slot_index);
+#endif
 
 		void save_texture(const texture &texture);
 		void update_texture(texture &texture, uint32_t width, uint32_t height, uint32_t depth, const void *pixels);
@@ -233,6 +251,16 @@ namespace reshade
 #endif
 
 		bool get_texture_data(api::resource resource, api::resource_usage state, uint8_t *pixels);
+		bool begin_texture_readback(api::resource resource, api::resource_usage state, api::resource &readback_texture, uint64_t &fence_value);
+		bool finish_texture_readback(api::resource readback_texture, uint64_t fence_value, uint8_t *pixels);
+
+		void process_pending_screenshots(bool wait);
+		void write_screenshot(const std::filesystem::path &screenshot_path, unsigned int screenshot_count, bool include_preset, std::vector<uint8_t> &&pixels);
+
+		void start_frame_dump();
+		void stop_frame_dump();
+		void capture_frame_dump();
+		void process_pending_frame_dumps(size_t max_frames_in_flight);
 
 		bool execute_screenshot_post_save_command(const std::filesystem::path &screenshot_path, unsigned int screenshot_count);
 
@@ -275,6 +303,7 @@ namespace reshade
 
 		std::chrono::high_resolution_clock::duration _last_frame_duration;
 		std::chrono::high_resolution_clock::time_point _start_time, _last_present_time;
+		duration_histogram<600> _frame_time_statistics;
 		uint64_t _frame_count = 0;
 		#pragma endregion
 
@@ -302,6 +331,9 @@ namespace reshade
 		std::shared_mutex _reload_mutex;
 		std::vector<size_t> _reload_create_queue;
 		std::atomic<size_t> _reload_remaining_effects = std::numeric_limits<size_t>::max();
+		std::atomic<size_t> _reload_remaining_textures = std::numeric_limits<size_t>::max();
+		std::mutex _texture_upload_mutex;
+		std::vector<texture_load_job> _texture_upload_queue;
 		void *_d3d_compiler_module = nullptr;
 
 		std::vector<effect> _effects;
@@ -369,9 +401,39 @@ namespace reshade
 
 		bool _should_save_screenshot = false;
 		std::atomic<bool> _last_screenshot_save_successful = true;
+
+		struct pending_screenshot
+		{
+			api::resource readback_texture;
+			uint64_t fence_value;
+			std::filesystem::path screenshot_path;
+			unsigned int screenshot_count;
+			bool include_preset;
+		};
+
+		api::fence _readback_fence = {};
+		uint64_t _readback_fence_value = 0;
+		std::vector<api::resource> _readback_textures;
+		std::vector<pending_screenshot> _pending_screenshots;
 		bool _screenshot_directory_creation_successful = true;
 		std::filesystem::path _last_screenshot_file;
 		std::chrono::high_resolution_clock::time_point _last_screenshot_time;
+		// Keeps its threads for the lifetime of the runtime, so that saving a screenshot does not have to create new ones every time
+		std::unique_ptr<class png_encoder> _png_encoder;
+
+		unsigned int _frame_dump_key_data[4] = {};
+		unsigned int _frame_dump_compression = 1;
+
+		struct pending_frame_dump
+		{
+			api::resource readback_texture;
+			uint64_t fence_value;
+			uint64_t timestamp;
+		};
+
+		std::unique_ptr<class frame_dump_writer> _frame_dump;
+		std::vector<pending_frame_dump> _pending_frame_dumps;
+		std::chrono::high_resolution_clock::time_point _frame_dump_start_time;
 		#pragma endregion
 
 		#pragma region Preset Switching
@@ -381,6 +443,7 @@ namespace reshade
 		unsigned int _preset_transition_duration = 1000;
 		std::filesystem::path _startup_preset_path;
 		std::filesystem::path _current_preset_path;
+		preset_library _preset_library;
 
 		bool _is_in_preset_transition = false;
 		std::chrono::high_resolution_clock::time_point _last_preset_switching_time;
@@ -510,6 +573,8 @@ namespace reshade
 		#pragma region Overlay Statistics
 #if RESHADE_FX
 		bool _gather_gpu_statistics = false;
+		bool _gather_pass_statistics = false;
+		trace_timeline _timeline;
 		api::resource_view _preview_texture = {};
 		unsigned int _preview_size[3] = { 0, 0, 0xFFFFFFFF };
 		uint64_t _timestamp_frequency = 0;
@@ -1436,6 +1436,43 @@ void reshade::runtime::reorder_techniques([[maybe_unused]] size_t count, [[maybe
 #endif
 }
 
+template <size_t SAMPLES>
+static void fill_duration_statistics(const duration_histogram<SAMPLES> &histogram, reshade::api::duration_statistics *out_statistics)
+{
+	if (out_statistics == nullptr)
+		return;
+
+	out_statistics->sample_count = static_cast<uint32_t>(histogram.count());
+	out_statistics->mean = histogram.mean();
+	out_statistics->p50 = histogram.percentile(50.0);
+	out_statistics->p95 = histogram.percentile(95.0);
+	out_statistics->p99 = histogram.percentile(99.0);
+	out_statistics->max = histogram.max();
+}
+
+void reshade::runtime::get_frame_time_statistics(api::duration_statistics *out_statistics) const
+{
+	fill_duration_statistics(_frame_time_statistics, out_statistics);
+}
+bool reshade::runtime::get_technique_statistics([[maybe_unused]] api::effect_technique handle, api::duration_statistics *out_cpu_statistics, api::duration_statistics *out_gpu_statistics) const
+{
+#if RESHADE_FX
+	const auto tech = reinterpret_cast<const technique *>(handle.handle);
+	if (tech != nullptr)
+	{
+		fill_duration_statistics(tech->cpu_duration, out_cpu_statistics);
+		fill_duration_statistics(tech->gpu_duration, out_gpu_statistics);
+		return true;
+	}
+#endif
+
+	if (out_cpu_statistics != nullptr)
+		*out_cpu_statistics = {};
+	if (out_gpu_statistics != nullptr)
+		*out_gpu_statistics = {};
+	return false;
+}
+
 #if RESHADE_GUI == 0
 bool reshade::runtime::open_overlay(bool /*open*/, api::input_source /*source*/)
 {
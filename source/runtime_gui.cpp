@@ -84,6 +84,14 @@ static std::string_view get_localized_annotation(T &object, const std::string_vi
 	return object.annotation_as_string(ann_name);
 }
 
+template <size_t SAMPLES>
+static void draw_duration_percentiles_tooltip(const duration_histogram<SAMPLES> &histogram)
+{
+	if (ImGui::IsItemHovered(ImGuiHoveredFlags_ForTooltip) && histogram.count() != 0)
+		ImGui::SetTooltip("P50 %.3f ms\nP95 %.3f ms\nP99 %.3f ms\nMax %.3f ms",
+			histogram.percentile(50.0) * 1e-6f, histogram.percentile(95.0) * 1e-6f, histogram.percentile(99.0) * 1e-6f, histogram.max() * 1e-6f);
+}
+
 static const ImVec4 COLOR_RED = ImColor(240, 100, 100);
 static const ImVec4 COLOR_YELLOW = ImColor(204, 204, 0);
 
@@ -1585,7 +1593,7 @@ void reshade::runtime::draw_gui_home()
 		if (imgui::file_dialog("##browse", _file_selection_path, browse_button_width, { L".ini", L".txt" }, { _config_path, global_config().path() }))
 		{
 			// Check that this is actually a valid preset file
-			if (ini_file::load_cache(_file_selection_path).has({}, "Techniques"))
+			if (_preset_library.contains(_file_selection_path) || ini_file::load_cache(_file_selection_path).has({}, "Techniques"))
 			{
 				reload_preset = true;
 				_current_preset_path = _file_selection_path;
@@ -2003,6 +2011,8 @@ void reshade::runtime::draw_gui_settings()
 		if (_input != nullptr)
 		{
 			modified |= imgui::key_input_box(_("Screenshot key"), _screenshot_key_data, *_input);
+			modified |= imgui::key_input_box(_("Frame dump key"), _frame_dump_key_data, *_input);
+			ImGui::SetItemTooltip(_("Starts or stops writing every presented frame to a single lossless frame dump file in the screenshot path."));
 		}
 
 		modified |= imgui::directory_input_box(_("Screenshot path"), _screenshot_path, _file_selection_path);
@@ -2048,6 +2058,8 @@ void reshade::runtime::draw_gui_settings()
 		else
 			modified |= ImGui::Checkbox(_("Clear alpha channel"), &_screenshot_clear_alpha);
 
+		modified |= ImGui::Combo(_("Frame dump compression"), reinterpret_cast<int *>(&_frame_dump_compression), "None\0QOI (lossless)\0");
+
 #if RESHADE_FX
 		modified |= ImGui::Checkbox(_("Save current preset file"), &_screenshot_include_preset);
 		modified |= ImGui::Checkbox(_("Save before and after images"), &_screenshot_save_before);
@@ -2369,10 +2381,12 @@ void reshade::runtime::draw_gui_statistics()
 	{
 		for (const technique &tech : _techniques)
 		{
-			cpu_digits = std::max(cpu_digits, tech.average_cpu_duration >= 100'000'000 ? 3u : tech.average_cpu_duration >= 10'000'000 ? 2u : 1u);
-			post_processing_time_cpu += tech.average_cpu_duration;
-			gpu_digits = std::max(gpu_digits, tech.average_gpu_duration >= 100'000'000 ? 3u : tech.average_gpu_duration >= 10'000'000 ? 2u : 1u);
-			post_processing_time_gpu += tech.average_gpu_duration;
+			const uint64_t average_cpu_duration = tech.cpu_duration.mean();
+			cpu_digits = std::max(cpu_digits, average_cpu_duration >= 100'000'000 ? 3u : average_cpu_duration >= 10'000'000 ? 2u : 1u);
+			post_processing_time_cpu += average_cpu_duration;
+			const uint64_t average_gpu_duration = tech.gpu_duration.mean();
+			gpu_digits = std::max(gpu_digits, average_gpu_duration >= 100'000'000 ? 3u : average_gpu_duration >= 10'000'000 ? 2u : 1u);
+			post_processing_time_gpu += average_gpu_duration;
 		}
 	}
 #endif
@@ -2431,6 +2445,9 @@ void reshade::runtime::draw_gui_statistics()
 		case api::device_api::vulkan:
 			api_name = "Vulkan";
 			break;
+		case api::device_api::null:
+			api_name = "Null";
+			break;
 		}
 
 		ImGui::TextUnformatted(api_name);
@@ -2457,12 +2474,50 @@ void reshade::runtime::draw_gui_statistics()
 		ImGui::Text("0x%X", std::hash<std::string>()(g_target_executable_path.stem().u8string()) & 0xFFFFFFFF);
 		ImGui::Text("%.0f ms", std::chrono::duration_cast<std::chrono::nanoseconds>(_last_present_time - _start_time).count() * 1e-6f);
 		ImGui::Text("%*.3f ms", gpu_digits + 4, _last_frame_duration.count() * 1e-6f);
+		draw_duration_percentiles_tooltip(_frame_time_statistics);
 #if RESHADE_FX
 		if (_gather_gpu_statistics && post_processing_time_gpu != 0)
 			ImGui::Text("%*.3f ms GPU", gpu_digits + 4, (post_processing_time_gpu * 1e-6f));
 #endif
 
 		ImGui::EndGroup();
+
+		if (ImGui::Button(_("Export statistics to CSV"), ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+		{
+			const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+			struct tm tm; localtime_s(&tm, &t);
+
+			char file_name[64];
+			ImFormatString(file_name, sizeof(file_name), "ReShade_Statistics_%04d-%02d-%02d_%02d-%02d-%02d.csv", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+			export_statistics(g_reshade_base_path / file_name);
+		}
+
+#if RESHADE_FX
+		if (ImGui::Button(_timeline.is_recording() ? _("Stop timeline capture") : _("Start timeline capture"), ImVec2((ImGui::GetContentRegionAvail().x - _imgui_context->Style.ItemSpacing.x) / 2, 0)))
+		{
+			if (_timeline.is_recording())
+				_timeline.stop();
+			else
+				_timeline.start(_timestamp_frequency);
+		}
+
+		ImGui::SameLine();
+
+		ImGui::BeginDisabled(_timeline.is_recording() || _timeline.empty());
+		if (ImGui::Button(_("Export timeline as Chrome trace"), ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+		{
+			const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+			struct tm tm; localtime_s(&tm, &t);
+
+			char file_name[64];
+			ImFormatString(file_name, sizeof(file_name), "ReShade_Timeline_%04d-%02d-%02d_%02d-%02d-%02d.json", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+			if (_timeline.export_chrome_trace(g_reshade_base_path / file_name))
+				_timeline.clear();
+		}
+		ImGui::EndDisabled();
+#endif
 	}
 
 #if RESHADE_FX
@@ -2471,6 +2526,9 @@ void reshade::runtime::draw_gui_statistics()
 		// Only need to gather GPU statistics if the statistics are actually visible
 		_gather_gpu_statistics = true;
 
+		ImGui::Checkbox(_("Measure individual passes"), &_gather_pass_statistics);
+		ImGui::SetItemTooltip(_("Records a GPU timestamp (and pipeline statistics where supported) after every pass, to find out which pass of a technique is the expensive one."));
+
 		ImGui::BeginGroup();
 
 		std::vector<bool> long_technique_name(_techniques.size());
@@ -2489,6 +2547,17 @@ void reshade::runtime::draw_gui_statistics()
 			long_technique_name[technique_index] = (ImGui::GetItemRectSize().x + 10.0f) > (ImGui::GetWindowWidth() * 0.33333333f);
 			if (long_technique_name[technique_index])
 				ImGui::NewLine();
+
+			if (_gather_pass_statistics)
+			{
+				for (size_t pass_index = 0; pass_index < tech.passes.size(); ++pass_index)
+				{
+					if (tech.passes[pass_index].name.empty())
+						ImGui::TextDisabled("  Pass %zu", pass_index);
+					else
+						ImGui::TextDisabled("  %s", tech.passes[pass_index].name.c_str());
+				}
+			}
 		}
 
 		ImGui::EndGroup();
@@ -2505,10 +2574,29 @@ void reshade::runtime::draw_gui_statistics()
 			if (long_technique_name[technique_index])
 				ImGui::NewLine();
 
-			if (tech.average_cpu_duration != 0)
-				ImGui::Text("%*.3f ms CPU", cpu_digits + 4, tech.average_cpu_duration * 1e-6f);
+			if (tech.cpu_duration.mean() != 0)
+			{
+				ImGui::Text("%*.3f ms CPU", cpu_digits + 4, tech.cpu_duration.mean() * 1e-6f);
+				draw_duration_percentiles_tooltip(tech.cpu_duration);
+			}
 			else
+			{
 				ImGui::NewLine();
+			}
+
+			if (_gather_pass_statistics)
+			{
+				for (const technique::pass_data &pass_data : tech.passes_data)
+				{
+					// Pipeline statistics are not available for all APIs
+					if (pass_data.compute_shader_invocations != 0)
+						ImGui::TextDisabled("%llu CS invocations", pass_data.compute_shader_invocations);
+					else if (pass_data.pixel_shader_invocations != 0)
+						ImGui::TextDisabled("%llu PS invocations", pass_data.pixel_shader_invocations);
+					else
+						ImGui::NewLine();
+				}
+			}
 		}
 
 		ImGui::EndGroup();
@@ -2526,10 +2614,31 @@ void reshade::runtime::draw_gui_statistics()
 				ImGui::NewLine();
 
 			// GPU timings are not available for all APIs
-			if (_gather_gpu_statistics && tech.average_gpu_duration != 0)
-				ImGui::Text("%*.3f ms GPU", gpu_digits + 4, tech.average_gpu_duration * 1e-6f);
+			if (_gather_gpu_statistics && tech.gpu_duration.mean() != 0)
+			{
+				ImGui::Text("%*.3f ms GPU", gpu_digits + 4, tech.gpu_duration.mean() * 1e-6f);
+				draw_duration_percentiles_tooltip(tech.gpu_duration);
+			}
 			else
+			{
 				ImGui::NewLine();
+			}
+
+			if (_gather_pass_statistics)
+			{
+				for (const technique::pass_data &pass_data : tech.passes_data)
+				{
+					if (pass_data.gpu_duration.mean() != 0)
+					{
+						ImGui::TextDisabled("%*.3f ms GPU", gpu_digits + 4, pass_data.gpu_duration.mean() * 1e-6f);
+						draw_duration_percentiles_tooltip(pass_data.gpu_duration);
+					}
+					else
+					{
+						ImGui::NewLine();
+					}
+				}
+			}
 		}
 
 		ImGui::EndGroup();
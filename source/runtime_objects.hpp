@@ -6,7 +6,10 @@
 #pragma once
 
 #include "effect_module.hpp"
-#include "moving_average.hpp"
+#include "duration_histogram.hpp"
+#include <memory>
+#include <cstdlib>
+#include <filesystem>
 
 namespace reshade
 {
@@ -209,17 +212,52 @@ namespace reshade
 			api::descriptor_table storage_table = {};
 			std::vector<api::resource> modified_resources;
 			std::vector<api::resource_view> generate_mipmap_views;
+
+			duration_histogram<600> gpu_duration;
+			uint64_t pixel_shader_invocations = 0;
+			uint64_t compute_shader_invocations = 0;
+		};
+
+		/// <summary>
+		/// State of the queries recorded for one of the frames in flight, which are read back a few frames later.
+		/// </summary>
+		struct query_slot
+		{
+			bool pending = false;
+			bool per_pass = false;
+			bool pipeline_statistics = false;
+			uint64_t frame_index = 0;
+			uint64_t cpu_time = 0;
 		};
 
 		std::vector<pass_data> passes_data;
 		uint32_t query_base_index = 0;
-		moving_average<uint64_t, 60> average_cpu_duration;
-		moving_average<uint64_t, 60> average_gpu_duration;
+		uint32_t pipeline_statistics_query_base_index = 0;
+		query_slot query_slots[4];
+		duration_histogram<600> cpu_duration;
+		duration_histogram<600> gpu_duration;
+	};
+
+	/// <summary>
+	/// Image data of a texture that is loaded from a source file on a worker thread and then handed over to the render thread for upload.
+	/// </summary>
+	struct texture_load_job
+	{
+		size_t texture_index = std::numeric_limits<size_t>::max();
+		std::string texture_name;
+		std::filesystem::path source_path;
+		reshadefx::texture_format format = reshadefx::texture_format::unknown;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t depth = 0;
+		uint32_t levels = 1;
+		std::unique_ptr<void, void(*)(void *)> pixels = { nullptr, std::free };
 	};
 
 	struct effect
 	{
 		unsigned int rendering = 0;
+		unsigned int pending_textures = 0;
 		bool skipped = false;
 		bool compiled = false;
 		bool preprocessed = false;
@@ -237,6 +275,8 @@ namespace reshade
 		std::vector<uint8_t> uniform_data_storage;
 
 		api::query_heap query_heap = {};
+		api::query_heap pipeline_statistics_query_heap = {};
+		uint32_t num_pipeline_statistics_queries = 0;
 		api::resource cb = {};
 		api::pipeline_layout layout = {};
 
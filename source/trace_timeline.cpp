@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "trace_timeline.hpp"
+#include "dll_log.hpp"
+#include <fstream>
+
+static void write_json_string(std::ostream &stream, const std::string &value)
+{
+	stream << '\"';
+	for (const char c : value)
+	{
+		switch (c)
+		{
+		case '\"':
+			stream << "\\\"";
+			break;
+		case '\\':
+			stream << "\\\\";
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+				stream << ' ';
+			else
+				stream << c;
+			break;
+		}
+	}
+	stream << '\"';
+}
+
+void reshade::trace_timeline::start(uint64_t timestamp_frequency, size_t max_spans)
+{
+	clear();
+
+	_recording = true;
+	_max_spans = max_spans;
+	_timestamp_frequency = timestamp_frequency;
+}
+
+void reshade::trace_timeline::clear()
+{
+	_recording = false;
+	_spans.clear();
+	_has_gpu_reference = false;
+}
+
+void reshade::trace_timeline::add_span(span &&span)
+{
+	if (!_recording)
+		return;
+
+	_spans.push_back(std::move(span));
+
+	if (_spans.size() >= _max_spans)
+	{
+		LOG(WARN) << "Stopped timeline capture after reaching the limit of " << _max_spans << " spans.";
+		_recording = false;
+	}
+}
+
+uint64_t reshade::trace_timeline::convert_gpu_timestamp(uint64_t gpu_timestamp, uint64_t cpu_reference)
+{
+	if (!_has_gpu_reference)
+	{
+		_has_gpu_reference = true;
+		_gpu_reference = gpu_timestamp;
+		_cpu_reference = cpu_reference;
+	}
+
+	if (_timestamp_frequency == 0)
+		return _cpu_reference;
+
+	// Split the conversion, to avoid overflowing the multiplication for long captures with high frequency counters
+	const int64_t delta = static_cast<int64_t>(gpu_timestamp - _gpu_reference);
+	const int64_t frequency = static_cast<int64_t>(_timestamp_frequency);
+	return _cpu_reference + (delta / frequency) * 1000000000ll + (delta % frequency) * 1000000000ll / frequency;
+}
+
+bool reshade::trace_timeline::export_chrome_trace(const std::filesystem::path &path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		LOG(ERROR) << "Failed to open timeline file " << path << " for writing!";
+		return false;
+	}
+
+	file.setf(std::ios::fixed);
+	file.precision(3);
+
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"ReShade\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << static_cast<uint32_t>(span_track::cpu) << ",\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << static_cast<uint32_t>(span_track::gpu) << ",\"args\":{\"name\":\"GPU\"}}";
+
+	for (const span &span : _spans)
+	{
+		// Chrome trace timestamps are in microseconds
+		file << ",\n{\"name\":";
+		write_json_string(file, span.name);
+		file << ",\"cat\":\"" << span.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << static_cast<uint32_t>(span.track) <<
+			",\"ts\":" << span.begin * 1e-3 << ",\"dur\":" << (span.end > span.begin ? span.end - span.begin : 0) * 1e-3;
+
+		file << ",\"args\":{\"frame\":" << span.frame_index << ",\"effect\":";
+		write_json_string(file, span.effect_name);
+		if (span.pixel_shader_invocations != std::numeric_limits<uint64_t>::max())
+			file << ",\"ps_invocations\":" << span.pixel_shader_invocations;
+		if (span.compute_shader_invocations != std::numeric_limits<uint64_t>::max())
+			file << ",\"cs_invocations\":" << span.compute_shader_invocations;
+		file << "}}";
+	}
+
+	file << "\n]}\n";
+
+	return !file.fail();
+}
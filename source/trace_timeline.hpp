@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// Records CPU and GPU spans of effect rendering over a number of frames and exports them in the Chrome trace event format (viewable in chrome://tracing or Perfetto).
+	/// </summary>
+	class trace_timeline
+	{
+	public:
+		enum class span_track : uint32_t
+		{
+			cpu = 1,
+			gpu = 2,
+		};
+
+		struct span
+		{
+			span_track track;
+			const char *category;
+			std::string name;
+			std::string effect_name;
+			uint64_t frame_index;
+			uint64_t begin; // Nanoseconds on the CPU clock
+			uint64_t end;
+			uint64_t pixel_shader_invocations = std::numeric_limits<uint64_t>::max();
+			uint64_t compute_shader_invocations = std::numeric_limits<uint64_t>::max();
+		};
+
+		/// <summary>
+		/// Discards any previously recorded spans and starts recording new ones.
+		/// </summary>
+		/// <param name="timestamp_frequency">Frequency of the GPU timestamp counter in Hz.</param>
+		/// <param name="max_spans">Maximum number of spans to record, after which recording stops automatically.</param>
+		void start(uint64_t timestamp_frequency, size_t max_spans = 1000000);
+		void stop() { _recording = false; }
+		void clear();
+
+		bool is_recording() const { return _recording; }
+		bool empty() const { return _spans.empty(); }
+		size_t size() const { return _spans.size(); }
+
+		/// <summary>
+		/// Adds a span to the timeline, if currently recording.
+		/// </summary>
+		void add_span(span &&span);
+
+		/// <summary>
+		/// Converts a GPU timestamp to nanoseconds on the CPU clock.
+		/// The two clocks are aligned once, by assuming that the first GPU timestamp seen corresponds to the specified <paramref name="cpu_reference"/> time (e.g. the CPU time at which the GPU commands were recorded).
+		/// This keeps relative GPU timings exact, while the absolute offset to CPU spans is only an approximation.
+		/// </summary>
+		uint64_t convert_gpu_timestamp(uint64_t gpu_timestamp, uint64_t cpu_reference);
+
+		/// <summary>
+		/// Writes all recorded spans to a JSON file in the Chrome trace event format.
+		/// </summary>
+		bool export_chrome_trace(const std::filesystem::path &path) const;
+
+	private:
+		bool _recording = false;
+		size_t _max_spans = 0;
+		std::vector<span> _spans;
+		uint64_t _timestamp_frequency = 0;
+		bool _has_gpu_reference = false;
+		uint64_t _gpu_reference = 0;
+		uint64_t _cpu_reference = 0;
+	};
+}
@@ -9,10 +9,10 @@
 #include "vulkan_impl_type_convert.hpp"
 #include "dll_log.hpp"
 #include "addon_manager.hpp"
-#include "lockfree_linear_map.hpp"
+#include "lockfree_hash_map.hpp"
 #include <algorithm>
 
-extern lockfree_linear_map<void *, reshade::vulkan::device_impl *, 8> g_vulkan_devices;
+extern lockfree_hash_map<void *, reshade::vulkan::device_impl *> g_vulkan_devices;
 
 #define GET_DISPATCH_PTR_FROM(name, data) \
 	assert((data) != nullptr); \
@@ -11,14 +11,14 @@
 #include "dll_log.hpp"
 #include "hook_manager.hpp"
 #include "addon_manager.hpp"
-#include "lockfree_linear_map.hpp"
+#include "lockfree_hash_map.hpp"
 
 // Set during Vulkan device creation and presentation, to avoid hooking internal D3D devices created e.g. by NVIDIA Ansel and Optimus
 extern thread_local bool g_in_dxgi_runtime;
 
-lockfree_linear_map<void *, reshade::vulkan::device_impl *, 8> g_vulkan_devices;
-extern lockfree_linear_map<void *, instance_dispatch_table, 16> g_vulkan_instances;
-extern lockfree_linear_map<VkSurfaceKHR, HWND, 16> g_surface_windows;
+lockfree_hash_map<void *, reshade::vulkan::device_impl *> g_vulkan_devices;
+extern lockfree_hash_map<void *, instance_dispatch_table> g_vulkan_instances;
+extern lockfree_hash_map<VkSurfaceKHR, HWND> g_surface_windows;
 
 #define GET_DISPATCH_PTR(name, object) \
 	GET_DISPATCH_PTR_FROM(name, g_vulkan_devices.at(dispatch_key_from_handle(object)))
@@ -218,6 +218,12 @@ VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDevi
 		enabled_features.shaderImageGatherExtended = true;
 		enabled_features.shaderStorageImageWriteWithoutFormat = true;
 
+		// Enable optional features that ReShade uses when they are supported
+		VkPhysicalDeviceFeatures supported_features = {};
+		instance_dispatch.GetPhysicalDeviceFeatures(physicalDevice, &supported_features);
+		if (supported_features.pipelineStatisticsQuery)
+			enabled_features.pipelineStatisticsQuery = true; // Used to count shader invocations of effect passes
+
 		// Enable extensions that ReShade requires
 		if (instance_dispatch.api_version < VK_API_VERSION_1_3 && !add_extension(VK_EXT_PRIVATE_DATA_EXTENSION_NAME, true))
 			return VK_ERROR_EXTENSION_NOT_PRESENT;
@@ -6,10 +6,10 @@
 #include "vulkan_hooks.hpp"
 #include "dll_log.hpp"
 #include "hook_manager.hpp"
-#include "lockfree_linear_map.hpp"
+#include "lockfree_hash_map.hpp"
 
-lockfree_linear_map<void *, instance_dispatch_table, 16> g_vulkan_instances;
-lockfree_linear_map<VkSurfaceKHR, HWND, 16> g_surface_windows;
+lockfree_hash_map<void *, instance_dispatch_table> g_vulkan_instances;
+lockfree_hash_map<VkSurfaceKHR, HWND> g_surface_windows;
 
 #define GET_DISPATCH_PTR(name, object) \
 	PFN_vk##name trampoline = g_vulkan_instances.at(dispatch_key_from_handle(object)).name; \
@@ -1694,6 +1694,12 @@ bool reshade::vulkan::device_impl::create_query_heap(api::query_type type, uint3
 
 	if (type == api::query_type::pipeline_statistics)
 	{
+		if (!_enabled_features.pipelineStatisticsQuery)
+		{
+			*out_handle = { 0 };
+			return false;
+		}
+
 		create_info.pipelineStatistics =
 			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
 			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
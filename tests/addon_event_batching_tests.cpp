@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "tests.hpp"
+#include "addon_event_stream.hpp"
+
+using namespace reshade;
+
+using draw_batching = addon_event_batching<addon_event_traits<addon_event::draw>::decl>;
+using bind_pipeline_batching = addon_event_batching<addon_event_traits<addon_event::bind_pipeline>::decl>;
+
+static std::vector<uint32_t> s_vertex_counts;
+static std::vector<uint64_t> s_pipelines;
+
+static bool on_draw(api::command_list *, uint32_t vertex_count, uint32_t, uint32_t, uint32_t)
+{
+	s_vertex_counts.push_back(vertex_count);
+	return false;
+}
+static void on_bind_pipeline(api::command_list *, api::pipeline_stage, api::pipeline pipeline)
+{
+	s_pipelines.push_back(pipeline.handle);
+}
+
+static void replay(const addon_event_stream &stream)
+{
+	const std::vector<void *> draw_callbacks = { reinterpret_cast<void *>(&on_draw) };
+	const std::vector<void *> bind_pipeline_callbacks = { reinterpret_cast<void *>(&on_bind_pipeline) };
+
+	s_vertex_counts.clear();
+	s_pipelines.clear();
+
+	stream.for_each([&](addon_event ev, const uint8_t *data) {
+		if (ev == addon_event::draw)
+			draw_batching::replay(nullptr, data, draw_callbacks);
+		else if (ev == addon_event::bind_pipeline)
+			bind_pipeline_batching::replay(nullptr, data, bind_pipeline_callbacks);
+	});
+}
+
+RESHADE_TEST(addon_event_batching_record_replay)
+{
+	addon_event_stream stream;
+
+	bind_pipeline_batching::record(stream, addon_event::bind_pipeline, api::pipeline_stage::all_graphics, api::pipeline { 42 });
+	draw_batching::record(stream, addon_event::draw, 3, 1, 0, 0);
+	draw_batching::record(stream, addon_event::draw, 6, 2, 3, 1);
+	CHECK(stream.data.size() % 8 == 0);
+
+	replay(stream);
+	CHECK(s_pipelines.size() == 1 && s_pipelines[0] == 42);
+	CHECK(s_vertex_counts.size() == 2 && s_vertex_counts[0] == 3 && s_vertex_counts[1] == 6);
+
+	// Command lists that are executed multiple times deliver their events every time
+	replay(stream);
+	CHECK(s_vertex_counts.size() == 2);
+}
+
+RESHADE_TEST(addon_event_batching_finish_command_list)
+{
+	// Mirrors the events 'ID3D11DeviceContext::FinishCommandList' causes: The commands recorded on the deferred context are appended to the new command list,
+	// after which the deferred context has to start from an empty stream, no matter whether its state is restored or not
+	addon_event_stream deferred_context;
+	addon_event_stream command_list_1;
+	addon_event_stream command_list_2;
+
+	draw_batching::record(deferred_context, addon_event::draw, 3, 1, 0, 0);
+	command_list_1.append(deferred_context);
+	deferred_context.data.clear();
+
+	draw_batching::record(deferred_context, addon_event::draw, 6, 1, 0, 0);
+	command_list_2.append(deferred_context);
+	deferred_context.data.clear();
+
+	replay(command_list_1);
+	CHECK(s_vertex_counts.size() == 1 && s_vertex_counts[0] == 3);
+
+	// Only the commands recorded after the first command list was finished may end up in the second one
+	replay(command_list_2);
+	CHECK(s_vertex_counts.size() == 1 && s_vertex_counts[0] == 6);
+
+	replay(deferred_context);
+	CHECK(s_vertex_counts.empty());
+}
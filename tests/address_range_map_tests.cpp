@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "tests.hpp"
+#include "address_range_map.hpp"
+#include <chrono>
+#include <thread>
+
+RESHADE_TEST(address_range_map_basic)
+{
+	address_range_map<uint32_t> map;
+
+	uint32_t value = 0;
+	uint64_t offset = 0;
+	CHECK(!map.find(0, &value));
+
+	map.insert(0x1000, 0x100, 1);
+	map.insert(0x2000, 0x100, 2);
+	map.insert(0x1100, 0x100, 3); // Adjacent to the first range, without overlapping it
+	map.insert(0x3000, 0, 4); // Empty ranges are ignored
+	CHECK(map.size() == 3);
+
+	CHECK(!map.find(0x0FFF, &value));
+	CHECK(map.find(0x1000, &value, &offset) && value == 1 && offset == 0);
+	CHECK(map.find(0x10FF, &value, &offset) && value == 1 && offset == 0xFF);
+	CHECK(map.find(0x1100, &value, &offset) && value == 3 && offset == 0);
+	CHECK(!map.find(0x1200, &value));
+	CHECK(map.find(0x2080, &value, &offset) && value == 2 && offset == 0x80);
+	CHECK(!map.find(0x2100, &value));
+	CHECK(!map.find(0x3000, &value));
+
+	CHECK(map.erase(3));
+	CHECK(!map.erase(3));
+	CHECK(!map.find(0x1100, &value));
+	CHECK(map.size() == 2);
+
+	map.clear();
+	CHECK(map.size() == 0);
+	CHECK(!map.find(0x1000, &value));
+}
+
+RESHADE_TEST(address_range_map_aliasing)
+{
+	address_range_map<uint32_t> map;
+
+	uint32_t value = 0;
+	uint64_t offset = 0;
+
+	// Placed resources may alias the same memory, in which case the most recently added one shadows the parts of the ones it overlaps
+	map.insert(0x1000, 0x1000, 1);
+	map.insert(0x1800, 0x1000, 2);
+	CHECK(map.find(0x1000, &value, &offset) && value == 1 && offset == 0);
+	CHECK(map.find(0x17FF, &value, &offset) && value == 1 && offset == 0x7FF);
+	CHECK(map.find(0x1900, &value, &offset) && value == 2 && offset == 0x100);
+	CHECK(map.size() == 2);
+
+	map.insert(0x2700, 0x200, 3);
+	CHECK(map.find(0x1900, &value, &offset) && value == 2 && offset == 0x100);
+	CHECK(map.find(0x2800, &value, &offset) && value == 3 && offset == 0x100);
+	CHECK(!map.find(0x2900, &value));
+
+	// Erasing the shadowing range makes the parts it overlapped visible again
+	CHECK(map.erase(3));
+	CHECK(map.find(0x2780, &value, &offset) && value == 2 && offset == 0xF80);
+	CHECK(map.erase(2));
+	CHECK(map.find(0x1900, &value, &offset) && value == 1 && offset == 0x900);
+	CHECK(!map.find(0x2000, &value));
+
+	// A range inside another one splits it, with offsets still relative to the start of the outer range
+	map.insert(0x1400, 0x100, 4);
+	CHECK(map.find(0x13FF, &value, &offset) && value == 1 && offset == 0x3FF);
+	CHECK(map.find(0x1450, &value, &offset) && value == 4 && offset == 0x50);
+	CHECK(map.find(0x1500, &value, &offset) && value == 1 && offset == 0x500);
+	CHECK(map.erase(4));
+	CHECK(map.find(0x1450, &value, &offset) && value == 1 && offset == 0x450);
+
+	// Erasing a shadowed range does not change what is visible of the ranges added after it
+	map.insert(0x1000, 0x100, 5);
+	CHECK(map.erase(1));
+	CHECK(map.find(0x1000, &value) && value == 5);
+	CHECK(!map.find(0x1100, &value));
+	CHECK(map.erase(5));
+	CHECK(!map.find(0x1000, &value));
+	CHECK(map.size() == 0);
+}
+
+RESHADE_TEST(address_range_map_concurrent)
+{
+	address_range_map<uint64_t> map;
+
+	constexpr uint64_t range_size = 0x100;
+	constexpr uint64_t num_ranges = 256;
+	constexpr uint32_t num_iterations = 20000;
+
+	// Every range is associated with its start address as value, so that look ups can verify the result independent of which ranges exist right now
+	std::atomic<bool> stop = false;
+	std::atomic<uint32_t> num_wrong_values = 0;
+	std::thread reader([&]() {
+		for (uint64_t i = 0; !stop; ++i)
+		{
+			const uint64_t address = (i * 0x97) % (num_ranges * range_size);
+
+			uint64_t value = 0, offset = 0;
+			if (map.find(address, &value, &offset) && (value + offset != address || offset >= range_size))
+				num_wrong_values++;
+		}
+	});
+
+	for (uint32_t i = 0; i < num_iterations; ++i)
+	{
+		const uint64_t address = (i % num_ranges) * range_size;
+
+		if (i >= num_ranges)
+			map.erase(address);
+		map.insert(address, range_size, address);
+	}
+
+	stop = true;
+	reader.join();
+
+	CHECK(num_wrong_values == 0);
+	CHECK(map.size() == num_ranges);
+}
+
+RESHADE_BENCHMARK(address_range_map_find)
+{
+	address_range_map<uint64_t> map;
+
+	constexpr uint64_t num_ranges = 4096;
+	for (uint64_t i = 0; i < num_ranges; ++i)
+		map.insert(i * 0x10000, 0x8000, i);
+
+	constexpr uint32_t num_look_ups = 10000000;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	uint64_t sum = 0;
+	for (uint32_t i = 0; i < num_look_ups; ++i)
+		if (uint64_t value = 0; map.find((i % num_ranges) * 0x10000 + 0x100, &value))
+			sum += value;
+
+	const auto end = std::chrono::high_resolution_clock::now();
+
+	CHECK(sum != 0);
+	std::printf("  %.2f ns per look up\n", std::chrono::duration<double, std::nano>(end - start).count() / num_look_ups);
+}
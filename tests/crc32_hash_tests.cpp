@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "tests.hpp"
+#include "../examples/utils/crc32_hash.hpp"
+#include <chrono>
+#include <random>
+
+// Byte-wise implementation the dump and replace add-ons originally used, which all others have to match
+static uint32_t update_crc32_reference(uint32_t crc, const uint8_t *data, size_t size)
+{
+	for (; size != 0; --size, ++data)
+		crc = (crc >> 8) ^ crc32_internal::crc32_table.data[0][(crc ^ (*data)) & 0xFF];
+	return crc;
+}
+
+RESHADE_TEST(crc32_hash_known_values)
+{
+	CHECK(compute_crc32(nullptr, 0) == 0);
+	CHECK(compute_crc32(reinterpret_cast<const uint8_t *>("123456789"), 9) == 0xCBF43926);
+	CHECK(compute_crc32(reinterpret_cast<const uint8_t *>("The quick brown fox jumps over the lazy dog"), 43) == 0x414FA339);
+}
+
+RESHADE_TEST(crc32_hash_matches_reference)
+{
+	std::mt19937 rng(42);
+	std::vector<uint8_t> buffer(4096 + 16);
+	for (uint8_t &value : buffer)
+		value = static_cast<uint8_t>(rng());
+
+	for (uint32_t i = 0; i < 2000; ++i)
+	{
+		// Cover every length up to 512 bytes, followed by random ones up to 4096 bytes, each at a random alignment
+		const size_t size = i <= 512 ? i : rng() % 4097;
+		const uint8_t *const data = buffer.data() + rng() % 16;
+
+		const uint32_t expected = update_crc32_reference(0xFFFFFFFF, data, size);
+
+		CHECK(crc32_internal::update_crc32_slicing_by_8(0xFFFFFFFF, data, size) == expected);
+		CHECK(compute_crc32(data, size) == ~expected);
+
+#if defined(_M_IX86) || defined(_M_X64)
+		// The folding path requires at least 64 bytes in multiples of 16, the rest is left to the portable implementation
+		if (const size_t folded_size = size & ~static_cast<size_t>(15); folded_size >= 64 && crc32_internal::has_pclmul())
+		{
+			const uint32_t folded = crc32_internal::update_crc32_pclmul(0xFFFFFFFF, data, folded_size);
+			CHECK(folded == update_crc32_reference(0xFFFFFFFF, data, folded_size));
+			CHECK(crc32_internal::update_crc32_slicing_by_8(folded, data + folded_size, size - folded_size) == expected);
+		}
+#elif defined(_M_ARM64)
+		CHECK(crc32_internal::update_crc32_armv8(0xFFFFFFFF, data, size) == expected);
+#endif
+	}
+}
+
+template <typename F>
+static void measure_crc32_throughput(const char *name, const std::vector<uint8_t> &buffer, F update)
+{
+	constexpr uint32_t num_iterations = 16;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	uint32_t crc = 0;
+	for (uint32_t i = 0; i < num_iterations; ++i)
+		crc ^= update(buffer.data(), buffer.size());
+
+	const auto end = std::chrono::high_resolution_clock::now();
+
+	CHECK(crc != 0xDEADBEEF); // Keep the result alive
+	std::printf("  %-16s %.2f GB/s\n", name, (static_cast<double>(buffer.size()) * num_iterations) / std::chrono::duration<double, std::nano>(end - start).count());
+}
+
+RESHADE_BENCHMARK(crc32_hash_throughput)
+{
+	std::mt19937 rng(42);
+	std::vector<uint8_t> buffer(16 * 1024 * 1024);
+	for (uint8_t &value : buffer)
+		value = static_cast<uint8_t>(rng());
+
+	measure_crc32_throughput("byte-wise", buffer, [](const uint8_t *data, size_t size) { return update_crc32_reference(0xFFFFFFFF, data, size); });
+	measure_crc32_throughput("slicing-by-8", buffer, [](const uint8_t *data, size_t size) { return crc32_internal::update_crc32_slicing_by_8(0xFFFFFFFF, data, size); });
+	measure_crc32_throughput("compute_crc32", buffer, [](const uint8_t *data, size_t size) { return compute_crc32(data, size); });
+}
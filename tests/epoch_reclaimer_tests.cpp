@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "tests.hpp"
+#include "epoch_reclaimer.hpp"
+#include <thread>
+
+// Counts live lists, to check that every replaced list is eventually freed
+static std::atomic<int> s_num_live_lists = 0;
+
+struct callback_list
+{
+	explicit callback_list(uint32_t generation, size_t count) : callbacks(count, generation) { s_num_live_lists++; }
+	~callback_list() { callbacks.assign(callbacks.size(), 0xDEADBEEF); s_num_live_lists--; }
+
+	std::vector<uint32_t> callbacks;
+};
+
+RESHADE_TEST(epoch_reclaimer_register_while_invoking)
+{
+	// Mirrors how the add-on manager publishes event lists: events are invoked without locking, while add-ons register and unregister callbacks concurrently
+	epoch_reclaimer<callback_list> reclaimer;
+	std::atomic<const callback_list *> event_list = new callback_list(1, 1);
+
+	std::atomic<bool> stop = false;
+	std::atomic<uint32_t> num_invocations = 0;
+	std::atomic<uint32_t> num_wrong_callbacks = 0;
+
+	std::vector<std::thread> invoking_threads;
+	for (int i = 0; i < 4; ++i)
+	{
+		invoking_threads.emplace_back([&]() {
+			while (!stop)
+			{
+				const epoch_reclaimer<callback_list>::read_guard guard(reclaimer);
+
+				// Every entry of a list has the same value, so a list that was freed (and overwritten) while iterating it is detected
+				const callback_list *const list = event_list.load();
+				for (const uint32_t callback : list->callbacks)
+					if (callback != list->callbacks.front() || callback == 0xDEADBEEF)
+						num_wrong_callbacks++;
+
+				num_invocations++;
+			}
+		});
+	}
+
+	// Register and unregister callbacks, which replaces the list every time
+	for (uint32_t generation = 2; generation < 20000; ++generation)
+	{
+		const callback_list *const old_list = event_list.exchange(new callback_list(generation, 1 + generation % 16));
+		reclaimer.retire(old_list);
+
+		// Present periodically tries to free lists too
+		if (generation % 64 == 0)
+			reclaimer.reclaim();
+	}
+
+	stop = true;
+	for (std::thread &thread : invoking_threads)
+		thread.join();
+
+	CHECK(num_wrong_callbacks == 0);
+	CHECK(num_invocations != 0);
+
+	// With no more invocations running, the remaining lists are freed on the next attempt
+	reclaimer.reclaim();
+	CHECK(!reclaimer.has_retired());
+	CHECK(s_num_live_lists == 1);
+
+	delete event_list.load();
+	CHECK(s_num_live_lists == 0);
+}
+
+RESHADE_TEST(epoch_reclaimer_blocked_reader)
+{
+	epoch_reclaimer<callback_list> reclaimer;
+	std::atomic<const callback_list *> event_list = new callback_list(1, 4);
+
+	{
+		// A reader that is still iterating the list keeps it alive, no matter how many times the list is replaced or reclaiming is attempted
+		const epoch_reclaimer<callback_list>::read_guard guard(reclaimer);
+		const callback_list *const list = event_list.load();
+
+		reclaimer.retire(event_list.exchange(new callback_list(2, 4)));
+		for (int i = 0; i < 16; ++i)
+			reclaimer.reclaim();
+
+		CHECK(reclaimer.has_retired());
+		CHECK(list->callbacks.front() == 1);
+	}
+
+	reclaimer.reclaim();
+	reclaimer.reclaim();
+	CHECK(!reclaimer.has_retired());
+	CHECK(s_num_live_lists == 1);
+
+	delete event_list.load();
+}
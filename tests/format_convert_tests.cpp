@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "tests.hpp"
+#include "reshade_api_format_convert.hpp"
+#include <chrono>
+#include <random>
+
+using namespace reshade::api;
+
+struct format_info
+{
+	format src_format;
+	uint32_t texel_size;
+	const char *name;
+};
+
+static const format_info s_row_formats[] = {
+	{ format::l8_unorm, 1, "l8_unorm" },
+	{ format::a8_unorm, 1, "a8_unorm" },
+	{ format::r8_unorm, 1, "r8_unorm" },
+	{ format::l8a8_unorm, 2, "l8a8_unorm" },
+	{ format::r8g8_unorm, 2, "r8g8_unorm" },
+	{ format::r8g8b8a8_unorm, 4, "r8g8b8a8_unorm" },
+	{ format::r8g8b8x8_unorm, 4, "r8g8b8x8_unorm" },
+	{ format::b8g8r8a8_unorm, 4, "b8g8r8a8_unorm" },
+	{ format::b8g8r8x8_unorm, 4, "b8g8r8x8_unorm" },
+	{ format::r10g10b10a2_unorm, 4, "r10g10b10a2_unorm" },
+	{ format::b10g10r10a2_unorm, 4, "b10g10r10a2_unorm" },
+};
+
+static const format_info s_block_formats[] = {
+	{ format::bc1_unorm, 8, "bc1_unorm" },
+	{ format::bc2_unorm, 16, "bc2_unorm" },
+	{ format::bc3_unorm, 16, "bc3_unorm" },
+	{ format::bc4_unorm, 8, "bc4_unorm" },
+	{ format::bc5_unorm, 16, "bc5_unorm" },
+};
+
+static std::vector<uint8_t> make_random_data(size_t size, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> data(size);
+	for (uint8_t &value : data)
+		value = static_cast<uint8_t>(rng());
+	return data;
+}
+
+RESHADE_TEST(format_convert_known_values)
+{
+	uint32_t rgba = 0;
+
+	const uint8_t bgra8[4] = { 0x11, 0x22, 0x33, 0x44 };
+	CHECK(convert_texture_to_rgba8(format::b8g8r8a8_unorm, 1, 1, bgra8, 4, &rgba, 4) && rgba == 0x44112233);
+	CHECK(convert_texture_to_rgba8(format::b8g8r8x8_unorm, 1, 1, bgra8, 4, &rgba, 4) && rgba == 0xFF112233);
+
+	const uint8_t l8a8[2] = { 0x80, 0x40 };
+	CHECK(convert_texture_to_rgba8(format::l8a8_unorm, 1, 1, l8a8, 2, &rgba, 4) && rgba == 0x40808080);
+
+	// Red at maximum, green at half, blue at zero and alpha at one third
+	const uint32_t rgb10a2 = 0x3FF | (0x200 << 10) | (1u << 30);
+	CHECK(convert_texture_to_rgba8(format::r10g10b10a2_unorm, 1, 1, &rgb10a2, 4, &rgba, 4) && rgba == 0x550080FF);
+	CHECK(convert_texture_to_rgba8(format::b10g10r10a2_unorm, 1, 1, &rgb10a2, 4, &rgba, 4) && rgba == 0x55FF8000);
+
+	CHECK(!convert_texture_to_rgba8(format::r16g16b16a16_float, 1, 1, &rgb10a2, 4, &rgba, 4));
+}
+
+RESHADE_TEST(format_convert_rows_match_scalar)
+{
+	// Rows of this width are mostly converted by the SIMD paths, while converting a single texel at a time always goes through the scalar ones
+	constexpr uint32_t width = 37;
+
+	for (const format_info &info : s_row_formats)
+	{
+		const std::vector<uint8_t> src = make_random_data(width * info.texel_size, static_cast<uint32_t>(info.src_format));
+
+		uint32_t converted_row[width];
+		CHECK(convert_texture_to_rgba8(info.src_format, width, 1, src.data(), width * info.texel_size, converted_row, width * 4));
+
+		uint32_t num_mismatches = 0;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			uint32_t converted_texel = 0;
+			convert_texture_to_rgba8(info.src_format, 1, 1, src.data() + x * info.texel_size, info.texel_size, &converted_texel, 4);
+			if (converted_texel != converted_row[x])
+				num_mismatches++;
+		}
+
+		if (num_mismatches != 0)
+			std::printf("  %s: %u texels differ between SIMD and scalar conversion\n", info.name, num_mismatches);
+		CHECK(num_mismatches == 0);
+	}
+}
+
+RESHADE_TEST(format_convert_blocks_match_single_threaded)
+{
+	// Include dimensions that are not a multiple of the block size, so that clipping at the edges is covered
+	const std::pair<uint32_t, uint32_t> sizes[] = { { 1, 1 }, { 13, 9 }, { 64, 64 }, { 301, 157 } };
+
+	for (const format_info &info : s_block_formats)
+	{
+		for (const auto &[width, height] : sizes)
+		{
+			const uint32_t src_row_pitch = ((width + 3) / 4) * info.texel_size;
+			const std::vector<uint8_t> src = make_random_data(static_cast<size_t>(src_row_pitch) * ((height + 3) / 4), width * height);
+
+			// Add a guard row after the destination, which must stay untouched
+			std::vector<uint32_t> single_threaded(static_cast<size_t>(width) * (height + 1), 0xCDCDCDCD);
+			std::vector<uint32_t> multi_threaded(single_threaded);
+
+			CHECK(convert_texture_to_rgba8(info.src_format, width, height, src.data(), src_row_pitch, single_threaded.data(), width * 4, 1));
+			CHECK(convert_texture_to_rgba8(info.src_format, width, height, src.data(), src_row_pitch, multi_threaded.data(), width * 4, 4));
+
+			CHECK(single_threaded == multi_threaded);
+			CHECK(std::all_of(single_threaded.end() - width, single_threaded.end(), [](uint32_t value) { return value == 0xCDCDCDCD; }));
+		}
+	}
+}
+
+template <typename F>
+static double measure_texels_per_second(uint32_t num_texels, F convert)
+{
+	constexpr uint32_t num_iterations = 8;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < num_iterations; ++i)
+		convert();
+	const auto end = std::chrono::high_resolution_clock::now();
+
+	return (static_cast<double>(num_texels) * num_iterations) / std::chrono::duration<double>(end - start).count();
+}
+
+RESHADE_BENCHMARK(format_convert_throughput)
+{
+	constexpr uint32_t width = 2048, height = 2048;
+
+	std::vector<uint32_t> dst(static_cast<size_t>(width) * height);
+
+	for (const format_info &info : s_row_formats)
+	{
+		const std::vector<uint8_t> src = make_random_data(static_cast<size_t>(width) * height * info.texel_size, 1);
+
+		// Compare against converting every texel on its own, which only uses the scalar paths
+		const double simd_rate = measure_texels_per_second(width * height, [&]() {
+			convert_texture_to_rgba8(info.src_format, width, height, src.data(), width * info.texel_size, dst.data(), width * 4); });
+		const double scalar_rate = measure_texels_per_second(width * height, [&]() {
+			for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i)
+				convert_texture_to_rgba8(info.src_format, 1, 1, src.data() + i * info.texel_size, info.texel_size, dst.data() + i, 4); });
+
+		std::printf("  %-18s %8.1f MTexels/s (scalar %8.1f MTexels/s)\n", info.name, simd_rate / 1e6, scalar_rate / 1e6);
+	}
+
+	for (const format_info &info : s_block_formats)
+	{
+		const std::vector<uint8_t> src = make_random_data(static_cast<size_t>(width / 4) * (height / 4) * info.texel_size, 1);
+
+		const double single_threaded_rate = measure_texels_per_second(width * height, [&]() {
+			convert_texture_to_rgba8(info.src_format, width, height, src.data(), (width / 4) * info.texel_size, dst.data(), width * 4, 1); });
+		const double automatic_rate = measure_texels_per_second(width * height, [&]() {
+			convert_texture_to_rgba8(info.src_format, width, height, src.data(), (width / 4) * info.texel_size, dst.data(), width * 4, 0); });
+
+		std::printf("  %-18s %8.1f MTexels/s (single-threaded %8.1f MTexels/s)\n", info.name, automatic_rate / 1e6, single_threaded_rate / 1e6);
+	}
+}
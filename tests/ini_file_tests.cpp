@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "tests.hpp"
+#include "ini_file.hpp"
+#include <cmath>
+#include <fstream>
+
+// Defined by the ReShade module, which the tests do not link against
+std::filesystem::path g_target_executable_path;
+
+RESHADE_TEST(ini_file_number_parsing)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / L"ReShadeTests.ini";
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file <<
+			"[NUMBERS]\r\n"
+			"Plain=1.5\r\n"
+			"Signs=+2.25,-2.25,+-3\r\n"
+			"Garbage=1.5abc,12px,abc\r\n"
+			"Comma=12,5\r\n"
+			"Special=.5,5.,1e3,1e,0x1.8p1,-0x10,inf,-Infinity,nan\r\n"
+			"Integers=42,-42,+42,0x10,0010, 7 \r\n"
+			"Ranges=9223372036854775807,9223372036854775808,-9223372036854775809,99999999999999999999\r\n"
+			"Unsigned=-1,18446744073709551615,18446744073709551616\r\n"
+			"Bools=1,0,true,TRUE,false,2\r\n";
+	}
+
+	{
+		const ini_file ini(path);
+
+		float plain = 0.0f;
+		CHECK(ini.get("NUMBERS", "Plain", plain) && plain == 1.5f);
+
+		// Leading sign and trailing characters that are not part of the number are accepted like with 'strtod', but not two signs
+		float signs[3] = {};
+		CHECK(ini.get("NUMBERS", "Signs", signs) && signs[0] == 2.25f && signs[1] == -2.25f && signs[2] == 0.0f);
+		float garbage[3] = {};
+		CHECK(ini.get("NUMBERS", "Garbage", garbage) && garbage[0] == 1.5f && garbage[1] == 12.0f && garbage[2] == 0.0f);
+
+		// Commas separate values, so a decimal comma (as with some locales) never makes it into a single number
+		float comma[2] = {};
+		CHECK(ini.get("NUMBERS", "Comma", comma) && comma[0] == 12.0f && comma[1] == 5.0f);
+
+		double special[9] = {};
+		CHECK(ini.get("NUMBERS", "Special", special));
+		CHECK(special[0] == 0.5 && special[1] == 5.0 && special[2] == 1000.0 && special[3] == 1.0);
+		CHECK(special[4] == 3.0 && special[5] == -16.0);
+		CHECK(std::isinf(special[6]) && special[6] > 0 && std::isinf(special[7]) && special[7] < 0 && std::isnan(special[8]));
+
+		// Integers are always decimal, like with 'strtol' and a base of 10
+		int integers[6] = {};
+		CHECK(ini.get("NUMBERS", "Integers", integers));
+		CHECK(integers[0] == 42 && integers[1] == -42 && integers[2] == 42 && integers[3] == 0 && integers[4] == 10 && integers[5] == 7);
+
+		// Out of range values are clamped like with 'strtoll'
+		long long ranges[4] = {};
+		CHECK(ini.get("NUMBERS", "Ranges", ranges));
+		CHECK(ranges[0] == std::numeric_limits<long long>::max() && ranges[1] == std::numeric_limits<long long>::max() && ranges[2] == std::numeric_limits<long long>::min() && ranges[3] == std::numeric_limits<long long>::max());
+
+		// Negative values wrap around for unsigned types, like with 'strtoull'
+		unsigned long long unsigned_values[3] = {};
+		CHECK(ini.get("NUMBERS", "Unsigned", unsigned_values));
+		CHECK(unsigned_values[0] == std::numeric_limits<unsigned long long>::max() && unsigned_values[1] == std::numeric_limits<unsigned long long>::max() && unsigned_values[2] == std::numeric_limits<unsigned long long>::max());
+
+		bool bools[6] = {};
+		CHECK(ini.get("NUMBERS", "Bools", bools));
+		CHECK(bools[0] && !bools[1] && bools[2] && bools[3] && !bools[4] && bools[5]);
+
+		float missing = 4.0f;
+		CHECK(!ini.get("NUMBERS", "Missing", missing) && missing == 4.0f);
+	}
+
+	std::error_code ec;
+	std::filesystem::remove(path, ec);
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "tests.hpp"
+#include "lockfree_hash_map.hpp"
+#include <chrono>
+#include <thread>
+#include <shared_mutex>
+#include <unordered_map>
+
+// Counts the memory a map allocates for its tables, to check that it does not hold on to more of it over time
+template <typename T>
+struct counting_allocator
+{
+	using value_type = T;
+
+	explicit counting_allocator(std::atomic<size_t> &allocated_bytes) : allocated_bytes(&allocated_bytes) {}
+	template <typename U>
+	counting_allocator(const counting_allocator<U> &other) : allocated_bytes(other.allocated_bytes) {}
+
+	T *allocate(size_t n)
+	{
+		*allocated_bytes += n * sizeof(T);
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T *p, size_t n)
+	{
+		*allocated_bytes -= n * sizeof(T);
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	template <typename U>
+	bool operator==(const counting_allocator<U> &other) const { return allocated_bytes == other.allocated_bytes; }
+	template <typename U>
+	bool operator!=(const counting_allocator<U> &other) const { return allocated_bytes != other.allocated_bytes; }
+
+	std::atomic<size_t> *allocated_bytes;
+};
+
+RESHADE_TEST(lockfree_hash_map_basic)
+{
+	lockfree_hash_map<uintptr_t, void *> map;
+
+	for (uintptr_t key = 1; key <= 1000; ++key)
+		CHECK(map.emplace(key, reinterpret_cast<void *>(key * 2)));
+	CHECK(!map.emplace(1, nullptr));
+	CHECK(map.size() == 1000);
+
+	for (uintptr_t key = 1; key <= 1000; key += 2)
+		CHECK(map.erase(key) == reinterpret_cast<void *>(key * 2));
+	CHECK(map.erase(1) == nullptr);
+	CHECK(map.size() == 500);
+
+	for (uintptr_t key = 1; key <= 1000; ++key)
+		CHECK(map.at(key) == (key % 2 == 0 ? reinterpret_cast<void *>(key * 2) : nullptr));
+
+	map.clear();
+	CHECK(map.size() == 0);
+	CHECK(map.at(2) == nullptr);
+
+	CHECK(map.emplace(2, reinterpret_cast<void *>(8)));
+	CHECK(map.at(2) == reinterpret_cast<void *>(8));
+
+	lockfree_hash_map<uintptr_t, int> value_map;
+	value_map.emplace(1, 4);
+	CHECK(value_map.at(1) == 4);
+
+	int value = 0;
+	CHECK(value_map.erase(1, value) && value == 4);
+	CHECK(!value_map.erase(1));
+}
+
+RESHADE_TEST(lockfree_hash_map_churn)
+{
+	std::atomic<size_t> allocated_bytes = 0;
+	{
+		lockfree_hash_map<uintptr_t, void *, counting_allocator<uint8_t>> map { counting_allocator<uint8_t>(allocated_bytes) };
+
+		constexpr uintptr_t num_live_keys = 64;
+		constexpr uintptr_t num_iterations = 200000;
+
+		// Look up keys concurrently, so that look ups race with rebuilds that reuse a spare table they may still be reading (which they have to detect and retry)
+		std::atomic<bool> stop = false;
+		std::atomic<uintptr_t> newest_key = 0;
+		std::atomic<uint32_t> num_wrong_values = 0;
+		std::thread reader([&]() {
+			while (!stop)
+			{
+				// The key may be erased concurrently, in which case the look up fails, but it must never return the value of another key
+				if (const uintptr_t key = newest_key.load(); key != 0)
+					if (void *const value = map.at(key); value != nullptr && value != reinterpret_cast<void *>(key))
+						num_wrong_values++;
+			}
+		});
+
+		size_t allocated_bytes_after_warm_up = 0;
+
+		// Keep the number of keys constant, while always adding new ones, which leaves a tombstone for every removed key
+		for (uintptr_t key = 1; key <= num_iterations; ++key)
+		{
+			map.emplace(key, reinterpret_cast<void *>(key));
+			newest_key = key;
+
+			if (key > num_live_keys)
+				map.erase(key - num_live_keys);
+
+			if (key == 1000)
+				allocated_bytes_after_warm_up = allocated_bytes;
+		}
+
+		stop = true;
+		reader.join();
+
+		CHECK(num_wrong_values == 0);
+		CHECK(map.size() == num_live_keys);
+		// Rebuilds must reuse the tables they replaced as spares, rather than allocating new ones for the lifetime of the map
+		CHECK(allocated_bytes <= allocated_bytes_after_warm_up);
+	}
+
+	// Destroying the map frees its current table and all spares
+	CHECK(allocated_bytes == 0);
+}
+
+RESHADE_BENCHMARK(lockfree_hash_map_look_up)
+{
+	lockfree_hash_map<uintptr_t, void *> map;
+
+	for (uintptr_t key = 1; key <= 1024; ++key)
+		map.emplace(key * 64, reinterpret_cast<void *>(key));
+
+	constexpr uint32_t num_look_ups = 10000000;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	uintptr_t sum = 0;
+	for (uint32_t i = 0; i < num_look_ups; ++i)
+		sum += reinterpret_cast<uintptr_t>(map.at(((i % 1024) + 1) * 64));
+
+	const auto end = std::chrono::high_resolution_clock::now();
+
+	CHECK(sum != 0);
+	std::printf("  %.2f ns per look up\n", std::chrono::duration<double, std::nano>(end - start).count() / num_look_ups);
+}
+
+template <typename LookUp, typename Modify>
+static double measure_concurrent_look_ups(unsigned int num_readers, LookUp look_up, Modify modify)
+{
+	constexpr uint32_t num_look_ups_per_reader = 2000000;
+
+	// A single writer keeps adding and removing keys while the readers look up others, like devices and objects being created while hooks look up their data
+	std::atomic<bool> stop = false;
+	std::thread writer([&]() {
+		for (uintptr_t i = 0; !stop; ++i)
+			modify(((i % 64) + 2048) * 64);
+	});
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::atomic<uintptr_t> sum = 0;
+	std::vector<std::thread> readers;
+	for (unsigned int r = 0; r < num_readers; ++r)
+	{
+		readers.emplace_back([&, r]() {
+			uintptr_t local_sum = 0;
+			for (uint32_t i = 0; i < num_look_ups_per_reader; ++i)
+				local_sum += look_up((((i + r * 97) % 1024) + 1) * 64);
+			sum += local_sum;
+		});
+	}
+
+	for (std::thread &reader : readers)
+		reader.join();
+
+	const auto end = std::chrono::high_resolution_clock::now();
+
+	stop = true;
+	writer.join();
+
+	CHECK(sum != 0);
+	return std::chrono::duration<double, std::nano>(end - start).count() / (static_cast<double>(num_look_ups_per_reader) * num_readers);
+}
+
+RESHADE_BENCHMARK(lockfree_hash_map_concurrent_look_up)
+{
+	const unsigned int max_readers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	for (unsigned int num_readers = 1; num_readers <= max_readers; num_readers *= 2)
+	{
+		lockfree_hash_map<uintptr_t, void *> lockfree_map;
+		for (uintptr_t key = 1; key <= 1024; ++key)
+			lockfree_map.emplace(key * 64, reinterpret_cast<void *>(key));
+
+		const double lockfree_time = measure_concurrent_look_ups(num_readers,
+			[&](uintptr_t key) { return reinterpret_cast<uintptr_t>(lockfree_map.at(key)); },
+			[&](uintptr_t key) { lockfree_map.emplace(key, reinterpret_cast<void *>(key)); lockfree_map.erase(key); });
+
+		std::shared_mutex mutex;
+		std::unordered_map<uintptr_t, void *> locked_map;
+		for (uintptr_t key = 1; key <= 1024; ++key)
+			locked_map.emplace(key * 64, reinterpret_cast<void *>(key));
+
+		const double locked_time = measure_concurrent_look_ups(num_readers,
+			[&](uintptr_t key) {
+				const std::shared_lock<std::shared_mutex> lock(mutex);
+				const auto it = locked_map.find(key);
+				return it != locked_map.end() ? reinterpret_cast<uintptr_t>(it->second) : 0;
+			},
+			[&](uintptr_t key) {
+				const std::unique_lock<std::shared_mutex> lock(mutex);
+				locked_map.emplace(key, reinterpret_cast<void *>(key));
+				locked_map.erase(key);
+			});
+
+		std::printf("  %u reader(s) and 1 writer: %.2f ns per look up (std::shared_mutex + std::unordered_map: %.2f ns)\n", num_readers, lockfree_time, locked_time);
+	}
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "tests.hpp"
+#include <cstring>
+
+int main(int argc, char *argv[])
+{
+	// Usage: tests [--benchmark] [filter]
+	bool run_benchmarks = false;
+	const char *filter = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--benchmark") == 0)
+			run_benchmarks = true;
+		else
+			filter = argv[i];
+	}
+
+	unsigned int num_tests = 0;
+	unsigned int num_failed_tests = 0;
+
+	for (const reshade::tests::test_case &test : reshade::tests::registered_tests())
+	{
+		if (test.benchmark != run_benchmarks || (filter != nullptr && std::strstr(test.name, filter) == nullptr))
+			continue;
+
+		std::printf("Running %s ...\n", test.name);
+
+		reshade::tests::num_failed_checks = 0;
+		test.func();
+
+		num_tests++;
+		if (reshade::tests::num_failed_checks != 0)
+			num_failed_tests++;
+	}
+
+	std::printf("%u of %u %s passed.\n", num_tests - num_failed_tests, num_tests, run_benchmarks ? "benchmarks" : "tests");
+
+	return num_failed_tests != 0 ? 1 : 0;
+}
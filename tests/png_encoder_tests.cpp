@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "tests.hpp"
+#include "png_encoder.hpp"
+#include "../examples/utils/crc32_hash.hpp"
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <algorithm>
+#include <fpng.h>
+#include <stb_image.h>
+
+static uint32_t read_be32(const uint8_t *data)
+{
+	return (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+static uint32_t compute_adler32(const uint8_t *data, size_t size)
+{
+	uint32_t a = 1, b = 0;
+	for (size_t i = 0; i < size; ++i)
+		a = (a + data[i]) % 65521, b = (b + a) % 65521;
+	return a | (b << 16);
+}
+
+/// <summary>
+/// Checks the checksums 'stb_image' skips when decoding: The CRC-32 of every chunk and the Adler-32 of the inflated zlib stream.
+/// </summary>
+static bool check_png_checksums(const std::vector<uint8_t> &encoded_data)
+{
+	std::vector<uint8_t> zlib_data;
+
+	for (size_t offset = 8; offset < encoded_data.size();)
+	{
+		if (offset + 12 > encoded_data.size())
+			return false;
+		const uint32_t chunk_size = read_be32(encoded_data.data() + offset);
+		if (offset + 12 + chunk_size > encoded_data.size())
+			return false;
+
+		const uint8_t *const chunk_type = encoded_data.data() + offset + 4;
+		if (compute_crc32(chunk_type, 4 + chunk_size) != read_be32(chunk_type + 4 + chunk_size))
+			return false;
+		if (std::memcmp(chunk_type, "IDAT", 4) == 0)
+			zlib_data.insert(zlib_data.end(), chunk_type + 4, chunk_type + 4 + chunk_size);
+
+		offset += 12 + chunk_size;
+	}
+
+	if (zlib_data.size() < 6)
+		return false;
+
+	// Inflate with 'stb_image' as well, which parses the zlib header, but does not verify the Adler-32 checksum at the end
+	int inflated_size = 0;
+	char *const inflated_data = stbi_zlib_decode_malloc(reinterpret_cast<const char *>(zlib_data.data()), static_cast<int>(zlib_data.size()), &inflated_size);
+	if (inflated_data == nullptr)
+		return false;
+
+	const uint32_t adler = compute_adler32(reinterpret_cast<const uint8_t *>(inflated_data), inflated_size);
+	stbi_image_free(inflated_data);
+	return adler == read_be32(zlib_data.data() + zlib_data.size() - 4);
+}
+
+static bool encode_and_decode(reshade::png_encoder &encoder, const std::vector<uint8_t> &pixels, uint32_t width, uint32_t height, uint32_t num_channels)
+{
+	std::vector<uint8_t> encoded_data;
+	if (!encoder.encode(pixels.data(), width, height, num_channels, encoded_data))
+		return false;
+
+	if (!check_png_checksums(encoded_data))
+		return false;
+
+	// Decode with an independent inflater, which fails on any corrupted deflate stream
+	int decoded_width = 0, decoded_height = 0, decoded_channels = 0;
+	stbi_uc *const decoded_pixels = stbi_load_from_memory(encoded_data.data(), static_cast<int>(encoded_data.size()), &decoded_width, &decoded_height, &decoded_channels, static_cast<int>(num_channels));
+	if (decoded_pixels == nullptr)
+		return false;
+
+	const bool equal =
+		static_cast<uint32_t>(decoded_width) == width &&
+		static_cast<uint32_t>(decoded_height) == height &&
+		std::equal(pixels.begin(), pixels.end(), decoded_pixels);
+	stbi_image_free(decoded_pixels);
+	return equal;
+}
+
+static std::vector<uint8_t> make_test_image(uint32_t width, uint32_t height, uint32_t num_channels, uint32_t noise_period, std::mt19937 &rng)
+{
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * num_channels);
+	for (uint32_t y = 0, i = 0; y < height; ++y)
+		for (uint32_t x = 0; x < width * num_channels; ++x, ++i)
+			pixels[i] = (noise_period == 1 || (y / noise_period) % 2 != 0) ? static_cast<uint8_t>(rng()) : static_cast<uint8_t>(x + y);
+	return pixels;
+}
+
+RESHADE_TEST(png_encoder_round_trip)
+{
+	fpng::fpng_init();
+
+	std::mt19937 rng(42);
+
+	for (const uint32_t num_channels : { 3u, 4u })
+	{
+		// Random noise is incompressible, which makes the encoder fall back to stored blocks, which need to stay byte aligned when stripes are stitched together
+		// Alternate between noise and smooth gradients every few rows, so that stored blocks also follow compressed blocks that end in the middle of a byte
+		for (const uint32_t noise_period : { 1u, 7u, 40u })
+		{
+			const uint32_t width = 333, height = 1000;
+			const std::vector<uint8_t> pixels = make_test_image(width, height, num_channels, noise_period, rng);
+
+			for (const uint32_t max_threads : { 1u, 2u, 3u, 7u })
+			{
+				reshade::png_encoder encoder(max_threads);
+				CHECK(encode_and_decode(encoder, pixels, width, height, num_channels));
+			}
+		}
+	}
+}
+
+RESHADE_TEST(png_encoder_shared_between_threads)
+{
+	fpng::fpng_init();
+
+	reshade::png_encoder encoder(4);
+
+	// Several threads encoding at the same time queue their stripes on the same worker threads, and help with each other's stripes while waiting for their own
+	std::atomic<uint32_t> num_failures = 0;
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([&encoder, &num_failures, t]() {
+			std::mt19937 rng(t);
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				const uint32_t width = 97 + t * 31, height = 512 + i * 77;
+				if (!encode_and_decode(encoder, make_test_image(width, height, 4, 7, rng), width, height, 4))
+					num_failures++;
+			}
+		});
+	}
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	CHECK(num_failures == 0);
+}
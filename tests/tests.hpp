@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+namespace reshade::tests
+{
+	struct test_case
+	{
+		const char *name;
+		void(*func)();
+		bool benchmark;
+	};
+
+	/// <summary>
+	/// Gets the list of all tests and benchmarks, which are registered during static initialization via <see cref="RESHADE_TEST"/> and <see cref="RESHADE_BENCHMARK"/>.
+	/// </summary>
+	inline std::vector<test_case> &registered_tests()
+	{
+		static std::vector<test_case> tests;
+		return tests;
+	}
+
+	/// <summary>
+	/// Number of checks that failed in the test that is currently running.
+	/// </summary>
+	inline unsigned int num_failed_checks = 0;
+
+	struct test_registration
+	{
+		test_registration(const char *name, void(*func)(), bool benchmark)
+		{
+			registered_tests().push_back({ name, func, benchmark });
+		}
+	};
+}
+
+#define RESHADE_TEST(name) \
+	static void name(); \
+	static const reshade::tests::test_registration name##_registration(#name, &name, false); \
+	static void name()
+#define RESHADE_BENCHMARK(name) \
+	static void name(); \
+	static const reshade::tests::test_registration name##_registration(#name, &name, true); \
+	static void name()
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+			reshade::tests::num_failed_checks++; \
+		} \
+	} while (false)